@@ -5,6 +5,7 @@
 #include "dpi_memutil.h"
 
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
@@ -14,6 +15,7 @@
 #include <unistd.h>
 #include <vector>
 
+#include "elf_cache.h"
 #include "sv_scoped.h"
 
 namespace {
@@ -59,9 +61,30 @@ class ElfFile {
     }
   }
 
+  // Parse an ELF file whose contents have already been read into memory.
+  // The contents must outlive this object.
+  ElfFile(const std::string &path, std::vector<char> *contents)
+      : path_(path), fd_(-1) {
+    (void)elf_errno();
+    if (elf_version(EV_CURRENT) == EV_NONE) {
+      throw std::runtime_error(elf_errmsg(-1));
+    }
+
+    ptr_ = elf_memory(contents->data(), contents->size());
+    if (!ptr_) {
+      throw ElfError(path, elf_errmsg(-1));
+    }
+
+    if (elf_kind(ptr_) != ELF_K_ELF) {
+      elf_end(ptr_);
+      throw ElfError(path, "not an ELF file.");
+    }
+  }
+
   ~ElfFile() {
     elf_end(ptr_);
-    close(fd_);
+    if (fd_ >= 0)
+      close(fd_);
   }
 
   size_t GetPhdrNum() {
@@ -85,6 +108,37 @@ class ElfFile {
 };
 }  // namespace
 
+// Read the whole of the file at path
+static std::vector<char> ReadFileContents(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw ElfError(path, "could not open file.");
+  }
+
+  std::vector<char> contents;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    contents.reserve(st.st_size);
+  }
+
+  char buf[65536];
+  for (;;) {
+    ssize_t got = read(fd, buf, sizeof buf);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got < 0) {
+      close(fd);
+      throw ElfError(path, "could not read file.");
+    }
+    if (got == 0)
+      break;
+    contents.insert(contents.end(), buf, buf + got);
+  }
+  close(fd);
+
+  return contents;
+}
+
 // Convert a string to a MemImageType, throwing a std::runtime_error
 // if it's not a known name.
 static MemImageType GetMemImageTypeByName(const std::string &name) {
@@ -310,6 +364,10 @@ std::vector<uint8_t> StagedMem::GetFlat() const {
   return ret;
 }
 
+DpiMemUtil::DpiMemUtil() : elf_cache_(new ElfCache(kDefaultElfCacheSize)) {}
+
+DpiMemUtil::~DpiMemUtil() {}
+
 void DpiMemUtil::RegisterMemoryArea(const std::string &name, uint32_t base,
                                     const MemArea *mem_area) {
   assert(mem_area);
@@ -420,8 +478,9 @@ void DpiMemUtil::LoadFileToNamedMem(bool verbose, const std::string &name,
 void DpiMemUtil::LoadElfToMemories(bool verbose, const std::string &filepath) {
   // Load the contents of the ELF file into the staging area
   StageElf(verbose, filepath);
+  assert(staging_area_);
 
-  for (const auto &pr : staging_area_) {
+  for (const auto &pr : staging_area_->mems) {
     const std::string &mem_name = pr.first;
     const StagedMem &staged_mem = pr.second;
 
@@ -453,13 +512,33 @@ void DpiMemUtil::LoadElfToMemories(bool verbose, const std::string &filepath) {
 
 void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
   // Clear out anything that was in the staging area before
-  staging_area_.clear();
+  staging_area_.reset();
+
+  std::vector<char> contents = ReadFileContents(path);
+  uint64_t key = ElfCache::Hash(contents.data(), contents.size(),
+                                HashMemoryLayout());
+
+  // If we've staged a file with these contents before, use the cached image
+  std::shared_ptr<const StagedElf> cached = elf_cache_->Find(key);
+  if (cached) {
+    if (RestoreElfExtra(cached->extra)) {
+      if (verbose) {
+        std::cout << "Using cached segments for ELF file `" << path << "'."
+                  << std::endl;
+      }
+      staging_area_ = cached;
+      return;
+    }
+    elf_cache_->Erase(key);
+  }
 
-  ElfFile elf(path);
+  ElfFile elf(path, &contents);
 
   // Allow subclasses to get at the loaded ELF data if they need it
   OnElfLoaded(elf.ptr_);
 
+  std::shared_ptr<StagedElf> staged(new StagedElf);
+
   size_t file_size;
   const char *file_data = elf_rawfile(elf.ptr_, &file_size);
   assert(file_data);
@@ -514,7 +593,7 @@ void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
 
     // Get the StagedMem object associated with this memory area. If
     // there isn't one, make a new empty one.
-    StagedMem &staged_mem = staging_area_[name];
+    StagedMem &staged_mem = staged->mems[name];
 
     const char *seg_data = file_data + phdr.p_offset;
     std::vector<uint8_t> vec(phdr.p_filesz, 0);
@@ -522,11 +601,38 @@ void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
 
     staged_mem.AddSegment(local_base, std::move(vec));
   }
+
+  SaveElfExtra(&staged->extra);
+
+  staging_area_ = staged;
+  elf_cache_->Insert(key, staging_area_);
+}
+
+void DpiMemUtil::SetElfCacheSize(size_t max_entries) {
+  elf_cache_->SetMaxEntries(max_entries);
+}
+
+void DpiMemUtil::SetElfCacheDir(const std::string &dir) {
+  elf_cache_->SetDir(dir);
 }
 
 const StagedMem &DpiMemUtil::GetMemoryData(const std::string &mem_name) const {
-  auto it = staging_area_.find(mem_name);
-  return (it == staging_area_.end()) ? empty_ : it->second;
+  if (!staging_area_)
+    return empty_;
+
+  auto it = staging_area_->mems.find(mem_name);
+  return (it == staging_area_->mems.end()) ? empty_ : it->second;
+}
+
+uint64_t DpiMemUtil::HashMemoryLayout() const {
+  uint64_t hash = ElfCache::kHashSeed;
+  for (size_t i = 0; i < mem_areas_.size(); ++i) {
+    uint32_t words[3] = {base_addrs_[i], mem_areas_[i]->GetSizeBytes(),
+                         mem_areas_[i]->GetWidthByte()};
+    hash = ElfCache::Hash(names_[i].c_str(), names_[i].size() + 1, hash);
+    hash = ElfCache::Hash(words, sizeof words, hash);
+  }
+  return hash;
 }
 
 size_t DpiMemUtil::GetRegionForSegment(const std::string &path, int seg_idx,
@@ -16,6 +16,8 @@
 // Forward declaration for the Elf type from libelf.
 struct Elf;
 
+class ElfCache;
+
 enum MemImageType {
   kMemImageUnknown = 0,
   kMemImageElf,
@@ -52,6 +54,14 @@ class StagedMem {
   SegMap segs_;
 };
 
+// The staging area for an ELF file: a StagedMem for each memory that the
+// file touches (keyed by memory name), together with any extra data that a
+// subclass of DpiMemUtil saved from the file with SaveElfExtra().
+struct StagedElf {
+  std::map<std::string, StagedMem> mems;
+  std::vector<uint8_t> extra;
+};
+
 /**
  * Provide various memory loading utilities for verilog simulations
  *
@@ -62,7 +72,8 @@ class StagedMem {
  */
 class DpiMemUtil {
  public:
-  virtual ~DpiMemUtil() {}
+  DpiMemUtil();
+  virtual ~DpiMemUtil();
 
   /**
    * Register a memory as instantiated by generic ram
@@ -123,11 +134,29 @@ class DpiMemUtil {
    * Load an ELF file into a staging area in this object, which can then be
    * accessed with GetMemoryData().
    *
+   * Staged images are cached, keyed by the contents of the file. If the same
+   * contents are staged again, the cached image is used and the file is not
+   * parsed again (see SetElfCacheSize() and SetElfCacheDir()).
+   *
    * If the load fails, raises a std::exception with information about what
    * happened.
    */
   void StageElf(bool verbose, const std::string &path);
 
+  /**
+   * Set the number of staged ELF images that are cached in memory. Zero
+   * disables the in-memory cache. The default is kDefaultElfCacheSize.
+   */
+  void SetElfCacheSize(size_t max_entries);
+  static const size_t kDefaultElfCacheSize = 64;
+
+  /**
+   * Set a directory in which to cache staged ELF images on disk, so that they
+   * can be shared between simulations. By default, there is no such
+   * directory. An empty string disables the on-disk cache.
+   */
+  void SetElfCacheDir(const std::string &dir);
+
   /**
    * Get the contents of the staging area by memory name
    */
@@ -141,6 +170,22 @@ class DpiMemUtil {
    */
   virtual void OnElfLoaded(Elf *elf_file) {}
 
+  /**
+   * Hooks for subclasses that use OnElfLoaded, so that their results can be
+   * cached with the staged image.
+   *
+   * SaveElfExtra runs after OnElfLoaded and should serialize whatever it
+   * computed to |out| (using an ElfCacheWriter). When a later StageElf call
+   * finds the image in the cache, it doesn't call OnElfLoaded but calls
+   * RestoreElfExtra with that data instead. This returns false if the data is
+   * malformed, in which case the cache entry is dropped and the ELF file is
+   * parsed again.
+   */
+  virtual void SaveElfExtra(std::vector<uint8_t> *out) const {}
+  virtual bool RestoreElfExtra(const std::vector<uint8_t> &extra) {
+    return true;
+  }
+
  private:
   // Memory area registry. The maps give indices pointing into the vectors
   // (which all have the same number of elements). Note that mem_areas_ does
@@ -156,9 +201,19 @@ class DpiMemUtil {
   // stored in name_to_mem_. We also ensure that every segment in a StagedMem
   // for a memory starts at an address that's aligned for the word width of
   // that memory. Note: we don't also check segments' lengths are aligned.
-  std::map<std::string, StagedMem> staging_area_;
+  //
+  // This is shared with elf_cache_ and is null if nothing is staged.
+  std::shared_ptr<const StagedElf> staging_area_;
   const StagedMem empty_;
 
+  std::unique_ptr<ElfCache> elf_cache_;
+
+  /**
+   * A hash of the registered memories, which is mixed into the keys of
+   * cached images (since the staged segments depend on them).
+   */
+  uint64_t HashMemoryLayout() const;
+
   /**
    * Find the index of a memory area containing the given segment's addresses.
    * Raises a std::exception if none is found.
@@ -32,47 +32,23 @@ void Ecc32MemArea::LoadVmem(const std::string &path) const {
 
 Ecc32MemArea::EccWords Ecc32MemArea::ReadWithIntegrity(
     uint32_t word_offset, uint32_t num_words) const {
-  assert(word_offset + num_words <= num_words_);
-
-  // See MemArea::Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
   EccWords ret;
-  ret.reserve(num_words);
-
-  for (uint32_t i = 0; i < num_words; ++i) {
-    uint32_t src_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(src_word);
-
-    ReadToMinibuf(minibuf, phys_addr);
-    ReadBufferWithIntegrity(ret, minibuf, src_word);
-  }
-
+  ret.reserve((size_t)num_words * (width_byte_ / 4));
+  ReadWords(word_offset, num_words, [&](const uint8_t *buf, uint32_t word) {
+    ReadBufferWithIntegrity(ret, buf, word);
+  });
   return ret;
 }
 
 void Ecc32MemArea::WriteWithIntegrity(uint32_t word_offset,
                                       const EccWords &data) const {
-  // See MemArea::Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
   uint32_t width_32 = width_byte_ / 4;
   uint32_t to_write = data.size() / width_32;
-
   assert((data.size() % width_32) == 0);
-  assert(word_offset + to_write <= num_words_);
 
-  for (uint32_t i = 0; i < to_write; ++i) {
-    uint32_t dst_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(dst_word);
-
-    WriteBufferWithIntegrity(minibuf, data, i * width_32, dst_word);
-    WriteFromMinibuf(phys_addr, minibuf, dst_word);
-  }
+  WriteWords(word_offset, to_write, [&](uint8_t *buf, uint32_t i) {
+    WriteBufferWithIntegrity(buf, data, i * width_32, word_offset + i);
+  });
 }
 
 // Zero enough of the buffer to fill it with a word using insert_bits
@@ -0,0 +1,304 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "elf_cache.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The first bytes of a cache file, which include a format version
+static const char kFileMagic[8] = {'O', 'T', 'S', 'T', 'G', 'E', 'L', '1'};
+
+void ElfCacheWriter::PutU32(uint32_t val) { PutBytes(&val, sizeof val); }
+
+void ElfCacheWriter::PutU64(uint64_t val) { PutBytes(&val, sizeof val); }
+
+void ElfCacheWriter::PutBytes(const void *data, size_t len) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  out_->insert(out_->end(), bytes, bytes + len);
+}
+
+void ElfCacheWriter::PutString(const std::string &str) {
+  PutU32(str.size());
+  PutBytes(str.data(), str.size());
+}
+
+bool ElfCacheReader::GetBytes(const uint8_t **data, size_t len) {
+  if (left_ < len)
+    return false;
+
+  *data = ptr_;
+  ptr_ += len;
+  left_ -= len;
+  return true;
+}
+
+bool ElfCacheReader::GetU32(uint32_t *val) {
+  const uint8_t *data;
+  if (!GetBytes(&data, sizeof *val))
+    return false;
+  memcpy(val, data, sizeof *val);
+  return true;
+}
+
+bool ElfCacheReader::GetU64(uint64_t *val) {
+  const uint8_t *data;
+  if (!GetBytes(&data, sizeof *val))
+    return false;
+  memcpy(val, data, sizeof *val);
+  return true;
+}
+
+bool ElfCacheReader::GetString(std::string *str) {
+  uint32_t len;
+  const uint8_t *data;
+  ElfCacheReader saved = *this;
+  if (!GetU32(&len) || !GetBytes(&data, len)) {
+    *this = saved;
+    return false;
+  }
+  str->assign(reinterpret_cast<const char *>(data), len);
+  return true;
+}
+
+void ElfCache::SetMaxEntries(size_t max_entries) {
+  max_entries_ = max_entries;
+  while (entries_.size() > max_entries_) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+void ElfCache::SetDir(const std::string &dir) {
+  dir_ = dir;
+  if (dir_.empty())
+    return;
+
+  // Create the directory if necessary. Another simulation might be doing the
+  // same thing at the same time, so EEXIST is fine.
+  if (mkdir(dir_.c_str(), 0777) != 0 && errno != EEXIST) {
+    std::cerr << "WARNING: Cannot create ELF cache directory `" << dir_
+              << "': " << strerror(errno) << ". Not caching ELF files on disk."
+              << std::endl;
+    dir_.clear();
+  }
+}
+
+uint64_t ElfCache::Hash(const void *data, size_t len, uint64_t seed) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::shared_ptr<const StagedElf> ElfCache::Find(uint64_t key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    // Move the entry to the front of the LRU list
+    lru_.splice(lru_.begin(), lru_, it->second.second);
+    return it->second.first;
+  }
+
+  if (dir_.empty())
+    return nullptr;
+
+  std::shared_ptr<const StagedElf> image = ReadFile(key);
+  if (image) {
+    Remember(key, image);
+  }
+  return image;
+}
+
+void ElfCache::Insert(uint64_t key,
+                      const std::shared_ptr<const StagedElf> &image) {
+  assert(image);
+  Remember(key, image);
+  if (!dir_.empty()) {
+    WriteFile(key, *image);
+  }
+}
+
+void ElfCache::Erase(uint64_t key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.erase(it->second.second);
+    entries_.erase(it);
+  }
+  if (!dir_.empty()) {
+    unlink(FilePath(key).c_str());
+  }
+}
+
+void ElfCache::Remember(uint64_t key,
+                        const std::shared_ptr<const StagedElf> &image) {
+  if (!max_entries_)
+    return;
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    it->second.first = image;
+    lru_.splice(lru_.begin(), lru_, it->second.second);
+    return;
+  }
+
+  if (entries_.size() >= max_entries_) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(key);
+  entries_.emplace(key, Entry(image, lru_.begin()));
+}
+
+// A cache file has the following format, where all integers are in host byte
+// order and strings are a 32-bit length followed by that many bytes:
+//
+//   magic (8 bytes)
+//   key (64 bits)
+//   extra data (string)
+//   number of memories (32 bits)
+//   for each memory:
+//     name (string)
+//     number of segments (32 bits)
+//     for each segment:
+//       offset (32 bits)
+//       data (string)
+std::vector<uint8_t> ElfCache::Encode(uint64_t key, const StagedElf &image) {
+  std::vector<uint8_t> ret;
+  ElfCacheWriter writer(&ret);
+
+  writer.PutBytes(kFileMagic, sizeof kFileMagic);
+  writer.PutU64(key);
+  writer.PutU32(image.extra.size());
+  writer.PutBytes(image.extra.data(), image.extra.size());
+  writer.PutU32(image.mems.size());
+  for (const auto &pr : image.mems) {
+    const StagedMem::SegMap &segs = pr.second.GetSegs();
+    writer.PutString(pr.first);
+    writer.PutU32(segs.size());
+    for (const auto &seg_pr : segs) {
+      writer.PutU32(seg_pr.first.lo);
+      writer.PutU32(seg_pr.second.size());
+      writer.PutBytes(seg_pr.second.data(), seg_pr.second.size());
+    }
+  }
+  return ret;
+}
+
+std::shared_ptr<StagedElf> ElfCache::Decode(uint64_t key, const uint8_t *data,
+                                            size_t len) {
+  ElfCacheReader reader(data, len);
+  std::shared_ptr<StagedElf> image(new StagedElf);
+
+  const uint8_t *magic;
+  uint64_t file_key;
+  if (!reader.GetBytes(&magic, sizeof kFileMagic) ||
+      memcmp(magic, kFileMagic, sizeof kFileMagic) ||
+      !reader.GetU64(&file_key) || file_key != key)
+    return nullptr;
+
+  uint32_t extra_len, num_mems;
+  const uint8_t *extra;
+  if (!reader.GetU32(&extra_len) || !reader.GetBytes(&extra, extra_len) ||
+      !reader.GetU32(&num_mems))
+    return nullptr;
+  image->extra.assign(extra, extra + extra_len);
+
+  for (uint32_t i = 0; i < num_mems; ++i) {
+    std::string name;
+    uint32_t num_segs;
+    if (!reader.GetString(&name) || !reader.GetU32(&num_segs))
+      return nullptr;
+
+    StagedMem &staged_mem = image->mems[name];
+    for (uint32_t j = 0; j < num_segs; ++j) {
+      uint32_t offset, seg_len;
+      const uint8_t *seg_data;
+      if (!reader.GetU32(&offset) || !reader.GetU32(&seg_len) ||
+          !reader.GetBytes(&seg_data, seg_len))
+        return nullptr;
+
+      // A segment that would wrap around the address space is malformed
+      if (seg_len && offset + (seg_len - 1) < offset)
+        return nullptr;
+
+      staged_mem.AddSegment(
+          offset, std::vector<uint8_t>(seg_data, seg_data + seg_len));
+    }
+  }
+
+  if (!reader.AtEnd())
+    return nullptr;
+
+  return image;
+}
+
+std::string ElfCache::FilePath(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof name, "/%016llx.stgelf", (unsigned long long)key);
+  return dir_ + name;
+}
+
+std::shared_ptr<StagedElf> ElfCache::ReadFile(uint64_t key) const {
+  std::string path = FilePath(key);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  std::shared_ptr<StagedElf> image;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      image = Decode(key, static_cast<const uint8_t *>(data), st.st_size);
+      munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+  return image;
+}
+
+void ElfCache::WriteFile(uint64_t key, const StagedElf &image) const {
+  std::string path = FilePath(key);
+  std::vector<uint8_t> contents = Encode(key, image);
+
+  // Write to a temporary file and then rename it into place, so that another
+  // simulation reading the cache never sees a partly written file.
+  std::ostringstream tmp_oss;
+  tmp_oss << path << ".tmp" << getpid();
+  std::string tmp_path = tmp_oss.str();
+
+  bool ok = false;
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd >= 0) {
+    size_t done = 0;
+    while (done < contents.size()) {
+      ssize_t written =
+          write(fd, contents.data() + done, contents.size() - done);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      done += written;
+    }
+    ok = (close(fd) == 0) && (done == contents.size()) &&
+         (rename(tmp_path.c_str(), path.c_str()) == 0);
+  }
+
+  if (!ok) {
+    std::cerr << "WARNING: Failed to write ELF cache file `" << path
+              << "': " << strerror(errno) << "." << std::endl;
+    unlink(tmp_path.c_str());
+  }
+}
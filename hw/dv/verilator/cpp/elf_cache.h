@@ -0,0 +1,141 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_ELF_CACHE_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_ELF_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dpi_memutil.h"
+
+/**
+ * Serialize data for a cached ELF image
+ *
+ * Values are appended to a byte vector in host byte order. The cache files
+ * are only ever read back by the machine that wrote them, so there is no need
+ * for a portable encoding.
+ */
+class ElfCacheWriter {
+ public:
+  ElfCacheWriter(std::vector<uint8_t> *out) : out_(out) {}
+
+  void PutU32(uint32_t val);
+  void PutU64(uint64_t val);
+  void PutBytes(const void *data, size_t len);
+  void PutString(const std::string &str);
+
+ private:
+  std::vector<uint8_t> *out_;
+};
+
+/**
+ * Deserialize data written by ElfCacheWriter
+ *
+ * The Get functions return false (and don't touch their output argument) if
+ * there isn't enough data left.
+ */
+class ElfCacheReader {
+ public:
+  ElfCacheReader(const uint8_t *data, size_t len) : ptr_(data), left_(len) {}
+
+  bool GetU32(uint32_t *val);
+  bool GetU64(uint64_t *val);
+  bool GetString(std::string *str);
+
+  // Point *data at the next len bytes and skip over them
+  bool GetBytes(const uint8_t **data, size_t len);
+
+  bool AtEnd() const { return left_ == 0; }
+
+ private:
+  const uint8_t *ptr_;
+  size_t left_;
+};
+
+/**
+ * A cache of staged ELF images
+ *
+ * Images are keyed by a hash of the contents of the ELF file and of the
+ * memory layout that they were staged for (see Hash()). The most recently
+ * used images are kept in memory. If a directory has been set with SetDir(),
+ * images are also written to files in that directory, so that other
+ * simulations that load the same ELF file can read them back with a single
+ * mmap rather than parsing the ELF file again.
+ *
+ * Problems with the cache directory are not fatal: a file that can't be read
+ * or is malformed is treated as a miss and a file that can't be written is
+ * skipped with a warning.
+ */
+class ElfCache {
+ public:
+  ElfCache(size_t max_entries) : max_entries_(max_entries) {}
+
+  /**
+   * Set the number of images that are kept in memory. Zero disables the
+   * in-memory cache.
+   */
+  void SetMaxEntries(size_t max_entries);
+
+  /**
+   * Set the directory for cache files. An empty string disables the on-disk
+   * cache. The directory is created if it doesn't exist.
+   */
+  void SetDir(const std::string &dir);
+
+  /**
+   * A 64-bit FNV-1a hash of len bytes at data, starting from seed. Use
+   * kHashSeed as a seed for the first call.
+   */
+  static uint64_t Hash(const void *data, size_t len, uint64_t seed);
+  static const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+  /**
+   * Look up the image with the given key in memory and then in the cache
+   * directory. Returns null if there isn't one.
+   */
+  std::shared_ptr<const StagedElf> Find(uint64_t key);
+
+  /**
+   * Add an image to the cache, writing it to the cache directory if there is
+   * one.
+   */
+  void Insert(uint64_t key, const std::shared_ptr<const StagedElf> &image);
+
+  /**
+   * Drop the image with the given key from memory and from the cache
+   * directory.
+   */
+  void Erase(uint64_t key);
+
+  // Convert between a staged image and the format of a cache file. Decode
+  // returns null if the data is malformed or isn't for the given key.
+  static std::vector<uint8_t> Encode(uint64_t key, const StagedElf &image);
+  static std::shared_ptr<StagedElf> Decode(uint64_t key, const uint8_t *data,
+                                           size_t len);
+
+ private:
+  // Add image to the in-memory cache, evicting the least recently used image
+  // if it is full.
+  void Remember(uint64_t key, const std::shared_ptr<const StagedElf> &image);
+
+  std::string FilePath(uint64_t key) const;
+  std::shared_ptr<StagedElf> ReadFile(uint64_t key) const;
+  void WriteFile(uint64_t key, const StagedElf &image) const;
+
+  size_t max_entries_;
+  std::string dir_;
+
+  // The cached images and the order in which they were used (most recent
+  // first). Each entry in entries_ holds its position in lru_.
+  typedef std::list<uint64_t> LruList;
+  typedef std::pair<std::shared_ptr<const StagedElf>, LruList::iterator> Entry;
+  std::map<uint64_t, Entry> entries_;
+  LruList lru_;
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_ELF_CACHE_H_
@@ -14,66 +14,115 @@
 // DPI exports, defined in prim_util_memload.svh
 extern "C" {
 void simutil_memload(const char *file);
-int simutil_set_mem(int index, const svBitVecVal *val);
-int simutil_get_mem(int index, svBitVecVal *val);
+int simutil_set_mem_block(int index, int num_rows, const svBitVecVal *vals);
+int simutil_get_mem_block(int index, int num_rows, svBitVecVal *vals);
 }
 
+static MemArea::StorageFinder storage_finder = nullptr;
+
 MemArea::MemArea(const std::string &scope, uint32_t num_words,
                  uint32_t width_byte)
-    : scope_(scope), num_words_(num_words), width_byte_(width_byte) {
+    : scope_(scope),
+      num_words_(num_words),
+      width_byte_(width_byte),
+      storage_looked_up_(false),
+      has_storage_(false) {
   assert(0 < num_words);
   assert(width_byte <= SV_MEM_WIDTH_BYTES);
 }
 
+void MemArea::SetStorageFinder(StorageFinder finder) {
+  storage_finder = finder;
+}
+
 void MemArea::Write(uint32_t word_offset,
                     const std::vector<uint8_t> &data) const {
-  // This "mini buffer" is used to transfer each write to SystemVerilog.
-  // `simutil_set_mem` takes a fixed SV_MEM_WIDTH_BITS-bit vector but it will
-  // only use the bits required for the RAM width. As an example, for a 32-bit
-  // wide RAM only elements 3:0 of `minibuf` will be written to memory. Since
-  // the simulator may still read bits from minibuf it does not use, we must
-  // use a fixed allocation of the full bit vector size to avoid an out of
-  // bounds access.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
   uint32_t data_words = (data.size() + width_byte_ - 1) / width_byte_;
-  assert(word_offset + data_words <= num_words_);
-
-  for (uint32_t i = 0; i < data_words; ++i) {
-    uint32_t dst_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(dst_word);
-
-    WriteBuffer(minibuf, data, i * width_byte_, dst_word);
-    WriteFromMinibuf(phys_addr, minibuf, dst_word);
-  }
+  WriteWords(word_offset, data_words, [&](uint8_t *buf, uint32_t i) {
+    WriteBuffer(buf, data, i * width_byte_, word_offset + i);
+  });
 }
 
 std::vector<uint8_t> MemArea::Read(uint32_t word_offset,
                                    uint32_t num_words) const {
-  assert(word_offset + num_words <= num_words_);
+  std::vector<uint8_t> ret;
+  ret.reserve((size_t)width_byte_ * num_words);
+  ReadWords(word_offset, num_words, [&](const uint8_t *buf, uint32_t word) {
+    ReadBuffer(ret, buf, word);
+  });
+  return ret;
+}
 
-  uint32_t num_bytes = width_byte_ * num_words;
-  assert(num_words <= num_bytes);
+void MemArea::WriteWords(
+    uint32_t word_offset, uint32_t num_words,
+    const std::function<void(uint8_t *buf, uint32_t i)> &fill_row) const {
+  // This buffer is used to transfer each block of rows to SystemVerilog.
+  // `simutil_set_mem_block` takes an array of SV_MEM_BLOCK_ROWS fixed
+  // SV_MEM_WIDTH_BITS-bit vectors but it will only use the rows that it is
+  // asked to write and the bits required for the RAM width. As an example, for
+  // a 32-bit wide RAM only bytes 3:0 of each row will be written to memory.
+  // Since the simulator may still read bits from rows it does not use, we must
+  // use a fixed allocation of the full array size to avoid an out of bounds
+  // access.
+  uint8_t rows[SV_MEM_BLOCK_ROWS * SV_MEM_WIDTH_BYTES];
+  memset(rows, 0, sizeof rows);
+  assert(width_byte_ <= SV_MEM_WIDTH_BYTES);
+  assert(word_offset + num_words <= num_words_);
 
-  // See Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
+  if (num_words) {
+    BeginAccess();
+  }
 
-  std::vector<uint8_t> ret;
-  ret.reserve(num_bytes);
+  // Write runs of words with consecutive physical addresses as a block
+  uint32_t i = 0;
+  while (i < num_words) {
+    uint32_t first_word = word_offset + i;
+    uint32_t phys_addr = ToPhysAddr(first_word);
+
+    uint32_t num_rows = 0;
+    do {
+      fill_row(&rows[num_rows * SV_MEM_WIDTH_BYTES], i + num_rows);
+      ++num_rows;
+    } while (i + num_rows < num_words && num_rows < SV_MEM_BLOCK_ROWS &&
+             ToPhysAddr(first_word + num_rows) == phys_addr + num_rows);
+
+    WriteRows(phys_addr, num_rows, rows, first_word);
+    i += num_rows;
+  }
+}
 
-  for (uint32_t i = 0; i < num_words; ++i) {
-    uint32_t src_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(src_word);
+void MemArea::ReadWords(
+    uint32_t word_offset, uint32_t num_words,
+    const std::function<void(const uint8_t *buf, uint32_t word)> &take_row)
+    const {
+  // See WriteWords for an explanation for this buffer.
+  uint8_t rows[SV_MEM_BLOCK_ROWS * SV_MEM_WIDTH_BYTES];
+  memset(rows, 0, sizeof rows);
+  assert(width_byte_ <= SV_MEM_WIDTH_BYTES);
+  assert(word_offset + num_words <= num_words_);
 
-    ReadToMinibuf(minibuf, phys_addr);
-    ReadBuffer(ret, minibuf, src_word);
+  if (num_words) {
+    BeginAccess();
   }
 
-  return ret;
+  // Read runs of words with consecutive physical addresses as a block
+  uint32_t i = 0;
+  while (i < num_words) {
+    uint32_t first_word = word_offset + i;
+    uint32_t phys_addr = ToPhysAddr(first_word);
+
+    uint32_t num_rows = 1;
+    while (i + num_rows < num_words && num_rows < SV_MEM_BLOCK_ROWS &&
+           ToPhysAddr(first_word + num_rows) == phys_addr + num_rows) {
+      ++num_rows;
+    }
+
+    ReadRows(rows, phys_addr, num_rows);
+    for (uint32_t j = 0; j < num_rows; ++j) {
+      take_row(&rows[j * SV_MEM_WIDTH_BYTES], first_word + j);
+    }
+    i += num_rows;
+  }
 }
 
 void MemArea::LoadVmem(const std::string &path) const {
@@ -101,23 +150,68 @@ void MemArea::ReadBuffer(std::vector<uint8_t> &data,
               std::back_inserter(data));
 }
 
-void MemArea::ReadToMinibuf(uint8_t *minibuf, uint32_t phys_addr) const {
-  SVScoped scoped(scope_);
-  if (!simutil_get_mem(phys_addr, (svBitVecVal *)minibuf)) {
-    std::ostringstream oss;
-    oss << "Could not read memory word at physical index 0x" << std::hex
-        << phys_addr << ".";
-    throw std::runtime_error(oss.str());
+void MemArea::ReadRows(uint8_t *rows, uint32_t phys_addr,
+                       uint32_t num_rows) const {
+  assert(0 < num_rows && num_rows <= SV_MEM_BLOCK_ROWS);
+
+  const MemAreaStorage *storage = GetStorage();
+  if (!storage) {
+    SVScoped scoped(scope_);
+    if (simutil_get_mem_block(phys_addr, num_rows, (svBitVecVal *)rows)) {
+      return;
+    }
+  } else if ((uint64_t)phys_addr + num_rows <= storage->num_rows) {
+    uint32_t row_bytes = (storage->width + 7) / 8;
+    for (uint32_t i = 0; i < num_rows; ++i) {
+      uint8_t *row = &rows[i * SV_MEM_WIDTH_BYTES];
+      memcpy(row, storage->data + (phys_addr + i) * storage->row_stride,
+             row_bytes);
+      memset(row + row_bytes, 0, SV_MEM_WIDTH_BYTES - row_bytes);
+    }
+    return;
+  }
+
+  std::ostringstream oss;
+  oss << "Could not read " << num_rows
+      << " memory words at physical index 0x" << std::hex << phys_addr << ".";
+  throw std::runtime_error(oss.str());
+}
+
+void MemArea::WriteRows(uint32_t phys_addr, uint32_t num_rows,
+                        const uint8_t *rows, uint32_t dst_word) const {
+  assert(0 < num_rows && num_rows <= SV_MEM_BLOCK_ROWS);
+
+  const MemAreaStorage *storage = GetStorage();
+  if (!storage) {
+    SVScoped scoped(scope_);
+    if (simutil_set_mem_block(phys_addr, num_rows,
+                              (const svBitVecVal *)rows)) {
+      return;
+    }
+  } else if ((uint64_t)phys_addr + num_rows <= storage->num_rows) {
+    // Copy the bytes that hold the row and clear any bits above its width,
+    // as the simulator expects.
+    uint32_t row_bytes = (storage->width + 7) / 8;
+    uint8_t top_mask = 0xff >> ((8 - storage->width % 8) % 8);
+    for (uint32_t i = 0; i < num_rows; ++i) {
+      uint8_t *dst = storage->data + (phys_addr + i) * storage->row_stride;
+      memcpy(dst, &rows[i * SV_MEM_WIDTH_BYTES], row_bytes);
+      dst[row_bytes - 1] &= top_mask;
+      memset(dst + row_bytes, 0, storage->row_stride - row_bytes);
+    }
+    return;
   }
+
+  std::ostringstream oss;
+  oss << "Could not set " << num_rows << " memory words at byte offset 0x"
+      << std::hex << dst_word * width_byte_ << ".";
+  throw std::runtime_error(oss.str());
 }
 
-void MemArea::WriteFromMinibuf(uint32_t phys_addr, const uint8_t *minibuf,
-                               uint32_t dst_word) const {
-  SVScoped scoped(scope_);
-  if (!simutil_set_mem(phys_addr, (const svBitVecVal *)minibuf)) {
-    std::ostringstream oss;
-    oss << "Could not set memory at byte offset 0x" << std::hex
-        << dst_word * width_byte_ << ".";
-    throw std::runtime_error(oss.str());
+const MemAreaStorage *MemArea::GetStorage() const {
+  if (!storage_looked_up_) {
+    has_storage_ = storage_finder && storage_finder(scope_, &storage_);
+    storage_looked_up_ = true;
   }
+  return has_storage_ ? &storage_ : nullptr;
 }
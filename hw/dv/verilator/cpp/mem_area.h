@@ -6,6 +6,7 @@
 #define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_AREA_H_
 
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,27 @@
 // using the svBitVecVal type, we have to round up to the next 32-bit word.
 #define SV_MEM_WIDTH_BYTES (4 * ((SV_MEM_WIDTH_BITS + 31) / 32))
 
+// This is the maximum number of rows that are transferred by a single call to
+// simutil_set_mem_block or simutil_get_mem_block in prim_util_memload.svh. The
+// rows are passed as an array of svBitVecVal bit vectors of
+// SV_MEM_WIDTH_BYTES bytes each.
+#define SV_MEM_BLOCK_ROWS 64
+
+/**
+ * Direct access to the storage of a memory in the simulated design
+ *
+ * Some simulators (like Verilator) store each memory as a plain array, which
+ * can be read and written without going through DPI if it is made visible to
+ * C++ code. Row i of the memory is at <tt>data + i * row_stride</tt>, with its
+ * bytes in little-endian order. Bits above \c width must be zero.
+ */
+struct MemAreaStorage {
+  uint8_t *data;        ///< Start of row 0
+  uint32_t row_stride;  ///< Offset in bytes between consecutive rows
+  uint32_t num_rows;    ///< Number of rows in the memory
+  uint32_t width;       ///< Width of each row in bits
+};
+
 /**
  * A "memory area", representing a memory in the simulated design.
  */
@@ -39,11 +61,31 @@ class MemArea {
 
   virtual ~MemArea() {}
 
+  /** A function that finds the storage of the memory at a SystemVerilog
+   * scope. If it can be accessed directly, this fills in \p storage and returns
+   * true. Otherwise it returns false.
+   */
+  typedef bool (*StorageFinder)(const std::string &scope,
+                                MemAreaStorage *storage);
+
+  /** Set the function used to find the storage of each memory
+   *
+   * A simulator-specific wrapper (like VerilatorMemUtil) can call this to give
+   * every memory area a faster path than DPI. Each memory area calls the
+   * function once, on its first access. By default, there is no such function
+   * and all accesses go through DPI.
+   */
+  static void SetStorageFinder(StorageFinder finder);
+
   /** Write data to this memory area at the given word offset
+   *
+   * Words whose physical addresses are consecutive are written to the memory
+   * as a block, with one call to \c simutil_set_mem_block (or directly, if the
+   * storage of the memory is visible).
    *
    * This assumes that the result will fit in the memory. If the scope cannot
-   * be set, this throws an SVScoped::Error. If a call to \c simutil_set_mem
-   * fails, this throws a \c std::runtime_error.
+   * be set, this throws an SVScoped::Error. If a call to \c
+   * simutil_set_mem_block fails, this throws a \c std::runtime_error.
    *
    * @param word_offset The offset, in words, of the first word that should be
    *                    written.
@@ -59,9 +101,10 @@ class MemArea {
    *
    * This assumes that there are <tt>word_offset + num_words</tt> words in the
    * memory. Returns a vector with <tt>num_words * width_byte_</tt> elements.
+   * Like Write(), this reads consecutive physical rows as a block.
    *
    * If the scope cannot be set, this throws an SVScoped::Error. If a call to
-   * simutil_get_mem fails, this throws a std::runtime_error.
+   * simutil_get_mem_block fails, this throws a std::runtime_error.
    *
    * @param word_offset The offset, in words, of the first word that should be
    *                    written.
@@ -85,6 +128,16 @@ class MemArea {
   uint32_t num_words_;   ///< Size of the memory area in words
   uint32_t width_byte_;  ///< Size of each word in bytes
 
+  /** Prepare for an access to the memory
+   *
+   * This is called once at the start of each non-empty read or write, before
+   * any of the per-word hooks below. The default implementation does nothing.
+   * Memories whose per-word transformations depend on state in the design
+   * (like a scrambling key) can read that state here once, rather than for
+   * every word.
+   */
+  virtual void BeginAccess() const {}
+
   /** Write to buf with the data that should be copied to the physical memory
    * for a single memory word.
    *
@@ -131,20 +184,52 @@ class MemArea {
     return logical_addr;
   }
 
-  /** Read the memory word at phys_addr into minibuf
+  /** Write num_words words, starting at logical address word_offset
+   *
+   * This calls BeginAccess() and then fill_row(buf, i) for each word, where i
+   * counts from zero. fill_row should fill buf (SV_MEM_WIDTH_BYTES long) with
+   * the physical row for word <tt>word_offset + i</tt>. Rows with consecutive
+   * physical addresses are written as a block with WriteRows().
+   */
+  void WriteWords(
+      uint32_t word_offset, uint32_t num_words,
+      const std::function<void(uint8_t *buf, uint32_t i)> &fill_row) const;
+
+  /** Read num_words words, starting at logical address word_offset
+   *
+   * This is the counterpart of WriteWords(). It reads the rows in blocks with
+   * ReadRows() and then calls take_row(buf, word) for each word in order,
+   * where buf holds the physical row for the word at logical address word.
+   */
+  void ReadWords(uint32_t word_offset, uint32_t num_words,
+                 const std::function<void(const uint8_t *buf, uint32_t word)>
+                     &take_row) const;
+
+  /** Read num_rows consecutive rows, starting at phys_addr, into rows
+   *
+   * rows holds SV_MEM_WIDTH_BYTES bytes for each row and num_rows must be at
+   * most SV_MEM_BLOCK_ROWS.
+   */
+  void ReadRows(uint8_t *rows, uint32_t phys_addr, uint32_t num_rows) const;
+
+  /** Write num_rows consecutive rows, starting at phys_addr, from rows
    *
-   * minibuf should be at least SV_MEM_WIDTH_BYTES in size. See the
-   * implementation of MemArea::Write() for the details.
+   * rows is laid out as for ReadRows(). dst_word is the logical address of the
+   * first row, which is used for error messages.
    */
-  void ReadToMinibuf(uint8_t *minibuf, uint32_t phys_addr) const;
+  void WriteRows(uint32_t phys_addr, uint32_t num_rows, const uint8_t *rows,
+                 uint32_t dst_word) const;
 
-  /** Write from minibuf to the memory word at phys_addr
+ private:
+  /** The storage of the memory, or null if it can't be accessed directly
    *
-   * minibuf should be at least SV_MEM_WIDTH_BYTES in size. See the
-   * implementation of MemArea::Write() for the details.
+   * This calls the storage finder the first time it is used.
    */
-  void WriteFromMinibuf(uint32_t phys_addr, const uint8_t *minibuf,
-                        uint32_t dst_word) const;
+  const MemAreaStorage *GetStorage() const;
+
+  mutable bool storage_looked_up_;  ///< True if GetStorage() has been called
+  mutable bool has_storage_;        ///< True if storage_ is valid
+  mutable MemAreaStorage storage_;
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_AREA_H_
@@ -12,6 +12,11 @@
 #include "scramble_model.h"
 #include "sv_scoped.h"
 
+// A value in phys_addrs_ for a word whose physical address hasn't been
+// computed yet. This can't be a real address, because the number of words in
+// a memory fits in a uint32_t.
+static const uint32_t kNoPhysAddr = ~0u;
+
 // This is the maximum width of a nonce that's supported by the code in
 // prim_util_get_scramble_key_nonce.svh
 static const uint32_t kScrMaxNonceWidth = 320;
@@ -159,13 +164,46 @@ void ScrambledEcc32MemArea::WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
   ScrambleBuffer(buf, dst_word);
 }
 
+void ScrambledEcc32MemArea::BeginAccess() const {
+  std::vector<uint8_t> key = GetScrambleKey();
+  std::vector<uint8_t> nonce = GetScrambleNonce();
+  if (key == key_ && nonce == nonce_) {
+    return;
+  }
+
+  key_.swap(key);
+  nonce_.swap(nonce);
+  phys_addrs_.assign(GetSizeWords(), kNoPhysAddr);
+  keystreams_.resize((size_t)GetSizeWords() * GetPhysWidthByte());
+  have_keystream_.assign(GetSizeWords(), false);
+}
+
+void ScrambledEcc32MemArea::ApplyKeystream(uint8_t *buf, uint32_t word) const {
+  assert(word < have_keystream_.size() && "BeginAccess() not called");
+
+  uint32_t phys_width_byte = GetPhysWidthByte();
+  uint8_t *keystream = &keystreams_[(size_t)word * phys_width_byte];
+
+  if (!have_keystream_[word]) {
+    // With the S&P layer disabled, encrypting zero gives the keystream.
+    std::vector<uint8_t> ks = scramble_encrypt_data(
+        std::vector<uint8_t>(phys_width_byte, 0), GetPhysWidth(), 39,
+        AddrIntToBytes(word, addr_width_), addr_width_, nonce_, key_,
+        repeat_keystream_, false);
+    std::copy(ks.begin(), ks.end(), keystream);
+    have_keystream_[word] = true;
+  }
+
+  for (uint32_t i = 0; i < phys_width_byte; ++i) {
+    buf[i] ^= keystream[i];
+  }
+}
+
 std::vector<uint8_t> ScrambledEcc32MemArea::ReadUnscrambled(
     const uint8_t buf[SV_MEM_WIDTH_BYTES], uint32_t src_word) const {
-  std::vector<uint8_t> scrambled_data(buf, buf + GetPhysWidthByte());
-  return scramble_decrypt_data(scrambled_data, GetPhysWidth(), 39,
-                               AddrIntToBytes(src_word, addr_width_),
-                               addr_width_, GetScrambleNonce(),
-                               GetScrambleKey(), repeat_keystream_, false);
+  std::vector<uint8_t> unscrambled_data(buf, buf + GetPhysWidthByte());
+  ApplyKeystream(&unscrambled_data[0], src_word);
+  return unscrambled_data;
 }
 
 void ScrambledEcc32MemArea::ReadBuffer(std::vector<uint8_t> &data,
@@ -192,21 +230,19 @@ void ScrambledEcc32MemArea::WriteBufferWithIntegrity(
 
 void ScrambledEcc32MemArea::ScrambleBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
                                            uint32_t dst_word) const {
-  std::vector<uint8_t> scramble_buf(buf, buf + GetPhysWidthByte());
-
   // Scramble data with integrity
-  scramble_buf = scramble_encrypt_data(
-      scramble_buf, GetPhysWidth(), 39, AddrIntToBytes(dst_word, addr_width_),
-      addr_width_, GetScrambleNonce(), GetScrambleKey(), repeat_keystream_,
-      false);
-
-  // Copy scrambled data to write buffer
-  std::copy(scramble_buf.begin(), scramble_buf.end(), &buf[0]);
+  ApplyKeystream(buf, dst_word);
 }
 
 uint32_t ScrambledEcc32MemArea::ToPhysAddr(uint32_t logical_addr) const {
-  // Scramble logical address to get physical address
-  return AddrBytesToInt(scramble_addr(AddrIntToBytes(logical_addr, addr_width_),
-                                      addr_width_, GetScrambleNonce(),
-                                      GetNonceWidth()));
+  assert(logical_addr < phys_addrs_.size() && "BeginAccess() not called");
+
+  uint32_t &phys_addr = phys_addrs_[logical_addr];
+  if (phys_addr == kNoPhysAddr) {
+    // Scramble logical address to get physical address
+    phys_addr = AddrBytesToInt(
+        scramble_addr(AddrIntToBytes(logical_addr, addr_width_), addr_width_,
+                      nonce_, GetNonceWidth()));
+  }
+  return phys_addr;
 }
@@ -32,6 +32,14 @@ class ScrambledEcc32MemArea : public Ecc32MemArea {
   ScrambledEcc32MemArea(const std::string &scope, uint32_t size,
                         uint32_t width_32, bool repeat_keystream = true);
 
+ protected:
+  /**
+   * Read the scrambling key and nonce from the design. If either has changed
+   * since the last access, this throws away the addresses and keystreams
+   * that were computed from the old values.
+   */
+  void BeginAccess() const override;
+
  private:
   void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
                    const std::vector<uint8_t> &data, size_t start_idx,
@@ -65,9 +73,23 @@ class ScrambledEcc32MemArea : public Ecc32MemArea {
   std::vector<uint8_t> GetScrambleKey() const;
   std::vector<uint8_t> GetScrambleNonce() const;
 
+  // XOR the first GetPhysWidthByte() bytes of buf with the keystream for the
+  // memory word at word. Since we don't use the S&P layer, this both
+  // scrambles and unscrambles.
+  void ApplyKeystream(uint8_t *buf, uint32_t word) const;
+
   std::string scr_scope_;
   uint32_t addr_width_;
   bool repeat_keystream_;
+
+  // The key and nonce that BeginAccess last read from the design, together
+  // with the physical address and keystream of each word, which are computed
+  // from them on first use. These stay valid until the key or nonce changes,
+  // so repeated loads of the same memory don't need to run PRINCE again.
+  mutable std::vector<uint8_t> key_, nonce_;
+  mutable std::vector<uint32_t> phys_addrs_;
+  mutable std::vector<uint8_t> keystreams_;
+  mutable std::vector<bool> have_keystream_;
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_SCRAMBLED_ECC32_MEM_AREA_H_
@@ -11,6 +11,9 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <svdpi.h>
+#include <verilated.h>
+#include <verilated_syms.h>
 #include <vector>
 
 namespace {
@@ -62,6 +65,45 @@ static LoadArg ParseMemArg(std::string mem_argument) {
   return {.name = args[0], .filepath = args[1], .type = type};
 }
 
+// Find the storage of the memory at scope: the `mem` array that
+// prim_util_memload.svh requires. Verilator only makes this visible to C++ if
+// it is public (see memutil_verilator.vlt). Otherwise, return false and let
+// MemArea use DPI.
+static bool FindVerilatedStorage(const std::string &scope,
+                                 MemAreaStorage *storage) {
+  // Verilator's svScope is a pointer to the VerilatedScope
+  const VerilatedScope *vl_scope =
+      static_cast<const VerilatedScope *>(svGetScopeFromName(scope.c_str()));
+  if (!vl_scope)
+    return false;
+
+  const VerilatedVar *var = vl_scope->varFind("mem");
+  if (!var || !var->isPublicRW() || var->udims() != 1 ||
+      var->unpacked().low() != 0)
+    return false;
+
+  switch (var->vltype()) {
+    case VLVT_UINT8:
+    case VLVT_UINT16:
+    case VLVT_UINT32:
+    case VLVT_UINT64:
+    case VLVT_WDATA:
+      break;
+    default:
+      return false;
+  }
+
+  int width = var->packed().elements();
+  if (width <= 0 || width > SV_MEM_WIDTH_BITS)
+    return false;
+
+  storage->data = static_cast<uint8_t *>(var->datap());
+  storage->row_stride = var->entSize();
+  storage->num_rows = var->unpacked().elements();
+  storage->width = width;
+  return true;
+}
+
 // Print a usage message to stdout
 static void PrintHelp() {
   std::cout << "Simulation memory utilities:\n\n"
@@ -86,10 +128,12 @@ static void PrintHelp() {
 
 VerilatorMemUtil::VerilatorMemUtil() : allocation_(new DpiMemUtil()) {
   mem_util_ = allocation_.get();
+  MemArea::SetStorageFinder(FindVerilatedStorage);
 }
 
 VerilatorMemUtil::VerilatorMemUtil(DpiMemUtil *mem_util) : mem_util_(mem_util) {
   assert(mem_util);
+  MemArea::SetStorageFinder(FindVerilatedStorage);
 }
 
 bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
@@ -7,6 +7,10 @@
 //
 // A wrapper class that converts a DpiMemutil into a SimCtrlExtension
 //
+// Constructing a VerilatorMemUtil also lets every MemArea access the storage
+// of its memory directly, rather than through DPI, where Verilator has made
+// that storage public.
+//
 
 #include <memory>
 
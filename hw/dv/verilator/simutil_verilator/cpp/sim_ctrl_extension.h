@@ -5,6 +5,8 @@
 #ifndef OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
 #define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
 
+#include <string>
+
 class SimCtrlExtension {
  public:
   virtual ~SimCtrlExtension() = default;
@@ -43,6 +45,39 @@ class SimCtrlExtension {
    * Function to be called after executing the simulation
    */
   virtual void PostExec() {}
+
+  /**
+   * Save the extension's state to a checkpoint
+   *
+   * Called when VerilatorSimCtrl saves a checkpoint, after the state of the
+   * Verilated model has been saved. Anything the extension needs to carry on
+   * from the checkpoint (that isn't in the model) should be written to state,
+   * which is stored in the checkpoint file.
+   *
+   * @param state Opaque data, passed to RestoreCheckpoint() when restoring
+   * @return Return code, true == success
+   */
+  virtual bool SaveCheckpoint(std::string &state) { return true; }
+
+  /**
+   * Prepare to restore a checkpoint
+   *
+   * Called when the Verilated model has run its initial blocks, but before
+   * its state has been overwritten by the checkpoint. Extensions can use this
+   * to grab anything created by the initial blocks (like the handles of DPI
+   * objects), which the checkpoint will replace with stale values.
+   */
+  virtual void PreRestoreCheckpoint() {}
+
+  /**
+   * Restore the extension's state from a checkpoint
+   *
+   * Called after the state of the Verilated model has been restored.
+   *
+   * @param state The data that SaveCheckpoint() wrote
+   * @return Return code, true == success
+   */
+  virtual bool RestoreCheckpoint(const std::string &state) { return true; }
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
@@ -0,0 +1,189 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sim_ctrl_stats.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <typeinfo>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+// The name of an extension's class, demangled if possible
+static std::string ExtensionName(const SimCtrlExtension &ext) {
+  const char *mangled = typeid(ext).name();
+#ifdef __GNUG__
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+  if (status == 0 && demangled) {
+    std::string name(demangled);
+    free(demangled);
+    return name;
+  }
+#endif
+  return mangled;
+}
+
+// Format ns nanoseconds with a sensible unit
+static std::string FormatNs(uint64_t ns) {
+  static const char *const units[] = {"ns", "us", "ms", "s"};
+  unsigned unit = 0;
+  uint64_t scale = 1;
+  while (unit < 3 && ns >= scale * 1000) {
+    scale *= 1000;
+    ++unit;
+  }
+  std::ostringstream oss;
+  oss << ns / scale << " " << units[unit];
+  return oss.str();
+}
+
+// Escape str for use in a JSON string
+static std::string JsonEscape(const std::string &str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      ret.push_back('\\');
+      ret.push_back(c);
+    } else if ((unsigned char)c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof buf, "\\u%04x", (unsigned)c);
+      ret += buf;
+    } else {
+      ret.push_back(c);
+    }
+  }
+  return ret;
+}
+
+SimCtrlStats::SimCtrlStats(const std::vector<SimCtrlExtension *> &extensions)
+    : names_({"other", "eval", "trace"}),
+      histogram_(kNumBuckets, 0),
+      in_cycle_(false) {
+  for (const SimCtrlExtension *ext : extensions) {
+    names_.push_back("extension " + ExtensionName(*ext));
+  }
+  ns_.assign(names_.size(), 0);
+}
+
+void SimCtrlStats::Start() {
+  last_ = Clock::now();
+  in_cycle_ = false;
+}
+
+void SimCtrlStats::StartCycle() {
+  Lap(kOther);
+
+  if (in_cycle_) {
+    uint64_t ns = ToNs(last_ - cycle_start_);
+    unsigned bucket = 0;
+    while (bucket + 1 < kNumBuckets && (ns >> (bucket + 1))) {
+      ++bucket;
+    }
+    ++histogram_[bucket];
+  }
+
+  cycle_start_ = last_;
+  in_cycle_ = true;
+}
+
+uint64_t SimCtrlStats::TotalNs() const {
+  uint64_t total = 0;
+  for (uint64_t ns : ns_) {
+    total += ns;
+  }
+  return total;
+}
+
+void SimCtrlStats::Print(std::ostream &os, unsigned long cycles) const {
+  uint64_t total_ns = TotalNs();
+  double total_s = total_ns / 1e9;
+
+  os << std::endl
+     << "Simulation time by component" << std::endl
+     << "============================" << std::endl;
+  if (total_s > 0) {
+    os << "Cycles/s:  " << cycles / total_s << std::endl;
+  }
+
+  for (size_t i = 0; i < names_.size(); ++i) {
+    double pct = total_ns ? 100.0 * ns_[i] / total_ns : 0;
+    os << std::setw(6) << std::fixed << std::setprecision(2) << pct << "%  "
+       << std::setw(10) << FormatNs(ns_[i]);
+    if (cycles) {
+      os << "  " << std::setw(8) << ns_[i] / cycles << " ns/cycle";
+    }
+    os << "  " << names_[i] << std::endl;
+  }
+  os.unsetf(std::ios_base::floatfield);
+
+  uint64_t timed_cycles = 0;
+  unsigned widest = 0;
+  for (unsigned i = 0; i < kNumBuckets; ++i) {
+    timed_cycles += histogram_[i];
+    if (histogram_[i] > histogram_[widest])
+      widest = i;
+  }
+  if (!timed_cycles)
+    return;
+
+  os << std::endl << "Cost per cycle:" << std::endl;
+  for (unsigned i = 0; i < kNumBuckets; ++i) {
+    if (!histogram_[i])
+      continue;
+    unsigned bar = (unsigned)(50 * histogram_[i] / histogram_[widest]);
+    os << std::setw(10) << FormatNs((uint64_t)1 << i) << " - " << std::setw(10)
+       << FormatNs((uint64_t)2 << i) << "  " << std::setw(10) << histogram_[i]
+       << "  " << std::string(bar, '#') << std::endl;
+  }
+}
+
+bool SimCtrlStats::WriteJson(const std::string &path,
+                             unsigned long cycles) const {
+  std::ofstream os(path);
+  if (!os) {
+    std::cerr << "ERROR: Failed to open `" << path
+              << "' for simulation statistics." << std::endl;
+    return false;
+  }
+
+  uint64_t total_ns = TotalNs();
+
+  os << "{\n"
+     << "  \"cycles\": " << cycles << ",\n"
+     << "  \"time_ns\": " << total_ns << ",\n"
+     << "  \"cycles_per_s\": "
+     << (total_ns ? cycles / (total_ns / 1e9) : 0.0) << ",\n"
+     << "  \"components\": [";
+  for (size_t i = 0; i < names_.size(); ++i) {
+    os << (i ? "," : "") << "\n    {\"name\": \"" << JsonEscape(names_[i])
+       << "\", \"time_ns\": " << ns_[i] << "}";
+  }
+  os << "\n  ],\n"
+     << "  \"cycle_cost_histogram\": [";
+  bool first = true;
+  for (unsigned i = 0; i < kNumBuckets; ++i) {
+    if (!histogram_[i])
+      continue;
+    os << (first ? "" : ",") << "\n    {\"min_ns\": " << ((uint64_t)1 << i)
+       << ", \"max_ns\": " << ((uint64_t)2 << i)
+       << ", \"cycles\": " << histogram_[i] << "}";
+    first = false;
+  }
+  os << "\n  ]\n"
+     << "}\n";
+
+  if (!os) {
+    std::cerr << "ERROR: Failed to write simulation statistics to `" << path
+              << "'." << std::endl;
+    return false;
+  }
+  return true;
+}
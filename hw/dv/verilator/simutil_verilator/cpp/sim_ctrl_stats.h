@@ -0,0 +1,93 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_STATS_H_
+#define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+
+/**
+ * Timing statistics for the main loop of VerilatorSimCtrl
+ *
+ * The wall-clock time of the loop is split between a fixed set of
+ * components: the model's eval(), tracing, each registered extension and
+ * "other" (the loop's own bookkeeping). The caller marks the end of each
+ * piece of work with Lap(), which charges the time since the previous lap
+ * to a component, so there is one clock read per piece of work.
+ *
+ * Time spent in DPI functions and other code called by the model is part of
+ * eval().
+ *
+ * The cost of each clock cycle is also collected into a histogram with
+ * power-of-two buckets, which shows whether a slow simulation is uniformly
+ * slow or dominated by a few expensive cycles.
+ */
+class SimCtrlStats {
+ public:
+  /** Components that aren't extensions */
+  enum Component { kOther = 0, kEval = 1, kTrace = 2, kFirstExtension = 3 };
+
+  /**
+   * Constructor. There is a component for each extension in extensions, which
+   * must be the order that the extensions are called in.
+   */
+  explicit SimCtrlStats(const std::vector<SimCtrlExtension *> &extensions);
+
+  /** Start timing. Call this just before the main loop. */
+  void Start();
+
+  /** Charge the time since the last lap to component */
+  void Lap(unsigned component) {
+    Clock::time_point now = Clock::now();
+    ns_[component] += ToNs(now - last_);
+    last_ = now;
+  }
+
+  /**
+   * Mark the start of a clock cycle. The time since the last lap is charged to
+   * kOther and the time since the previous call is added to the histogram.
+   */
+  void StartCycle();
+
+  /**
+   * Print a summary for a simulation of cycles clock cycles
+   */
+  void Print(std::ostream &os, unsigned long cycles) const;
+
+  /**
+   * Write the same summary as JSON to path. Returns false (having printed an
+   * error message) on failure.
+   */
+  bool WriteJson(const std::string &path, unsigned long cycles) const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  static uint64_t ToNs(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  }
+
+  // The total time charged to all components, in ns
+  uint64_t TotalNs() const;
+
+  // The cycle cost histogram. Bucket i counts cycles that took [2^i, 2^(i+1))
+  // ns (bucket zero also counts cycles that took no measurable time).
+  static const unsigned kNumBuckets = 40;
+
+  std::vector<std::string> names_;
+  std::vector<uint64_t> ns_;
+  std::vector<uint64_t> histogram_;
+
+  Clock::time_point last_;
+  Clock::time_point cycle_start_;
+  bool in_cycle_;
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_STATS_H_
@@ -43,6 +43,13 @@
 #endif
 #endif
 
+// VM_SAVABLE must be set by the user when calling Verilator with --savable.
+// It enables saving and restoring the state of the model (see
+// VerilatorSimCtrl's checkpoint options).
+#ifdef VM_SAVABLE
+#include "verilated_save.h"
+#endif
+
 #if VM_TRACE == 1
 /**
  * "Base" for all tracers in Verilator with common functionality
@@ -123,6 +130,11 @@ class VerilatedToplevel {
   virtual const char *name() const = 0;
   virtual void trace(VerilatedTracer &tfp, int levels, int options) = 0;
 
+#ifdef VM_SAVABLE
+  virtual void save(VerilatedSerialize &os) = 0;
+  virtual void restore(VerilatedDeserialize &os) = 0;
+#endif
+
   /**
    * Get the Verilator-generated device under test
    *
@@ -150,6 +162,15 @@ class TOPLEVEL_NAME : public VERILATED_TOPLEVEL_NAME, public VerilatedToplevel {
     assert(0 && "Tracing not enabled.");
 #endif
   }
+
+#ifdef VM_SAVABLE
+  void save(VerilatedSerialize &os) {
+    os << static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+  }
+  void restore(VerilatedDeserialize &os) {
+    os >> static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+  }
+#endif
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATED_TOPLEVEL_H_
@@ -4,6 +4,8 @@
 
 #include "verilator_sim_ctrl.h"
 
+#include <cstdio>
+#include <cstring>
 #include <getopt.h>
 #include <iostream>
 #include <signal.h>
@@ -111,6 +113,13 @@ bool VerilatorSimCtrl::ParseCommandArgs(int argc, char **argv, bool &exit_app) {
   const struct option long_options[] = {
       {"term-after-cycles", required_argument, nullptr, 'c'},
       {"trace", optional_argument, nullptr, 't'},
+      {"trace-start", required_argument, nullptr, 'S'},
+      {"trace-stop", required_argument, nullptr, 'E'},
+      {"trace-pre-trigger", required_argument, nullptr, 'P'},
+      {"sim-stats", no_argument, nullptr, 's'},
+      {"save-checkpoint-at", required_argument, nullptr, 'C'},
+      {"restore-checkpoint", required_argument, nullptr, 'R'},
+      {"sim-stats-json", required_argument, nullptr, 'j'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, no_argument, nullptr, 0}};
 
@@ -145,6 +154,51 @@ bool VerilatorSimCtrl::ParseCommandArgs(int argc, char **argv, bool &exit_app) {
           return false;
         }
         break;
+      case 'S':
+      case 'E':
+      case 'P': {
+        if (!tracing_possible_) {
+          std::cerr << "ERROR: Tracing has not been enabled at compile time."
+                    << std::endl;
+          exit_app = true;
+          return false;
+        }
+        const char *arg_name = (c == 'S')   ? "trace-start"
+                               : (c == 'E') ? "trace-stop"
+                                            : "trace-pre-trigger";
+        unsigned long *arg_val = (c == 'S')   ? &trace_start_cycle_
+                                 : (c == 'E') ? &trace_stop_cycle_
+                                              : &pre_trigger_cycles_;
+        if (!read_ul_arg(arg_val, arg_name, optarg)) {
+          exit_app = true;
+          return false;
+        }
+        break;
+      }
+      case 'C':
+      case 'R':
+#ifndef VM_SAVABLE
+        std::cerr << "ERROR: Checkpoints have not been enabled at compile "
+                     "time (Verilate with --savable and define VM_SAVABLE)."
+                  << std::endl;
+        exit_app = true;
+        return false;
+#endif
+        if (c == 'R') {
+          restore_checkpoint_path_ = optarg;
+        } else if (!read_ul_arg(&save_checkpoint_cycle_, "save-checkpoint-at",
+                                optarg)) {
+          exit_app = true;
+          return false;
+        }
+        break;
+      case 's':
+        stats_enabled_ = true;
+        break;
+      case 'j':
+        stats_enabled_ = true;
+        stats_json_path_ = optarg;
+        break;
       case 'h':
         PrintHelp();
         exit_app = true;
@@ -243,7 +297,16 @@ VerilatorSimCtrl::VerilatorSimCtrl()
       request_stop_(false),
       simulation_success_(true),
       tracer_(VerilatedTracer()),
-      term_after_cycles_(0) {
+      term_after_cycles_(0),
+      save_checkpoint_cycle_(kNoCycle),
+      stats_enabled_(false),
+      trace_start_cycle_(kNoCycle),
+      trace_stop_cycle_(kNoCycle),
+      pre_trigger_cycles_(0),
+      ring_idx_(0),
+      ring_segment_start_(0),
+      ring_segments_(0),
+      ring_done_(false) {
 }
 
 void VerilatorSimCtrl::RegisterSignalHandler() {
@@ -279,8 +342,31 @@ void VerilatorSimCtrl::PrintHelp() const {
   if (tracing_possible_) {
     std::cout << "-t|--trace\n"
                  "   --trace=FILE\n"
-                 "  Write a trace file from the start\n\n";
+                 "  Write a trace file from the start\n\n"
+                 "--trace-start=CYCLE\n"
+                 "  Start writing the trace file at CYCLE\n\n"
+                 "--trace-stop=CYCLE\n"
+                 "  Stop writing the trace file at CYCLE\n\n"
+                 "--trace-pre-trigger=N\n"
+                 "  Until tracing starts, keep the trace of the last N to 2N\n"
+                 "  cycles in files next to the trace file. These are kept\n"
+                 "  when tracing is triggered or, if it never is, when the\n"
+                 "  simulation ends.\n\n";
   }
+#ifdef VM_SAVABLE
+  std::cout << "--save-checkpoint-at=CYCLE\n"
+               "  Save the state of the simulation at CYCLE to a file called\n"
+               "  sim-CYCLE.ckpt\n\n"
+               "--restore-checkpoint=FILE\n"
+               "  Start the simulation from the checkpoint in FILE, rather\n"
+               "  than from reset\n\n";
+#endif
+  std::cout << "--sim-stats\n"
+               "  Print the time spent in eval(), tracing and each extension\n"
+               "  and a histogram of the time taken by each cycle\n\n"
+               "--sim-stats-json=FILE\n"
+               "  As --sim-stats, and also write the statistics to FILE as\n"
+               "  JSON\n\n";
   std::cout << "-c|--term-after-cycles=N\n"
                "  Terminate simulation after N cycles. 0 means no timeout.\n\n"
                "-h|--help\n"
@@ -326,6 +412,13 @@ void VerilatorSimCtrl::PrintStatistics() const {
   if (tracing_enabled_ && FileSize(GetTraceFileName(), trace_size_byte)) {
     std::cout << "Trace file size:  " << trace_size_byte << " B" << std::endl;
   }
+
+  if (stats_) {
+    stats_->Print(std::cout, time_ / 2);
+    if (!stats_json_path_.empty()) {
+      stats_->WriteJson(stats_json_path_, time_ / 2);
+    }
+  }
 }
 
 std::string VerilatorSimCtrl::GetTraceFileName() const {
@@ -347,10 +440,29 @@ void VerilatorSimCtrl::Run() {
   std::cout << std::endl
             << "Simulation running, end by pressing CTRL-c." << std::endl;
 
+  // Restore a checkpoint if we have one. This replaces the state of the
+  // model, including the reset signal, so we don't touch reset afterwards.
+  bool restored = false;
+  if (!restore_checkpoint_path_.empty()) {
+    if (!RestoreCheckpoint(restore_checkpoint_path_)) {
+      simulation_success_ = false;
+      time_begin_ = time_end_ = std::chrono::steady_clock::now();
+      return;
+    }
+    restored = true;
+  }
+
   time_begin_ = std::chrono::steady_clock::now();
-  UnsetReset();
+  if (!restored) {
+    UnsetReset();
+  }
   Trace();
 
+  if (stats_enabled_) {
+    stats_.reset(new SimCtrlStats(extension_array_));
+    stats_->Start();
+  }
+
   unsigned long start_reset_cycle_ = initial_reset_delay_cycles_;
   unsigned long end_reset_cycle_ = start_reset_cycle_ + reset_duration_cycles_;
 
@@ -363,20 +475,46 @@ void VerilatorSimCtrl::Run() {
       UnsetReset();
     }
 
+    // Checkpoints are saved just before a positive edge of the clock
+    if (!*sig_clk_ && cycle_ == save_checkpoint_cycle_) {
+      if (!SaveCheckpoint(GetCheckpointFileName(cycle_))) {
+        RequestStop(false);
+      }
+    }
+
     *sig_clk_ = !*sig_clk_;
 
     // Call all extension on-clock methods
     if (*sig_clk_) {
-      for (auto it = extension_array_.begin(); it != extension_array_.end();
-           ++it) {
-        (*it)->OnClock(time_);
+      if (stats_) {
+        stats_->StartCycle();
+      }
+
+      if (cycle_ == trace_start_cycle_) {
+        TriggerTraceStart("--trace-start");
+      }
+      if (cycle_ == trace_stop_cycle_) {
+        TriggerTraceStop("--trace-stop");
+      }
+
+      for (size_t i = 0; i < extension_array_.size(); ++i) {
+        extension_array_[i]->OnClock(time_);
+        if (stats_) {
+          stats_->Lap(SimCtrlStats::kFirstExtension + i);
+        }
       }
     }
 
     top_->eval();
+    if (stats_) {
+      stats_->Lap(SimCtrlStats::kEval);
+    }
     time_++;
 
     Trace();
+    if (stats_) {
+      stats_->Lap(SimCtrlStats::kTrace);
+    }
 
     if (request_stop_) {
       std::cout << "Received stop request, shutting down simulation."
@@ -398,6 +536,10 @@ void VerilatorSimCtrl::Run() {
   top_->final();
   time_end_ = std::chrono::steady_clock::now();
 
+  if (RingActive()) {
+    SaveRing();
+  }
+
   if (TracingEverEnabled()) {
     tracer_.close();
   }
@@ -456,6 +598,16 @@ void VerilatorSimCtrl::Trace() {
     tracing_enabled_changed_ = false;
   }
 
+  // The pre-trigger ring runs until tracing is enabled for the first time
+  // (however that happens).
+  if (RingActive()) {
+    if (!TracingEnabled()) {
+      TraceRing();
+      return;
+    }
+    SaveRing();
+  }
+
   if (!TracingEnabled()) {
     return;
   }
@@ -468,3 +620,205 @@ void VerilatorSimCtrl::Trace() {
 
   tracer_.dump(GetTime());
 }
+
+void VerilatorSimCtrl::TriggerTraceStart(const std::string &reason) {
+  if (!tracing_possible_ || tracing_enabled_) {
+    return;
+  }
+
+  std::cout << "Trace started at cycle " << time_ / 2 << " (" << reason
+            << ")." << std::endl;
+  TraceOn();
+}
+
+void VerilatorSimCtrl::TriggerTraceStop(const std::string &reason) {
+  if (!tracing_enabled_) {
+    return;
+  }
+
+  std::cout << "Trace stopped at cycle " << time_ / 2 << " (" << reason
+            << ")." << std::endl;
+  TraceOff();
+}
+
+void VerilatorSimCtrl::TraceRing() {
+  unsigned long cycle = time_ / 2;
+
+  // Switch to the other file in the ring once the current one holds
+  // pre_trigger_cycles_ cycles. Opening the file truncates whatever was in it
+  // from two segments ago.
+  if (!tracer_.isOpen() ||
+      cycle - ring_segment_start_ >= pre_trigger_cycles_) {
+    if (tracer_.isOpen()) {
+      tracer_.close();
+      ring_idx_ ^= 1;
+    }
+    tracer_.open(GetRingFileName("ring" + std::to_string(ring_idx_)).c_str());
+    ring_segment_start_ = cycle;
+    ++ring_segments_;
+  }
+
+  tracer_.dump(GetTime());
+}
+
+void VerilatorSimCtrl::SaveRing() {
+  assert(RingActive());
+  ring_done_ = true;
+
+  if (!ring_segments_) {
+    return;
+  }
+  tracer_.close();
+
+  // The file that we were writing has the most recent cycles. If we have
+  // switched files at least once, the other file has the cycles before that.
+  std::string older = GetRingFileName("pre-trigger-1");
+  std::string newer = GetRingFileName("pre-trigger-2");
+  std::string cur = GetRingFileName("ring" + std::to_string(ring_idx_));
+  std::string prev = GetRingFileName("ring" + std::to_string(ring_idx_ ^ 1));
+
+  bool ok = (rename(cur.c_str(), newer.c_str()) == 0);
+  if (ring_segments_ > 1) {
+    ok &= (rename(prev.c_str(), older.c_str()) == 0);
+  }
+  if (!ok) {
+    std::cerr << "ERROR: Failed to rename the pre-trigger trace files."
+              << std::endl;
+    return;
+  }
+
+  std::cout << "Wrote the trace from before cycle " << time_ / 2 << " to ";
+  if (ring_segments_ > 1) {
+    std::cout << older << " (older cycles) and ";
+  }
+  std::cout << newer << "." << std::endl;
+}
+
+std::string VerilatorSimCtrl::GetRingFileName(const std::string &tag) const {
+  std::string path = GetTraceFileName();
+  size_t slash = path.rfind('/');
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return path + "." + tag;
+  }
+  return path.substr(0, dot) + "." + tag + path.substr(dot);
+}
+
+std::string VerilatorSimCtrl::GetCheckpointFileName(
+    unsigned long cycle) const {
+  return "sim-" + std::to_string(cycle) + ".ckpt";
+}
+
+#ifdef VM_SAVABLE
+// The first thing in a checkpoint file (after Verilator's own header). The
+// number at the end is the version of the format.
+static const char kCheckpointMagic[] = "simctrl-checkpoint-1";
+
+bool VerilatorSimCtrl::SaveCheckpoint(const std::string &path) {
+  // Ask the extensions for their state first: they might fail.
+  std::vector<std::string> ext_states(extension_array_.size());
+  for (size_t i = 0; i < extension_array_.size(); ++i) {
+    if (!extension_array_[i]->SaveCheckpoint(ext_states[i])) {
+      std::cerr << "ERROR: Failed to save checkpoint: an extension could not "
+                   "save its state."
+                << std::endl;
+      return false;
+    }
+  }
+
+  VerilatedSave os;
+  os.open(path.c_str());
+  if (!os.isOpen()) {
+    std::cerr << "ERROR: Failed to open `" << path
+              << "' to save a checkpoint." << std::endl;
+    return false;
+  }
+
+  uint64_t time = time_;
+  uint64_t num_exts = ext_states.size();
+  os.write(kCheckpointMagic, sizeof kCheckpointMagic);
+  os.write(&time, sizeof time);
+  top_->save(os);
+  os.write(&num_exts, sizeof num_exts);
+  for (const std::string &state : ext_states) {
+    uint64_t len = state.size();
+    os.write(&len, sizeof len);
+    os.write(state.data(), state.size());
+  }
+  os.close();
+
+  std::cout << "Saved a checkpoint at cycle " << time_ / 2 << " to " << path
+            << "." << std::endl;
+  return true;
+}
+
+bool VerilatorSimCtrl::RestoreCheckpoint(const std::string &path) {
+  for (SimCtrlExtension *ext : extension_array_) {
+    ext->PreRestoreCheckpoint();
+  }
+
+  VerilatedRestore is;
+  is.open(path.c_str());
+  if (!is.isOpen()) {
+    std::cerr << "ERROR: Failed to open checkpoint `" << path << "'."
+              << std::endl;
+    return false;
+  }
+
+  char magic[sizeof kCheckpointMagic];
+  is.read(magic, sizeof magic);
+  if (memcmp(magic, kCheckpointMagic, sizeof magic) != 0) {
+    std::cerr << "ERROR: `" << path << "' is not a checkpoint file."
+              << std::endl;
+    return false;
+  }
+
+  uint64_t time, num_exts;
+  is.read(&time, sizeof time);
+  top_->restore(is);
+  is.read(&num_exts, sizeof num_exts);
+  if (num_exts != extension_array_.size()) {
+    std::cerr << "ERROR: Checkpoint `" << path << "' has state for "
+              << num_exts << " extensions, but this simulation has "
+              << extension_array_.size() << "." << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> ext_states(num_exts);
+  for (std::string &state : ext_states) {
+    uint64_t len;
+    is.read(&len, sizeof len);
+    state.resize(len);
+    if (len) {
+      is.read(&state[0], len);
+    }
+  }
+  is.close();
+
+  time_ = time;
+  for (size_t i = 0; i < extension_array_.size(); ++i) {
+    if (!extension_array_[i]->RestoreCheckpoint(ext_states[i])) {
+      std::cerr << "ERROR: Failed to restore checkpoint: an extension could "
+                   "not restore its state."
+                << std::endl;
+      return false;
+    }
+  }
+
+  std::cout << "Restored a checkpoint at cycle " << time_ / 2 << " from "
+            << path << "." << std::endl;
+  return true;
+}
+#else
+bool VerilatorSimCtrl::SaveCheckpoint(const std::string &path) {
+  std::cerr << "ERROR: Checkpoints have not been enabled at compile time."
+            << std::endl;
+  return false;
+}
+
+bool VerilatorSimCtrl::RestoreCheckpoint(const std::string &path) {
+  std::cerr << "ERROR: Checkpoints have not been enabled at compile time."
+            << std::endl;
+  return false;
+}
+#endif  // VM_SAVABLE
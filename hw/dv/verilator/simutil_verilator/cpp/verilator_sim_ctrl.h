@@ -6,10 +6,12 @@
 #define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATOR_SIM_CTRL_H_
 
 #include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "sim_ctrl_extension.h"
+#include "sim_ctrl_stats.h"
 #include "verilated_toplevel.h"
 
 enum VerilatorSimCtrlFlags {
@@ -121,6 +123,26 @@ class VerilatorSimCtrl {
    */
   unsigned long GetTime() const { return time_; }
 
+  /**
+   * Start writing a wave trace because something interesting happened
+   *
+   * This is for extensions that watch the design for a trigger (like a PC
+   * being executed). The reason is printed with the current cycle. Does
+   * nothing if tracing is already enabled or isn't possible.
+   *
+   * If a pre-trigger window is set (with --trace-pre-trigger), the window is
+   * saved next to the trace file. Must not be called from a signal handler.
+   */
+  void TriggerTraceStart(const std::string &reason);
+
+  /**
+   * Stop writing a wave trace because something interesting happened
+   *
+   * This is the counterpart to TriggerTraceStart(). Does nothing if tracing
+   * is not enabled.
+   */
+  void TriggerTraceStop(const std::string &reason);
+
  private:
   VerilatedToplevel *top_;
   CData *sig_clk_;
@@ -142,6 +164,36 @@ class VerilatorSimCtrl {
   unsigned long term_after_cycles_;
   std::vector<SimCtrlExtension *> extension_array_;
 
+  // Checkpoints: the cycle at which to save one (kNoCycle for never) and the
+  // file to restore one from (empty for none). Checkpoints need a model that
+  // was Verilated with --savable (see VM_SAVABLE in verilated_toplevel.h).
+  unsigned long save_checkpoint_cycle_;
+  std::string restore_checkpoint_path_;
+
+  // Timing statistics for the main loop. These are only collected if
+  // --sim-stats or --sim-stats-json is passed, in which case stats_ is
+  // created when the simulation starts.
+  bool stats_enabled_;
+  std::string stats_json_path_;
+  std::unique_ptr<SimCtrlStats> stats_;
+
+  // Cycles at which to start and stop tracing (kNoCycle for never)
+  static const unsigned long kNoCycle = ~0ul;
+  unsigned long trace_start_cycle_;
+  unsigned long trace_stop_cycle_;
+
+  // The pre-trigger window. If this is nonzero, cycles before tracing is
+  // enabled are traced into a ring of two files, switching between them every
+  // pre_trigger_cycles_ cycles. ring_idx_ is the file that is currently being
+  // written, which was opened at ring_segment_start_. ring_segments_ counts
+  // the files that have been opened. Once the ring has been saved (when
+  // tracing is enabled or at the end of the simulation), ring_done_ is set.
+  unsigned long pre_trigger_cycles_;
+  int ring_idx_;
+  unsigned long ring_segment_start_;
+  unsigned long ring_segments_;
+  bool ring_done_;
+
   /**
    * Default constructor
    *
@@ -248,6 +300,52 @@ class VerilatorSimCtrl {
    * Perform tracing in Verilator if required
    */
   void Trace();
+
+  /**
+   * Get the name of the file for a checkpoint saved at the given cycle
+   */
+  std::string GetCheckpointFileName(unsigned long cycle) const;
+
+  /**
+   * Save a checkpoint to path
+   *
+   * The checkpoint holds the current time, the state of the Verilated model
+   * and the state of each extension (see SimCtrlExtension::SaveCheckpoint).
+   * This must be called between clock edges, once the model has been
+   * evaluated. Prints an error and returns false on failure.
+   */
+  bool SaveCheckpoint(const std::string &path);
+
+  /**
+   * Restore a checkpoint from path
+   *
+   * This must be called after the initial blocks of the model have run.
+   * Prints an error and returns false on failure.
+   */
+  bool RestoreCheckpoint(const std::string &path);
+
+  /**
+   * Is the pre-trigger ring in use? It is used until tracing is first enabled.
+   */
+  bool RingActive() const { return pre_trigger_cycles_ && !ring_done_; }
+
+  /**
+   * Dump a time step to the pre-trigger ring, switching files if necessary
+   */
+  void TraceRing();
+
+  /**
+   * Close the pre-trigger ring and give its files their final names
+   */
+  void SaveRing();
+
+  /**
+   * Get the file name for a slot in the pre-trigger ring
+   *
+   * The files are named like the trace file, with ".TAG" inserted before the
+   * extension.
+   */
+  std::string GetRingFileName(const std::string &tag) const;
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATOR_SIM_CTRL_H_
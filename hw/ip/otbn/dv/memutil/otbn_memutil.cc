@@ -5,6 +5,7 @@
 #include "otbn_memutil.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <gelf.h>
 #include <iostream>
@@ -14,6 +15,7 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "elf_cache.h"
 #include "scrambled_ecc32_mem_area.h"
 #include "sv_scoped.h"
 #include "sv_utils.h"
@@ -24,6 +26,11 @@ OtbnMemUtil::OtbnMemUtil(const std::string &top_scope)
       expected_end_addr_(-1) {
   RegisterMemoryArea("imem", 0x4000, &imem_);
   RegisterMemoryArea("dmem", 0x8000, &dmem_);
+
+  const char *cache_dir = getenv("OTBN_ELF_CACHE_DIR");
+  if (cache_dir && cache_dir[0]) {
+    SetElfCacheDir(cache_dir);
+  }
 }
 
 void OtbnMemUtil::LoadElf(const std::string &elf_path) {
@@ -45,6 +52,9 @@ void OtbnMemUtil::OnElfLoaded(Elf *elf_file) {
 
   expected_end_addr_ = -1;
   loop_warp_.clear();
+  imem_symbols_.clear();
+  imem_symbol_ranks_.clear();
+  imem_symbol_addrs_.clear();
 
   // Look through the symbol table of elf_file for an expected end
   // address and any loop warping symbols.
@@ -68,9 +78,100 @@ void OtbnMemUtil::OnElfLoaded(Elf *elf_file) {
         continue;
 
       OnSymbol(sym_name, sym.st_value);
+
+      // Code symbols are the ones that are defined in an executable section.
+      // Skip section and file symbols, which don't name anything useful.
+      int sym_type = GELF_ST_TYPE(sym.st_info);
+      if (!sym_name[0] || sym_type == STT_SECTION || sym_type == STT_FILE ||
+          sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE)
+        continue;
+
+      Elf_Scn *sym_scn = elf_getscn(elf_file, sym.st_shndx);
+      Elf32_Shdr *sym_shdr = sym_scn ? elf32_getshdr(sym_scn) : nullptr;
+      if (!sym_shdr || !(sym_shdr->sh_flags & SHF_EXECINSTR))
+        continue;
+
+      int rank = (sym_type == STT_FUNC ? 2 : 0) +
+                 (GELF_ST_BIND(sym.st_info) == STB_LOCAL ? 0 : 1);
+      OnImemSymbol(sym_name, sym.st_value, rank);
     }
     break;
   }
+
+  imem_symbol_ranks_.clear();
+}
+
+void OtbnMemUtil::SaveElfExtra(std::vector<uint8_t> *out) const {
+  ElfCacheWriter writer(out);
+
+  writer.PutU32(expected_end_addr_);
+
+  writer.PutU32(loop_warp_.size());
+  for (const auto &pr : loop_warp_) {
+    writer.PutU32(pr.first.first);
+    writer.PutU32(pr.first.second);
+    writer.PutU32(pr.second);
+  }
+
+  writer.PutU32(imem_symbols_.size());
+  for (const auto &pr : imem_symbols_) {
+    writer.PutU32(pr.first);
+    writer.PutString(pr.second);
+  }
+
+  writer.PutU32(imem_symbol_addrs_.size());
+  for (const auto &pr : imem_symbol_addrs_) {
+    writer.PutString(pr.first);
+    writer.PutU32(pr.second);
+  }
+}
+
+bool OtbnMemUtil::RestoreElfExtra(const std::vector<uint8_t> &extra) {
+  ElfCacheReader reader(extra.data(), extra.size());
+
+  uint32_t expected_end_addr, count;
+  LoopWarps loop_warp;
+  Symbols imem_symbols;
+  std::map<std::string, uint32_t> imem_symbol_addrs;
+
+  if (!reader.GetU32(&expected_end_addr) || !reader.GetU32(&count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t addr, from_cnt, to_cnt;
+    if (!reader.GetU32(&addr) || !reader.GetU32(&from_cnt) ||
+        !reader.GetU32(&to_cnt))
+      return false;
+    loop_warp[std::make_pair(addr, from_cnt)] = to_cnt;
+  }
+
+  if (!reader.GetU32(&count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t addr;
+    std::string name;
+    if (!reader.GetU32(&addr) || !reader.GetString(&name))
+      return false;
+    imem_symbols[addr] = name;
+  }
+
+  if (!reader.GetU32(&count))
+    return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string name;
+    uint32_t addr;
+    if (!reader.GetString(&name) || !reader.GetU32(&addr))
+      return false;
+    imem_symbol_addrs[name] = addr;
+  }
+
+  if (!reader.AtEnd())
+    return false;
+
+  expected_end_addr_ = (int)expected_end_addr;
+  loop_warp_.swap(loop_warp);
+  imem_symbols_.swap(imem_symbols);
+  imem_symbol_addrs_.swap(imem_symbol_addrs);
+  return true;
 }
 
 void OtbnMemUtil::OnSymbol(const std::string &name, uint32_t value) {
@@ -111,6 +212,29 @@ void OtbnMemUtil::OnSymbol(const std::string &name, uint32_t value) {
   }
 }
 
+void OtbnMemUtil::OnImemSymbol(const std::string &name, uint32_t value,
+                               int rank) {
+  imem_symbol_addrs_.insert(std::make_pair(name, value));
+
+  auto it = imem_symbol_ranks_.find(value);
+  if (it != imem_symbol_ranks_.end() && it->second >= rank)
+    return;
+
+  imem_symbol_ranks_[value] = rank;
+  imem_symbols_[value] = name;
+}
+
+bool OtbnMemUtil::GetImemSymbolAddr(const std::string &name,
+                                    uint32_t *addr) const {
+  assert(addr);
+  auto it = imem_symbol_addrs_.find(name);
+  if (it == imem_symbol_addrs_.end())
+    return false;
+
+  *addr = it->second;
+  return true;
+}
+
 void OtbnMemUtil::AddLoopWarp(uint32_t addr, uint32_t from_cnt,
                               uint32_t to_cnt) {
   auto key = std::make_pair(addr, from_cnt);
@@ -5,6 +5,7 @@
 #define OPENTITAN_HW_IP_OTBN_DV_MEMUTIL_OTBN_MEMUTIL_H_
 
 #include <map>
+#include <string>
 #include <svdpi.h>
 #include <vector>
 
@@ -14,9 +15,13 @@
 class OtbnMemUtil : public DpiMemUtil {
  public:
   typedef std::map<std::pair<uint32_t, uint32_t>, uint32_t> LoopWarps;
+  typedef std::map<uint32_t, std::string> Symbols;
 
   // Constructor. top_scope is the SV scope that contains IMEM and
   // DMEM memories as u_imem and u_dmem, respectively.
+  //
+  // If the OTBN_ELF_CACHE_DIR environment variable is set, staged ELF images
+  // are cached on disk in that directory (see DpiMemUtil::SetElfCacheDir).
   OtbnMemUtil(const std::string &top_scope);
 
   // Load an ELF file at the given path and backdoor load it into the
@@ -43,18 +48,43 @@ class OtbnMemUtil : public DpiMemUtil {
   // Read-only access to the table of loop warps
   const LoopWarps &GetLoopWarps() const { return loop_warp_; }
 
+  // The names of the code symbols in the ELF file, keyed by address. Where
+  // more than one symbol has the same address, this prefers functions to
+  // other symbols and global symbols to local ones.
+  const Symbols &GetImemSymbols() const { return imem_symbols_; }
+
+  // Look up the address of the code symbol called name, writing it to *addr.
+  // Returns false if there is no such symbol.
+  bool GetImemSymbolAddr(const std::string &name, uint32_t *addr) const;
+
  private:
   void OnElfLoaded(Elf *elf_file) override;
 
+  // Save and restore the results of OnElfLoaded with a cached ELF image
+  void SaveElfExtra(std::vector<uint8_t> *out) const override;
+  bool RestoreElfExtra(const std::vector<uint8_t> &extra) override;
+
   // Called by OnElfLoaded for each symbol in the symbol table
   void OnSymbol(const std::string &name, uint32_t value);
 
+  // Called by OnElfLoaded for each symbol in an executable section. rank says
+  // how much we prefer this symbol to others at the same address (higher is
+  // better).
+  void OnImemSymbol(const std::string &name, uint32_t value, int rank);
+
   // Add an entry to loop_warp_
   void AddLoopWarp(uint32_t addr, uint32_t from_cnt, uint32_t to_cnt);
 
   ScrambledEcc32MemArea imem_, dmem_;
   int expected_end_addr_;
   LoopWarps loop_warp_;
+  Symbols imem_symbols_;
+
+  // The rank of each entry in imem_symbols_ (only used while loading)
+  std::map<uint32_t, int> imem_symbol_ranks_;
+
+  // The address of each code symbol, keyed by name
+  std::map<std::string, uint32_t> imem_symbol_addrs_;
 };
 
 // DPI-accessible wrappers
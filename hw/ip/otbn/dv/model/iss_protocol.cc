@@ -0,0 +1,594 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "iss_protocol.h"
+
+#include <cassert>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// Command names, indexed by opcode - 1
+static const char *const kCommandNames[] = {
+    "start_operation",
+    "step",
+    "load_elf",
+    "add_loop_warp",
+    "clear_loop_warps",
+    "load_d",
+    "load_i",
+    "dump_d",
+    "print_regs",
+    "print_call_stack",
+    "reset",
+    "edn_rnd_step",
+    "edn_urnd_step",
+    "edn_rnd_cdc_done",
+    "edn_urnd_cdc_done",
+    "edn_flush",
+    "invalidate_imem",
+    "invalidate_dmem",
+    "set_keymgr_value",
+    "step_crc",
+    "send_err_escalation",
+    "set_rma_req",
+    "initial_secure_wipe",
+    "otp_key_cdc_done",
+    "set_software_errs_fatal",
+    "run",
+    "load_d_shared",
+    "load_i_shared",
+    "dump_d_shared",
+    "dump_d_dirty",
+    "save_state",
+    "restore_state",
+};
+
+static const char *const kExtRegNames[IssResponse::NumExtRegs] = {
+    "INTR_STATE", "STATUS",  "ERR_BITS",   "INSN_CNT",
+    "STOP_PC",    "RND_REQ", "WIPE_START", "LOAD_CHECKSUM"};
+
+// Record types in a binary response (REC_* in iss_protocol.py)
+enum record_t : uint8_t {
+  RecLine = 1,
+  RecExtReg = 2,
+  RecRegs = 3,
+  RecCallStackEntry = 4,
+  RecCycleEnd = 5
+};
+
+// The line that marks the end of a cycle in text mode (CYCLE_END_LINE in
+// iss_protocol.py)
+static const char kCycleEndLine[] = "END_CYCLE";
+
+static void append_u16(std::string *dst, uint16_t value) {
+  dst->push_back((char)(value & 0xff));
+  dst->push_back((char)(value >> 8));
+}
+
+static void append_u32(std::string *dst, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    dst->push_back((char)((value >> (8 * i)) & 0xff));
+  }
+}
+
+static uint32_t load_u32(const char *src) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(src);
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+IssCommand &IssCommand::hex32(uint32_t value) {
+  args_.push_back(Arg{Hex32, value, std::string()});
+  return *this;
+}
+
+IssCommand &IssCommand::dec32(uint32_t value) {
+  args_.push_back(Arg{Dec32, value, std::string()});
+  return *this;
+}
+
+IssCommand &IssCommand::le_bytes(const uint8_t *data, size_t len) {
+  args_.push_back(
+      Arg{Bytes, 0, std::string(reinterpret_cast<const char *>(data), len)});
+  return *this;
+}
+
+IssCommand &IssCommand::le_words(const uint32_t *data, size_t len) {
+  std::string bytes;
+  bytes.reserve(4 * len);
+  for (size_t i = 0; i < len; ++i) {
+    append_u32(&bytes, data[i]);
+  }
+  args_.push_back(Arg{Bytes, 0, bytes});
+  return *this;
+}
+
+IssCommand &IssCommand::str(const std::string &value) {
+  assert(value.size() <= UINT16_MAX);
+  args_.push_back(Arg{Str, 0, value});
+  return *this;
+}
+
+std::string IssCommand::to_text() const {
+  assert(1 <= opcode_ && opcode_ <= sizeof kCommandNames / sizeof(char *));
+
+  std::ostringstream oss;
+  oss << kCommandNames[opcode_ - 1];
+  for (const Arg &arg : args_) {
+    oss << " ";
+    switch (arg.type) {
+      case Hex32:
+        oss << "0x" << std::hex << arg.value << std::dec;
+        break;
+      case Dec32:
+        oss << arg.value;
+        break;
+      case Bytes:
+        // Write the bytes as a hex number, starting with the most significant
+        oss << "0x" << std::hex << std::setfill('0');
+        for (size_t i = 0; i < arg.data.size(); ++i) {
+          oss << std::setw(2)
+              << (unsigned)(uint8_t)arg.data[arg.data.size() - 1 - i];
+        }
+        oss << std::dec << std::setfill(' ');
+        break;
+      case Str:
+        oss << arg.data;
+        break;
+      default:
+        assert(0);
+    }
+  }
+  oss << "\n";
+  return oss.str();
+}
+
+std::string IssCommand::to_payload() const {
+  std::string payload(1, (char)opcode_);
+  for (const Arg &arg : args_) {
+    switch (arg.type) {
+      case Hex32:
+      case Dec32:
+        append_u32(&payload, arg.value);
+        break;
+      case Bytes:
+        payload += arg.data;
+        break;
+      case Str:
+        append_u16(&payload, (uint16_t)arg.data.size());
+        payload += arg.data;
+        break;
+      default:
+        assert(0);
+    }
+  }
+  return payload;
+}
+
+void IssResponse::clear() {
+  lines.clear();
+  ext_regs.clear();
+  has_regs = false;
+  gprs.fill(0);
+  for (wdr_t &wdr : wdrs) {
+    wdr.fill(0);
+  }
+  call_stack.clear();
+  cycle_ends.clear();
+}
+
+const char *IssResponse::ext_reg_name(ext_reg_t reg) {
+  assert(reg < NumExtRegs);
+  return kExtRegNames[reg];
+}
+
+// Parse exactly len hex digits from str as a uint32_t (so len must be at most
+// 8). Returns false if there is a character that isn't a lower-case hex
+// digit.
+static bool parse_hex_32(const char *str, size_t len, uint32_t *dst) {
+  assert(len <= 8);
+  uint32_t acc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    char c = str[i];
+    uint32_t digit;
+    if ('0' <= c && c <= '9') {
+      digit = c - '0';
+    } else if ('a' <= c && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    acc = (acc << 4) | digit;
+  }
+  *dst = acc;
+  return true;
+}
+
+// Try to parse a line that shows an update to an external register. These
+// look something like this:
+//
+//   ! otbn.$REG_NAME: 0x00000000
+//
+// Returns false if the line doesn't have this format or if REG_NAME isn't one
+// of the registers in kExtRegNames.
+static bool parse_ext_reg_line(const std::string &line,
+                               IssResponse::ext_reg_t *reg, uint32_t *value) {
+  static const char prefix[] = "! otbn.";
+  static const size_t prefix_len = sizeof prefix - 1;
+
+  if (line.compare(0, prefix_len, prefix) != 0)
+    return false;
+
+  size_t colon = line.find(':', prefix_len);
+  if (colon == std::string::npos)
+    return false;
+
+  // We expect exactly ": 0x" and then 8 hex digits after the name
+  if (line.size() != colon + 12 || line.compare(colon, 4, ": 0x") != 0)
+    return false;
+
+  if (!parse_hex_32(&line[colon + 4], 8, value))
+    return false;
+
+  size_t name_len = colon - prefix_len;
+  for (int i = 0; i < IssResponse::NumExtRegs; ++i) {
+    if (line.compare(prefix_len, name_len, kExtRegNames[i]) == 0) {
+      *reg = (IssResponse::ext_reg_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Parse a line of print_regs output into the register file. These look like
+//
+//  x3  = 0x12345678
+//  w10 = 0x0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef
+//
+// seen_mask is a record of which registers we've seen (to check we see each
+// register exactly once). GPR i sets bit i. WDR i sets bit 32 + i.
+static void parse_reg_line(const std::string &line, IssResponse *dst,
+                           uint64_t *seen_mask) {
+  size_t pos = line.find_first_not_of(" \t");
+  bool good = pos != std::string::npos &&
+              (line[pos] == 'x' || line[pos] == 'w');
+
+  bool is_wide = false;
+  unsigned reg_idx = 0;
+  size_t name_start = pos;
+  if (good) {
+    is_wide = line[pos] == 'w';
+    size_t num_digits = 0;
+    ++pos;
+    while (pos < line.size() && isdigit(line[pos]) && num_digits < 2) {
+      reg_idx = 10 * reg_idx + (line[pos] - '0');
+      ++pos;
+      ++num_digits;
+    }
+    good = num_digits > 0;
+  }
+  size_t name_end = pos;
+
+  if (good) {
+    pos = line.find_first_not_of(" \t", pos);
+    good = pos != std::string::npos && line[pos] == '=';
+  }
+  if (good) {
+    pos = line.find_first_not_of(" \t", pos + 1);
+    good = pos != std::string::npos && line.compare(pos, 2, "0x") == 0;
+    pos += 2;
+  }
+  if (!good) {
+    std::ostringstream oss;
+    oss << "Invalid line in ISS print_register output (`" << line << "').";
+    throw std::runtime_error(oss.str());
+  }
+
+  std::string reg_name = line.substr(name_start, name_end - name_start);
+  if (reg_idx >= 32) {
+    std::ostringstream oss;
+    oss << "Invalid register name in ISS output (`" << reg_name
+        << "'). Line was `" << line << "'.";
+    throw std::runtime_error(oss.str());
+  }
+
+  unsigned idx_seen = reg_idx + (is_wide ? 32 : 0);
+  if ((*seen_mask >> idx_seen) & 1) {
+    std::ostringstream oss;
+    oss << "Duplicate lines writing register " << reg_name << ".";
+    throw std::runtime_error(oss.str());
+  }
+
+  unsigned num_u32s = is_wide ? 8 : 1;
+  size_t expected_value_len = 8 * num_u32s;
+  size_t value_len = line.size() - pos;
+  if (value_len != expected_value_len) {
+    std::ostringstream oss;
+    oss << "Value for register " << reg_name << " has " << value_len
+        << " hex characters, but we expected " << expected_value_len << ".";
+    throw std::runtime_error(oss.str());
+  }
+
+  uint32_t *words = is_wide ? &dst->wdrs[reg_idx][7] : &dst->gprs[reg_idx];
+  for (unsigned i = 0; i < num_u32s; ++i) {
+    if (!parse_hex_32(&line[pos + 8 * i], 8, words)) {
+      std::ostringstream oss;
+      oss << "Invalid line in ISS print_register output (`" << line << "').";
+      throw std::runtime_error(oss.str());
+    }
+    --words;
+  }
+
+  *seen_mask |= ((uint64_t)1 << idx_seen);
+}
+
+// Parse a line of print_call_stack output (of the form 0x12345678)
+static uint32_t parse_call_stack_line(const std::string &line) {
+  size_t pos = line.find_first_not_of(" \t");
+  uint32_t value = 0;
+  if (pos == std::string::npos || line.compare(pos, 2, "0x") != 0 ||
+      line.size() != pos + 10 || !parse_hex_32(&line[pos + 2], 8, &value)) {
+    std::ostringstream oss;
+    oss << "Invalid line in ISS print_call_stack output (`" << line << "').";
+    throw std::runtime_error(oss.str());
+  }
+  return value;
+}
+
+void IssResponse::from_text(const std::vector<std::string> &text_lines) {
+  clear();
+
+  // The lines after a PRINT_REGS or PRINT_CALL_STACK header are a dump of the
+  // register file or call stack, respectively.
+  enum { Normal, Regs, CallStack } state = Normal;
+  uint64_t seen_mask = 0;
+
+  for (const std::string &line : text_lines) {
+    switch (state) {
+      case Regs:
+        parse_reg_line(line, this, &seen_mask);
+        break;
+
+      case CallStack:
+        call_stack.push_back(parse_call_stack_line(line));
+        break;
+
+      default: {
+        assert(state == Normal);
+        ext_reg_t reg;
+        uint32_t value;
+        if (parse_ext_reg_line(line, &reg, &value)) {
+          ext_regs.push_back(std::make_pair(reg, value));
+          break;
+        }
+
+        if (line == kCycleEndLine) {
+          cycle_ends.push_back(CycleEnd{lines.size(), ext_regs.size()});
+          break;
+        }
+
+        lines.push_back(line);
+        if (line == "PRINT_REGS") {
+          state = Regs;
+        } else if (line == "PRINT_CALL_STACK") {
+          state = CallStack;
+        }
+        break;
+      }
+    }
+  }
+
+  if (state == Regs) {
+    // Check that we've seen all the registers
+    if (~seen_mask) {
+      std::ostringstream oss;
+      oss << "Some registers were missing from print_register output. "
+          << "Mask: 0x" << std::hex << seen_mask << ".";
+      throw std::runtime_error(oss.str());
+    }
+    has_regs = true;
+  }
+}
+
+// Throw a std::runtime_error unless there are at least len bytes of payload
+// starting at pos
+static void check_payload_len(const std::string &payload, size_t pos,
+                              size_t len, const char *what) {
+  if (payload.size() < pos || payload.size() - pos < len) {
+    std::ostringstream oss;
+    oss << "Truncated " << what << " record in binary ISS response.";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+void IssResponse::from_payload(const std::string &payload) {
+  clear();
+
+  size_t pos = 0;
+  while (pos < payload.size()) {
+    uint8_t rec_type = (uint8_t)payload[pos];
+    ++pos;
+
+    switch (rec_type) {
+      case RecLine: {
+        check_payload_len(payload, pos, 2, "line");
+        size_t len =
+            (uint8_t)payload[pos] | ((size_t)(uint8_t)payload[pos + 1] << 8);
+        pos += 2;
+        check_payload_len(payload, pos, len, "line");
+        lines.push_back(payload.substr(pos, len));
+        pos += len;
+        break;
+      }
+
+      case RecExtReg: {
+        check_payload_len(payload, pos, 5, "ext reg");
+        uint8_t reg = (uint8_t)payload[pos];
+        if (reg >= NumExtRegs) {
+          std::ostringstream oss;
+          oss << "Unknown external register index in binary ISS response: "
+              << (unsigned)reg << ".";
+          throw std::runtime_error(oss.str());
+        }
+        ext_regs.push_back(
+            std::make_pair((ext_reg_t)reg, load_u32(&payload[pos + 1])));
+        pos += 5;
+        break;
+      }
+
+      case RecRegs:
+        check_payload_len(payload, pos, 4 * 32 + 32 * 32, "register");
+        for (uint32_t &gpr : gprs) {
+          gpr = load_u32(&payload[pos]);
+          pos += 4;
+        }
+        for (wdr_t &wdr : wdrs) {
+          for (uint32_t &word : wdr) {
+            word = load_u32(&payload[pos]);
+            pos += 4;
+          }
+        }
+        has_regs = true;
+        break;
+
+      case RecCallStackEntry:
+        check_payload_len(payload, pos, 4, "call stack");
+        call_stack.push_back(load_u32(&payload[pos]));
+        pos += 4;
+        break;
+
+      case RecCycleEnd:
+        cycle_ends.push_back(CycleEnd{lines.size(), ext_regs.size()});
+        break;
+
+      default: {
+        std::ostringstream oss;
+        oss << "Unknown record type in binary ISS response: "
+            << (unsigned)rec_type << ".";
+        throw std::runtime_error(oss.str());
+      }
+    }
+  }
+}
+
+std::vector<std::string> IssResponse::to_text() const {
+  std::vector<std::string> ret;
+  auto cycle_end = cycle_ends.begin();
+  for (size_t i = 0; i <= lines.size(); ++i) {
+    for (; cycle_end != cycle_ends.end() && cycle_end->num_lines == i;
+         ++cycle_end) {
+      ret.push_back(kCycleEndLine);
+    }
+    if (i < lines.size())
+      ret.push_back(lines[i]);
+  }
+
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0');
+
+  if (has_regs) {
+    for (int i = 0; i < 32; ++i) {
+      oss.str("");
+      oss << " x" << std::left << std::setw(2) << std::setfill(' ') << std::dec
+          << i << std::right << std::setfill('0') << std::hex << " = 0x"
+          << std::setw(8) << gprs[i];
+      ret.push_back(oss.str());
+    }
+    for (int i = 0; i < 32; ++i) {
+      oss.str("");
+      oss << " w" << std::left << std::setw(2) << std::setfill(' ') << std::dec
+          << i << std::right << std::setfill('0') << std::hex << " = 0x";
+      for (int j = 7; j >= 0; --j) {
+        oss << std::setw(8) << wdrs[i][j];
+      }
+      ret.push_back(oss.str());
+    }
+  }
+
+  for (uint32_t entry : call_stack) {
+    oss.str("");
+    oss << "0x" << std::setw(8) << entry;
+    ret.push_back(oss.str());
+  }
+
+  for (const auto &pr : ext_regs) {
+    oss.str("");
+    oss << "! otbn." << ext_reg_name(pr.first) << ": 0x" << std::setw(8)
+        << pr.second;
+    ret.push_back(oss.str());
+  }
+
+  return ret;
+}
+
+bool IssResponse::operator==(const IssResponse &other) const {
+  return lines == other.lines && ext_regs == other.ext_regs &&
+         has_regs == other.has_regs && gprs == other.gprs &&
+         wdrs == other.wdrs && call_stack == other.call_stack &&
+         cycle_ends == other.cycle_ends;
+}
+
+void IssResponse::split_cycles(std::deque<IssResponse> *dst) const {
+  assert(dst);
+
+  CycleEnd start{0, 0};
+  for (const CycleEnd &end : cycle_ends) {
+    dst->emplace_back();
+    IssResponse &cycle = dst->back();
+    cycle.lines.assign(lines.begin() + start.num_lines,
+                       lines.begin() + end.num_lines);
+    cycle.ext_regs.assign(ext_regs.begin() + start.num_ext_regs,
+                          ext_regs.begin() + end.num_ext_regs);
+    start = end;
+  }
+}
+
+static void store_u32(uint8_t *dst, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    dst[i] = (value >> (8 * i)) & 0xff;
+}
+
+size_t IssSharedMem::size_bytes(uint32_t imem_words, uint32_t dmem_words) {
+  return kHeaderBytes +
+         kBytesPerWord * ((size_t)imem_words + (size_t)dmem_words) +
+         dmem_words;
+}
+
+void IssSharedMem::write_header(uint8_t *base, uint32_t imem_words,
+                                uint32_t dmem_words) {
+  store_u32(base, imem_words);
+  store_u32(base + 4, dmem_words);
+}
+
+uint32_t IssSharedMem::num_words(bool is_imem) const {
+  return load_u32(reinterpret_cast<const char *>(base_) + (is_imem ? 0 : 4));
+}
+
+uint8_t *IssSharedMem::words(bool is_imem) const {
+  uint8_t *imem = base_ + kHeaderBytes;
+  return is_imem ? imem : imem + kBytesPerWord * num_words(true);
+}
+
+uint8_t *IssSharedMem::dirty_flags() const {
+  return words(false) + kBytesPerWord * num_words(false);
+}
+
+bool IssSharedMem::get_word(const uint8_t *ptr, uint32_t *value) {
+  assert(value);
+  if (ptr[0] > 1) {
+    std::ostringstream oss;
+    oss << "Shared memory word has a validity byte with value " << (int)ptr[0]
+        << "; not 0 or 1.";
+    throw std::runtime_error(oss.str());
+  }
+  *value = load_u32(reinterpret_cast<const char *>(ptr) + 1);
+  return ptr[0] == 1;
+}
+
+void IssSharedMem::put_word(uint8_t *ptr, bool valid, uint32_t value) {
+  ptr[0] = valid ? 1 : 0;
+  store_u32(ptr + 1, value);
+}
@@ -0,0 +1,224 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+#ifndef OPENTITAN_HW_IP_OTBN_DV_MODEL_ISS_PROTOCOL_H_
+#define OPENTITAN_HW_IP_OTBN_DV_MODEL_ISS_PROTOCOL_H_
+
+// Commands and responses for the protocol between ISSWrapper and the ISS.
+//
+// The ISS understands two protocols: a line-based text protocol (one command
+// per line, with output terminated by a line containing just ".") and a binary
+// framed protocol. The framing is described in
+// hw/ip/otbn/dv/otbnsim/sim/iss_protocol.py, which must be kept in sync with
+// this file.
+//
+// The classes here abstract over the two: an IssCommand can be rendered in
+// either format and an IssResponse can be decoded from either.
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The magic string and version that start the "hello" frame sent by the ISS
+// in binary mode (MAGIC and VERSION in iss_protocol.py)
+constexpr char kIssProtocolMagic[] = "OTBN";
+constexpr uint16_t kIssProtocolVersion = 5;
+
+// A command to be sent to the ISS
+class IssCommand {
+ public:
+  // Command opcodes. These must match the order of COMMANDS in
+  // iss_protocol.py.
+  enum opcode_t : uint8_t {
+    StartOperation = 1,
+    Step,
+    LoadElf,
+    AddLoopWarp,
+    ClearLoopWarps,
+    LoadD,
+    LoadI,
+    DumpD,
+    PrintRegs,
+    PrintCallStack,
+    Reset,
+    EdnRndStep,
+    EdnUrndStep,
+    EdnRndCdcDone,
+    EdnUrndCdcDone,
+    EdnFlush,
+    InvalidateImem,
+    InvalidateDmem,
+    SetKeymgrValue,
+    StepCrc,
+    SendErrEscalation,
+    SetRmaReq,
+    InitialSecureWipe,
+    OtpKeyCdcDone,
+    SetSoftwareErrsFatal,
+    Run,
+    LoadDShared,
+    LoadIShared,
+    DumpDShared,
+    DumpDDirty,
+    SaveState,
+    RestoreState,
+  };
+
+  explicit IssCommand(opcode_t opcode) : opcode_(opcode) {}
+
+  // Append arguments to the command. These must match the argument types in
+  // COMMANDS in iss_protocol.py. The hex32 and dec32 methods both append a
+  // 32-bit integer and only differ in how it is written in text mode. The
+  // le_bytes and le_words methods append a little-endian integer of the given
+  // size (written in hex in text mode).
+  IssCommand &hex32(uint32_t value);
+  IssCommand &dec32(uint32_t value);
+  IssCommand &le_bytes(const uint8_t *data, size_t len);
+  IssCommand &le_words(const uint32_t *data, size_t len);
+  IssCommand &str(const std::string &value);
+
+  opcode_t opcode() const { return opcode_; }
+
+  // The command as a line of text (including the trailing newline)
+  std::string to_text() const;
+
+  // The command as the payload of a binary frame
+  std::string to_payload() const;
+
+ private:
+  enum arg_type_t { Hex32, Dec32, Bytes, Str };
+  struct Arg {
+    arg_type_t type;
+    uint32_t value;
+    std::string data;
+  };
+
+  opcode_t opcode_;
+  std::vector<Arg> args_;
+};
+
+// A decoded response from the ISS
+class IssResponse {
+ public:
+  // External registers that are reported with dedicated records (EXT_REGS in
+  // iss_protocol.py).
+  enum ext_reg_t : uint8_t {
+    ExtIntrState,
+    ExtStatus,
+    ExtErrBits,
+    ExtInsnCnt,
+    ExtStopPc,
+    ExtRndReq,
+    ExtWipeStart,
+    ExtLoadChecksum,
+    NumExtRegs
+  };
+
+  typedef std::array<uint32_t, 8> wdr_t;
+
+  // The position of the end of a cycle in the response to a run command,
+  // given as the number of entries in lines and ext_regs at that point.
+  struct CycleEnd {
+    size_t num_lines;
+    size_t num_ext_regs;
+
+    bool operator==(const CycleEnd &other) const {
+      return num_lines == other.num_lines &&
+             num_ext_regs == other.num_ext_regs;
+    }
+  };
+
+  IssResponse() { clear(); }
+
+  void clear();
+
+  // Fill this object by parsing the text output from a command (without the
+  // terminating "." line). Throws a std::runtime_error on malformed input.
+  void from_text(const std::vector<std::string> &text_lines);
+
+  // Fill this object by decoding the payload of a binary frame. Throws a
+  // std::runtime_error on malformed input.
+  void from_payload(const std::string &payload);
+
+  // Render this object as text, in the same format that from_text parses
+  // (except that changes to external registers come after the other lines).
+  // This is used for error messages.
+  std::vector<std::string> to_text() const;
+
+  // A response to a run command covers several cycles. Split it into one
+  // response per cycle, appending them to *dst.
+  void split_cycles(std::deque<IssResponse> *dst) const;
+
+  bool operator==(const IssResponse &other) const;
+  bool operator!=(const IssResponse &other) const { return !(*this == other); }
+
+  static const char *ext_reg_name(ext_reg_t reg);
+
+  // Lines of output that aren't described by the fields below. For the step
+  // command, these are the ISS trace lines.
+  std::vector<std::string> lines;
+
+  // Changes to external registers, in the order they were reported
+  std::vector<std::pair<ext_reg_t, uint32_t>> ext_regs;
+
+  // The register file (set by print_regs). WDR words are in LSB order.
+  bool has_regs;
+  std::array<uint32_t, 32> gprs;
+  std::array<wdr_t, 32> wdrs;
+
+  // The call stack, starting from the bottom (set by print_call_stack)
+  std::vector<uint32_t> call_stack;
+
+  // The ends of the cycles that were run (set by run)
+  std::vector<CycleEnd> cycle_ends;
+};
+
+// A view of the memory that ISSWrapper shares with the ISS, which is used to
+// pass the contents of IMEM and DMEM without going through temporary files
+// (see the load_d_shared, load_i_shared, dump_d_shared and dump_d_dirty
+// commands). The layout matches sim/shared_mem.py.
+//
+// The region starts with a header of two 32-bit little-endian words, giving
+// the number of words of IMEM and of DMEM. The contents of IMEM and then DMEM
+// follow. Each 32-bit word is stored as 5 bytes (the format used by load_d and
+// dump_d): a validity byte (0 or 1) and then the word in little-endian order.
+// After DMEM, there is a dirty flag byte for each word of DMEM, which
+// dump_d_dirty sets to 1 for each word that it writes.
+class IssSharedMem {
+ public:
+  static const size_t kHeaderBytes = 8;
+  static const size_t kBytesPerWord = 5;
+
+  // The number of bytes needed for a region with the given memory sizes
+  static size_t size_bytes(uint32_t imem_words, uint32_t dmem_words);
+
+  // Wrap the region at base, which must be at least kHeaderBytes long and
+  // must already have a header.
+  explicit IssSharedMem(uint8_t *base) : base_(base) {}
+
+  // Write a header to the region at base, which must be at least
+  // size_bytes(imem_words, dmem_words) long.
+  static void write_header(uint8_t *base, uint32_t imem_words,
+                           uint32_t dmem_words);
+
+  uint32_t num_words(bool is_imem) const;
+
+  // The start of the (5-byte) words for IMEM or DMEM
+  uint8_t *words(bool is_imem) const;
+
+  // The dirty flags for DMEM (one byte per word)
+  uint8_t *dirty_flags() const;
+
+  // Read or write the 5-byte word at ptr. get_word throws a
+  // std::runtime_error if the validity byte is not 0 or 1.
+  static bool get_word(const uint8_t *ptr, uint32_t *value);
+  static void put_word(uint8_t *ptr, bool valid, uint32_t value);
+
+ private:
+  uint8_t *base_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_MODEL_ISS_PROTOCOL_H_
@@ -4,23 +4,38 @@
 
 #include "iss_wrapper.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <dirent.h>
+#include <exception>
 #include <fcntl.h>
+#include <fstream>
 #include <ftw.h>
-#include <iomanip>
+#include <functional>
 #include <iostream>
 #ifdef __MACH__
 #include <libproc.h>
 #endif
 #include <memory>
-#include <regex>
+#include <mutex>
 #include <signal.h>
 #include <sstream>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 
+#include "native_iss.h"
 #include "otbn_trace_checker.h"
+#include "spsc_queue.h"
 
 // Guard class to safely delete C strings
 namespace {
@@ -105,6 +120,291 @@ struct TmpDir {
   }
 };
 
+// Guard class for the memory that is shared with the ISS (see IssSharedMem in
+// iss_protocol.h). On Linux, this is backed by an anonymous memfd. Elsewhere,
+// it is backed by a file in tmp_dir, which is unlinked as soon as it has been
+// created. In either case, the file descriptor has FD_CLOEXEC set. The child
+// process clears this between fork and exec so that it can map the region.
+struct SharedMem {
+  int fd;
+  uint8_t *base;
+  size_t size;
+
+  SharedMem(const std::string &tmp_dir, uint32_t imem_words,
+            uint32_t dmem_words)
+      : fd(-1),
+        base(nullptr),
+        size(IssSharedMem::size_bytes(imem_words, dmem_words)) {
+#ifdef __linux__
+    (void)tmp_dir;
+    fd = memfd_create("otbn_iss_mem", MFD_CLOEXEC);
+#else
+    std::string path_template = tmp_dir + "/shared_mem_XXXXXX";
+    fd = mkstemp(&path_template.at(0));
+    if (fd >= 0) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      unlink(path_template.c_str());
+    }
+#endif
+    if (fd < 0)
+      fail("create");
+
+    if (ftruncate(fd, size) != 0)
+      fail("resize");
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+      fail("map");
+
+    base = static_cast<uint8_t *>(ptr);
+    IssSharedMem::write_header(base, imem_words, dmem_words);
+  }
+
+  ~SharedMem() {
+    if (base)
+      munmap(base, size);
+    if (fd >= 0)
+      close(fd);
+  }
+
+ private:
+  // Tidy up and throw a std::runtime_error, saying what we failed to do
+  void fail(const char *what) {
+    std::ostringstream oss;
+    oss << "Failed to " << what << " shared memory for OTBN ISS: "
+        << strerror(errno);
+    if (fd >= 0)
+      close(fd);
+    throw std::runtime_error(oss.str());
+  }
+};
+
+// A worker thread that runs the ISS ahead of the RTL (see OTBN_ISS_ASYNC in
+// iss_wrapper.h).
+//
+// Once kicked, the worker runs batches of cycles with run_batch and pushes the
+// response for each cycle onto the cycles queue. It stops when a batch ends
+// early or ends with an externally visible event, since the ISS might need an
+// input from the RTL before it can run the next cycle. It also stops if asked
+// to pause, which is how the main thread gets exclusive use of the ISS.
+//
+// Neither thread spins. The worker sleeps on wake_ until it is kicked or
+// there is space in the queue for another batch, and the main thread sleeps
+// on progress_ until the worker pushes some cycles or stops.
+struct IssWorker {
+  typedef std::function<void(IssResponse *)> run_batch_t;
+
+  IssWorker(uint32_t batch_size, run_batch_t run_batch)
+      : cycles(std::max<size_t>(1024, 4 * (size_t)batch_size)),
+        batch_size_(batch_size),
+        run_batch_(std::move(run_batch)),
+        busy_(false),
+        pause_(false),
+        want_space_(false),
+        quit_(false),
+        kicked_(false),
+        thread_(&IssWorker::main, this) {}
+
+  ~IssWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  // Start running batches of cycles. The worker must not be busy.
+  void kick() {
+    assert(!busy());
+    busy_.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      kicked_ = true;
+    }
+    wake_.notify_one();
+  }
+
+  // True if the worker is running cycles (or has been kicked, but hasn't
+  // started yet)
+  bool busy() const { return busy_.load(std::memory_order_acquire); }
+
+  // Wait for the worker to stop after its current batch and then rethrow any
+  // exception that it raised.
+  void pause() {
+    pause_.store(true);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.notify_one();
+      progress_.wait(lock, [this] { return !busy(); });
+    }
+    pause_.store(false);
+    rethrow_error();
+  }
+
+  // Pop the response for the next cycle from the queue (like cycles.try_pop)
+  // and wake the worker if it is waiting for space. Only call this from the
+  // main thread.
+  bool try_pop(IssResponse *dst) {
+    if (!cycles.try_pop(dst))
+      return false;
+
+    // Pairs with the fence in wait_for_space(): either the worker sees the
+    // space that we just made or we see that it is waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (want_space_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wake_.notify_one();
+    }
+    return true;
+  }
+
+  // Wait until the worker has pushed a cycle or has stopped. Only call this
+  // from the main thread.
+  void wait_for_cycle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    progress_.wait(lock, [this] { return !cycles.empty() || !busy(); });
+  }
+
+  // If the worker raised an exception since the last call, rethrow it. Only
+  // call this when the worker isn't busy.
+  void rethrow_error() {
+    if (!error_)
+      return;
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+
+  // The responses for cycles that the ISS has run but step() hasn't consumed.
+  // The worker pushes to this and the main thread pops from it.
+  SpscQueue<IssResponse> cycles;
+
+ private:
+  void main() {
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return kicked_ || quit_; });
+        if (quit_)
+          return;
+        kicked_ = false;
+      }
+
+      try {
+        run_until_stopped();
+      } catch (...) {
+        error_ = std::current_exception();
+      }
+      busy_.store(false, std::memory_order_release);
+      notify_progress();
+    }
+  }
+
+  // Wake the main thread if it is waiting in pause() or wait_for_cycle().
+  // Taking the mutex means that it can't miss the change to the queue or to
+  // busy_ between checking for it and going to sleep.
+  void notify_progress() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_.notify_one();
+  }
+
+  bool has_space() const {
+    return cycles.capacity() - cycles.size() >= batch_size_;
+  }
+
+  // Wait until there's space in the queue for a whole batch or we have been
+  // asked to stop.
+  void wait_for_space() {
+    if (has_space())
+      return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    want_space_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_.wait(lock, [this] { return stop_requested() || has_space(); });
+    want_space_.store(false, std::memory_order_relaxed);
+  }
+
+  // True if the cycle has a change to an external register other than
+  // INSN_CNT (matching the events that stop a run command)
+  static bool has_event(const IssResponse &cycle) {
+    for (const auto &pr : cycle.ext_regs) {
+      if (pr.first != IssResponse::ExtInsnCnt)
+        return true;
+    }
+    return false;
+  }
+
+  bool stop_requested() const { return pause_.load() || quit_.load(); }
+
+  void run_until_stopped() {
+    std::deque<IssResponse> batch_cycles;
+    for (;;) {
+      // Wait until there's space for a whole batch, so that pushing the
+      // cycles below can't fail.
+      wait_for_space();
+      if (stop_requested())
+        return;
+
+      IssResponse batch;
+      run_batch_(&batch);
+      batch.split_cycles(&batch_cycles);
+      if (batch_cycles.empty())
+        throw std::runtime_error("ISS ran no cycles for a run command.");
+
+      // The run command stops early at an event or when the next cycle might
+      // need an input from the RTL. A batch that stopped on its last cycle
+      // might not look like it stopped early, but that only happens on a
+      // cycle with an event: the other reasons for stopping (leaving the
+      // execute state and raising RND_REQ) cause one on the way in.
+      bool stopped = batch_cycles.size() < batch_size_ ||
+                     has_event(batch_cycles.back());
+
+      for (IssResponse &cycle : batch_cycles) {
+        bool pushed = cycles.try_push(std::move(cycle));
+        assert(pushed);
+        (void)pushed;
+      }
+      batch_cycles.clear();
+      notify_progress();
+
+      if (stopped)
+        return;
+    }
+  }
+
+  uint32_t batch_size_;
+  run_batch_t run_batch_;
+
+  // Set by the main thread when it kicks the worker and cleared by the worker
+  // when it stops.
+  std::atomic<bool> busy_;
+
+  // Set by the main thread to ask the worker to stop after its current batch
+  std::atomic<bool> pause_;
+
+  // Set by the worker while it waits in wait_for_space()
+  std::atomic<bool> want_space_;
+
+  // Protected by mutex_ and signalled with wake_: quit_ tells the worker to
+  // exit and kicked_ tells it to start running batches.
+  // quit_ is atomic because the worker also polls it while running batches.
+  // The worker signals progress_ when it pushes cycles or stops.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable progress_;
+  std::atomic<bool> quit_;
+  bool kicked_;
+
+  // An exception raised by the worker, which the main thread rethrows. This
+  // is only accessed by the worker while busy_ is set and by the main thread
+  // otherwise.
+  std::exception_ptr error_;
+
+  std::thread thread_;
+};
+
 // Find the top of the OpenTitan repository
 //
 // If REPO_TOP is defined, use that. Otherwise, this will only work if we're
@@ -202,54 +502,349 @@ static std::string find_otbn_model() {
   return std::string(abs_path.get());
 }
 
-// Read 8 hex characters from str as a uint32_t.
-static uint32_t read_hex_32(const char *str) {
+// Connect to the fork server listening at socket_path. Returns the connected
+// socket, or -1 if there is no server listening there. On other failures,
+// throws a std::runtime_error.
+static int connect_to_fork_server(const std::string &socket_path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof addr);
+  if (socket_path.size() >= sizeof addr.sun_path) {
+    std::ostringstream oss;
+    oss << "Path for OTBN ISS fork server socket is too long: `"
+        << socket_path << "'.";
+    throw std::runtime_error(oss.str());
+  }
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path.c_str());
+
+  // The child that the server forks runs as the server's user, so make sure
+  // that is us: otherwise, another user could serve us an ISS of their own.
+  struct stat sock_stat;
+  if (stat(socket_path.c_str(), &sock_stat) == 0 &&
+      sock_stat.st_uid != getuid()) {
+    std::ostringstream oss;
+    oss << "OTBN ISS fork server socket at `" << socket_path
+        << "' belongs to another user.";
+    throw std::runtime_error(oss.str());
+  }
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock == -1) {
+    std::ostringstream oss;
+    oss << "Failed to create socket for OTBN ISS fork server: "
+        << strerror(errno);
+    throw std::runtime_error(oss.str());
+  }
+  fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+  if (connect(sock, (struct sockaddr *)&addr, sizeof addr) == 0)
+    return sock;
+
+  int err = errno;
+  close(sock);
+  if (err == ENOENT || err == ECONNREFUSED)
+    return -1;
+
+  std::ostringstream oss;
+  oss << "Failed to connect to OTBN ISS fork server at `" << socket_path
+      << "': " << strerror(err);
+  throw std::runtime_error(oss.str());
+}
+
+// Start a fork server for the ISS at model_path, listening at socket_path. The
+// server runs in its own session and isn't our child, so it outlives this
+// process. Its output goes to a log file next to the socket.
+static void spawn_fork_server(const std::string &model_path,
+                              const std::string &socket_path) {
+  std::string server_path =
+      model_path.substr(0, model_path.find_last_of('/') + 1) +
+      "fork_server.py";
+  std::string log_path = socket_path + ".log";
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    std::ostringstream oss;
+    oss << "Failed to fork to start OTBN ISS fork server: " << strerror(errno);
+    throw std::runtime_error(oss.str());
+  }
+
+  if (pid == 0) {
+    // We are the child process. Start a new session and then fork again, so
+    // that the server is an orphan and can't get signals meant for us.
+    setsid();
+    pid_t server_pid = fork();
+    if (server_pid != 0)
+      _exit(server_pid == -1 ? 1 : 0);
+
+    int null_fd = open("/dev/null", O_RDONLY);
+    int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (null_fd == -1 || log_fd == -1 || dup2(null_fd, 0) == -1 ||
+        dup2(log_fd, 1) == -1 || dup2(log_fd, 2) == -1) {
+      _exit(1);
+    }
+    execl("/usr/bin/env", "/usr/bin/env", "python3", "-u",
+          server_path.c_str(), "--socket", socket_path.c_str(), NULL);
+    _exit(1);
+  }
+
+  // Wait for the intermediate child, which exits as soon as it has forked.
+  waitpid(pid, NULL, 0);
+}
+
+// The files that go into the source key for the fork server, as a directory
+// (relative to the directory that contains stepped.py) and the suffixes of the
+// files to include from it. This must match _SOURCE_KEY_DIRS in
+// fork_server.py.
+struct SourceKeyDir {
+  const char *rel_dir;
+  std::vector<std::string> suffixes;
+};
+static const SourceKeyDir kSourceKeyDirs[] = {
+    {".", {".py"}},
+    {"sim", {".py"}},
+    {"../../util/shared", {".py"}},
+    {"../../data", {".yml", ".hjson"}},
+};
+
+// Update a CRC-32 (as computed by zlib.crc32) with len bytes at data
+static uint32_t crc32_update(uint32_t crc, const char *data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= (uint8_t)data[i];
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static bool has_suffix(const std::string &name,
+                       const std::vector<std::string> &suffixes) {
+  for (const std::string &suffix : suffixes) {
+    if (name.size() >= suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Compute the source key that the fork server for the ISS at model_path should
+// have (see _source_key in fork_server.py). The server rejects requests with a
+// different key, which means that the simulator has changed since it started.
+static std::string fork_server_source_key(const std::string &model_path) {
+  std::string model_dir = model_path.substr(0, model_path.find_last_of('/'));
+
+  uint32_t crc = 0;
+  for (const SourceKeyDir &key_dir : kSourceKeyDirs) {
+    std::string dir_path = model_dir + "/" + key_dir.rel_dir;
+    DIR *dir = opendir(dir_path.c_str());
+    if (!dir) {
+      std::ostringstream oss;
+      oss << "Cannot list `" << dir_path << "' for OTBN ISS fork server: "
+          << strerror(errno);
+      throw std::runtime_error(oss.str());
+    }
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir)) {
+      std::string name(entry->d_name);
+      if (has_suffix(name, key_dir.suffixes))
+        names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string &name : names) {
+      std::string path = dir_path + "/" + name;
+      struct stat file_stat;
+      if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+        continue;
+      std::ifstream file(path, std::ios::binary);
+      std::ostringstream contents;
+      contents << file.rdbuf();
+      crc = crc32_update(crc, name.c_str(), name.size() + 1);
+      std::string data = contents.str();
+      crc = crc32_update(crc, data.c_str(), data.size() + 1);
+    }
+  }
+
   char buf[9];
-  memcpy(buf, str, 8);
-  buf[8] = '\0';
-  return strtoul(buf, nullptr, 16);
+  snprintf(buf, sizeof buf, "%08x", crc);
+  return buf;
 }
 
-// Read through trace output (in the lines argument) to pick up any write to
-// the named CSR register, updating *dest.
-static void read_ext_reg(const std::string &reg_name,
-                         const std::vector<std::string> &lines,
-                         uint32_t *dest) {
-  assert(dest);
+// Send a request to the fork server at socket_path, starting the server if
+// necessary, and return its reply. data is the request data (see
+// fork_from_server). On failure, throws a std::runtime_error.
+static std::string send_fork_request(const std::string &socket_path,
+                                     const std::string &model_path,
+                                     const std::string &data, int stdin_fd,
+                                     int stdout_fd, int shm_fd) {
+  int sock = connect_to_fork_server(socket_path);
+  if (sock == -1) {
+    spawn_fork_server(model_path, socket_path);
+
+    // Wait for the server to start listening. It has to import the simulator
+    // first, so give it a while.
+    for (int i = 0; i < 3000 && sock == -1; ++i) {
+      usleep(20000);
+      sock = connect_to_fork_server(socket_path);
+    }
+    if (sock == -1) {
+      std::ostringstream oss;
+      oss << "Timed out waiting for OTBN ISS fork server to start at `"
+          << socket_path << "' (see " << socket_path << ".log).";
+      throw std::runtime_error(oss.str());
+    }
+  }
 
-  // We're interested in lines that show an update to the external register
-  // called reg_name. These look something like this:
-  //
-  //   ! otbn.$REG_NAME: 0x00000000
-  std::regex re("! otbn\\." + reg_name + ": 0x([0-9a-f]{8})");
-  std::smatch match;
+  int fds[4] = {stdin_fd, stdout_fd, STDERR_FILENO, shm_fd};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof fds)];
+  } control;
+  memset(&control, 0, sizeof control);
+
+  struct iovec iov;
+  iov.iov_base = const_cast<char *>(data.data());
+  iov.iov_len = data.size();
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof msg);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof control.buf;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof fds);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof fds);
+
+#ifdef MSG_NOSIGNAL
+  int send_flags = MSG_NOSIGNAL;
+#else
+  int send_flags = 0;
+#endif
+  // The file descriptors go with the first part of the data. The request
+  // might be too big to send in one go, so send the rest separately and then
+  // shut down our side of the connection to mark the end of the request.
+  ssize_t sent = sendmsg(sock, &msg, send_flags);
+  size_t done = sent > 0 ? sent : 0;
+  while (sent > 0 && done < data.size()) {
+    sent = send(sock, data.data() + done, data.size() - done, send_flags);
+    if (sent > 0)
+      done += sent;
+    else if (sent == -1 && errno == EINTR)
+      sent = 0;
+  }
+  if (done < data.size() || shutdown(sock, SHUT_WR) != 0) {
+    int err = errno;
+    close(sock);
+    std::ostringstream oss;
+    oss << "Failed to send request to OTBN ISS fork server: " << strerror(err);
+    throw std::runtime_error(oss.str());
+  }
 
-  for (const auto &line : lines) {
-    if (std::regex_match(line, match, re)) {
-      // Ahah! We have a match. We have captured exactly 8 hex digits, so know
-      // that we can safely parse them to a uint32_t without risking a parse
-      // failure or overflow.
-      assert(match.size() == 2);
-      *dest = (uint32_t)strtoul(match[1].str().c_str(), nullptr, 16);
+  // The server replies with a single line and then closes the connection.
+  std::string reply;
+  char buf[256];
+  for (;;) {
+    ssize_t len = read(sock, buf, sizeof buf);
+    if (len > 0) {
+      reply.append(buf, len);
+    } else if (len == 0 || errno != EINTR) {
+      break;
     }
   }
+  close(sock);
+  return reply;
+}
+
+extern char **environ;
+
+// Ask the fork server at socket_path for a new ISS process, starting the
+// server if necessary. The child runs model_path with the given arguments,
+// using stdin_fd and stdout_fd as its stdin and stdout and mapping the shared
+// memory at shm_fd. It shares our stderr. Returns the PID of the child. On
+// failure, throws a std::runtime_error.
+//
+// If the server has a different source key, it exits and we start a new one.
+static pid_t fork_from_server(const std::string &socket_path,
+                              const std::string &model_path,
+                              const std::vector<std::string> &args,
+                              int stdin_fd, int stdout_fd, int shm_fd) {
+  // The request is a sequence of NUL-terminated strings, with the file
+  // descriptors for the child attached (see fork_server.py). The child gets
+  // our environment, rather than the one that the server started with.
+  c_str_ptr cwd(getcwd(NULL, 0));
+  if (!cwd) {
+    std::ostringstream oss;
+    oss << "Cannot get working directory: " << strerror(errno);
+    throw std::runtime_error(oss.str());
+  }
+  std::string data = model_path + '\0' +
+                     fork_server_source_key(model_path) + '\0' + cwd.get() +
+                     '\0';
+  std::vector<const char *> env_vars;
+  for (char **var = environ; *var; ++var)
+    env_vars.push_back(*var);
+  data += std::to_string(env_vars.size()) + '\0';
+  for (const char *var : env_vars)
+    data += std::string(var) + '\0';
+  for (const std::string &arg : args)
+    data += arg + '\0';
+
+  // A server that was started before the simulator changed replies "STALE"
+  // and exits. In that case, start a new one and try again.
+  std::string reply;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    reply = send_fork_request(socket_path, model_path, data, stdin_fd,
+                              stdout_fd, shm_fd);
+    if (reply != "STALE\n")
+      break;
+  }
+
+  long pid = 0;
+  if (reply.compare(0, 3, "OK ") == 0)
+    pid = strtol(reply.c_str() + 3, NULL, 10);
+  if (pid <= 0) {
+    if (!reply.empty() && reply.back() == '\n')
+      reply.pop_back();
+    std::ostringstream oss;
+    oss << "OTBN ISS fork server at `" << socket_path
+        << "' failed to start ISS: `" << reply << "'.";
+    throw std::runtime_error(oss.str());
+  }
+  return pid;
+}
+
+// Read through a response to pick up any write to the given external
+// register, updating *dest.
+static void read_ext_reg(IssResponse::ext_reg_t reg, const IssResponse &resp,
+                         uint32_t *dest) {
+  assert(dest);
+
+  for (const auto &pr : resp.ext_regs) {
+    if (pr.first == reg)
+      *dest = pr.second;
+  }
 }
 
 // A specialized version of read_ext_reg that updates a boolean flag
 // (assuming that the ISS will always signal the register as having
 // value 0 or 1). Prints a message to stderr and returns false on
 // error.
-static bool read_ext_flag(const std::string &reg_name,
-                          const std::vector<std::string> &lines, bool *dest) {
+static bool read_ext_flag(IssResponse::ext_reg_t reg, const IssResponse &resp,
+                          bool *dest) {
   assert(dest);
 
   uint32_t dest32 = *dest ? 1 : 0;
-  read_ext_reg(reg_name, lines, &dest32);
+  read_ext_reg(reg, resp, &dest32);
 
   if (dest32 > 1) {
-    std::cerr << "ERROR: Unexpected update to " << reg_name << " with value 0x"
-              << std::hex << dest32 << std::dec
-              << " when we expected a boolean flag.";
+    std::cerr << "ERROR: Unexpected update to "
+              << IssResponse::ext_reg_name(reg) << " with value 0x" << std::hex
+              << dest32 << std::dec << " when we expected a boolean flag.";
     return false;
   }
 
@@ -266,7 +861,93 @@ void MirroredRegs::reset() {
   wipe_start = false;
 }
 
-ISSWrapper::ISSWrapper() : tmpdir(new TmpDir()) {
+ISSWrapper::ISSWrapper(uint32_t imem_words, uint32_t dmem_words)
+    : backend_(backend_from_env()),
+      protocol_(protocol_from_env()),
+      run_ahead_(run_ahead_from_env()),
+      keep_history_(run_ahead_ > 1 || async_from_env()),
+      kept_files_(0),
+      fork_server_(fork_server_from_env()),
+      child_pid(-1),
+      child_write_file(nullptr),
+      child_read_file(nullptr),
+      tmpdir(new TmpDir()),
+      shared_mem_(new SharedMem(tmpdir->path, imem_words, dmem_words)) {
+  if (backend_ != PythonBackend)
+    native_.reset(new NativeISS(shared_mem_->base));
+  if (backend_ != NativeBackend)
+    start_child();
+
+  if (async_from_env()) {
+    // The run command stops early at the first event, so a batch of a single
+    // cycle wouldn't tell the worker whether it can carry on.
+    uint32_t batch_size = std::max<uint32_t>(2, run_ahead_);
+    worker_.reset(
+        new IssWorker(batch_size, [this, batch_size](IssResponse *dst) {
+          IssCommand cmd = IssCommand(IssCommand::Run).dec32(batch_size);
+          send_command(cmd, dst);
+          record_command(cmd, *dst);
+        }));
+  }
+}
+
+ISSWrapper::backend_t ISSWrapper::backend_from_env() {
+  const char *backend_str = getenv("OTBN_ISS_BACKEND");
+  if (!backend_str || strcmp(backend_str, "python") == 0)
+    return PythonBackend;
+  if (strcmp(backend_str, "native") == 0)
+    return NativeBackend;
+  if (strcmp(backend_str, "cross") == 0)
+    return CrossBackend;
+
+  std::ostringstream oss;
+  oss << "Unknown value for OTBN_ISS_BACKEND: `" << backend_str
+      << "'. Expected python, native or cross.";
+  throw std::runtime_error(oss.str());
+}
+
+ISSWrapper::protocol_t ISSWrapper::protocol_from_env() {
+  const char *protocol_str = getenv("OTBN_ISS_PROTOCOL");
+  if (!protocol_str || strcmp(protocol_str, "binary") == 0)
+    return BinaryProtocol;
+  if (strcmp(protocol_str, "text") == 0)
+    return TextProtocol;
+
+  std::ostringstream oss;
+  oss << "Unknown value for OTBN_ISS_PROTOCOL: `" << protocol_str
+      << "'. Expected binary or text.";
+  throw std::runtime_error(oss.str());
+}
+
+uint32_t ISSWrapper::run_ahead_from_env() {
+  const char *run_ahead_str = getenv("OTBN_ISS_RUN_AHEAD");
+  if (!run_ahead_str)
+    return 1;
+
+  char *end;
+  errno = 0;
+  unsigned long run_ahead = strtoul(run_ahead_str, &end, 0);
+  if (run_ahead_str[0] == '-' || errno || end == run_ahead_str || *end ||
+      run_ahead == 0 || run_ahead > UINT32_MAX) {
+    std::ostringstream oss;
+    oss << "Invalid value for OTBN_ISS_RUN_AHEAD: `" << run_ahead_str
+        << "'. Expected a positive number of cycles.";
+    throw std::runtime_error(oss.str());
+  }
+  return run_ahead;
+}
+
+bool ISSWrapper::async_from_env() {
+  const char *async_str = getenv("OTBN_ISS_ASYNC");
+  return async_str && !strcmp(async_str, "1");
+}
+
+std::string ISSWrapper::fork_server_from_env() {
+  const char *socket_path = getenv("OTBN_ISS_FORK_SERVER");
+  return socket_path ? socket_path : "";
+}
+
+void ISSWrapper::start_child() {
   std::string model_path(find_otbn_model());
 
   // We want two pipes: one for writing to the child process, and the other for
@@ -291,7 +972,27 @@ ISSWrapper::ISSWrapper() : tmpdir(new TmpDir()) {
   // We'll attach fds[0] to the child's stdin and fds[3] to the child's stdout.
   // That means we write to fds[1] to send data to the child and read from
   // fds[2] to get data back.
-  pid_t pid = fork();
+  std::string shm_arg = "--shared-mem=" + std::to_string(shared_mem_->fd);
+
+  pid_t pid;
+  if (fork_server_.empty()) {
+    pid = fork();
+  } else {
+    // The fork server does the fork for us, so we never get to the child
+    // branch below.
+    std::vector<std::string> args;
+    if (protocol_ == BinaryProtocol)
+      args.push_back("--binary");
+    try {
+      pid = fork_from_server(fork_server_, model_path, args, fds[0], fds[3],
+                             shared_mem_->fd);
+    } catch (...) {
+      for (int fd : fds)
+        close(fd);
+      throw;
+    }
+  }
+
   if (pid == -1) {
     // Something went wrong.
     std::ostringstream oss;
@@ -314,9 +1015,20 @@ ISSWrapper::ISSWrapper() : tmpdir(new TmpDir()) {
                 << "\n";
       abort();
     }
+    // Let the ISS keep the shared memory fd over the exec
+    if (fcntl(shared_mem_->fd, F_SETFD, 0) == -1) {
+      std::cerr << "Failed to share memory with ISS subprocess: "
+                << strerror(errno) << "\n";
+      abort();
+    }
     // Finally, exec the ISS
-    execl("/usr/bin/env", "/usr/bin/env", "python3", "-u", model_path.c_str(),
-          NULL);
+    if (protocol_ == BinaryProtocol) {
+      execl("/usr/bin/env", "/usr/bin/env", "python3", "-u",
+            model_path.c_str(), shm_arg.c_str(), "--binary", NULL);
+    } else {
+      execl("/usr/bin/env", "/usr/bin/env", "python3", "-u",
+            model_path.c_str(), shm_arg.c_str(), NULL);
+    }
   }
 
   // We are the parent process and pid is the PID of the child. Close the pipe
@@ -335,16 +1047,48 @@ ISSWrapper::ISSWrapper() : tmpdir(new TmpDir()) {
   // valid). Add an assertion to make sure nothing weird happens.
   assert(child_write_file);
   assert(child_read_file);
+
+  if (protocol_ == BinaryProtocol) {
+    // If the handshake fails, the constructor won't complete, so we have to
+    // tidy up the child process here, rather than in the destructor.
+    try {
+      check_child_hello();
+    } catch (...) {
+      if (fork_server_.empty()) {
+        kill(child_pid, SIGKILL);
+        waitpid(child_pid, NULL, 0);
+      }
+      fclose(child_write_file);
+      fclose(child_read_file);
+      child_pid = -1;
+      throw;
+    }
+  }
 }
 
 ISSWrapper::~ISSWrapper() {
-  // Stop the child process if it's still running. No need to be nice: we'll
-  // just send a SIGKILL. Also, no need to check whether it's running first: we
-  // can just fire off the signal and ignore whether it worked or not.
-  kill(child_pid, SIGKILL);
-
-  // Now wait for the child. This should be a very short wait.
-  waitpid(child_pid, NULL, 0);
+  // Stop the worker thread (if any) before tearing down the ISS that it talks
+  // to.
+  worker_.reset();
+
+  // Nothing to do if we never started a child process (because we're just
+  // using the native model).
+  if (child_pid == -1)
+    return;
+
+  // If the child came from the fork server, it isn't ours to kill or wait
+  // for. It will exit when it sees EOF on its stdin, once we close
+  // child_write_file below. (Sending it a signal might hit an unrelated
+  // process if it had already exited and its PID had been reused.)
+  if (fork_server_.empty()) {
+    // Stop the child process if it's still running. No need to be nice: we'll
+    // just send a SIGKILL. Also, no need to check whether it's running first:
+    // we can just fire off the signal and ignore whether it worked or not.
+    kill(child_pid, SIGKILL);
+
+    // Now wait for the child. This should be a very short wait.
+    waitpid(child_pid, NULL, 0);
+  }
 
   // Close the child file handles.
   fclose(child_write_file);
@@ -352,110 +1096,276 @@ ISSWrapper::~ISSWrapper() {
 }
 
 void ISSWrapper::load_d(const std::string &path) {
-  std::ostringstream oss;
-  oss << "load_d " << path << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::LoadD).str(keep_file(path)), nullptr);
 }
 
 void ISSWrapper::load_i(const std::string &path) {
-  std::ostringstream oss;
-  oss << "load_i " << path << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::LoadI).str(keep_file(path)), nullptr);
 }
 
 void ISSWrapper::add_loop_warp(uint32_t addr, uint32_t from_cnt,
                                uint32_t to_cnt) {
-  std::ostringstream oss;
-  oss << "add_loop_warp 0x" << std::hex << addr << std::dec << " " << from_cnt
-      << " " << to_cnt << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::AddLoopWarp)
+                  .hex32(addr)
+                  .dec32(from_cnt)
+                  .dec32(to_cnt),
+              nullptr);
 }
 
 void ISSWrapper::clear_loop_warps() {
-  run_command("clear_loop_warps\n", nullptr);
+  run_command(IssCommand(IssCommand::ClearLoopWarps), nullptr);
+}
+
+// Read the contents of a file into a string. Throws a std::runtime_error on
+// failure.
+static std::string read_file_contents(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::ostringstream oss;
+    oss << "Cannot open `" << path << "' for reading.";
+    throw std::runtime_error(oss.str());
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
 }
 
 void ISSWrapper::dump_d(const std::string &path) const {
+  if (backend_ != CrossBackend) {
+    run_command(IssCommand(IssCommand::DumpD).str(path), nullptr);
+    return;
+  }
+
+  // This talks to the two models directly, rather than with run_command, so
+  // needs to rewind the ISS itself. The command doesn't change the ISS state,
+  // so there's nothing to record in the history.
+  pause_worker();
+  rewind();
+
+  // When cross-checking, each model writes its own dump and we check that
+  // they match. The command echo includes the path, so the two responses
+  // won't match and we don't compare them.
+  std::string native_path = path + ".native";
+  IssResponse resp;
+  run_child_command(IssCommand(IssCommand::DumpD).str(path), &resp);
+  native_->run_command(IssCommand(IssCommand::DumpD).str(native_path).to_text(),
+                       nullptr);
+
+  bool match = read_file_contents(path) == read_file_contents(native_path);
+  remove(native_path.c_str());
+  if (!match) {
+    std::ostringstream err;
+    err << "OTBN ISS cross-check failed: DMEM contents dumped to `" << path
+        << "' by the Python ISS don't match the native model.";
+    throw std::runtime_error(err.str());
+  }
+}
+
+void ISSWrapper::load_d_shared() {
+  run_command(IssCommand(IssCommand::LoadDShared), nullptr);
+}
+
+void ISSWrapper::load_i_shared() {
+  run_command(IssCommand(IssCommand::LoadIShared), nullptr);
+}
+
+void ISSWrapper::dump_d_shared() const {
+  if (backend_ != CrossBackend) {
+    run_command(IssCommand(IssCommand::DumpDShared), nullptr);
+    return;
+  }
+
+  // This talks to the two models directly, rather than with run_command, so
+  // needs to rewind the ISS and record the command itself.
+  pause_worker();
+  rewind();
+
+  // When cross-checking, both models write to the same buffer. Take a copy of
+  // what the Python ISS wrote, then check that the native model writes the
+  // same thing.
+  IssSharedMem shm = get_shared_mem();
+  const uint8_t *dmem = shm.words(false);
+  size_t dmem_bytes = IssSharedMem::kBytesPerWord * shm.num_words(false);
+
+  IssResponse resp;
+  run_child_command(IssCommand(IssCommand::DumpDShared), &resp);
+  std::vector<uint8_t> py_dmem(dmem, dmem + dmem_bytes);
+  native_->run_command(IssCommand(IssCommand::DumpDShared).to_text(),
+                       nullptr);
+  record_command(IssCommand(IssCommand::DumpDShared), resp);
+  if (!std::equal(py_dmem.begin(), py_dmem.end(), dmem)) {
+    throw std::runtime_error(
+        "OTBN ISS cross-check failed: DMEM contents dumped to shared memory "
+        "by the Python ISS don't match the native model.");
+  }
+}
+
+void ISSWrapper::dump_d_dirty() const {
+  if (backend_ != CrossBackend) {
+    run_command(IssCommand(IssCommand::DumpDDirty), nullptr);
+    return;
+  }
+
+  // This talks to the two models directly, rather than with run_command, so
+  // needs to rewind the ISS and record the command itself.
+  pause_worker();
+  rewind();
+
+  // As with dump_d_shared, both models write to the same buffer. Since they
+  // only write the dirty words, take a copy of the DMEM words and dirty flags
+  // beforehand and restore it before running the native model. The two
+  // models should agree about which words are dirty, as well as their
+  // contents.
+  IssSharedMem shm = get_shared_mem();
+  uint8_t *dmem = shm.words(false);
+  size_t dmem_bytes = (IssSharedMem::kBytesPerWord + 1) * shm.num_words(false);
+
+  std::vector<uint8_t> old_dmem(dmem, dmem + dmem_bytes);
+  IssResponse resp;
+  run_child_command(IssCommand(IssCommand::DumpDDirty), &resp);
+  std::vector<uint8_t> py_dmem(dmem, dmem + dmem_bytes);
+  std::copy(old_dmem.begin(), old_dmem.end(), dmem);
+  native_->run_command(IssCommand(IssCommand::DumpDDirty).to_text(), nullptr);
+  record_command(IssCommand(IssCommand::DumpDDirty), resp);
+  if (!std::equal(py_dmem.begin(), py_dmem.end(), dmem)) {
+    throw std::runtime_error(
+        "OTBN ISS cross-check failed: dirty DMEM words dumped to shared "
+        "memory by the Python ISS don't match the native model.");
+  }
+}
+
+IssSharedMem ISSWrapper::get_shared_mem() const {
+  return IssSharedMem(shared_mem_->base);
+}
+
+// Throw a std::runtime_error unless backend is PythonBackend. The native model
+// doesn't support saving and restoring its state, so neither can the
+// cross-checking backend.
+static void check_python_only(ISSWrapper::backend_t backend,
+                              const char *what) {
+  if (backend == ISSWrapper::PythonBackend)
+    return;
+
   std::ostringstream oss;
-  oss << "dump_d " << path << "\n";
-  run_command(oss.str(), nullptr);
+  oss << "Cannot " << what << " the OTBN ISS state: this is only supported "
+      << "with the Python ISS (OTBN_ISS_BACKEND=python).";
+  throw std::runtime_error(oss.str());
 }
 
-void ISSWrapper::start_operation(command_t command) {
-  std::ostringstream cmd_stream;
+void ISSWrapper::save_state(const std::string &path) const {
+  check_python_only(backend_, "save");
+  run_command(IssCommand(IssCommand::SaveState).str(path), nullptr);
+}
 
-  cmd_stream << "start_operation ";
+void ISSWrapper::restore_state(const std::string &path) {
+  check_python_only(backend_, "restore");
+
+  IssResponse resp;
+  run_command(IssCommand(IssCommand::RestoreState).str(keep_file(path)),
+              &resp);
+
+  // The ISS reports the current value of every register that we mirror.
+  read_ext_reg(IssResponse::ExtStatus, resp, &mirrored_.status);
+  read_ext_reg(IssResponse::ExtInsnCnt, resp, &mirrored_.insn_cnt);
+  read_ext_reg(IssResponse::ExtErrBits, resp, &mirrored_.err_bits);
+  read_ext_reg(IssResponse::ExtStopPc, resp, &mirrored_.stop_pc);
+  if (!read_ext_flag(IssResponse::ExtRndReq, resp, &mirrored_.rnd_req) ||
+      !read_ext_flag(IssResponse::ExtWipeStart, resp, &mirrored_.wipe_start)) {
+    throw std::runtime_error(
+        "Bad flag value in ISS response to restore_state.");
+  }
+}
+
+void ISSWrapper::start_operation(command_t command) {
+  IssCommand cmd(IssCommand::StartOperation);
 
   switch (command) {
     case Execute:
-      cmd_stream << "Execute\n";
+      cmd.str("Execute");
       break;
 
     case DmemWipe:
-      cmd_stream << "DmemWipe\n";
+      cmd.str("DmemWipe");
       break;
 
     case ImemWipe:
-      cmd_stream << "ImemWipe\n";
+      cmd.str("ImemWipe");
       break;
     default:
       assert(0);
   }
 
-  run_command(cmd_stream.str(), nullptr);
+  run_command(cmd, nullptr);
 }
 
 void ISSWrapper::otp_key_cdc_done() {
-  run_command("otp_key_cdc_done\n", nullptr);
+  run_command(IssCommand(IssCommand::OtpKeyCdcDone), nullptr);
 }
 
 void ISSWrapper::edn_rnd_cdc_done() {
-  run_command("edn_rnd_cdc_done\n", nullptr);
+  run_command(IssCommand(IssCommand::EdnRndCdcDone), nullptr);
 }
 
 void ISSWrapper::edn_urnd_cdc_done() {
-  run_command("edn_urnd_cdc_done\n", nullptr);
+  run_command(IssCommand(IssCommand::EdnUrndCdcDone), nullptr);
 }
 
-void ISSWrapper::edn_flush() { run_command("edn_flush\n", nullptr); }
+void ISSWrapper::edn_flush() {
+  run_command(IssCommand(IssCommand::EdnFlush), nullptr);
+}
 
 void ISSWrapper::edn_rnd_step(uint32_t edn_rnd_data, bool fips_err) {
-  std::ostringstream oss;
-  oss << "edn_rnd_step " << std::hex << "0x" << edn_rnd_data;
-  oss << " " << fips_err << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(
+      IssCommand(IssCommand::EdnRndStep).hex32(edn_rnd_data).dec32(fips_err),
+      nullptr);
 }
 
 void ISSWrapper::edn_urnd_step(uint32_t edn_urnd_data) {
-  std::ostringstream oss;
-  oss << "edn_urnd_step " << std::hex << "0x" << edn_urnd_data << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::EdnUrndStep).hex32(edn_urnd_data),
+              nullptr);
 }
 
 void ISSWrapper::set_keymgr_value(const std::array<uint32_t, 12> &key0_arr,
                                   const std::array<uint32_t, 12> &key1_arr,
                                   bool valid) {
-  std::ostringstream oss;
-
-  oss << "set_keymgr_value 0x" << std::hex << std::setfill('0');
-  for (int i = 0; i < 12; ++i) {
-    oss << std::setw(8) << key0_arr[11 - i];
-  }
-  oss << " 0x";
-  for (int i = 0; i < 12; ++i) {
-    oss << std::setw(8) << key1_arr[11 - i];
-  }
-  oss << " " << valid << "\n";
-
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::SetKeymgrValue)
+                  .le_words(key0_arr.data(), key0_arr.size())
+                  .le_words(key1_arr.data(), key1_arr.size())
+                  .dec32(valid),
+              nullptr);
 }
 
 int ISSWrapper::step(bool gen_trace) {
-  std::vector<std::string> lines;
-
-  run_command("step\n", &lines);
-  if (gen_trace && lines.size()) {
-    if (!OtbnTraceChecker::get().OnIssTrace(lines)) {
+  IssResponse resp;
+
+  if (worker_) {
+    // Take the next cycle from the worker, starting it if it has stopped. It
+    // might have pushed its last cycles just before stopping, so check the
+    // queue again before starting it.
+    while (!worker_->try_pop(&resp)) {
+      if (!worker_->busy()) {
+        if (worker_->try_pop(&resp))
+          break;
+        worker_->rethrow_error();
+        worker_->kick();
+      }
+      worker_->wait_for_cycle();
+    }
+  } else if (run_ahead_ <= 1) {
+    run_command(IssCommand(IssCommand::Step), &resp);
+  } else {
+    if (pending_cycles_.empty()) {
+      IssResponse batch;
+      run_command(IssCommand(IssCommand::Run).dec32(run_ahead_), &batch);
+      batch.split_cycles(&pending_cycles_);
+      if (pending_cycles_.empty())
+        throw std::runtime_error("ISS ran no cycles for a run command.");
+    }
+    resp = std::move(pending_cycles_.front());
+    pending_cycles_.pop_front();
+  }
+  if (gen_trace && resp.lines.size()) {
+    if (!OtbnTraceChecker::get().OnIssTrace(resp.lines)) {
       return -1;
     }
   }
@@ -463,7 +1373,7 @@ int ISSWrapper::step(bool gen_trace) {
   // Try to read STATUS, which is written when execution ends. Execution has
   // finished if status_ is either 0 (IDLE) or 0xff (LOCKED)
   bool was_stopped = mirrored_.stopped();
-  read_ext_reg("STATUS", lines, &mirrored_.status);
+  read_ext_reg(IssResponse::ExtStatus, resp, &mirrored_.status);
   bool is_stopped = mirrored_.stopped();
   bool done = is_stopped && !was_stopped;
 
@@ -471,51 +1381,44 @@ int ISSWrapper::step(bool gen_trace) {
   // flags. Some of these flags only get updated around the end of an operation
   // but the precise timing is slightly fiddly, so it's easiest to just allow
   // updates whenever they arrive.
-  read_ext_reg("INSN_CNT", lines, &mirrored_.insn_cnt);
-  read_ext_reg("ERR_BITS", lines, &mirrored_.err_bits);
-  read_ext_reg("STOP_PC", lines, &mirrored_.stop_pc);
+  read_ext_reg(IssResponse::ExtInsnCnt, resp, &mirrored_.insn_cnt);
+  read_ext_reg(IssResponse::ExtErrBits, resp, &mirrored_.err_bits);
+  read_ext_reg(IssResponse::ExtStopPc, resp, &mirrored_.stop_pc);
 
-  if (!read_ext_flag("RND_REQ", lines, &mirrored_.rnd_req))
+  if (!read_ext_flag(IssResponse::ExtRndReq, resp, &mirrored_.rnd_req))
     return -1;
-  if (!read_ext_flag("WIPE_START", lines, &mirrored_.wipe_start))
+  if (!read_ext_flag(IssResponse::ExtWipeStart, resp, &mirrored_.wipe_start))
     return -1;
 
   return done ? 1 : 0;
 }
 
 void ISSWrapper::invalidate_imem() {
-  run_command("invalidate_imem\n", nullptr);
+  run_command(IssCommand(IssCommand::InvalidateImem), nullptr);
 }
 
 void ISSWrapper::invalidate_dmem() {
-  run_command("invalidate_dmem\n", nullptr);
+  run_command(IssCommand(IssCommand::InvalidateDmem), nullptr);
 }
 
 void ISSWrapper::set_software_errs_fatal(bool new_val) {
-  std::ostringstream oss;
-
-  oss << "set_software_errs_fatal " << new_val << "\n";
-
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::SetSoftwareErrsFatal).dec32(new_val),
+              nullptr);
 }
 
 void ISSWrapper::initial_secure_wipe() {
-  run_command("initial_secure_wipe\n", nullptr);
+  run_command(IssCommand(IssCommand::InitialSecureWipe), nullptr);
 }
 
 uint32_t ISSWrapper::step_crc(const std::array<uint8_t, 6> &item,
                               uint32_t state) const {
-  std::vector<std::string> lines;
-
-  std::ostringstream oss;
-  oss << std::hex << "step_crc 0x" << std::setfill('0');
-  for (size_t i = 0; i < item.size(); ++i) {
-    oss << std::setw(2) << (int)item[5 - i];
-  }
-  oss << " 0x" << std::setw(8) << state << "\n";
-  run_command(oss.str(), &lines);
+  IssResponse resp;
+  run_command(IssCommand(IssCommand::StepCrc)
+                  .le_bytes(item.data(), item.size())
+                  .hex32(state),
+              &resp);
 
-  read_ext_reg("LOAD_CHECKSUM", lines, &state);
+  read_ext_reg(IssResponse::ExtLoadChecksum, resp, &state);
   return state;
 }
 
@@ -523,141 +1426,49 @@ void ISSWrapper::reset(bool gen_trace) {
   if (gen_trace)
     OtbnTraceChecker::get().Flush();
 
-  run_command("reset\n", nullptr);
+  // There's no need to rewind the ISS before resetting it, so discard any
+  // queued cycles here, rather than letting run_command do so.
+  pause_worker();
+  discard_queued_cycles();
+  run_command(IssCommand(IssCommand::Reset), nullptr);
 
   // Reset all mirrored registers.
   mirrored_.reset();
 }
 
 void ISSWrapper::send_err_escalation(uint32_t err_val, bool lock_immediately) {
-  std::ostringstream oss;
-  oss << "send_err_escalation " << std::hex << "0x" << err_val << " "
-      << lock_immediately << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::SendErrEscalation)
+                  .hex32(err_val)
+                  .dec32(lock_immediately),
+              nullptr);
 }
 
 void ISSWrapper::set_rma_req(uint8_t rma_req) {
-  std::ostringstream oss;
-  oss << "set_rma_req " << std::hex << "0x" << (int)rma_req << "\n";
-  run_command(oss.str(), nullptr);
+  run_command(IssCommand(IssCommand::SetRmaReq).hex32(rma_req), nullptr);
 }
 
 void ISSWrapper::get_regs(std::array<uint32_t, 32> *gprs,
                           std::array<u256_t, 32> *wdrs) {
   assert(gprs && wdrs);
 
-  std::vector<std::string> lines;
-  run_command("print_regs\n", &lines);
-
-  // A record of which registers we've seen (to check we see each
-  // register exactly once). GPR i sets bit i. WDR i sets bit 32 + i.
-  uint64_t seen_mask = 0;
-
-  // Lines look like
-  //
-  //  x3  = 0x12345678
-  //  w10 = 0x0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef
-
-  std::regex re("\\s*([wx][0-9]{1,2})\\s*=\\s*0x([0-9a-f]+)");
-  std::smatch match;
-
-  for (const std::string &line : lines) {
-    if (line == "PRINT_REGS")
-      continue;
-
-    if (!std::regex_match(line, match, re)) {
-      std::ostringstream oss;
-      oss << "Invalid line in ISS print_register output (`" << line << "').";
-      throw std::runtime_error(oss.str());
-    }
-
-    assert(match.size() == 3);
-
-    std::string reg_name = match[1].str();
-    std::string str_value = match[2].str();
-
-    assert(reg_name.size() <= 3);
-    assert(reg_name[0] == 'w' || reg_name[0] == 'x');
-    bool is_wide = reg_name[0] == 'w';
-    int reg_idx = atoi(reg_name.c_str() + 1);
-
-    assert(reg_idx >= 0);
-    if (reg_idx >= 32) {
-      std::ostringstream oss;
-      oss << "Invalid register name in ISS output (`" << reg_name
-          << "'). Line was `" << line << "'.";
-      throw std::runtime_error(oss.str());
-    }
-
-    unsigned idx_seen = reg_idx + (is_wide ? 32 : 0);
-    if ((seen_mask >> idx_seen) & 1) {
-      std::ostringstream oss;
-      oss << "Duplicate lines writing register " << reg_name << ".";
-      throw std::runtime_error(oss.str());
-    }
+  IssResponse resp;
+  run_command(IssCommand(IssCommand::PrintRegs), &resp);
 
-    unsigned num_u32s = is_wide ? 8 : 1;
-    unsigned expected_value_len = 8 * num_u32s;
-    if (str_value.size() != expected_value_len) {
-      std::ostringstream oss;
-      oss << "Value for register " << reg_name << " has " << str_value.size()
-          << " hex characters, but we expected " << expected_value_len << ".";
-      throw std::runtime_error(oss.str());
-    }
-
-    uint32_t *dst = is_wide ? &(*wdrs)[reg_idx].words[7] : &(*gprs)[reg_idx];
-    for (unsigned i = 0; i < num_u32s; ++i) {
-      *dst = read_hex_32(&str_value[8 * i]);
-      --dst;
-    }
-
-    seen_mask |= ((uint64_t)1 << idx_seen);
+  if (!resp.has_regs) {
+    throw std::runtime_error(
+        "No register dump in ISS response to print_regs.");
   }
 
-  // Check that we've seen all the registers
-  if (~seen_mask) {
-    std::ostringstream oss;
-    oss << "Some registers were missing from print_register output. Mask: 0x"
-        << std::hex << seen_mask << ".";
-    throw std::runtime_error(oss.str());
+  *gprs = resp.gprs;
+  for (int i = 0; i < 32; ++i) {
+    std::copy(resp.wdrs[i].begin(), resp.wdrs[i].end(), (*wdrs)[i].words);
   }
 }
 
 std::vector<uint32_t> ISSWrapper::get_call_stack() {
-  std::vector<std::string> lines;
-  run_command("print_call_stack\n", &lines);
-
-  std::regex re("\\s*0x([0-9a-f]+)");
-  std::smatch match;
-  std::vector<uint32_t> call_stack;
-
-  for (const std::string &line : lines) {
-    if (line == "PRINT_CALL_STACK")
-      continue;
-
-    if (!std::regex_match(line, match, re)) {
-      std::ostringstream oss;
-      oss << "Invalid line in ISS print_call_stack output (`" << line << "').";
-      throw std::runtime_error(oss.str());
-    }
-
-    assert(match.size() == 2);
-
-    std::string str_value = match[1];
-
-    if (str_value.size() != 8) {
-      std::ostringstream oss;
-      oss << "Value from call stack " << str_value << " has "
-          << str_value.size() << " hex characters, but we expected 8.";
-      throw std::runtime_error(oss.str());
-    }
-
-    uint32_t call_stack_entry = read_hex_32(str_value.c_str());
-
-    call_stack.push_back(call_stack_entry);
-  }
-
-  return call_stack;
+  IssResponse resp;
+  run_command(IssCommand(IssCommand::PrintCallStack), &resp);
+  return resp.call_stack;
 }
 
 std::string ISSWrapper::make_tmp_path(const std::string &relative) const {
@@ -713,17 +1524,282 @@ bool ISSWrapper::read_child_response(std::vector<std::string> *dst) const {
   }
 }
 
-void ISSWrapper::run_command(const std::string &cmd,
-                             std::vector<std::string> *dst) const {
-  assert(cmd.size() > 0);
-  assert(cmd.back() == '\n');
+bool ISSWrapper::read_child_frame(std::string *payload) const {
+  assert(payload);
+
+  uint8_t hdr[4];
+  if (fread(hdr, 1, sizeof hdr, child_read_file) != sizeof hdr)
+    return false;
+
+  size_t len = (size_t)hdr[0] | ((size_t)hdr[1] << 8) |
+               ((size_t)hdr[2] << 16) | ((size_t)hdr[3] << 24);
+  payload->resize(len);
+  return len == 0 || fread(&payload->at(0), 1, len, child_read_file) == len;
+}
+
+void ISSWrapper::check_child_hello() const {
+  std::string payload;
+  if (!read_child_frame(&payload)) {
+    throw std::runtime_error(
+        "Failed to start ISS: EOF before protocol handshake.");
+  }
+
+  size_t magic_len = sizeof kIssProtocolMagic - 1;
+  if (payload.size() != magic_len + 2 ||
+      payload.compare(0, magic_len, kIssProtocolMagic) != 0) {
+    throw std::runtime_error(
+        "Failed to start ISS: bad protocol handshake from stepped.py.");
+  }
+
+  unsigned version = (uint8_t)payload[magic_len] |
+                     ((unsigned)(uint8_t)payload[magic_len + 1] << 8);
+  if (version != kIssProtocolVersion) {
+    std::ostringstream oss;
+    oss << "Failed to start ISS: stepped.py speaks version " << version
+        << " of the binary protocol, but we expected version "
+        << kIssProtocolVersion << ".";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+void ISSWrapper::run_child_command(const IssCommand &cmd,
+                                   IssResponse *dst) const {
+  assert(child_write_file && child_read_file);
+  assert(dst);
+
+  bool got_response;
+  if (protocol_ == BinaryProtocol) {
+    std::string payload = cmd.to_payload();
+    uint32_t len = payload.size();
+    uint8_t hdr[4] = {(uint8_t)len, (uint8_t)(len >> 8), (uint8_t)(len >> 16),
+                      (uint8_t)(len >> 24)};
+    fwrite(hdr, 1, sizeof hdr, child_write_file);
+    fwrite(payload.data(), 1, payload.size(), child_write_file);
+    fflush(child_write_file);
+
+    got_response = read_child_frame(&payload);
+    if (got_response)
+      dst->from_payload(payload);
+  } else {
+    std::vector<std::string> lines;
+    fputs(cmd.to_text().c_str(), child_write_file);
+    fflush(child_write_file);
+
+    got_response = read_child_response(&lines);
+    if (got_response)
+      dst->from_text(lines);
+  }
 
-  fputs(cmd.c_str(), child_write_file);
-  fflush(child_write_file);
-  if (!read_child_response(dst)) {
+  if (!got_response) {
     std::ostringstream oss;
-    std::string cmd_line = cmd.substr(0, cmd.size() - 1);
+    std::string cmd_line = cmd.to_text();
+    cmd_line.pop_back();
     oss << "Failed to run command '" << cmd_line << "': EOF from ISS.";
     throw std::runtime_error(oss.str());
   }
 }
+
+void ISSWrapper::pause_worker() const {
+  if (worker_)
+    worker_->pause();
+}
+
+size_t ISSWrapper::queued_cycles() const {
+  return pending_cycles_.size() + (worker_ ? worker_->cycles.size() : 0);
+}
+
+void ISSWrapper::discard_queued_cycles() const {
+  pending_cycles_.clear();
+  if (worker_) {
+    IssResponse discard;
+    while (worker_->cycles.try_pop(&discard)) {
+    }
+  }
+}
+
+void ISSWrapper::rewind() const {
+  size_t num_queued = queued_cycles();
+  if (!num_queued)
+    return;
+
+  // The queued cycles are the last thing that the ISS ran: any other command
+  // would have rewound it first. Drop them from the history.
+  assert(keep_history_ && !history_.empty() &&
+         history_.back().num_cycles >= num_queued);
+  discard_queued_cycles();
+  history_.back().num_cycles -= num_queued;
+  if (!history_.back().num_cycles)
+    history_.pop_back();
+
+  // Replaying the commands that use the shared memory overwrites it, so save
+  // its contents and put them back afterwards.
+  uint8_t *shm_base = shared_mem_->base;
+  std::vector<uint8_t> saved_mem(shm_base, shm_base + shared_mem_->size);
+
+  IssResponse reset_resp;
+  send_command(IssCommand(IssCommand::Reset), &reset_resp);
+  for (const HistoryEntry &entry : history_) {
+    // A run command stops early at an event, so it might take several to run
+    // the cycles in a single entry.
+    uint32_t cycles_left = entry.num_cycles;
+    while (cycles_left) {
+      IssResponse resp;
+      send_command(IssCommand(IssCommand::Run).dec32(cycles_left), &resp);
+      size_t cycles_run = resp.cycle_ends.size();
+      if (!cycles_run || cycles_run > cycles_left) {
+        throw std::runtime_error(
+            "ISS ran an unexpected number of cycles while replaying its "
+            "history.");
+      }
+      cycles_left -= cycles_run;
+    }
+    if (entry.num_cycles)
+      continue;
+
+    if (!entry.shared_mem.empty())
+      std::copy(entry.shared_mem.begin(), entry.shared_mem.end(), shm_base);
+
+    IssResponse resp;
+    send_command(entry.cmd, &resp);
+  }
+
+  std::copy(saved_mem.begin(), saved_mem.end(), shm_base);
+}
+
+void ISSWrapper::record_command(const IssCommand &cmd,
+                                const IssResponse &resp) const {
+  if (!keep_history_)
+    return;
+
+  uint32_t num_cycles = 0;
+  switch (cmd.opcode()) {
+    // These commands don't change the ISS state.
+    case IssCommand::DumpD:
+    case IssCommand::PrintRegs:
+    case IssCommand::PrintCallStack:
+    case IssCommand::StepCrc:
+    case IssCommand::SaveState:
+      return;
+
+    // Replaying the history starts with a reset, and a restored state
+    // replaces everything that came before it.
+    case IssCommand::Reset:
+      history_.clear();
+      return;
+    case IssCommand::RestoreState:
+      history_.clear();
+      break;
+
+    case IssCommand::Step:
+      num_cycles = 1;
+      break;
+    case IssCommand::Run:
+      num_cycles = resp.cycle_ends.size();
+      break;
+
+    default:
+      break;
+  }
+
+  if (num_cycles) {
+    if (!history_.empty() && history_.back().num_cycles)
+      history_.back().num_cycles += num_cycles;
+    else
+      history_.push_back(
+          HistoryEntry{IssCommand(IssCommand::Run), num_cycles, {}});
+    return;
+  }
+
+  HistoryEntry entry{cmd, 0, {}};
+  if (cmd.opcode() == IssCommand::LoadDShared ||
+      cmd.opcode() == IssCommand::LoadIShared) {
+    const uint8_t *shm_base = shared_mem_->base;
+    entry.shared_mem.assign(shm_base, shm_base + shared_mem_->size);
+  }
+  history_.push_back(std::move(entry));
+}
+
+std::string ISSWrapper::keep_file(const std::string &path) {
+  if (!keep_history_)
+    return path;
+
+  std::string copy_path =
+      make_tmp_path("history_" + std::to_string(kept_files_++));
+  std::ofstream copy(copy_path, std::ios::binary);
+  copy << read_file_contents(path);
+  copy.close();
+  if (!copy) {
+    std::ostringstream oss;
+    oss << "Cannot copy `" << path << "' to `" << copy_path << "'.";
+    throw std::runtime_error(oss.str());
+  }
+  return copy_path;
+}
+
+void ISSWrapper::run_command(const IssCommand &cmd, IssResponse *dst) const {
+  // If the ISS has run ahead, its state is from a later cycle than the RTL.
+  // The only command that doesn't care is step_crc, which is a pure function.
+  pause_worker();
+  if (cmd.opcode() != IssCommand::StepCrc)
+    rewind();
+
+  // Every command gets a response, even if the caller doesn't care about it.
+  IssResponse scratch;
+  IssResponse *resp = dst ? dst : &scratch;
+  send_command(cmd, resp);
+  record_command(cmd, *resp);
+}
+
+void ISSWrapper::send_command(const IssCommand &cmd, IssResponse *dst) const {
+  assert(dst);
+
+  switch (backend_) {
+    case PythonBackend:
+      run_child_command(cmd, dst);
+      return;
+
+    case NativeBackend: {
+      std::vector<std::string> lines;
+      native_->run_command(cmd.to_text(), &lines);
+      dst->from_text(lines);
+      return;
+    }
+
+    case CrossBackend:
+      break;
+
+    default:
+      assert(0);
+  }
+
+  IssResponse native_resp;
+  std::vector<std::string> native_lines;
+  run_child_command(cmd, dst);
+  native_->run_command(cmd.to_text(), &native_lines);
+  native_resp.from_text(native_lines);
+
+  if (*dst != native_resp) {
+    // Find the first line that differs and report it, together with the
+    // command that caused the mismatch.
+    std::vector<std::string> py_lines = dst->to_text();
+    native_lines = native_resp.to_text();
+
+    size_t idx = 0;
+    while (idx < py_lines.size() && idx < native_lines.size() &&
+           py_lines[idx] == native_lines[idx])
+      ++idx;
+
+    std::string cmd_line = cmd.to_text();
+    cmd_line.pop_back();
+
+    std::ostringstream oss;
+    oss << "OTBN ISS cross-check failed for command `" << cmd_line
+        << "'. Output line " << idx << " is `"
+        << (idx < py_lines.size() ? py_lines[idx] : std::string("<none>"))
+        << "' from the Python ISS but `"
+        << (idx < native_lines.size() ? native_lines[idx]
+                                      : std::string("<none>"))
+        << "' from the native model.";
+    throw std::runtime_error(oss.str());
+  }
+}
@@ -7,13 +7,20 @@
 #include <array>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <memory>
 #include <string>
 #include <unistd.h>
 #include <vector>
 
-// Forward declaration (the implementation is private in iss_wrapper.cc)
+#include "iss_protocol.h"
+
+// Forward declarations (the implementations are private in iss_wrapper.cc and
+// native_iss.h)
+struct IssWorker;
+struct SharedMem;
 struct TmpDir;
+class NativeISS;
 
 // OTBN has some externally visible CSRs that can be updated by hardware
 // (without explicit writes from software). The ISSWrapper mirrors the ISS's
@@ -44,7 +51,43 @@ class MirroredRegs {
   bool stopped() const { return status == 0 || status == 0xff; }
 };
 
-// An object wrapping the ISS subprocess.
+// An object wrapping the ISS.
+//
+// The model that actually runs is chosen at construction time by the
+// OTBN_ISS_BACKEND environment variable (see backend_t). The protocol used to
+// talk to the Python ISS is chosen by the OTBN_ISS_PROTOCOL environment
+// variable (see protocol_t).
+//
+// By default, the ISS is stepped one cycle at a time. If OTBN_ISS_RUN_AHEAD is
+// set to some N > 1, step() instead asks the ISS to run for up to N cycles at
+// once, stopping early at the next externally visible event (a change to
+// STATUS, RND_REQ, WIPE_START etc.). The results are queued and step()
+// consumes them a cycle at a time. This saves a round trip to the ISS per
+// cycle. If the RTL side sends the ISS an input (such as an error escalation
+// or a new keymgr value) or asks about its state while there are queued
+// cycles, the wrapper discards them and rewinds the ISS to the cycle that the
+// RTL has reached before sending the command. To do this, it keeps a history
+// of the commands that it has sent since the last reset and replays them
+// after resetting the ISS. This is slow if the history is long, so running
+// ahead only helps if such inputs are rare.
+//
+// If OTBN_ISS_ASYNC is set to 1, the ISS runs on a worker thread instead, so
+// that it can compute the next cycles while the RTL simulation evaluates the
+// current one. When step() needs a cycle that the ISS hasn't produced yet, it
+// starts the worker, which runs batches of max(2, OTBN_ISS_RUN_AHEAD) cycles
+// and passes the result for each cycle to step() through a lock-free queue.
+// The worker carries on with another batch for as long as the last one ran in
+// full without an externally visible event. step() only blocks if the queue is
+// empty. Inputs are handled in the same way as when running ahead.
+//
+// Starting the Python ISS takes a noticeable amount of time (mostly spent
+// importing the simulator). If OTBN_ISS_FORK_SERVER is set to the path of a
+// Unix socket, the wrapper instead asks a fork server listening there for a
+// child process (see hw/ip/otbn/dv/otbnsim/fork_server.py), starting the
+// server if there isn't one already. The server outlives the simulation, so
+// that the startup cost is only paid once. The child gets the wrapper's
+// environment and working directory. If the simulator sources have changed
+// since the server started, the server exits and the wrapper starts a new one.
 struct ISSWrapper {
   // A 256-bit unsigned integer value, stored in "LSB order". Thus, words[0]
   // contains the LSB and words[7] contains the MSB.
@@ -54,13 +97,48 @@ struct ISSWrapper {
 
   enum command_t { Execute, DmemWipe, ImemWipe };
 
-  ISSWrapper();
+  // The ISS implementation(s) to use.
+  //
+  //  - PythonBackend: Run the Python ISS (stepped.py) as a subprocess. This is
+  //    the reference model and is the default.
+  //
+  //  - NativeBackend: Run the in-process C++ model from native_iss.h.
+  //
+  //  - CrossBackend: Run both, checking that every command gives the same
+  //    output (and that DMEM dumps match). Any difference is reported by
+  //    throwing a std::runtime_error. The output from the Python ISS is used.
+  //
+  // These are selected by setting OTBN_ISS_BACKEND to "python", "native" or
+  // "cross", respectively.
+  enum backend_t { PythonBackend, NativeBackend, CrossBackend };
+
+  // The protocol to use to talk to the Python ISS.
+  //
+  //  - BinaryProtocol: Send commands and responses as length-prefixed binary
+  //    frames (see iss_protocol.h). This is the default.
+  //
+  //  - TextProtocol: Send commands as lines of text and parse the text output
+  //    from stepped.py. This is slower, but easier to follow when debugging.
+  //
+  // These are selected by setting OTBN_ISS_PROTOCOL to "binary" or "text",
+  // respectively.
+  enum protocol_t { BinaryProtocol, TextProtocol };
+
+  // Construct the wrapper, starting the ISS. The memory that is shared with
+  // the ISS (see get_shared_mem) has space for imem_words words of IMEM and
+  // dmem_words words of DMEM.
+  ISSWrapper(uint32_t imem_words, uint32_t dmem_words);
   ~ISSWrapper();
 
   // Load new contents of DMEM / IMEM
   void load_d(const std::string &path);
   void load_i(const std::string &path);
 
+  // Load new contents of DMEM / IMEM from the memory shared with the ISS.
+  // This is equivalent to load_d / load_i, but doesn't go through a file.
+  void load_d_shared();
+  void load_i_shared();
+
   // Add a loop warp instruction to the simulation
   void add_loop_warp(uint32_t addr, uint32_t from_cnt, uint32_t to_cnt);
 
@@ -70,6 +148,32 @@ struct ISSWrapper {
   // Dump the contents of DMEM to a file
   void dump_d(const std::string &path) const;
 
+  // Dump the contents of DMEM to the memory shared with the ISS
+  void dump_d_shared() const;
+
+  // Dump the words of DMEM that have changed since DMEM was last loaded or
+  // dumped through the memory shared with the ISS, setting their dirty flags
+  // (see IssSharedMem::dirty_flags). The caller should clear the flags once it
+  // has read the words. The other words of DMEM in the shared memory already
+  // hold the ISS's contents.
+  void dump_d_dirty() const;
+
+  // Save the state of the ISS to an opaque file at path, which restore_state
+  // can read back (possibly in another simulation). The state can only be
+  // saved between instructions. Only the Python ISS supports this: with the
+  // other backends, this throws a std::runtime_error.
+  void save_state(const std::string &path) const;
+
+  // Replace the state of the ISS with one written by save_state, updating the
+  // mirrored registers to match. As with save_state, this only works with the
+  // Python ISS.
+  void restore_state(const std::string &path);
+
+  // Get the memory that is shared with the ISS. This is used to pass the
+  // contents of IMEM and DMEM with load_d_shared, load_i_shared,
+  // dump_d_shared and dump_d_dirty.
+  IssSharedMem get_shared_mem() const;
+
   // Start an operation (execute, dmem wipe or imem wipe)
   void start_operation(command_t command);
 
@@ -102,7 +206,8 @@ struct ISSWrapper {
   // Run simulation for a single cycle.
   //
   // If gen_trace is true, pass trace data to the (singleton) OtbnTraceChecker
-  // object.
+  // object. If running ahead (see OTBN_ISS_RUN_AHEAD, above), the trace data
+  // for each cycle is passed to the checker as that cycle is consumed.
   //
   // The return code describes the state of the simulation. It is 1 if the
   // simulation just stopped (on ECALL or an architectural error); it is 0 if
@@ -130,9 +235,9 @@ struct ISSWrapper {
 
   // Reset simulation
   //
-  // This doesn't actually send anything to the ISS, but instead tells the
-  // OtbnTraceChecker to clear out any partial instructions. It also resets
-  // mirrored registers to their initial states.
+  // This tells the OtbnTraceChecker to clear out any partial instructions and
+  // resets the ISS. It also resets mirrored registers to their initial states
+  // and discards any cycles that the ISS had run ahead.
   void reset(bool gen_trace);
 
   // Send an error escalation
@@ -154,16 +259,132 @@ struct ISSWrapper {
   // path of the temporary directory).
   std::string make_tmp_path(const std::string &relative) const;
 
+  backend_t get_backend() const { return backend_; }
+
+  protocol_t get_protocol() const { return protocol_; }
+
  private:
+  // Read OTBN_ISS_BACKEND to find the backend to use. Throws a
+  // std::runtime_error if it is set to something unexpected.
+  static backend_t backend_from_env();
+
+  // Read OTBN_ISS_PROTOCOL to find the protocol to use. Throws a
+  // std::runtime_error if it is set to something unexpected.
+  static protocol_t protocol_from_env();
+
+  // Read OTBN_ISS_RUN_AHEAD to find the maximum number of cycles to run in a
+  // single command. Returns 1 if it is not set. Throws a std::runtime_error if
+  // it is set to something that isn't a positive integer.
+  static uint32_t run_ahead_from_env();
+
+  // Read OTBN_ISS_ASYNC to see whether to run the ISS on a worker thread.
+  static bool async_from_env();
+
+  // Read OTBN_ISS_FORK_SERVER to find the socket of the fork server to use.
+  // Returns an empty string if it is not set.
+  static std::string fork_server_from_env();
+
+  // Start the Python ISS subprocess
+  void start_child();
+
   // Read line by line from the child process until we get ".\n".
   // Return true if we got the ".\n" terminator, false if EOF. If dst
   // is not null, append to it each line that was read.
   bool read_child_response(std::vector<std::string> *dst) const;
 
-  // Send a command to the child and wait for its response. If no
-  // response, raise a runtime_error.
-  void run_command(const std::string &cmd, std::vector<std::string> *dst) const;
+  // Read a binary frame from the child process into *payload. Return false on
+  // EOF.
+  bool read_child_frame(std::string *payload) const;
+
+  // Read the "hello" frame that the child sends when it starts in binary mode
+  // and check that it speaks the protocol version that we expect. Raise a
+  // runtime_error if not.
+  void check_child_hello() const;
+
+  // Send a command to the child and wait for its response, which is decoded
+  // into *dst. If no response, raise a runtime_error.
+  void run_child_command(const IssCommand &cmd, IssResponse *dst) const;
+
+  // Send a command to the ISS (or both ISS implementations, in cross-checking
+  // mode) and wait for its response. If dst is not null, the decoded response
+  // is written to it. On failure or, when cross-checking, a mismatch, raise a
+  // runtime_error. If the ISS has run ahead of the RTL, rewind it first.
+  void run_command(const IssCommand &cmd, IssResponse *dst) const;
+
+  // The part of run_command that actually talks to the ISS, without rewinding
+  // it or recording the command in the history. dst must not be null.
+  void send_command(const IssCommand &cmd, IssResponse *dst) const;
+
+  // If there is a worker thread, stop it (once it finishes its current
+  // batch) and rethrow any exception that it raised. After this, the calling
+  // thread can talk to the ISS directly.
+  void pause_worker() const;
+
+  // The number of cycles that the ISS has run but step() hasn't consumed yet
+  size_t queued_cycles() const;
+
+  // Discard any cycles that the ISS has run but step() hasn't consumed. The
+  // worker must be paused.
+  void discard_queued_cycles() const;
+
+  // If the ISS has run ahead of the RTL, discard the queued cycles and put
+  // the ISS back in the state it had at the end of the last cycle that step()
+  // consumed. This resets the ISS and replays history_. The worker must be
+  // paused.
+  void rewind() const;
+
+  // Add a command that has just been sent to the ISS to history_ (if we keep
+  // one), where resp is the ISS's response.
+  void record_command(const IssCommand &cmd, const IssResponse &resp) const;
+
+  // If we keep a history, copy the file at path into the temporary directory,
+  // so that rewind() can load it again, and return the path of the copy.
+  // Otherwise, return path.
+  std::string keep_file(const std::string &path);
+
+  backend_t backend_;
+  protocol_t protocol_;
+
+  // The maximum number of cycles to run with a single command and the
+  // responses for cycles that the ISS has run but step() hasn't consumed yet.
+  // This is mutable because rewind() empties it.
+  uint32_t run_ahead_;
+  mutable std::deque<IssResponse> pending_cycles_;
+
+  // A command in history_. A run of cycles (from step or run commands) is
+  // stored as a single entry with num_cycles set. An entry for a command that
+  // reads the memory shared with the ISS holds a copy of that memory.
+  struct HistoryEntry {
+    IssCommand cmd;
+    uint32_t num_cycles;
+    std::vector<uint8_t> shared_mem;
+  };
+
+  // The commands that have changed the ISS state since it was last reset, so
+  // that rewind() can replay them. This is only kept if the ISS can run ahead
+  // and is appended to by the worker thread when there is one.
+  bool keep_history_;
+  mutable std::vector<HistoryEntry> history_;
+
+  // The number of files that keep_file has copied (used to name the copies)
+  unsigned kept_files_;
+
+  // The worker thread that runs the ISS (null unless OTBN_ISS_ASYNC is set).
+  // When there is a worker, it queues the cycles instead of pending_cycles_.
+  std::unique_ptr<IssWorker> worker_;
 
+  // The in-process model (null unless backend_ is NativeBackend or
+  // CrossBackend)
+  std::unique_ptr<NativeISS> native_;
+
+  // The socket of the fork server that starts the Python subprocess (empty if
+  // we start it ourselves)
+  std::string fork_server_;
+
+  // The Python subprocess (child_pid is -1 and the files are null unless
+  // backend_ is PythonBackend or CrossBackend). If the subprocess came from
+  // the fork server, it isn't our child and it exits when we close
+  // child_write_file.
   pid_t child_pid;
   FILE *child_write_file;
   FILE *child_read_file;
@@ -171,6 +392,10 @@ struct ISSWrapper {
   // A temporary directory for communicating with the child process
   std::unique_ptr<TmpDir> tmpdir;
 
+  // Memory that is shared with the ISS (with the child process, if there is
+  // one)
+  std::unique_ptr<SharedMem> shared_mem_;
+
   // Mirrored copies of registers
   MirroredRegs mirrored_;
 };
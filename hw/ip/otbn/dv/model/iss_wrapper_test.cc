@@ -0,0 +1,191 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// A test that ISSWrapper gives the same results when it runs the ISS ahead of
+// the RTL (with OTBN_ISS_RUN_AHEAD or OTBN_ISS_ASYNC) as it does in lockstep,
+// even if the RTL sends an input or asks about the ISS state part way through
+// a run. It drives the wrapper the way otbn_core_model does: it runs a long
+// straight-line program, reads the registers, sends a lifecycle escalation
+// once the ISS has had time to run ahead and then steps until OTBN locks.
+//
+// The test uses the backend named by OTBN_ISS_BACKEND (the native model if it
+// isn't set). It doesn't check traces, so it provides the parts of
+// OtbnTraceChecker that the wrapper uses, rather than linking against the real
+// one (which needs the DPI functions from a Verilator build).
+//
+// hw/ip/otbn/dv/otbnsim/test/iss_wrapper_test.py builds this and runs it with
+// each backend, as part of the otbnsim tests.
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "iss_wrapper.h"
+#include "otbn_trace_checker.h"
+
+OtbnTraceChecker &OtbnTraceChecker::get() { abort(); }
+bool OtbnTraceChecker::OnIssTrace(const std::vector<std::string> &) {
+  return true;
+}
+void OtbnTraceChecker::Flush() {}
+
+namespace {
+
+const uint32_t kImemWords = 4096 / 4;
+const uint32_t kDmemWords = 3072 / 4;
+
+// The number of instructions in the program and the cycle of the run at which
+// we read the registers and send the escalation.
+const int kNumInsns = 1000;
+const int kReadRegsCycle = 100;
+const int kEscalateCycle = 400;
+
+// addi x2, x2, 1 and ecall
+const uint32_t kAddiInsn = 0x00110113;
+const uint32_t kEcallInsn = 0x00000073;
+
+// ERR_BITS.LIFECYCLE_ESCALATION
+const uint32_t kLifecycleEscalation = 1 << 22;
+
+// What we saw from a run: the mirrored registers after each cycle and the
+// GPRs at kReadRegsCycle and the end.
+struct RunResult {
+  std::vector<std::array<uint32_t, 4>> cycles;
+  std::array<uint32_t, 32> mid_gprs;
+  std::array<uint32_t, 32> end_gprs;
+};
+
+// Step the ISS while it reseeds URND, as otbn_core_model does when it sees
+// the request from the RTL.
+void reseed_urnd(ISSWrapper *iss, uint32_t seed) {
+  for (uint32_t i = 0; i < 8; ++i)
+    iss->edn_urnd_step(seed + i);
+  iss->step(false);
+  iss->edn_urnd_cdc_done();
+}
+
+void record_cycle(const ISSWrapper &iss, RunResult *result) {
+  const MirroredRegs &regs = iss.get_mirrored();
+  result->cycles.push_back(
+      {regs.status, regs.insn_cnt, regs.err_bits, regs.stop_pc});
+}
+
+RunResult run(const char *run_ahead, const char *async) {
+  setenv("OTBN_ISS_RUN_AHEAD", run_ahead, 1);
+  setenv("OTBN_ISS_ASYNC", async, 1);
+
+  ISSWrapper iss(kImemWords, kDmemWords);
+  std::array<ISSWrapper::u256_t, 32> wdrs;
+  RunResult result;
+
+  // Run the initial secure wipe, which reseeds URND twice
+  iss.initial_secure_wipe();
+  for (uint32_t round = 0; round < 2; ++round) {
+    reseed_urnd(&iss, 0x1000 + 0x100 * round);
+    for (int i = 0; i < 150; ++i)
+      iss.step(false);
+  }
+  if (iss.get_mirrored().status != 0) {
+    std::cerr << "Initial secure wipe didn't finish.\n";
+    exit(1);
+  }
+
+  IssSharedMem shm = iss.get_shared_mem();
+  uint8_t *imem = shm.words(true);
+  for (int i = 0; i < kNumInsns; ++i)
+    IssSharedMem::put_word(imem + i * IssSharedMem::kBytesPerWord, true,
+                           kAddiInsn);
+  IssSharedMem::put_word(imem + kNumInsns * IssSharedMem::kBytesPerWord, true,
+                         kEcallInsn);
+  iss.load_i_shared();
+  iss.load_d_shared();
+
+  iss.start_operation(ISSWrapper::Execute);
+  reseed_urnd(&iss, 0x2000);
+  record_cycle(iss, &result);
+
+  int wipe_cycles = 0;
+  for (int cycle = 0; cycle < 2 * kNumInsns; ++cycle) {
+    if (cycle == kReadRegsCycle)
+      iss.get_regs(&result.mid_gprs, &wdrs);
+    if (cycle == kEscalateCycle) {
+      // Give the worker a chance to run ahead before sending the escalation.
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      iss.send_err_escalation(kLifecycleEscalation, false);
+    }
+
+    if (iss.step(false) < 0) {
+      std::cerr << "Bad step result at cycle " << cycle << ".\n";
+      exit(1);
+    }
+    record_cycle(iss, &result);
+
+    // The escalation starts a secure wipe. This has two rounds and the ISS
+    // asks for a new URND seed after the first one, which takes 68 cycles.
+    uint32_t status = iss.get_mirrored().status;
+    if (status == 0x04 && ++wipe_cycles == 100)
+      reseed_urnd(&iss, 0x3000);
+    if (status == 0xff)
+      break;
+  }
+
+  iss.get_regs(&result.end_gprs, &wdrs);
+  return result;
+}
+
+bool check_same(const RunResult &expected, const RunResult &seen,
+                const char *what) {
+  if (seen.mid_gprs != expected.mid_gprs) {
+    std::cerr << what << ": GPRs differ at cycle " << kReadRegsCycle << ".\n";
+    return false;
+  }
+  if (seen.end_gprs != expected.end_gprs) {
+    std::cerr << what << ": GPRs differ at the end of the run.\n";
+    return false;
+  }
+  for (size_t i = 0; i < expected.cycles.size(); ++i) {
+    if (i >= seen.cycles.size() || seen.cycles[i] != expected.cycles[i]) {
+      std::cerr << what << ": mirrored registers differ after cycle " << i
+                << ".\n";
+      return false;
+    }
+  }
+  if (seen.cycles.size() != expected.cycles.size()) {
+    std::cerr << what << ": ran " << seen.cycles.size() << " cycles, not "
+              << expected.cycles.size() << ".\n";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  setenv("OTBN_ISS_BACKEND", "native", 0);
+
+  RunResult lockstep = run("1", "0");
+
+  // The escalation should have locked OTBN before it got to the ECALL, and
+  // the registers that we read part way through should be from that cycle,
+  // rather than the end of the run.
+  const std::array<uint32_t, 4> &last = lockstep.cycles.back();
+  if (last[0] != 0xff || !(last[2] & kLifecycleEscalation) ||
+      lockstep.mid_gprs[2] == 0 || lockstep.mid_gprs[2] >= kNumInsns) {
+    std::cerr << "Unexpected result from lockstep run.\n";
+    return 1;
+  }
+
+  bool ok = check_same(lockstep, run("16", "0"), "OTBN_ISS_RUN_AHEAD=16");
+  ok &= check_same(lockstep, run("16", "1"),
+                   "OTBN_ISS_RUN_AHEAD=16 OTBN_ISS_ASYNC=1");
+  if (!ok)
+    return 1;
+
+  std::cout << "PASS\n";
+  return 0;
+}
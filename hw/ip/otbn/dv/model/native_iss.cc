@@ -0,0 +1,4213 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "native_iss.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "iss_protocol.h"
+
+// This file is a port of the Python ISS in hw/ip/otbn/dv/otbnsim. The
+// structure deliberately follows the Python code (sim.py, state.py and the
+// register, memory and instruction files that they use) so that the two can
+// be compared side by side. Where the Python code would fail an assertion, we
+// throw a std::runtime_error.
+
+namespace {
+
+// Sizes of the memories in bytes. These must match the memory layout in
+// otbn.hjson (which is what the Python model reads with get_memory_layout()).
+const uint32_t kImemSizeBytes = 8192;
+const uint32_t kDmemSizeBytes = 4096;
+
+// Number of cycles spent per round of a secure wipe (see _WIPE_CYCLES in
+// state.py)
+const int kWipeCycles = 68;
+
+// Depth of the x1 call stack and the loop stack
+const size_t kCallStackDepth = 8;
+const size_t kLoopStackDepth = 8;
+
+// The number of 32-bit words accumulated by an EDN client, and the maximum
+// number of cycles we allow between getting the last word and being told that
+// CDC has finished.
+const size_t kEdnAccLen = 8;
+const int kEdnMaxCdcWait = 5;
+
+namespace ErrBits {
+const uint32_t kBadDataAddr = 1 << 0;
+const uint32_t kBadInsnAddr = 1 << 1;
+const uint32_t kCallStack = 1 << 2;
+const uint32_t kIllegalInsn = 1 << 3;
+const uint32_t kLoop = 1 << 4;
+const uint32_t kKeyInvalid = 1 << 5;
+const uint32_t kRndRepChkFail = 1 << 6;
+const uint32_t kRndFipsChkFail = 1 << 7;
+const uint32_t kImemIntgViolation = 1 << 16;
+const uint32_t kDmemIntgViolation = 1 << 17;
+const uint32_t kMask = (1 << 24) - 1;
+}  // namespace ErrBits
+
+namespace Status {
+const uint32_t kIdle = 0x00;
+const uint32_t kBusyExecute = 0x01;
+const uint32_t kBusySecWipeDmem = 0x02;
+const uint32_t kBusySecWipeImem = 0x03;
+const uint32_t kBusySecWipeInt = 0x04;
+const uint32_t kLocked = 0xff;
+}  // namespace Status
+
+// The same encoding as lc_tx_t in the RTL
+enum class LcTx { On = 0x5, Off = 0xa, Invalid = 0 };
+
+enum class FsmState {
+  PreWipe = 0,
+  Wiping = 1,
+  Idle = 2,
+  PreExec = 3,
+  Exec = 4,
+  MemSecWipe = 10,
+  Locked = 255
+};
+
+enum class InitSecWipeState { NotDone, InProgress, Done };
+
+// Throw a std::runtime_error if cond is false. This is used in the places
+// where the Python model has an assertion.
+void check(bool cond, const char *what) {
+  if (!cond) {
+    std::ostringstream oss;
+    oss << "Native OTBN ISS internal check failed: " << what;
+    throw std::runtime_error(oss.str());
+  }
+}
+
+// A 256-bit unsigned integer value, stored in "LSB order". Thus, element 0
+// contains the LSB and element 7 contains the MSB.
+typedef std::array<uint32_t, 8> Wide;
+
+Wide wide_zero() {
+  Wide ret;
+  ret.fill(0);
+  return ret;
+}
+
+Wide wide_from_u64(uint64_t value) {
+  Wide ret = wide_zero();
+  ret[0] = (uint32_t)value;
+  ret[1] = (uint32_t)(value >> 32);
+  return ret;
+}
+
+bool wide_is_zero(const Wide &a) {
+  for (uint32_t w : a) {
+    if (w)
+      return false;
+  }
+  return true;
+}
+
+bool wide_bit(const Wide &a, unsigned idx) {
+  assert(idx < 256);
+  return (a[idx / 32] >> (idx % 32)) & 1;
+}
+
+uint64_t wide_u64(const Wide &a, unsigned idx) {
+  assert(idx < 4);
+  return ((uint64_t)a[2 * idx + 1] << 32) | a[2 * idx];
+}
+
+// Compute a + b + cin, writing the bottom 256 bits to *out and returning the
+// carry out.
+bool wide_add(const Wide &a, const Wide &b, bool cin, Wide *out) {
+  uint64_t carry = cin ? 1 : 0;
+  for (int i = 0; i < 8; ++i) {
+    uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+    (*out)[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+  return carry != 0;
+}
+
+// Compute a - b - bin, writing the bottom 256 bits to *out and returning the
+// borrow out (which matches bit 256 of the result as a two's complement
+// number).
+bool wide_sub(const Wide &a, const Wide &b, bool bin, Wide *out) {
+  uint64_t borrow = bin ? 1 : 0;
+  for (int i = 0; i < 8; ++i) {
+    uint64_t diff = (uint64_t)a[i] - b[i] - borrow;
+    (*out)[i] = (uint32_t)diff;
+    borrow = (diff >> 32) & 1;
+  }
+  return borrow != 0;
+}
+
+int wide_cmp(const Wide &a, const Wide &b) {
+  for (int i = 7; i >= 0; --i) {
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+Wide wide_shl(const Wide &a, unsigned n) {
+  Wide ret = wide_zero();
+  if (n >= 256)
+    return ret;
+  unsigned words = n / 32, bits = n % 32;
+  for (int i = 7; i >= (int)words; --i) {
+    uint32_t lo = a[i - words];
+    uint32_t below = (bits && i - (int)words - 1 >= 0) ? a[i - words - 1] : 0;
+    ret[i] = bits ? ((lo << bits) | (below >> (32 - bits))) : lo;
+  }
+  return ret;
+}
+
+Wide wide_shr(const Wide &a, unsigned n) {
+  Wide ret = wide_zero();
+  if (n >= 256)
+    return ret;
+  unsigned words = n / 32, bits = n % 32;
+  for (unsigned i = 0; i + words < 8; ++i) {
+    uint32_t hi = a[i + words];
+    uint32_t above = (bits && i + words + 1 < 8) ? a[i + words + 1] : 0;
+    ret[i] = bits ? ((hi >> bits) | (above << (32 - bits))) : hi;
+  }
+  return ret;
+}
+
+Wide wide_and(const Wide &a, const Wide &b) {
+  Wide ret;
+  for (int i = 0; i < 8; ++i)
+    ret[i] = a[i] & b[i];
+  return ret;
+}
+
+Wide wide_or(const Wide &a, const Wide &b) {
+  Wide ret;
+  for (int i = 0; i < 8; ++i)
+    ret[i] = a[i] | b[i];
+  return ret;
+}
+
+Wide wide_xor(const Wide &a, const Wide &b) {
+  Wide ret;
+  for (int i = 0; i < 8; ++i)
+    ret[i] = a[i] ^ b[i];
+  return ret;
+}
+
+Wide wide_not(const Wide &a) {
+  Wide ret;
+  for (int i = 0; i < 8; ++i)
+    ret[i] = ~a[i];
+  return ret;
+}
+
+// Keep only the bottom num_bits bits of a
+Wide wide_trunc(const Wide &a, unsigned num_bits) {
+  Wide ret = a;
+  for (unsigned i = 0; i < 8; ++i) {
+    unsigned lsb = 32 * i;
+    if (num_bits <= lsb) {
+      ret[i] = 0;
+    } else if (num_bits < lsb + 32) {
+      ret[i] &= (1u << (num_bits - lsb)) - 1;
+    }
+  }
+  return ret;
+}
+
+// Compute a * b, truncated to 256 bits
+Wide wide_mul(const Wide &a, const Wide &b) {
+  Wide ret = wide_zero();
+  for (int i = 0; i < 8; ++i) {
+    if (!a[i])
+      continue;
+    uint64_t carry = 0;
+    for (int j = 0; i + j < 8; ++j) {
+      uint64_t acc = (uint64_t)a[i] * b[j] + ret[i + j] + carry;
+      ret[i + j] = (uint32_t)acc;
+      carry = acc >> 32;
+    }
+  }
+  return ret;
+}
+
+// Render a 32-bit value in the format expected by RTL tracing
+std::string hex_u32(uint32_t value) {
+  char buf[11];
+  snprintf(buf, sizeof buf, "0x%08x", value);
+  return buf;
+}
+
+// Render an optional 32-bit value in the format expected by RTL tracing
+std::string hex_u32(bool valid, uint32_t value) {
+  return valid ? hex_u32(value) : "0xxxxxxxxx";
+}
+
+// Render an optional 256-bit value in the format expected by RTL tracing
+// (groups of 8 hex digits, MSB first, separated by underscores)
+std::string hex_wide(bool valid, const Wide &value) {
+  std::string ret = "0x";
+  for (int i = 7; i >= 0; --i) {
+    if (valid) {
+      char buf[9];
+      snprintf(buf, sizeof buf, "%08x", value[i]);
+      ret += buf;
+    } else {
+      ret += "xxxxxxxx";
+    }
+    if (i)
+      ret += '_';
+  }
+  return ret;
+}
+
+// A model of an EDN client (see edn_client.py)
+class EdnClient {
+ public:
+  struct CdcResult {
+    bool has_data;
+    Wide data;
+    bool retry;
+    bool fips_err;
+    bool rep_err;
+  };
+
+  EdnClient() { edn_reset(); }
+
+  // Start a request if there isn't one pending
+  void request() {
+    if (!acc_valid_) {
+      check(cdc_counter_ < 0, "EdnClient: request with CDC pending");
+      acc_valid_ = true;
+      acc_.clear();
+    } else if (poisoned_) {
+      retry_ = true;
+    }
+  }
+
+  // Mark any current request as "poisoned" and clear the retry flag
+  void poison() {
+    if (acc_valid_) {
+      poisoned_ = true;
+      retry_ = false;
+      fips_err_ = false;
+      rep_err_ = false;
+    }
+  }
+
+  // Clear the retry flag, if set.
+  void forget() { retry_ = false; }
+
+  // Take a 32-bit data word (ignored if there is no request in flight)
+  void take_word(uint32_t word, bool fips_err) {
+    if (!acc_valid_)
+      return;
+
+    check(acc_.size() < kEdnAccLen, "EdnClient: too many words");
+    check(cdc_counter_ < 0, "EdnClient: word arrived with CDC pending");
+
+    fips_err_ = fips_err_ || fips_err;
+    rep_err_ = rep_err_ || (last_word_valid_ && last_word_ == word);
+
+    acc_.push_back(word);
+    last_word_ = word;
+    last_word_valid_ = true;
+    if (acc_.size() == kEdnAccLen)
+      cdc_counter_ = 0;
+  }
+
+  // Called on a reset signal on the EDN clock domain
+  void edn_reset() {
+    acc_valid_ = false;
+    acc_.clear();
+    cdc_counter_ = -1;
+    poisoned_ = false;
+    retry_ = false;
+    fips_err_ = false;
+    rep_err_ = false;
+    last_word_valid_ = false;
+    last_word_ = 0;
+  }
+
+  // Called when CDC completes for a transfer
+  CdcResult cdc_complete() {
+    check(acc_valid_ && acc_.size() == kEdnAccLen && cdc_counter_ >= 0 &&
+              cdc_counter_ <= kEdnMaxCdcWait,
+          "EdnClient: unexpected CDC completion");
+
+    CdcResult ret;
+    ret.has_data = !poisoned_;
+    ret.retry = retry_;
+    ret.data = wide_zero();
+    ret.fips_err = false;
+    ret.rep_err = false;
+    if (!poisoned_) {
+      for (size_t i = 0; i < kEdnAccLen; ++i)
+        ret.data[i] = acc_[i];
+      ret.fips_err = fips_err_;
+      ret.rep_err = rep_err_;
+    }
+
+    acc_valid_ = false;
+    acc_.clear();
+    cdc_counter_ = -1;
+    poisoned_ = false;
+    retry_ = false;
+    fips_err_ = false;
+    rep_err_ = false;
+
+    if (ret.retry)
+      request();
+
+    return ret;
+  }
+
+  // Called on each main clock cycle. Increment and check CDC counter
+  void step() {
+    if (cdc_counter_ >= 0) {
+      ++cdc_counter_;
+      check(cdc_counter_ <= kEdnMaxCdcWait, "EdnClient: CDC took too long");
+    }
+  }
+
+ private:
+  bool acc_valid_;
+  std::vector<uint32_t> acc_;
+  int cdc_counter_;
+  bool poisoned_;
+  bool retry_;
+  bool fips_err_;
+  bool rep_err_;
+  bool last_word_valid_;
+  uint32_t last_word_;
+};
+
+// The externally visible registers that the model might update. The order
+// matches the order that the Python model uses for its dictionary (the order
+// of registers in otbn.hjson, followed by the fake STOP_PC, RND_REQ and
+// WIPE_START registers). Registers that the model never writes are omitted.
+enum ExtReg {
+  kExtIntrState,
+  kExtStatus,
+  kExtErrBits,
+  kExtInsnCnt,
+  kExtStopPc,
+  kExtRndReq,
+  kExtWipeStart,
+  kNumExtRegs
+};
+
+struct ExtRegInfo {
+  const char *name;
+  // The bits covered by fields in the register
+  uint32_t mask;
+  uint32_t reset;
+  // If true, there's an extra flop between the core and the register, so
+  // writes are only visible after an intervening commit.
+  bool double_flopped;
+};
+
+const ExtRegInfo kExtRegInfo[kNumExtRegs] = {
+    {"INTR_STATE", 0x00000001, 0, false}, {"STATUS", 0x000000ff, 4, true},
+    {"ERR_BITS", 0x00ff00ff, 0, false},   {"INSN_CNT", 0xffffffff, 0, false},
+    {"STOP_PC", 0xffffffff, 0, true},     {"RND_REQ", 0xffffffff, 0, false},
+    {"WIPE_START", 0xffffffff, 0, false}};
+
+// A model of OTBN's externally visible registers (see ext_regs.py). All writes
+// from the model are "from hardware", so none of the software access
+// restrictions apply.
+class ExtRegs {
+ public:
+  ExtRegs() : dirty_(0) {
+    for (int i = 0; i < kNumExtRegs; ++i) {
+      regs_[i].value = kExtRegInfo[i].reset;
+      regs_[i].next_value = kExtRegInfo[i].reset;
+    }
+  }
+
+  void write(ExtReg reg, uint32_t value, bool immediately = false) {
+    reg_write(reg, value, immediately);
+    dirty_ = 2;
+  }
+
+  void set_bits(ExtReg reg, uint32_t value) {
+    Reg &r = regs_[reg];
+    r.next_value |= value & kExtRegInfo[reg].mask;
+    changes_for(reg, false).push_back(r.next_value);
+    dirty_ = 2;
+  }
+
+  void increment_insn_cnt() {
+    uint32_t old = regs_[kExtInsnCnt].value;
+    reg_write(kExtInsnCnt, old == UINT32_MAX ? old : old + 1, false);
+  }
+
+  uint32_t read(ExtReg reg) const { return regs_[reg].value; }
+
+  void step() { rnd_client_.step(); }
+
+  void changes(std::vector<std::string> *dst) const {
+    for (int i = 0; i < kNumExtRegs; ++i) {
+      // If the dirty flag is not set, we know the only possible change is to
+      // the INSN_CNT register.
+      if (dirty_ == 0 && i != kExtInsnCnt)
+        continue;
+      for (uint32_t now : regs_[i].changes) {
+        dst->push_back(std::string("! otbn.") + kExtRegInfo[i].name + ": " +
+                       hex_u32(now));
+      }
+    }
+  }
+
+  void commit() {
+    if (dirty_ > 0) {
+      for (int i = 0; i < kNumExtRegs; ++i)
+        commit_reg((ExtReg)i);
+      dirty_ = dirty_ > 0 ? dirty_ - 1 : 0;
+    } else {
+      commit_reg(kExtInsnCnt);
+    }
+  }
+
+  // Commit a single register (used for WIPE_START, which is committed
+  // immediately when the model stops)
+  void commit_reg(ExtReg reg) {
+    Reg &r = regs_[reg];
+    r.value = r.next_value;
+    r.changes.swap(r.next_changes);
+    r.next_changes.clear();
+  }
+
+  void abort() {
+    for (Reg &r : regs_) {
+      r.next_value = r.value;
+      r.changes.clear();
+      r.next_changes.clear();
+    }
+    dirty_ = 0;
+  }
+
+  void rnd_request() {
+    rnd_client_.request();
+    if (read(kExtRndReq) == 0) {
+      reg_write(kExtRndReq, 1, false);
+      dirty_ = 2;
+    }
+  }
+
+  void rnd_take_word(uint32_t word, bool fips_err) {
+    rnd_client_.take_word(word, fips_err);
+  }
+
+  void rnd_reset() {
+    rnd_client_.edn_reset();
+    dirty_ = 2;
+  }
+
+  EdnClient::CdcResult rnd_cdc_complete() {
+    EdnClient::CdcResult res = rnd_client_.cdc_complete();
+    if (!res.retry) {
+      reg_write(kExtRndReq, 0, false);
+      dirty_ = 2;
+    }
+    return res;
+  }
+
+  void rnd_poison() { rnd_client_.poison(); }
+
+  void rnd_forget() {
+    rnd_client_.forget();
+    reg_write(kExtRndReq, 0, false);
+  }
+
+ private:
+  struct Reg {
+    uint32_t value;
+    uint32_t next_value;
+    // The new values of the register for writes that should appear in the
+    // trace for this cycle and for the next cycle, respectively.
+    std::vector<uint32_t> changes;
+    std::vector<uint32_t> next_changes;
+  };
+
+  std::vector<uint32_t> &changes_for(ExtReg reg, bool immediately) {
+    bool delayed = kExtRegInfo[reg].double_flopped && !immediately;
+    return delayed ? regs_[reg].next_changes : regs_[reg].changes;
+  }
+
+  // Stage a write without touching the dirty flag (RGReg.write)
+  void reg_write(ExtReg reg, uint32_t value, bool immediately) {
+    Reg &r = regs_[reg];
+    r.next_value = value & kExtRegInfo[reg].mask;
+    changes_for(reg, immediately).push_back(r.next_value);
+  }
+
+  Reg regs_[kNumExtRegs];
+  int dirty_;
+  EdnClient rnd_client_;
+};
+
+// The narrow register file, including the special behaviour of x0 and x1 (see
+// gpr.py and reg.py)
+class GprFile {
+ public:
+  GprFile() : call_stack_err(false), saw_read_(false) {
+    for (int i = 0; i < 32; ++i) {
+      regs_[i] = 0;
+      next_[i] = 0;
+      next_valid_[i] = false;
+    }
+    pending_ = 0;
+  }
+
+  uint32_t read(unsigned idx) {
+    assert(idx < 32);
+    if (idx == 0)
+      return 0;
+    if (idx == 1) {
+      if (stack_.empty()) {
+        call_stack_err = true;
+        return 0;
+      }
+      saw_read_ = true;
+      return stack_.back();
+    }
+    return regs_[idx];
+  }
+
+  int32_t read_signed(unsigned idx) { return (int32_t)read(idx); }
+
+  void write(unsigned idx, uint32_t value) {
+    assert(idx < 32);
+    if (idx == 0)
+      return;
+    next_[idx] = value;
+    next_valid_[idx] = true;
+    pending_ |= 1u << idx;
+  }
+
+  void write_invalid(unsigned idx) {
+    assert(2 <= idx && idx < 32);
+    next_valid_[idx] = false;
+    pending_ |= 1u << idx;
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    for (unsigned idx = 0; idx < 32; ++idx) {
+      if (!((pending_ >> idx) & 1))
+        continue;
+      char name[8];
+      snprintf(name, sizeof name, "x%02u", idx);
+      dst->push_back(std::string("> ") + name + ": " +
+                     hex_u32(next_valid_[idx], next_[idx]));
+    }
+  }
+
+  // Check for call stack overflow (CallStackReg.post_insn)
+  void post_insn() {
+    if (next_valid_[1] && !saw_read_ && stack_.size() == kCallStackDepth)
+      call_stack_err = true;
+  }
+
+  uint32_t err_bits() const { return call_stack_err ? ErrBits::kCallStack : 0; }
+
+  void commit() {
+    for (unsigned idx = 2; idx < 32; ++idx) {
+      if ((pending_ >> idx) & 1) {
+        if (next_valid_[idx])
+          regs_[idx] = next_[idx];
+        next_valid_[idx] = false;
+      }
+    }
+    pending_ = 0;
+
+    check(!call_stack_err, "GPR commit with call stack error");
+
+    if (saw_read_) {
+      check(!stack_.empty(), "call stack pop when empty");
+      stack_.pop_back();
+      saw_read_ = false;
+    }
+    if (next_valid_[1]) {
+      check(stack_.size() <= kCallStackDepth, "call stack overflow");
+      stack_.push_back(next_[1]);
+    }
+    next_valid_[1] = false;
+  }
+
+  void abort() {
+    for (unsigned idx = 1; idx < 32; ++idx)
+      next_valid_[idx] = false;
+    pending_ = 0;
+    saw_read_ = false;
+    call_stack_err = false;
+  }
+
+  void empty_call_stack() {
+    stack_.clear();
+    saw_read_ = false;
+  }
+
+  // Wipe all registers and clear the call stack. The trace shows the
+  // registers as invalid, but (as in the Python model) the old values are
+  // kept.
+  void wipe() {
+    empty_call_stack();
+    for (unsigned idx = 2; idx < 32; ++idx)
+      write_invalid(idx);
+  }
+
+  // Backdoor read of the underlying register file (as printed by
+  // print_regs). Note that x1 is modelled by the call stack, so the
+  // underlying register is always zero.
+  uint32_t peek(unsigned idx) const { return idx < 2 ? 0 : regs_[idx]; }
+
+  const std::vector<uint32_t> &call_stack() const { return stack_; }
+
+  bool call_stack_err;
+
+ private:
+  uint32_t regs_[32];
+  uint32_t next_[32];
+  bool next_valid_[32];
+  uint32_t pending_;
+
+  std::vector<uint32_t> stack_;
+  bool saw_read_;
+};
+
+// The wide register file
+class WdrFile {
+ public:
+  WdrFile() : pending_(0) {
+    for (int i = 0; i < 32; ++i) {
+      regs_[i] = wide_zero();
+      next_[i] = wide_zero();
+      next_valid_[i] = false;
+    }
+  }
+
+  const Wide &read(unsigned idx) const {
+    assert(idx < 32);
+    return regs_[idx];
+  }
+
+  void write(unsigned idx, const Wide &value) {
+    assert(idx < 32);
+    next_[idx] = value;
+    next_valid_[idx] = true;
+    pending_ |= 1u << idx;
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    for (unsigned idx = 0; idx < 32; ++idx) {
+      if (!((pending_ >> idx) & 1))
+        continue;
+      char name[8];
+      snprintf(name, sizeof name, "w%02u", idx);
+      dst->push_back(std::string("> ") + name + ": " +
+                     hex_wide(next_valid_[idx], next_[idx]));
+    }
+  }
+
+  void commit() {
+    for (unsigned idx = 0; idx < 32; ++idx) {
+      if ((pending_ >> idx) & 1) {
+        if (next_valid_[idx])
+          regs_[idx] = next_[idx];
+        next_valid_[idx] = false;
+      }
+    }
+    pending_ = 0;
+  }
+
+  void abort() {
+    for (unsigned idx = 0; idx < 32; ++idx)
+      next_valid_[idx] = false;
+    pending_ = 0;
+  }
+
+  void wipe() {
+    for (unsigned idx = 0; idx < 32; ++idx) {
+      next_valid_[idx] = false;
+      pending_ |= 1u << idx;
+    }
+  }
+
+ private:
+  Wide regs_[32];
+  Wide next_[32];
+  bool next_valid_[32];
+  uint32_t pending_;
+};
+
+// A WSR without special behaviour (MOD and ACC)
+class DumbWsr {
+ public:
+  explicit DumbWsr(const char *name)
+      : name_(name),
+        value_(wide_zero()),
+        next_valid_(false),
+        pending_write_(false) {}
+
+  void on_start() {
+    value_ = wide_zero();
+    next_valid_ = false;
+  }
+
+  const Wide &read() const { return value_; }
+
+  void write(const Wide &value) {
+    next_ = value;
+    next_valid_ = true;
+    pending_write_ = true;
+  }
+
+  void write_invalid() {
+    next_valid_ = false;
+    pending_write_ = true;
+  }
+
+  void commit() {
+    if (next_valid_)
+      value_ = next_;
+    next_valid_ = false;
+    pending_write_ = false;
+  }
+
+  void abort() {
+    next_valid_ = false;
+    pending_write_ = false;
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    if (pending_write_)
+      dst->push_back(std::string("> ") + name_ + ": " +
+                     hex_wide(next_valid_, next_));
+  }
+
+ private:
+  const char *name_;
+  Wide value_;
+  Wide next_;
+  bool next_valid_;
+  bool pending_write_;
+};
+
+// The RND WSR, which can stall reads while waiting for EDN data (see RandWSR
+// in wsr.py)
+class RndWsr {
+ public:
+  explicit RndWsr(ExtRegs *ext_regs)
+      : ext_regs_(ext_regs),
+        valid_(false),
+        next_valid_(false),
+        pending_request_(false),
+        next_pending_request_(false),
+        fips_err_(false),
+        rep_err_(false),
+        fips_err_escalate(false),
+        rep_err_escalate(false) {}
+
+  const Wide &read() {
+    check(valid_, "RND read with no value");
+    next_valid_ = false;
+    rep_err_escalate = rep_err_;
+    fips_err_escalate = fips_err_;
+    return value_;
+  }
+
+  uint32_t read_u32() { return read()[0]; }
+
+  void on_start() {
+    next_valid_ = false;
+    next_pending_request_ = false;
+    fips_err_escalate = false;
+    rep_err_escalate = false;
+  }
+
+  void commit() {
+    valid_ = next_valid_;
+    value_ = next_value_;
+    pending_request_ = next_pending_request_;
+  }
+
+  // Signal intent to read RND, returning true if a value is available
+  bool request_value() {
+    if (valid_)
+      return true;
+    if (!pending_request_) {
+      next_pending_request_ = true;
+      ext_regs_->rnd_request();
+    }
+    return false;
+  }
+
+  // Set a random value that can be read by a future read()
+  void set_value(const Wide &value, bool fips_err, bool rep_err) {
+    fips_err_ = fips_err;
+    rep_err_ = rep_err;
+    fips_err_escalate = false;
+    rep_err_escalate = false;
+    next_value_ = value;
+    next_valid_ = true;
+    next_pending_request_ = false;
+  }
+
+ private:
+  ExtRegs *ext_regs_;
+
+  Wide value_;
+  bool valid_;
+  Wide next_value_;
+  bool next_valid_;
+
+  bool pending_request_;
+  bool next_pending_request_;
+
+  bool fips_err_;
+  bool rep_err_;
+
+ public:
+  bool fips_err_escalate;
+  bool rep_err_escalate;
+};
+
+// The URND PRNG (see URNDWSR in wsr.py)
+class UrndWsr {
+ public:
+  UrndWsr() : running(false) {
+    static const uint64_t seed[4] = {0x84ddfadaf7e1134d, 0x70aa1c59de6197ff,
+                                     0x25a4fe335d095f1e, 0x2cba89acbe4a07e9};
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j)
+        state_[i][j] = i == 0 ? seed[j] : 0;
+    }
+    value_ = wide_zero();
+    next_value_ = wide_zero();
+  }
+
+  uint32_t read_u32() const { return value_[0]; }
+  const Wide &read() const { return value_; }
+
+  void on_start() { running = false; }
+
+  void set_seed(const uint64_t seed[4]) {
+    running = true;
+    for (int i = 0; i < 4; ++i)
+      state_[0][i] = seed[i];
+    step();
+  }
+
+  void step() {
+    if (!running)
+      return;
+    Wide nv = wide_zero();
+    for (int i = 0; i < 4; ++i) {
+      const uint64_t *st = state_[i];
+      uint64_t mid = st[3] + st[0];
+      uint64_t out = rol(mid, 23) + st[3];
+      nv[2 * i] = (uint32_t)out;
+      nv[2 * i + 1] = (uint32_t)(out >> 32);
+      state_update(st, state_[(i + 1) & 3]);
+    }
+    next_value_ = nv;
+  }
+
+  void commit() { value_ = next_value_; }
+
+  bool running;
+
+ private:
+  static uint64_t rol(uint64_t n, unsigned d) {
+    return (n << d) | (n >> (64 - d));
+  }
+
+  static void state_update(const uint64_t *in, uint64_t *out) {
+    uint64_t a_in = in[3], b_in = in[2], c_in = in[1], d_in = in[0];
+    uint64_t tmp[4];
+    tmp[3] = a_in ^ b_in ^ d_in;
+    tmp[2] = a_in ^ b_in ^ c_in;
+    tmp[1] = a_in ^ (b_in << 17) ^ c_in;
+    tmp[0] = rol(d_in ^ b_in, 45);
+    for (int i = 0; i < 4; ++i)
+      out[i] = tmp[i];
+  }
+
+  uint64_t state_[4][4];
+  Wide value_;
+  Wide next_value_;
+};
+
+// A sideloaded key, with 384 bits of data and a valid signal
+struct SideloadKey {
+  SideloadKey() : valid(false) { value.fill(0); }
+
+  Wide read(unsigned shift) const {
+    Wide ret = wide_zero();
+    unsigned word_shift = shift / 32;
+    for (unsigned i = 0; i < 8 && i + word_shift < 12; ++i)
+      ret[i] = value[i + word_shift];
+    return ret;
+  }
+
+  bool valid;
+  std::array<uint32_t, 12> value;
+};
+
+// The WSR file
+struct WsrFile {
+  explicit WsrFile(ExtRegs *ext_regs) : MOD("MOD"), RND(ext_regs), ACC("ACC") {}
+
+  void on_start() {
+    MOD.on_start();
+    RND.on_start();
+    URND.on_start();
+    ACC.on_start();
+  }
+
+  static bool check_idx(uint32_t idx) { return idx < 8; }
+
+  bool has_value_at_idx(uint32_t idx) const {
+    switch (idx) {
+      case 4:
+      case 5:
+        return KeyS0.valid;
+      case 6:
+      case 7:
+        return KeyS1.valid;
+      default:
+        return true;
+    }
+  }
+
+  Wide read_at_idx(uint32_t idx) {
+    switch (idx) {
+      case 0:
+        return MOD.read();
+      case 1:
+        return RND.read();
+      case 2:
+        return URND.read();
+      case 3:
+        return ACC.read();
+      case 4:
+        return KeyS0.read(0);
+      case 5:
+        return KeyS0.read(256);
+      case 6:
+        return KeyS1.read(0);
+      case 7:
+        return KeyS1.read(256);
+      default:
+        check(false, "read from invalid WSR index");
+        return wide_zero();
+    }
+  }
+
+  void write_at_idx(uint32_t idx, const Wide &value) {
+    check(check_idx(idx), "write to invalid WSR index");
+    if (idx == 0)
+      MOD.write(value);
+    else if (idx == 3)
+      ACC.write(value);
+    // Writes to RND, URND and the key registers are ignored.
+  }
+
+  void commit() {
+    MOD.commit();
+    RND.commit();
+    URND.commit();
+    ACC.commit();
+  }
+
+  void abort() {
+    MOD.abort();
+    ACC.abort();
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    MOD.changes(dst);
+    ACC.changes(dst);
+  }
+
+  void wipe() {
+    MOD.write_invalid();
+    ACC.write_invalid();
+  }
+
+  DumbWsr MOD;
+  RndWsr RND;
+  UrndWsr URND;
+  DumbWsr ACC;
+  SideloadKey KeyS0;
+  SideloadKey KeyS1;
+};
+
+struct FlagReg {
+  FlagReg() : C(false), M(false), L(false), Z(false) {}
+  FlagReg(bool c, bool m, bool l, bool z) : C(c), M(m), L(l), Z(z) {}
+
+  static FlagReg mlz_for_result(bool c, const Wide &result) {
+    return FlagReg(c, wide_bit(result, 255), wide_bit(result, 0),
+                   wide_is_zero(result));
+  }
+
+  static FlagReg from_bits(uint32_t value) {
+    return FlagReg(value & 1, (value >> 1) & 1, (value >> 2) & 1,
+                   (value >> 3) & 1);
+  }
+
+  uint32_t to_bits() const {
+    return (Z << 3) | (L << 2) | (M << 1) | (C << 0);
+  }
+
+  bool get_by_idx(unsigned idx) const {
+    switch (idx) {
+      case 0:
+        return C;
+      case 1:
+        return M;
+      case 2:
+        return L;
+      default:
+        return Z;
+    }
+  }
+
+  bool C, M, L, Z;
+};
+
+// The two flag groups (see FlagGroups in flags.py)
+class FlagGroups {
+ public:
+  FlagGroups() : dirty_(false) {
+    has_new_[0] = has_new_[1] = false;
+  }
+
+  const FlagReg &operator[](unsigned fg) const {
+    assert(fg < 2);
+    return groups_[fg];
+  }
+
+  void set(unsigned fg, const FlagReg &value) {
+    assert(fg < 2);
+    dirty_ = true;
+    new_[fg] = value;
+    has_new_[fg] = true;
+  }
+
+  uint32_t read_unsigned() const {
+    return (groups_[1].to_bits() << 4) | groups_[0].to_bits();
+  }
+
+  void write_unsigned(uint32_t value) {
+    dirty_ = true;
+    for (int fg = 0; fg < 2; ++fg) {
+      new_[fg] = FlagReg::from_bits((value >> (4 * fg)) & 0xf);
+      has_new_[fg] = true;
+    }
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    for (int fg = 0; fg < 2; ++fg) {
+      if (!has_new_[fg])
+        continue;
+      const FlagReg &f = new_[fg];
+      std::ostringstream oss;
+      oss << "> FLAGS" << fg << ": {C: " << f.C << ", M: " << f.M
+          << ", L: " << f.L << ", Z: " << f.Z << "}";
+      dst->push_back(oss.str());
+    }
+  }
+
+  void commit() {
+    if (dirty_) {
+      for (int fg = 0; fg < 2; ++fg) {
+        if (has_new_[fg])
+          groups_[fg] = new_[fg];
+        has_new_[fg] = false;
+      }
+    }
+    dirty_ = false;
+  }
+
+  void abort() {
+    if (dirty_)
+      has_new_[0] = has_new_[1] = false;
+    dirty_ = false;
+  }
+
+ private:
+  FlagReg groups_[2];
+  FlagReg new_[2];
+  bool has_new_[2];
+  bool dirty_;
+};
+
+// A vector flag group (see VecFlagReg in flags.py). Each flag is a mask with
+// one bit per vector lane.
+struct VecFlagReg {
+  VecFlagReg() : C(0), M(0), L(0), Z(0) {}
+
+  // Set the flags of a lane, which must currently be clear
+  void set_lane(unsigned lane, const FlagReg &flags) {
+    assert(lane < 16);
+    C |= (uint32_t)flags.C << lane;
+    M |= (uint32_t)flags.M << lane;
+    L |= (uint32_t)flags.L << lane;
+    Z |= (uint32_t)flags.Z << lane;
+  }
+
+  // The lane mask for a flag (with indices as in FlagReg)
+  uint32_t get_by_idx(unsigned idx) const {
+    switch (idx) {
+      case 0:
+        return C;
+      case 1:
+        return M;
+      case 2:
+        return L;
+      default:
+        return Z;
+    }
+  }
+
+  static VecFlagReg from_bits(uint64_t value) {
+    VecFlagReg ret;
+    ret.C = value & 0xffff;
+    ret.M = (value >> 16) & 0xffff;
+    ret.L = (value >> 32) & 0xffff;
+    ret.Z = (value >> 48) & 0xffff;
+    return ret;
+  }
+
+  uint64_t to_bits() const {
+    return ((uint64_t)Z << 48) | ((uint64_t)L << 32) | ((uint64_t)M << 16) |
+           C;
+  }
+
+  uint32_t C, M, L, Z;
+};
+
+// The two vector flag groups (see VecFlagGroups in flags.py). These have no
+// entry in the RTL trace, so there is no changes() method.
+class VecFlagGroups {
+ public:
+  VecFlagGroups() : dirty_(false) { has_new_[0] = has_new_[1] = false; }
+
+  const VecFlagReg &operator[](unsigned vfg) const {
+    assert(vfg < 2);
+    return groups_[vfg];
+  }
+
+  void set(unsigned vfg, const VecFlagReg &value) {
+    assert(vfg < 2);
+    dirty_ = true;
+    new_[vfg] = value;
+    has_new_[vfg] = true;
+  }
+
+  uint64_t read_unsigned(unsigned vfg) const { return (*this)[vfg].to_bits(); }
+
+  void write_unsigned(unsigned vfg, uint64_t value) {
+    set(vfg, VecFlagReg::from_bits(value));
+  }
+
+  void commit() {
+    if (dirty_) {
+      for (int vfg = 0; vfg < 2; ++vfg) {
+        if (has_new_[vfg])
+          groups_[vfg] = new_[vfg];
+        has_new_[vfg] = false;
+      }
+    }
+    dirty_ = false;
+  }
+
+  void abort() {
+    if (dirty_)
+      has_new_[0] = has_new_[1] = false;
+    dirty_ = false;
+  }
+
+ private:
+  VecFlagReg groups_[2];
+  VecFlagReg new_[2];
+  bool has_new_[2];
+  bool dirty_;
+};
+
+// A model of DMEM (see dmem.py). Memory is stored as 32-bit words with a
+// validity flag.
+class Dmem {
+ public:
+  Dmem()
+      : data_(kDmemSizeBytes / 4, 0), valid_(kDmemSizeBytes / 4, false) {
+    mark_all_dirty();
+  }
+
+  // Replace the start of memory with len bytes at data, in the
+  // 5-byte-per-word format used by load_d / dump_d.
+  void load_5byte_le_words(const uint8_t *bytes, size_t len) {
+    if (len % 5) {
+      std::ostringstream oss;
+      oss << "Trying to load " << len
+          << " bytes of data, which is not a multiple of 5.";
+      throw std::runtime_error(oss.str());
+    }
+    size_t num_words = len / 5;
+    if (num_words > data_.size()) {
+      std::ostringstream oss;
+      oss << "Trying to load " << 4 * num_words
+          << " bytes of data, but DMEM is only " << 4 * data_.size()
+          << " bytes long.";
+      throw std::runtime_error(oss.str());
+    }
+    for (size_t i = 0; i < num_words; ++i) {
+      uint8_t vld = bytes[5 * i];
+      if (vld > 1) {
+        std::ostringstream oss;
+        oss << "The validity byte for 32-bit word " << i
+            << " in the input data is " << (int)vld << ", not 0 or 1.";
+        throw std::runtime_error(oss.str());
+      }
+      uint32_t u32 = 0;
+      for (int j = 0; j < 4; ++j)
+        u32 |= (uint32_t)bytes[5 * i + 1 + j] << (8 * j);
+      data_[i] = vld ? u32 : 0;
+      valid_[i] = vld != 0;
+      dirty_.insert(i);
+    }
+  }
+
+  std::vector<uint8_t> dump_le_words() const {
+    std::vector<uint8_t> ret;
+    ret.reserve(5 * data_.size());
+    for (size_t i = 0; i < data_.size(); ++i) {
+      bool vld = valid_[i];
+      uint32_t u32 = data_[i];
+      auto it = pending_.find(i);
+      if (it != pending_.end()) {
+        vld = true;
+        u32 = it->second;
+      }
+      ret.push_back(vld ? 1 : 0);
+      for (int j = 0; j < 4; ++j)
+        ret.push_back(vld ? (uint8_t)(u32 >> (8 * j)) : 0);
+    }
+    return ret;
+  }
+
+  bool is_valid_256b_addr(uint32_t addr) const {
+    return !(addr & 31) && addr / 4 < data_.size();
+  }
+
+  bool is_valid_32b_addr(uint32_t addr) const {
+    return !(addr & 3) && ((uint64_t)addr + 3) / 4 < data_.size();
+  }
+
+  // Read a 256-bit value from an aligned address. Returns false if any of the
+  // words are invalid.
+  bool load_u256(uint32_t addr, Wide *dst) const {
+    for (int i = 0; i < 8; ++i) {
+      if (!load_u32(addr + 4 * i, &(*dst)[i]))
+        return false;
+    }
+    return true;
+  }
+
+  // Read a 32-bit value from an aligned address. Returns false if the word is
+  // invalid.
+  bool load_u32(uint32_t addr, uint32_t *dst) const {
+    size_t idx = addr / 4;
+    auto it = pending_.find(idx);
+    if (it != pending_.end()) {
+      *dst = it->second;
+      return true;
+    }
+    *dst = data_[idx];
+    return valid_[idx];
+  }
+
+  void store_u256(uint32_t addr, const Wide &value) {
+    Store st = {addr, true, value};
+    trace_.push_back(st);
+  }
+
+  void store_u32(uint32_t addr, uint32_t value) {
+    Store st = {addr, false, wide_from_u64(value)};
+    trace_.push_back(st);
+  }
+
+  void commit() {
+    for (const auto &pr : pending_) {
+      data_[pr.first] = pr.second;
+      valid_[pr.first] = true;
+    }
+    pending_.clear();
+
+    for (const Store &st : trace_) {
+      size_t idx = st.addr / 4;
+      for (int i = 0; i < (st.is_wide ? 8 : 1); ++i) {
+        pending_[idx + i] = st.value[i];
+        dirty_.insert(idx + i);
+      }
+    }
+    trace_.clear();
+  }
+
+  void abort() { trace_.clear(); }
+
+  void empty_dmem() {
+    for (size_t i = 0; i < valid_.size(); ++i)
+      valid_[i] = false;
+    mark_all_dirty();
+  }
+
+  // Dirty tracking (see Dmem.mark_clean and Dmem.take_dirty in dmem.py)
+  void mark_clean() { dirty_.clear(); }
+
+  std::vector<size_t> take_dirty() {
+    std::vector<size_t> ret(dirty_.begin(), dirty_.end());
+    dirty_.clear();
+    return ret;
+  }
+
+  // Read word idx as dump_le_words would see it. Returns false if the word is
+  // invalid.
+  bool peek_word(size_t idx, uint32_t *dst) const {
+    auto it = pending_.find(idx);
+    if (it != pending_.end()) {
+      *dst = it->second;
+      return true;
+    }
+    *dst = valid_[idx] ? data_[idx] : 0;
+    return valid_[idx];
+  }
+
+ private:
+  struct Store {
+    uint32_t addr;
+    bool is_wide;
+    Wide value;
+  };
+
+  std::vector<uint32_t> data_;
+  std::vector<bool> valid_;
+
+  // Stores that have been committed once but not twice (mirroring the extra
+  // cycle of latency for stores in the RTL), keyed by word index.
+  std::map<size_t, uint32_t> pending_;
+
+  // Stores from the current instruction
+  std::vector<Store> trace_;
+
+  // Indices of words that might have changed since DMEM was last passed
+  // through shared memory
+  std::set<size_t> dirty_;
+
+  void mark_all_dirty() {
+    for (size_t i = 0; i < data_.size(); ++i)
+      dirty_.insert(dirty_.end(), i);
+  }
+};
+
+typedef std::map<uint32_t, uint32_t> LoopWarpsAtAddr;
+
+// The loop stack (see loop.py)
+class LoopStack {
+ public:
+  LoopStack() : err_flag(false), pop_on_commit_(false) {}
+
+  void start_loop(uint32_t start_addr, uint32_t loop_count,
+                  uint32_t insn_count) {
+    check(loop_count > 0 && insn_count > 0, "bad loop parameters");
+    if (stack_.size() == kLoopStackDepth)
+      err_flag = true;
+
+    Level lvl;
+    lvl.loop_count = loop_count;
+    lvl.restarts_left = loop_count - 1;
+    lvl.start_addr = start_addr;
+    lvl.last_addr = start_addr + 4 * insn_count - 4;
+    stack_.push_back(lvl);
+  }
+
+  bool is_last_insn_in_loop_body(uint32_t pc) const {
+    return !stack_.empty() && pc == stack_.back().last_addr;
+  }
+
+  void check_insn(uint32_t pc, bool insn_affects_control) {
+    if (is_last_insn_in_loop_body(pc) && insn_affects_control)
+      err_flag = true;
+  }
+
+  // Update loop stack. If we should loop, return true and set *back_pc.
+  bool step(uint32_t pc, const LoopWarpsAtAddr *warps, uint32_t *back_pc) {
+    pop_on_commit_ = false;
+
+    if (warps)
+      apply_warps(*warps);
+
+    if (!is_last_insn_in_loop_body(pc))
+      return false;
+
+    Level &top = stack_.back();
+    if (!top.restarts_left) {
+      pop_on_commit_ = true;
+      return false;
+    }
+    --top.restarts_left;
+    *back_pc = top.start_addr;
+    return true;
+  }
+
+  uint32_t err_bits() const { return err_flag ? ErrBits::kLoop : 0; }
+
+  void commit() {
+    check(!err_flag, "loop stack commit with error");
+    if (pop_on_commit_) {
+      stack_.pop_back();
+      pop_on_commit_ = false;
+    }
+  }
+
+  void abort() { err_flag = false; }
+
+  bool err_flag;
+
+ private:
+  struct Level {
+    uint32_t start_addr;
+    uint32_t last_addr;
+    uint32_t loop_count;
+    uint32_t restarts_left;
+  };
+
+  void apply_warps(const LoopWarpsAtAddr &warps) {
+    if (stack_.empty())
+      return;
+
+    Level &top = stack_.back();
+    uint32_t cur_iter_count = top.loop_count - (1 + top.restarts_left);
+    auto it = warps.find(cur_iter_count);
+    if (it == warps.end())
+      return;
+
+    uint32_t new_iter_count = it->second;
+    check(cur_iter_count <= new_iter_count &&
+              (uint64_t)new_iter_count + 1 <= top.loop_count,
+          "bad loop warp");
+    top.restarts_left = top.loop_count - new_iter_count - 1;
+  }
+
+  std::vector<Level> stack_;
+  bool pop_on_commit_;
+};
+
+enum class Op {
+  Empty,
+  Illegal,
+  Add,
+  Addi,
+  Lui,
+  Sub,
+  Sll,
+  Slli,
+  Srl,
+  Srli,
+  Sra,
+  Srai,
+  And,
+  Andi,
+  Or,
+  Ori,
+  Xor,
+  Xori,
+  Lw,
+  Sw,
+  Beq,
+  Bne,
+  Jal,
+  Jalr,
+  Csrrs,
+  Csrrw,
+  Ecall,
+  Loop,
+  Loopi,
+  BnAdd,
+  BnAddc,
+  BnAddi,
+  BnAddm,
+  BnMulqacc,
+  BnMulqaccWo,
+  BnMulqaccSo,
+  BnSub,
+  BnSubb,
+  BnSubi,
+  BnSubm,
+  BnAnd,
+  BnOr,
+  BnNot,
+  BnXor,
+  BnRshi,
+  BnSel,
+  BnCmp,
+  BnCmpb,
+  BnLid,
+  BnSid,
+  BnMov,
+  BnMovr,
+  BnWsrr,
+  BnWsrw,
+  BnAddv,
+  BnAddvm,
+  BnAddvc,
+  BnAddvi,
+  BnSubv,
+  BnSubvm,
+  BnSubvc,
+  BnSubvi,
+  BnMulv,
+  BnMulvl,
+  BnMulvm,
+  BnMulvml,
+  BnBflyv,
+  BnIbflyv,
+  BnTrn1,
+  BnTrn2,
+  BnShv,
+  BnSelv
+};
+
+// An entry in the decode table. A word matches if it has no bits set that are
+// set in must_zero and no bits clear that are set in must_one. These masks
+// are the ones that the Python model computes from insns.yml.
+struct InsnEncoding {
+  const char *mnemonic;
+  uint32_t must_zero;
+  uint32_t must_one;
+  Op op;
+};
+
+const InsnEncoding kInsnEncodings[] = {
+    {"add", 0xfe00704c, 0x00000033, Op::Add},
+    {"addi", 0x0000706c, 0x00000013, Op::Addi},
+    {"lui", 0x00000048, 0x00000037, Op::Lui},
+    {"sub", 0xbe00704c, 0x40000033, Op::Sub},
+    {"sll", 0xfe00604c, 0x00001033, Op::Sll},
+    {"slli", 0xfe00606c, 0x00001013, Op::Slli},
+    {"srl", 0xfe00204c, 0x00005033, Op::Srl},
+    {"srli", 0xfe00206c, 0x00005013, Op::Srli},
+    {"sra", 0xbe00204c, 0x40005033, Op::Sra},
+    {"srai", 0xbe00206c, 0x40005013, Op::Srai},
+    {"and", 0xfe00004c, 0x00007033, Op::And},
+    {"andi", 0x0000006c, 0x00007013, Op::Andi},
+    {"or", 0xfe00104c, 0x00006033, Op::Or},
+    {"ori", 0x0000106c, 0x00006013, Op::Ori},
+    {"xor", 0xfe00304c, 0x00004033, Op::Xor},
+    {"xori", 0x0000306c, 0x00004013, Op::Xori},
+    {"lw", 0x0000507c, 0x00002003, Op::Lw},
+    {"sw", 0x0000505c, 0x00002023, Op::Sw},
+    {"beq", 0x0000701c, 0x00000063, Op::Beq},
+    {"bne", 0x0000601c, 0x00001063, Op::Bne},
+    {"jal", 0x00000010, 0x0000006f, Op::Jal},
+    {"jalr", 0x00007018, 0x00000067, Op::Jalr},
+    {"csrrs", 0x0000500c, 0x00002073, Op::Csrrs},
+    {"csrrw", 0x0000600c, 0x00001073, Op::Csrrw},
+    {"ecall", 0xffffff8c, 0x00000073, Op::Ecall},
+    {"loop", 0x00007004, 0x0000007b, Op::Loop},
+    {"loopi", 0x00006004, 0x0000107b, Op::Loopi},
+    {"bn.add", 0x00007054, 0x0000002b, Op::BnAdd},
+    {"bn.addc", 0x00005054, 0x0000202b, Op::BnAddc},
+    {"bn.addi", 0x40003054, 0x0000402b, Op::BnAddi},
+    {"bn.addm", 0x40002054, 0x0000502b, Op::BnAddm},
+    {"bn.mulqacc", 0x60000044, 0x0000003b, Op::BnMulqacc},
+    {"bn.mulqacc.wo", 0x40000044, 0x2000003b, Op::BnMulqaccWo},
+    {"bn.mulqacc.so", 0x00000044, 0x4000003b, Op::BnMulqaccSo},
+    {"bn.sub", 0x00006054, 0x0000102b, Op::BnSub},
+    {"bn.subb", 0x00004054, 0x0000302b, Op::BnSubb},
+    {"bn.subi", 0x00003054, 0x4000402b, Op::BnSubi},
+    {"bn.subm", 0x00002054, 0x4000502b, Op::BnSubm},
+    {"bn.and", 0x00005004, 0x0000207b, Op::BnAnd},
+    {"bn.or", 0x00003004, 0x0000407b, Op::BnOr},
+    {"bn.not", 0x00002004, 0x0000507b, Op::BnNot},
+    {"bn.xor", 0x00001004, 0x0000607b, Op::BnXor},
+    {"bn.rshi", 0x00000004, 0x0000307b, Op::BnRshi},
+    {"bn.sel", 0x00007074, 0x0000000b, Op::BnSel},
+    {"bn.cmp", 0x00006074, 0x0000100b, Op::BnCmp},
+    {"bn.cmpb", 0x00004074, 0x0000300b, Op::BnCmpb},
+    {"bn.lid", 0x00003074, 0x0000400b, Op::BnLid},
+    {"bn.sid", 0x00002074, 0x0000500b, Op::BnSid},
+    {"bn.mov", 0x80001074, 0x0000600b, Op::BnMov},
+    {"bn.movr", 0x00001074, 0x8000600b, Op::BnMovr},
+    {"bn.wsrr", 0x80000074, 0x0000700b, Op::BnWsrr},
+    {"bn.wsrw", 0x00000074, 0x8000700b, Op::BnWsrw},
+    {"bn.addv", 0x4c007024, 0x0000005b, Op::BnAddv},
+    {"bn.addvm", 0x44007024, 0x0800005b, Op::BnAddvm},
+    {"bn.addvc", 0x48007024, 0x0400005b, Op::BnAddvc},
+    {"bn.addvi", 0x40005024, 0x0000205b, Op::BnAddvi},
+    {"bn.subv", 0x0c007024, 0x4000005b, Op::BnSubv},
+    {"bn.subvm", 0x04007024, 0x4800005b, Op::BnSubvm},
+    {"bn.subvc", 0x08007024, 0x4400005b, Op::BnSubvc},
+    {"bn.subvi", 0x00005024, 0x4000205b, Op::BnSubvi},
+    {"bn.mulv", 0xf2004024, 0x0000305b, Op::BnMulv},
+    {"bn.mulvl", 0x00004024, 0x0200305b, Op::BnMulvl},
+    {"bn.mulvm", 0xf2003024, 0x0000405b, Op::BnMulvm},
+    {"bn.mulvml", 0x00003024, 0x0200405b, Op::BnMulvml},
+    {"bn.bflyv", 0x40001024, 0x0000605b, Op::BnBflyv},
+    {"bn.ibflyv", 0x00001024, 0x4000605b, Op::BnIbflyv},
+    {"bn.trn1", 0x40002024, 0x0000505b, Op::BnTrn1},
+    {"bn.trn2", 0x00002024, 0x4000505b, Op::BnTrn2},
+    {"bn.shv", 0x00000024, 0x0000705b, Op::BnShv},
+    {"bn.selv", 0x00006024, 0x0000105b, Op::BnSelv},
+};
+
+// A decoded instruction. Which of the operand fields are meaningful depends on
+// the operation. Immediates have already been converted to operand values
+// (sign extended, shifted, and made absolute for PC-relative targets).
+struct Insn {
+  Insn()
+      : op(Op::Empty),
+        mnemonic("??"),
+        raw(0),
+        has_bits(false),
+        affects_control(false),
+        has_fetch_stall(false),
+        rd(0),
+        rs1(0),
+        rs2(0),
+        imm(0),
+        shift_type(0),
+        shift(0),
+        fg(0),
+        flag(0),
+        qs1(0),
+        qs2(0),
+        zero_acc(false),
+        hwsel(0),
+        inc1(false),
+        inc2(false),
+        dt(0),
+        lane(0) {}
+
+  Op op;
+  const char *mnemonic;
+  uint32_t raw;
+  bool has_bits;
+  bool affects_control;
+  bool has_fetch_stall;
+
+  // Destination and source register indices (GPRs or WDRs)
+  uint32_t rd, rs1, rs2;
+  // Immediate, offset or CSR/WSR index
+  int32_t imm;
+  // Shift direction and amount (in bits)
+  uint32_t shift_type, shift;
+  uint32_t fg, flag;
+  // Multiply-accumulate operands
+  uint32_t qs1, qs2;
+  bool zero_acc;
+  uint32_t hwsel;
+  // Increment flags for the first and second register operands of BN.LID,
+  // BN.SID and BN.MOVR.
+  bool inc1, inc2;
+  // Vector element datatype and lane
+  uint32_t dt, lane;
+};
+
+uint32_t bits(uint32_t word, unsigned hi, unsigned lo) {
+  uint32_t width = hi - lo + 1;
+  return (word >> lo) & ((width == 32) ? 0xffffffff : ((1u << width) - 1));
+}
+
+int32_t sext(uint32_t value, unsigned width) {
+  uint32_t sign = 1u << (width - 1);
+  return (int32_t)((value ^ sign) - sign);
+}
+
+Insn decode_word(uint32_t pc, uint32_t word) {
+  Insn insn;
+  insn.raw = word;
+  insn.has_bits = true;
+
+  const InsnEncoding *enc = nullptr;
+  for (const InsnEncoding &e : kInsnEncodings) {
+    if ((word & e.must_zero) || (~word & e.must_one))
+      continue;
+    enc = &e;
+    break;
+  }
+  if (!enc) {
+    insn.op = Op::Illegal;
+    insn.mnemonic = "dummy-insn";
+    return insn;
+  }
+
+  insn.op = enc->op;
+  insn.mnemonic = enc->mnemonic;
+
+  // Common fields
+  uint32_t f_rd = bits(word, 11, 7);
+  uint32_t f_rs1 = bits(word, 19, 15);
+  uint32_t f_rs2 = bits(word, 24, 20);
+  int32_t f_imm_i = sext(bits(word, 31, 20), 12);
+
+  switch (insn.op) {
+    case Op::Add:
+    case Op::Sub:
+    case Op::Sll:
+    case Op::Srl:
+    case Op::Sra:
+    case Op::And:
+    case Op::Or:
+    case Op::Xor:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      break;
+
+    case Op::Addi:
+    case Op::Andi:
+    case Op::Ori:
+    case Op::Xori:
+    case Op::Lw:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = f_imm_i;
+      break;
+
+    case Op::Jalr:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = f_imm_i;
+      insn.affects_control = true;
+      insn.has_fetch_stall = true;
+      break;
+
+    case Op::Slli:
+    case Op::Srli:
+    case Op::Srai:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 24, 20);
+      break;
+
+    case Op::Lui:
+      insn.rd = f_rd;
+      insn.imm = bits(word, 31, 12);
+      break;
+
+    case Op::Sw:
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.imm = sext((bits(word, 31, 25) << 5) | bits(word, 11, 7), 12);
+      break;
+
+    case Op::Beq:
+    case Op::Bne: {
+      uint32_t enc_imm = (bits(word, 31, 31) << 11) | (bits(word, 7, 7) << 10) |
+                         (bits(word, 30, 25) << 4) | bits(word, 11, 8);
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.imm = (int32_t)(pc + ((uint32_t)sext(enc_imm, 12) << 1));
+      insn.affects_control = true;
+      insn.has_fetch_stall = true;
+      break;
+    }
+
+    case Op::Jal: {
+      uint32_t enc_imm = (bits(word, 31, 31) << 19) |
+                         (bits(word, 19, 12) << 11) |
+                         (bits(word, 20, 20) << 10) | bits(word, 30, 21);
+      insn.rd = f_rd;
+      insn.imm = (int32_t)(pc + ((uint32_t)sext(enc_imm, 20) << 1));
+      insn.affects_control = true;
+      insn.has_fetch_stall = true;
+      break;
+    }
+
+    case Op::Csrrs:
+    case Op::Csrrw:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 31, 20);
+      break;
+
+    case Op::Ecall:
+      break;
+
+    case Op::Loop:
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 31, 20) + 1;
+      insn.affects_control = true;
+      break;
+
+    case Op::Loopi:
+      // rs2 holds the number of iterations
+      insn.rs2 = (bits(word, 19, 15) << 5) | bits(word, 11, 7);
+      insn.imm = bits(word, 31, 20) + 1;
+      insn.affects_control = true;
+      break;
+
+    case Op::BnAdd:
+    case Op::BnAddc:
+    case Op::BnSub:
+    case Op::BnSubb:
+    case Op::BnAnd:
+    case Op::BnOr:
+    case Op::BnXor:
+    case Op::BnCmp:
+    case Op::BnCmpb:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.shift_type = bits(word, 30, 30);
+      insn.shift = bits(word, 29, 25) << 3;
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnNot:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs2;
+      insn.shift_type = bits(word, 30, 30);
+      insn.shift = bits(word, 29, 25) << 3;
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnAddi:
+    case Op::BnSubi:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 29, 20);
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnAddm:
+    case Op::BnSubm:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      break;
+
+    case Op::BnMulqacc:
+    case Op::BnMulqaccWo:
+    case Op::BnMulqaccSo:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.qs1 = bits(word, 26, 25);
+      insn.qs2 = bits(word, 28, 27);
+      insn.shift = bits(word, 14, 13) << 6;
+      insn.zero_acc = bits(word, 12, 12);
+      insn.hwsel = bits(word, 29, 29);
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnRshi:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.imm = (bits(word, 31, 25) << 1) | bits(word, 14, 14);
+      break;
+
+    case Op::BnSel:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.fg = bits(word, 31, 31);
+      insn.flag = bits(word, 26, 25);
+      break;
+
+    case Op::BnLid:
+    case Op::BnSid:
+      // For BN.LID, rs2 is grd. For BN.SID, it is grs2.
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.imm = (int32_t)((uint32_t)sext(
+                               (bits(word, 11, 9) << 7) | bits(word, 31, 25),
+                               10)
+                           << 5);
+      insn.inc1 = bits(word, 8, 8);
+      insn.inc2 = bits(word, 7, 7);
+      break;
+
+    case Op::BnMov:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      break;
+
+    case Op::BnMovr:
+      // rs2 is grd and rs1 is grs
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.inc1 = bits(word, 9, 9);
+      insn.inc2 = bits(word, 7, 7);
+      break;
+
+    case Op::BnWsrr:
+    case Op::BnWsrw:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 27, 20);
+      break;
+
+    case Op::BnAddv:
+    case Op::BnAddvm:
+    case Op::BnAddvc:
+    case Op::BnSubv:
+    case Op::BnSubvm:
+    case Op::BnSubvc:
+    case Op::BnBflyv:
+    case Op::BnIbflyv:
+    case Op::BnTrn1:
+    case Op::BnTrn2:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.dt = bits(word, 29, 28);
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnAddvi:
+    case Op::BnSubvi:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.imm = bits(word, 27, 20);
+      insn.dt = bits(word, 29, 28);
+      insn.fg = bits(word, 31, 31);
+      break;
+
+    case Op::BnMulv:
+    case Op::BnMulvl:
+    case Op::BnMulvm:
+    case Op::BnMulvml:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.dt = bits(word, 27, 26);
+      insn.lane = bits(word, 31, 28);
+      break;
+
+    case Op::BnShv:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.dt = bits(word, 29, 28);
+      insn.shift_type = bits(word, 30, 30);
+      insn.shift = bits(word, 26, 20);
+      break;
+
+    case Op::BnSelv:
+      insn.rd = f_rd;
+      insn.rs1 = f_rs1;
+      insn.rs2 = f_rs2;
+      insn.dt = bits(word, 29, 28);
+      insn.fg = bits(word, 31, 31);
+      insn.flag = bits(word, 26, 25);
+      break;
+
+    default:
+      assert(0);
+  }
+
+  return insn;
+}
+
+// The bit size of a SIMD element for the given datatype encoding
+unsigned simd_element_size(uint32_t dt) {
+  assert(dt < 4);
+  return 16u << dt;
+}
+
+Wide extract_sub_word(const Wide &value, unsigned size, unsigned idx) {
+  check(idx < 256 / size, "sub-word index out of range");
+  return wide_trunc(wide_shr(value, size * idx), size);
+}
+
+// The Montgomery product of two size-bit elements, as computed by bn.mulvm
+// (montgomery_mul in the Python model). q and q_prime are the modulus and
+// Montgomery constant from MOD (see extract_vec_mod).
+Wide montgomery_mul(const Wide &a, const Wide &b, const Wide &q,
+                    const Wide &q_prime, unsigned size) {
+  // Elements have at most 128 bits, so p and m * q fit in 256 bits. Their
+  // sum might not, so the carry out becomes bit 256 - size of t.
+  Wide p = wide_mul(a, b);
+  Wide m = wide_trunc(wide_mul(wide_trunc(p, size), q_prime), size);
+  Wide sum;
+  bool carry = wide_add(p, wide_mul(m, q), false, &sum);
+  Wide t = wide_shr(sum, size);
+  if (carry)
+    t = wide_or(t, wide_shl(wide_from_u64(1), 256 - size));
+  if (wide_cmp(t, q) >= 0)
+    wide_sub(t, q, false, &t);
+  return wide_trunc(t, size);
+}
+
+Wide logical_byte_shift(const Wide &value, uint32_t shift_type,
+                        uint32_t shift_bits) {
+  return shift_type == 0 ? wide_shl(value, shift_bits)
+                         : wide_shr(value, shift_bits);
+}
+
+bool is_pc_valid(uint32_t pc) { return !(pc & 3) && pc < kImemSizeBytes; }
+
+}  // namespace
+
+// The architectural state of OTBN (see OTBNState in state.py)
+struct OtbnState {
+  OtbnState()
+      : wsrs(&ext_regs),
+        pc(0),
+        pc_next_override_valid(false),
+        pc_next_override(0),
+        fsm_state(FsmState::PreWipe),
+        next_fsm_state(FsmState::PreWipe),
+        init_sec_wipe_state(InitSecWipeState::NotDone),
+        wipe_rounds_to_do(2),
+        wipe_rounds_done(0),
+        err_bits(0),
+        pending_halt(false),
+        time_to_imem_invalidation(-1),
+        invalidated_imem(false),
+        wipe_cycles(-1),
+        lock_after_wipe(false),
+        injected_err_bits(0),
+        lock_immediately(false),
+        time_to_insn_cnt_zero(-1),
+        software_errs_fatal(false),
+        cycles_in_this_state(0),
+        rma_req(LcTx::Off),
+        has_state_to_wipe(false),
+        delayed_lock(false),
+        edn_seen_running(false) {}
+
+  uint32_t get_next_pc() const {
+    return pc_next_override_valid ? pc_next_override : pc + 4;
+  }
+
+  void set_next_pc(uint32_t next_pc) {
+    check(is_pc_valid(next_pc), "set_next_pc with invalid PC");
+    pc_next_override_valid = true;
+    pc_next_override = next_pc;
+  }
+
+  void edn_flush() {
+    ext_regs.rnd_reset();
+    urnd_client.edn_reset();
+    if (init_sec_wipe_state == InitSecWipeState::InProgress)
+      urnd_client.request();
+  }
+
+  void rnd_completed() {
+    EdnClient::CdcResult res = ext_regs.rnd_cdc_complete();
+    if (res.has_data)
+      wsrs.RND.set_value(res.data, res.fips_err, res.rep_err);
+  }
+
+  void urnd_completed() {
+    EdnClient::CdcResult res = urnd_client.cdc_complete();
+    check(res.has_data && !res.retry, "URND client was poisoned");
+
+    uint64_t seed[4];
+    for (int i = 0; i < 4; ++i)
+      seed[i] = wide_u64(res.data, i);
+
+    edn_seen_running = true;
+    wsrs.URND.set_seed(seed);
+  }
+
+  void start_init_sec_wipe() {
+    init_sec_wipe_state = InitSecWipeState::InProgress;
+    urnd_client.request();
+  }
+
+  bool init_sec_wipe_is_running() const {
+    return init_sec_wipe_state == InitSecWipeState::InProgress;
+  }
+
+  void loop_step(const LoopWarpsAtAddr *warps) {
+    uint32_t back_pc;
+    if (loop_stack.step(pc, warps, &back_pc))
+      set_next_pc(back_pc);
+  }
+
+  void changes(std::vector<std::string> *dst) const {
+    gprs.changes(dst);
+    ext_regs.changes(dst);
+    wsrs.changes(dst);
+    flags.changes(dst);
+    wdrs.changes(dst);
+  }
+
+  bool executing() const {
+    return !(fsm_state == FsmState::Idle || fsm_state == FsmState::Locked ||
+             fsm_state == FsmState::MemSecWipe);
+  }
+
+  bool wiping() const { return fsm_state == FsmState::Wiping; }
+
+  bool stop_if_pending_halt() {
+    if (pending_halt) {
+      stop();
+      return true;
+    }
+    return false;
+  }
+
+  void step(bool handle_injected_error) {
+    if (handle_injected_error)
+      take_injected_err_bits();
+    ext_regs.step();
+    urnd_client.step();
+  }
+
+  void commit(bool sim_stalled) {
+    if (time_to_imem_invalidation >= 0) {
+      --time_to_imem_invalidation;
+      if (time_to_imem_invalidation == 0) {
+        invalidated_imem = true;
+        time_to_imem_invalidation = -1;
+      }
+    }
+
+    FsmState old_state = fsm_state;
+    fsm_state = next_fsm_state;
+    if (fsm_state == old_state)
+      ++cycles_in_this_state;
+    else
+      cycles_in_this_state = 0;
+
+    ext_regs.commit();
+    wsrs.URND.commit();
+
+    if (old_state != FsmState::Exec && old_state != FsmState::Wiping)
+      return;
+
+    gprs.commit();
+    dmem.commit();
+    loop_stack.commit();
+    wsrs.commit();
+    flags.commit();
+    vec_flags.commit();
+    wdrs.commit();
+
+    if (!sim_stalled) {
+      pc = get_next_pc();
+      pc_next_override_valid = false;
+    }
+  }
+
+  void abort() {
+    gprs.abort();
+    pc_next_override_valid = false;
+    dmem.abort();
+    loop_stack.abort();
+    ext_regs.abort();
+    wsrs.abort();
+    flags.abort();
+    vec_flags.abort();
+    wdrs.abort();
+  }
+
+  void start() {
+    ext_regs.write(kExtStatus, Status::kBusyExecute);
+    pending_halt = false;
+    err_bits = 0;
+
+    fsm_state = FsmState::PreExec;
+    next_fsm_state = FsmState::PreExec;
+    has_state_to_wipe = true;
+
+    pc = 0;
+
+    flags = FlagGroups();
+    vec_flags = VecFlagGroups();
+    wsrs.on_start();
+    loop_stack = LoopStack();
+    gprs.empty_call_stack();
+
+    ext_regs.rnd_poison();
+    urnd_client.request();
+  }
+
+  void stop() {
+    bool insn_failed = err_bits && fsm_state == FsmState::Exec;
+    if (insn_failed)
+      abort();
+
+    ext_regs.set_bits(kExtIntrState, 1 << 0);
+
+    bool should_lock = (err_bits >> 16) != 0 || ((err_bits >> 10) & 1) ||
+                       (err_bits != 0 && software_errs_fatal) ||
+                       rma_req == LcTx::On;
+    ext_regs.write(kExtErrBits, err_bits);
+
+    pending_halt = false;
+
+    if (lock_immediately) {
+      check(should_lock, "lock_immediately without should_lock");
+      set_fsm_state(FsmState::Locked);
+      ext_regs.write(kExtStatus, Status::kLocked);
+    } else {
+      if (fsm_state == FsmState::Exec) {
+        ext_regs.write(kExtStopPc, pc);
+        ext_regs.write(kExtWipeStart, 1);
+        ext_regs.commit_reg(kExtWipeStart);
+
+        set_fsm_state(FsmState::PreWipe);
+        lock_after_wipe = should_lock;
+        wipe_rounds_done = 0;
+      } else if (fsm_state == FsmState::PreWipe ||
+                 fsm_state == FsmState::Wiping) {
+        check(should_lock, "stop while wiping without should_lock");
+        lock_after_wipe = true;
+      } else if (init_sec_wipe_state == InitSecWipeState::InProgress) {
+        check(should_lock, "stop in initial wipe without should_lock");
+        pending_halt = true;
+      } else if (init_sec_wipe_state == InitSecWipeState::Done) {
+        check(should_lock, "stop when idle without should_lock");
+        next_fsm_state = FsmState::Locked;
+        ext_regs.write(kExtStatus, Status::kLocked);
+      }
+    }
+
+    ext_regs.rnd_forget();
+  }
+
+  void set_fsm_state(FsmState new_state) {
+    if (new_state == FsmState::Wiping)
+      wipe_cycles = kWipeCycles;
+    next_fsm_state = new_state;
+  }
+
+  void set_mlz_flags(unsigned fg, const Wide &result) {
+    flags.set(fg, FlagReg::mlz_for_result(flags[fg].C, result));
+  }
+
+  void post_insn(const LoopWarpsAtAddr *warps) {
+    ext_regs.increment_insn_cnt();
+    loop_step(warps);
+    gprs.post_insn();
+
+    err_bits |= gprs.err_bits() | loop_stack.err_bits();
+    if (err_bits)
+      pending_halt = true;
+
+    if (!is_pc_valid(get_next_pc()) && !pending_halt) {
+      err_bits |= ErrBits::kBadInsnAddr;
+      pending_halt = true;
+    }
+  }
+
+  static bool csr_check_idx(uint32_t idx) {
+    return (0x7c0 <= idx && idx <= 0x7c5) || idx == 0x7c8 ||
+           (0x7d0 <= idx && idx <= 0x7d8) || idx == 0xfc0 || idx == 0xfc1;
+  }
+
+  uint32_t read_csr(uint32_t idx) {
+    if (idx == 0x7c0 || idx == 0x7c1)
+      return (flags.read_unsigned() >> (4 * (idx - 0x7c0))) & 0xf;
+    if (0x7c2 <= idx && idx <= 0x7c5) {
+      // VFG0_CM, VFG0_LZ, VFG1_CM, VFG1_LZ: each half of a vector flag group
+      unsigned vfg = (idx - 0x7c2) / 2, shift = 32 * ((idx - 0x7c2) % 2);
+      return (uint32_t)(vec_flags.read_unsigned(vfg) >> shift);
+    }
+    if (idx == 0x7c8)
+      return flags.read_unsigned();
+    if (0x7d0 <= idx && idx <= 0x7d7)
+      return wsrs.MOD.read()[idx - 0x7d0];
+    if (idx == 0x7d8)
+      return 0;
+    if (idx == 0xfc0)
+      return wsrs.RND.read_u32();
+    if (idx == 0xfc1)
+      return wsrs.URND.read_u32();
+
+    check(false, "read from unknown CSR index");
+    return 0;
+  }
+
+  void write_csr(uint32_t idx, uint32_t value) {
+    if (idx == 0x7c0 || idx == 0x7c1) {
+      unsigned shift = 4 * (idx - 0x7c0);
+      uint32_t old = flags.read_unsigned();
+      flags.write_unsigned((old & ~(0xfu << shift)) | ((value & 0xf) << shift));
+      return;
+    }
+    if (0x7c2 <= idx && idx <= 0x7c5) {
+      unsigned vfg = (idx - 0x7c2) / 2, shift = 32 * ((idx - 0x7c2) % 2);
+      uint64_t old = vec_flags.read_unsigned(vfg);
+      vec_flags.write_unsigned(vfg, (old & ~(0xffffffffull << shift)) |
+                                        ((uint64_t)value << shift));
+      return;
+    }
+    if (idx == 0x7c8) {
+      flags.write_unsigned(value);
+      return;
+    }
+    if (0x7d0 <= idx && idx <= 0x7d7) {
+      Wide mod = wsrs.MOD.read();
+      mod[idx - 0x7d0] = value;
+      wsrs.MOD.write(mod);
+      return;
+    }
+    if (idx == 0x7d8) {
+      wsrs.RND.request_value();
+      return;
+    }
+    if (idx == 0xfc0 || idx == 0xfc1)
+      return;
+
+    check(false, "write to unknown CSR index");
+  }
+
+  void stop_at_end_of_cycle(uint32_t new_err_bits) {
+    err_bits |= new_err_bits;
+    pending_halt = true;
+  }
+
+  void invalidate_imem() { time_to_imem_invalidation = 2; }
+
+  void clear_imem_invalidation() {
+    time_to_imem_invalidation = -1;
+    invalidated_imem = false;
+  }
+
+  void wipe() {
+    gprs.wipe();
+    wdrs.wipe();
+    wsrs.wipe();
+    flags.write_unsigned(0);
+    for (unsigned vfg = 0; vfg < 2; ++vfg)
+      vec_flags.write_unsigned(vfg, 0);
+  }
+
+  void take_injected_err_bits() {
+    if (injected_err_bits != 0) {
+      stop_at_end_of_cycle(injected_err_bits);
+      injected_err_bits = 0;
+    }
+  }
+
+  GprFile gprs;
+  WdrFile wdrs;
+  ExtRegs ext_regs;
+  WsrFile wsrs;
+  FlagGroups flags;
+  VecFlagGroups vec_flags;
+
+  uint32_t pc;
+  bool pc_next_override_valid;
+  uint32_t pc_next_override;
+
+  Dmem dmem;
+
+  FsmState fsm_state;
+  FsmState next_fsm_state;
+  InitSecWipeState init_sec_wipe_state;
+
+  int wipe_rounds_to_do;
+  int wipe_rounds_done;
+
+  LoopStack loop_stack;
+
+  uint32_t err_bits;
+  bool pending_halt;
+
+  EdnClient urnd_client;
+
+  // A countdown to IMEM invalidation (negative if there is none pending)
+  int time_to_imem_invalidation;
+  bool invalidated_imem;
+
+  int wipe_cycles;
+  bool lock_after_wipe;
+  uint32_t injected_err_bits;
+  bool lock_immediately;
+
+  // A countdown to zeroing INSN_CNT (negative if there is none pending)
+  int time_to_insn_cnt_zero;
+
+  bool software_errs_fatal;
+  unsigned cycles_in_this_state;
+  LcTx rma_req;
+  bool has_state_to_wipe;
+  bool delayed_lock;
+  bool edn_seen_running;
+};
+
+// The simulator itself (see OTBNSim in sim.py), together with the command
+// handlers from stepped.py.
+class NativeSim {
+ public:
+  // shared_mem is the memory shared with ISSWrapper (see IssSharedMem), or
+  // null if there is none.
+  explicit NativeSim(uint8_t *shared_mem)
+      : shared_mem_(shared_mem),
+        next_insn_valid_(false),
+        insn_in_progress_(false),
+        exec_stage_(0) {}
+
+  void run_command(const std::string &cmd, std::vector<std::string> *out);
+
+ private:
+  typedef std::vector<std::string> Args;
+
+  // Step the simulation by a cycle, returning true (and setting *insn) if an
+  // instruction retired.
+  bool step(Insn *insn, std::vector<std::string> *changes);
+
+  bool step_idle(std::vector<std::string> *changes);
+  bool step_ext_wipe(std::vector<std::string> *changes);
+  bool step_pre_exec(std::vector<std::string> *changes);
+  bool step_exec(Insn *insn, std::vector<std::string> *changes);
+  bool step_pre_wipe(std::vector<std::string> *changes);
+  bool step_wiping(std::vector<std::string> *changes);
+
+  void on_stall(bool fetch_next, std::vector<std::string> *changes);
+  void on_retire(const Insn &insn, std::vector<std::string> *changes);
+  void delayed_insn_cnt_zero(int delay_if_locking);
+
+  Insn fetch(uint32_t pc) const;
+
+  void start_mem_wipe(bool is_imem);
+  void on_otp_cdc_done();
+  void lock_immediately();
+  void urnd_completed();
+
+  // Run a cycle of the instruction. Returns true if the instruction has
+  // stalled and needs at least one more cycle.
+  bool execute(const Insn &insn);
+  bool execute_vec(const Insn &insn);
+
+  // Step a cycle, appending its trace to *out. Returns true if the cycle
+  // changed an external register other than INSN_CNT (step_cycle in
+  // stepped.py).
+  bool step_cycle(std::vector<std::string> *out);
+
+  // Command handlers
+  void on_start_operation(const Args &args, std::vector<std::string> *out);
+  void on_step(const Args &args, std::vector<std::string> *out);
+  void on_run(const Args &args, std::vector<std::string> *out);
+  void on_add_loop_warp(const Args &args, std::vector<std::string> *out);
+  void on_load_d(const Args &args, std::vector<std::string> *out);
+  void on_load_i(const Args &args, std::vector<std::string> *out);
+  void on_dump_d(const Args &args, std::vector<std::string> *out);
+  void on_load_d_shared(const Args &args, std::vector<std::string> *out);
+  void on_load_i_shared(const Args &args, std::vector<std::string> *out);
+  void on_dump_d_shared(const Args &args, std::vector<std::string> *out);
+  void on_dump_d_dirty(const Args &args, std::vector<std::string> *out);
+
+  // Replace the program with len bytes at data (in the 5-byte-per-word
+  // format), which came from src.
+  void load_program(const uint8_t *bytes, size_t len, const std::string &src);
+
+  // Get the shared memory, throwing a std::runtime_error if there is none.
+  IssSharedMem get_shared_mem(const char *verb) const;
+
+  uint8_t *shared_mem_;
+  void on_print_regs(const Args &args, std::vector<std::string> *out);
+  void on_print_call_stack(const Args &args, std::vector<std::string> *out);
+  void on_set_keymgr_value(const Args &args);
+  void on_step_crc(const Args &args, std::vector<std::string> *out);
+
+  OtbnState state_;
+  std::vector<Insn> program_;
+  std::map<uint32_t, LoopWarpsAtAddr> loop_warps_;
+
+  // The instruction that was fetched on the previous cycle, if any
+  bool next_insn_valid_;
+  Insn next_insn_;
+
+  // Execution state for a multi-cycle instruction. insn_in_progress_ is the
+  // equivalent of the Python model's _execute_generator being non-None.
+  // exec_stage_ counts the cycles that the instruction has already spent and
+  // the exec_* fields hold values that were computed on an earlier cycle.
+  bool insn_in_progress_;
+  unsigned exec_stage_;
+  uint32_t exec_u32_[2];
+  bool exec_valid_;
+  Wide exec_wide_;
+};
+
+Insn NativeSim::fetch(uint32_t pc) const {
+  uint32_t word_pc = pc >> 2;
+  if (word_pc >= program_.size()) {
+    std::ostringstream oss;
+    oss << "Trying to execute instruction at address 0x" << std::hex << pc
+        << ", but the program is only 0x" << 4 * program_.size()
+        << " bytes (" << std::dec << program_.size()
+        << " instructions) long. Since there are no architectural contents "
+           "of the memory here, we have to stop.";
+    throw std::runtime_error(oss.str());
+  }
+
+  if (state_.invalidated_imem)
+    return Insn();
+
+  return program_[word_pc];
+}
+
+void NativeSim::on_stall(bool fetch_next, std::vector<std::string> *changes) {
+  state_.stop_if_pending_halt();
+  state_.changes(changes);
+  state_.commit(true);
+  if (fetch_next) {
+    next_insn_ = fetch(state_.pc);
+    next_insn_valid_ = true;
+  }
+}
+
+void NativeSim::on_retire(const Insn &insn, std::vector<std::string> *changes) {
+  auto it = loop_warps_.find(state_.pc);
+  state_.post_insn(it == loop_warps_.end() ? nullptr : &it->second);
+
+  bool halting = state_.stop_if_pending_halt();
+  state_.changes(changes);
+
+  state_.commit(false);
+
+  bool no_fetch = halting || insn.has_fetch_stall;
+  if (no_fetch) {
+    next_insn_valid_ = false;
+  } else {
+    next_insn_ = fetch(state_.pc);
+    next_insn_valid_ = true;
+  }
+}
+
+void NativeSim::delayed_insn_cnt_zero(int delay_if_locking) {
+  check(state_.fsm_state == FsmState::PreWipe ||
+            state_.fsm_state == FsmState::Wiping,
+        "delayed_insn_cnt_zero outside of wipe");
+
+  if (!state_.lock_after_wipe)
+    return;
+
+  if (state_.ext_regs.read(kExtInsnCnt) == 0)
+    return;
+
+  if (state_.time_to_insn_cnt_zero < 0)
+    state_.time_to_insn_cnt_zero = delay_if_locking;
+  int count = std::min(state_.time_to_insn_cnt_zero, delay_if_locking);
+
+  if (count == 0) {
+    state_.ext_regs.write(kExtInsnCnt, 0);
+    state_.time_to_insn_cnt_zero = -1;
+  } else {
+    state_.time_to_insn_cnt_zero = count - 1;
+  }
+}
+
+bool NativeSim::step(Insn *insn, std::vector<std::string> *changes) {
+  switch (state_.fsm_state) {
+    case FsmState::MemSecWipe:
+      state_.step(true);
+      return step_ext_wipe(changes);
+    case FsmState::Idle:
+    case FsmState::Locked:
+      state_.step(true);
+      return step_idle(changes);
+    case FsmState::PreExec:
+      state_.step(true);
+      return step_pre_exec(changes);
+    case FsmState::Exec:
+      state_.step(false);
+      return step_exec(insn, changes);
+    case FsmState::PreWipe:
+      state_.step(true);
+      return step_pre_wipe(changes);
+    case FsmState::Wiping:
+      state_.step(true);
+      return step_wiping(changes);
+    default:
+      check(false, "unknown FSM state");
+      return false;
+  }
+}
+
+bool NativeSim::step_idle(std::vector<std::string> *changes) {
+  state_.stop_if_pending_halt();
+
+  bool is_locked = state_.fsm_state == FsmState::Locked;
+
+  // If we are locked or get an RMA request, the INSN_CNT register should be
+  // zeroed (but only write it if something changes).
+  bool should_zero = is_locked || state_.rma_req == LcTx::On;
+  bool new_zero = (state_.cycles_in_this_state == 0 ||
+                   state_.ext_regs.read(kExtInsnCnt) != 0);
+  if (should_zero && new_zero)
+    state_.ext_regs.write(kExtInsnCnt, 0);
+
+  if (state_.delayed_lock) {
+    state_.set_fsm_state(FsmState::Locked);
+    state_.ext_regs.write(kExtStatus, Status::kLocked);
+    is_locked = true;
+  }
+
+  if (state_.rma_req == LcTx::On && !is_locked) {
+    state_.ext_regs.write(kExtStatus, Status::kBusySecWipeInt);
+    state_.set_fsm_state(FsmState::PreWipe);
+    state_.lock_after_wipe = true;
+    state_.wipe_rounds_done = 0;
+  }
+
+  if (state_.init_sec_wipe_is_running() && !is_locked) {
+    if (state_.wsrs.URND.running) {
+      bool start_of_time_rma =
+          state_.rma_req == LcTx::On && !state_.has_state_to_wipe;
+      if (start_of_time_rma) {
+        state_.init_sec_wipe_state = InitSecWipeState::Done;
+        state_.set_fsm_state(FsmState::Locked);
+        state_.ext_regs.write(kExtStatus, Status::kLocked);
+      } else {
+        state_.set_fsm_state(FsmState::Wiping);
+        if (is_locked)
+          state_.lock_after_wipe = true;
+      }
+    }
+  }
+
+  state_.changes(changes);
+  state_.commit(true);
+  return false;
+}
+
+bool NativeSim::step_ext_wipe(std::vector<std::string> *changes) {
+  state_.stop_if_pending_halt();
+  state_.changes(changes);
+  state_.commit(true);
+  return false;
+}
+
+bool NativeSim::step_pre_exec(std::vector<std::string> *changes) {
+  if (state_.wsrs.URND.running)
+    state_.set_fsm_state(FsmState::Exec);
+
+  on_stall(false, changes);
+
+  if (state_.rma_req == LcTx::On)
+    lock_immediately();
+
+  // Zero INSN_CNT the cycle after we are told to start
+  if (state_.ext_regs.read(kExtInsnCnt) != 0)
+    state_.ext_regs.write(kExtInsnCnt, 0);
+
+  return false;
+}
+
+bool NativeSim::step_exec(Insn *insn_out, std::vector<std::string> *changes) {
+  check(state_.init_sec_wipe_state == InitSecWipeState::Done,
+        "executing before initial secure wipe is done");
+
+  state_.wsrs.URND.step();
+
+  if (!next_insn_valid_) {
+    state_.take_injected_err_bits();
+    on_stall(true, changes);
+    return false;
+  }
+
+  // Take a copy: next_insn_ gets overwritten when we fetch.
+  Insn insn = next_insn_;
+
+  if (state_.rma_req == LcTx::On) {
+    state_.stop_at_end_of_cycle(1);
+    state_.set_fsm_state(FsmState::PreWipe);
+    state_.lock_after_wipe = true;
+    insn_in_progress_ = false;
+  }
+
+  if (!insn.has_bits)
+    insn_in_progress_ = false;
+
+  if (!insn_in_progress_) {
+    state_.loop_stack.check_insn(state_.pc, insn.affects_control);
+    exec_stage_ = 0;
+  }
+
+  insn_in_progress_ = execute(insn);
+  if (insn_in_progress_)
+    ++exec_stage_;
+
+  if (state_.wsrs.RND.rep_err_escalate)
+    state_.stop_at_end_of_cycle(ErrBits::kRndRepChkFail);
+  if (state_.wsrs.RND.fips_err_escalate)
+    state_.stop_at_end_of_cycle(ErrBits::kRndFipsChkFail);
+
+  state_.take_injected_err_bits();
+
+  if (state_.pending_halt)
+    insn_in_progress_ = false;
+
+  if (!insn_in_progress_) {
+    on_retire(insn, changes);
+    *insn_out = insn;
+    return true;
+  }
+
+  on_stall(false, changes);
+  return false;
+}
+
+bool NativeSim::step_pre_wipe(std::vector<std::string> *changes) {
+  if (state_.rma_req == LcTx::On && !state_.edn_seen_running) {
+    state_.lock_after_wipe = true;
+    state_.wipe_rounds_to_do = 1;
+    state_.set_fsm_state(FsmState::Wiping);
+  }
+
+  if (state_.ext_regs.read(kExtWipeStart))
+    state_.ext_regs.write(kExtWipeStart, 0);
+
+  delayed_insn_cnt_zero(0);
+
+  if (state_.wsrs.URND.running) {
+    uint32_t status = state_.ext_regs.read(kExtStatus);
+    if (status != Status::kBusySecWipeInt && status != Status::kLocked)
+      state_.ext_regs.write(kExtStatus, Status::kBusySecWipeInt);
+
+    state_.set_fsm_state(FsmState::Wiping);
+  }
+
+  on_stall(false, changes);
+  return false;
+}
+
+bool NativeSim::step_wiping(std::vector<std::string> *changes) {
+  check(state_.wipe_cycles >= 0, "negative wipe cycle count");
+
+  bool was_wiping = state_.wipe_cycles > 0;
+  if (was_wiping)
+    --state_.wipe_cycles;
+
+  bool is_good = !state_.lock_after_wipe;
+  bool locking = state_.rma_req == LcTx::On || !is_good;
+
+  if (state_.rma_req == LcTx::On)
+    state_.lock_after_wipe = true;
+
+  if (state_.pending_halt)
+    state_.lock_after_wipe = true;
+
+  delayed_insn_cnt_zero(1);
+
+  if (state_.wipe_cycles == 1) {
+    // The penultimate cycle of a wipe round.
+    bool final_wipe_round =
+        state_.wipe_rounds_done == state_.wipe_rounds_to_do - 1;
+    if (final_wipe_round) {
+      state_.ext_regs.write(kExtStatus,
+                            locking ? Status::kLocked : Status::kIdle);
+      state_.wipe();
+    } else {
+      state_.wsrs.URND.running = false;
+      state_.urnd_client.request();
+    }
+  }
+
+  if (state_.wipe_cycles == 0) {
+    if (was_wiping)
+      ++state_.wipe_rounds_done;
+
+    bool final_wipe_round =
+        state_.wipe_rounds_done == state_.wipe_rounds_to_do;
+
+    if (!final_wipe_round) {
+      state_.set_fsm_state(FsmState::PreWipe);
+    } else {
+      if (state_.rma_req != LcTx::Off)
+        state_.delayed_lock = true;
+
+      FsmState next_state;
+      if (locking) {
+        next_state = FsmState::Locked;
+        state_.ext_regs.write(kExtStatus, Status::kLocked);
+      } else {
+        next_state = FsmState::Idle;
+        if (state_.init_sec_wipe_is_running())
+          state_.init_sec_wipe_state = InitSecWipeState::Done;
+      }
+
+      state_.wipe_cycles = -1;
+      state_.set_fsm_state(next_state);
+    }
+  }
+
+  on_stall(false, changes);
+  return false;
+}
+
+void NativeSim::start_mem_wipe(bool is_imem) {
+  if (state_.fsm_state != FsmState::Idle)
+    return;
+
+  state_.set_fsm_state(FsmState::MemSecWipe);
+  state_.ext_regs.write(kExtStatus, is_imem ? Status::kBusySecWipeImem
+                                            : Status::kBusySecWipeDmem);
+}
+
+void NativeSim::on_otp_cdc_done() {
+  FsmState cur = state_.fsm_state;
+  check(cur == FsmState::MemSecWipe || cur == FsmState::PreWipe ||
+            cur == FsmState::Wiping || cur == FsmState::Locked,
+        "OTP CDC completion in unexpected state");
+  if (cur == FsmState::MemSecWipe) {
+    state_.ext_regs.write(kExtStatus, Status::kIdle);
+    state_.set_fsm_state(FsmState::Idle);
+  }
+}
+
+void NativeSim::lock_immediately() {
+  state_.set_fsm_state(FsmState::Locked);
+  state_.ext_regs.write(kExtStatus, Status::kLocked, true);
+}
+
+void NativeSim::urnd_completed() {
+  state_.urnd_completed();
+
+  FsmState cur = state_.fsm_state;
+  if (cur != FsmState::PreExec && cur != FsmState::PreWipe)
+    lock_immediately();
+}
+
+bool NativeSim::execute(const Insn &insn) {
+  OtbnState &st = state_;
+  GprFile &gprs = st.gprs;
+  WdrFile &wdrs = st.wdrs;
+
+// Check for an error from reading x1 with an empty call stack. This appears
+// after the register reads in almost all the instructions below.
+#define CHECK_CALL_STACK()                        \
+  do {                                            \
+    if (gprs.call_stack_err) {                    \
+      st.stop_at_end_of_cycle(ErrBits::kCallStack); \
+      return false;                               \
+    }                                             \
+  } while (0)
+
+  switch (insn.op) {
+    case Op::Empty:
+      st.stop_at_end_of_cycle(ErrBits::kImemIntgViolation);
+      return false;
+
+    case Op::Illegal:
+      st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+      return false;
+
+    case Op::Add:
+    case Op::Sub:
+    case Op::Sll:
+    case Op::Srl:
+    case Op::And:
+    case Op::Or:
+    case Op::Xor: {
+      uint32_t val1 = gprs.read(insn.rs1);
+      uint32_t val2 = gprs.read(insn.rs2);
+      CHECK_CALL_STACK();
+      uint32_t result;
+      switch (insn.op) {
+        case Op::Add:
+          result = val1 + val2;
+          break;
+        case Op::Sub:
+          result = val1 - val2;
+          break;
+        case Op::Sll:
+          result = val1 << (val2 & 0x1f);
+          break;
+        case Op::Srl:
+          result = val1 >> (val2 & 0x1f);
+          break;
+        case Op::And:
+          result = val1 & val2;
+          break;
+        case Op::Or:
+          result = val1 | val2;
+          break;
+        default:
+          result = val1 ^ val2;
+          break;
+      }
+      gprs.write(insn.rd, result);
+      return false;
+    }
+
+    case Op::Sra: {
+      int32_t val1 = gprs.read_signed(insn.rs1);
+      uint32_t val2 = gprs.read(insn.rs2) & 0x1f;
+      CHECK_CALL_STACK();
+      gprs.write(insn.rd, (uint32_t)(val1 >> val2));
+      return false;
+    }
+
+    case Op::Addi:
+    case Op::Andi:
+    case Op::Ori:
+    case Op::Xori:
+    case Op::Slli:
+    case Op::Srli: {
+      uint32_t val1 = gprs.read(insn.rs1);
+      CHECK_CALL_STACK();
+      uint32_t imm = (uint32_t)insn.imm;
+      uint32_t result;
+      switch (insn.op) {
+        case Op::Addi:
+          result = val1 + imm;
+          break;
+        case Op::Andi:
+          result = val1 & imm;
+          break;
+        case Op::Ori:
+          result = val1 | imm;
+          break;
+        case Op::Xori:
+          result = val1 ^ imm;
+          break;
+        case Op::Slli:
+          result = val1 << imm;
+          break;
+        default:
+          result = val1 >> imm;
+          break;
+      }
+      gprs.write(insn.rd, result);
+      return false;
+    }
+
+    case Op::Srai: {
+      int32_t val1 = gprs.read_signed(insn.rs1);
+      CHECK_CALL_STACK();
+      gprs.write(insn.rd, (uint32_t)(val1 >> insn.imm));
+      return false;
+    }
+
+    case Op::Lui:
+      gprs.write(insn.rd, (uint32_t)insn.imm << 12);
+      return false;
+
+    case Op::Lw: {
+      if (exec_stage_ == 0) {
+        uint32_t base = gprs.read(insn.rs1);
+        CHECK_CALL_STACK();
+
+        uint32_t addr = base + (uint32_t)insn.imm;
+        if (!st.dmem.is_valid_32b_addr(addr)) {
+          st.stop_at_end_of_cycle(ErrBits::kBadDataAddr);
+          return false;
+        }
+
+        exec_valid_ = st.dmem.load_u32(addr, &exec_u32_[0]);
+
+        // Stall for a single cycle for memory to respond
+        return true;
+      }
+
+      if (!exec_valid_) {
+        st.stop_at_end_of_cycle(ErrBits::kDmemIntgViolation);
+        return false;
+      }
+      gprs.write(insn.rd, exec_u32_[0]);
+      return false;
+    }
+
+    case Op::Sw: {
+      uint32_t base = gprs.read(insn.rs1);
+      uint32_t addr = base + (uint32_t)insn.imm;
+      uint32_t value = gprs.read(insn.rs2);
+
+      bool bad_grs1 = gprs.call_stack_err && insn.rs1 == 1;
+      bool saw_err = false;
+
+      if (gprs.call_stack_err) {
+        st.stop_at_end_of_cycle(ErrBits::kCallStack);
+        saw_err = true;
+      }
+      if (!st.dmem.is_valid_32b_addr(addr) && !bad_grs1) {
+        st.stop_at_end_of_cycle(ErrBits::kBadDataAddr);
+        saw_err = true;
+      }
+      if (saw_err)
+        return false;
+
+      st.dmem.store_u32(addr, value);
+      return false;
+    }
+
+    case Op::Beq:
+    case Op::Bne: {
+      uint32_t val1 = gprs.read(insn.rs1);
+      uint32_t val2 = gprs.read(insn.rs2);
+      CHECK_CALL_STACK();
+
+      uint32_t tgt_pc = (uint32_t)insn.imm;
+      bool taken = (insn.op == Op::Beq) ? (val1 == val2) : (val1 != val2);
+      if (taken) {
+        if (!is_pc_valid(tgt_pc))
+          st.stop_at_end_of_cycle(ErrBits::kBadInsnAddr);
+        else
+          st.set_next_pc(tgt_pc);
+      }
+      return false;
+    }
+
+    case Op::Jal: {
+      gprs.write(insn.rd, st.pc + 4);
+
+      uint32_t next_pc = (uint32_t)insn.imm;
+      if (!is_pc_valid(next_pc))
+        st.stop_at_end_of_cycle(ErrBits::kBadInsnAddr);
+      else
+        st.set_next_pc(next_pc);
+      return false;
+    }
+
+    case Op::Jalr: {
+      uint32_t val1 = gprs.read(insn.rs1);
+      CHECK_CALL_STACK();
+
+      gprs.write(insn.rd, st.pc + 4);
+
+      uint32_t next_pc = val1 + (uint32_t)insn.imm;
+      if (!is_pc_valid(next_pc))
+        st.stop_at_end_of_cycle(ErrBits::kBadInsnAddr);
+      else
+        st.set_next_pc(next_pc);
+      return false;
+    }
+
+    case Op::Csrrs:
+    case Op::Csrrw: {
+      uint32_t csr = (uint32_t)insn.imm;
+      bool is_csrrs = insn.op == Op::Csrrs;
+
+      if (exec_stage_ == 0) {
+        if (!OtbnState::csr_check_idx(csr)) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          return false;
+        }
+
+        // For CSRRS, this is the bits to set. For CSRRW, it's the new value.
+        exec_u32_[0] = gprs.read(insn.rs1);
+        CHECK_CALL_STACK();
+      }
+
+      // A read from RND. If a RND value is not available, request_value()
+      // initiates or continues an EDN request and returns false, in which
+      // case we stall for a cycle.
+      bool reads_rnd = csr == 0xfc0 && (is_csrrs || insn.rd != 0);
+      if (reads_rnd && !st.wsrs.RND.request_value())
+        return true;
+
+      if (is_csrrs) {
+        uint32_t old_val = st.read_csr(csr);
+        gprs.write(insn.rd, old_val);
+        if (insn.rs1 != 0)
+          st.write_csr(csr, old_val | exec_u32_[0]);
+      } else {
+        if (insn.rd != 0)
+          gprs.write(insn.rd, st.read_csr(csr));
+        st.write_csr(csr, exec_u32_[0]);
+      }
+      return false;
+    }
+
+    case Op::Ecall:
+      st.stop_at_end_of_cycle(0);
+      return false;
+
+    case Op::Loop: {
+      uint32_t num_iters = gprs.read(insn.rs1);
+      CHECK_CALL_STACK();
+
+      if (num_iters == 0)
+        st.stop_at_end_of_cycle(ErrBits::kLoop);
+      else
+        st.loop_stack.start_loop(st.pc + 4, num_iters, insn.imm);
+      return false;
+    }
+
+    case Op::Loopi:
+      if (insn.rs2 == 0)
+        st.stop_at_end_of_cycle(ErrBits::kLoop);
+      else
+        st.loop_stack.start_loop(st.pc + 4, insn.rs2, insn.imm);
+      return false;
+
+    case Op::BnAdd:
+    case Op::BnAddc:
+    case Op::BnSub:
+    case Op::BnSubb:
+    case Op::BnCmp:
+    case Op::BnCmpb: {
+      const Wide &a = wdrs.read(insn.rs1);
+      Wide b_shifted =
+          logical_byte_shift(wdrs.read(insn.rs2), insn.shift_type, insn.shift);
+
+      bool use_carry = insn.op == Op::BnAddc || insn.op == Op::BnSubb ||
+                       insn.op == Op::BnCmpb;
+      bool cin = use_carry && st.flags[insn.fg].C;
+
+      Wide result;
+      bool carry;
+      if (insn.op == Op::BnAdd || insn.op == Op::BnAddc)
+        carry = wide_add(a, b_shifted, cin, &result);
+      else
+        carry = wide_sub(a, b_shifted, cin, &result);
+
+      if (insn.op != Op::BnCmp && insn.op != Op::BnCmpb)
+        wdrs.write(insn.rd, result);
+      st.flags.set(insn.fg, FlagReg::mlz_for_result(carry, result));
+      return false;
+    }
+
+    case Op::BnAddi:
+    case Op::BnSubi: {
+      const Wide &a = wdrs.read(insn.rs1);
+      Wide b = wide_from_u64((uint32_t)insn.imm);
+      Wide result;
+      bool carry = (insn.op == Op::BnAddi) ? wide_add(a, b, false, &result)
+                                           : wide_sub(a, b, false, &result);
+      wdrs.write(insn.rd, result);
+      st.flags.set(insn.fg, FlagReg::mlz_for_result(carry, result));
+      return false;
+    }
+
+    case Op::BnAddm: {
+      const Wide &a = wdrs.read(insn.rs1);
+      const Wide &b = wdrs.read(insn.rs2);
+      const Wide &mod = st.wsrs.MOD.read();
+
+      Wide result;
+      bool carry = wide_add(a, b, false, &result);
+      if (carry || wide_cmp(result, mod) >= 0)
+        wide_sub(result, mod, false, &result);
+      wdrs.write(insn.rd, result);
+      return false;
+    }
+
+    case Op::BnSubm: {
+      const Wide &a = wdrs.read(insn.rs1);
+      const Wide &b = wdrs.read(insn.rs2);
+      const Wide &mod = st.wsrs.MOD.read();
+
+      Wide result;
+      if (wide_sub(a, b, false, &result))
+        wide_add(result, mod, false, &result);
+      wdrs.write(insn.rd, result);
+      return false;
+    }
+
+    case Op::BnMulqacc:
+    case Op::BnMulqaccWo:
+    case Op::BnMulqaccSo: {
+      uint64_t a_qw = wide_u64(wdrs.read(insn.rs1), insn.qs1);
+      uint64_t b_qw = wide_u64(wdrs.read(insn.rs2), insn.qs2);
+      unsigned __int128 mul_res = (unsigned __int128)a_qw * b_qw;
+
+      Wide mul_wide = wide_zero();
+      for (int i = 0; i < 4; ++i)
+        mul_wide[i] = (uint32_t)(mul_res >> (32 * i));
+
+      Wide acc = insn.zero_acc ? wide_zero() : st.wsrs.ACC.read();
+      wide_add(acc, wide_shl(mul_wide, insn.shift), false, &acc);
+
+      if (insn.op == Op::BnMulqacc) {
+        st.wsrs.ACC.write(acc);
+      } else if (insn.op == Op::BnMulqaccWo) {
+        wdrs.write(insn.rd, acc);
+        st.wsrs.ACC.write(acc);
+        st.set_mlz_flags(insn.fg, acc);
+      } else {
+        Wide lo_part = wide_trunc(acc, 128);
+        Wide hi_part = wide_shr(acc, 128);
+
+        // Shift out the low part of the result into the selected half of wrd
+        unsigned hw_shift = 128 * insn.hwsel;
+        Wide hw_mask =
+            wide_shl(wide_trunc(wide_not(wide_zero()), 128), hw_shift);
+        Wide new_wrd = wide_or(wide_and(wdrs.read(insn.rd), wide_not(hw_mask)),
+                               wide_shl(lo_part, hw_shift));
+        wdrs.write(insn.rd, new_wrd);
+
+        st.wsrs.ACC.write(hi_part);
+
+        const FlagReg &old_flags = st.flags[insn.fg];
+        FlagReg new_flags;
+        if (insn.hwsel) {
+          new_flags = FlagReg(old_flags.C, wide_bit(lo_part, 127), old_flags.L,
+                              old_flags.Z && wide_is_zero(lo_part));
+        } else {
+          new_flags = FlagReg(old_flags.C, old_flags.M, wide_bit(lo_part, 0),
+                              wide_is_zero(lo_part));
+        }
+        st.flags.set(insn.fg, new_flags);
+      }
+      return false;
+    }
+
+    case Op::BnAnd:
+    case Op::BnOr:
+    case Op::BnXor: {
+      const Wide &a = wdrs.read(insn.rs1);
+      Wide b_shifted =
+          logical_byte_shift(wdrs.read(insn.rs2), insn.shift_type, insn.shift);
+      Wide result = insn.op == Op::BnAnd  ? wide_and(a, b_shifted)
+                    : insn.op == Op::BnOr ? wide_or(a, b_shifted)
+                                          : wide_xor(a, b_shifted);
+      wdrs.write(insn.rd, result);
+      st.set_mlz_flags(insn.fg, result);
+      return false;
+    }
+
+    case Op::BnNot: {
+      Wide a_shifted =
+          logical_byte_shift(wdrs.read(insn.rs1), insn.shift_type, insn.shift);
+      Wide result = wide_not(a_shifted);
+      wdrs.write(insn.rd, result);
+      st.set_mlz_flags(insn.fg, result);
+      return false;
+    }
+
+    case Op::BnRshi: {
+      const Wide &a = wdrs.read(insn.rs1);
+      const Wide &b = wdrs.read(insn.rs2);
+      unsigned imm = (unsigned)insn.imm;
+      Wide result =
+          imm == 0 ? b : wide_or(wide_shr(b, imm), wide_shl(a, 256 - imm));
+      wdrs.write(insn.rd, result);
+      return false;
+    }
+
+    case Op::BnSel: {
+      bool flag_is_set = st.flags[insn.fg].get_by_idx(insn.flag);
+      wdrs.write(insn.rd, wdrs.read(flag_is_set ? insn.rs1 : insn.rs2));
+      return false;
+    }
+
+    case Op::BnLid:
+    case Op::BnSid: {
+      // BN.LID and BN.SID execute over two cycles. On the first cycle, we
+      // read the base address, compute the address and check it for
+      // correctness, and increment any GPRs. BN.LID performs its load on the
+      // first cycle and writes the WDR on the second. BN.SID reads the WDR
+      // and stores it on the second cycle.
+      bool is_lid = insn.op == Op::BnLid;
+      if (exec_stage_ == 0) {
+        if (insn.inc1 && insn.inc2) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          return false;
+        }
+
+        uint32_t grs1_val = gprs.read(insn.rs1);
+        uint32_t addr = grs1_val + (uint32_t)insn.imm;
+        uint32_t grx_val = gprs.read(insn.rs2);
+
+        bool bad_grs1 = gprs.call_stack_err && insn.rs1 == 1;
+        bool bad_grx = gprs.call_stack_err && insn.rs2 == 1;
+        bool saw_err = false;
+
+        if (gprs.call_stack_err) {
+          st.stop_at_end_of_cycle(ErrBits::kCallStack);
+          saw_err = true;
+        }
+        if (grx_val > 31 && !bad_grx) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          saw_err = true;
+        }
+        if (!st.dmem.is_valid_256b_addr(addr) && !bad_grs1) {
+          st.stop_at_end_of_cycle(ErrBits::kBadDataAddr);
+          saw_err = true;
+        }
+        if (saw_err)
+          return false;
+
+        exec_u32_[0] = addr;
+        exec_u32_[1] = grx_val & 0x1f;
+        if (is_lid)
+          exec_valid_ = st.dmem.load_u256(addr, &exec_wide_);
+
+        if (is_lid) {
+          if (insn.inc2)
+            gprs.write(insn.rs2, grx_val + 1);
+          if (insn.inc1)
+            gprs.write(insn.rs1, grs1_val + 32);
+        } else {
+          if (insn.inc1)
+            gprs.write(insn.rs1, grs1_val + 32);
+          if (insn.inc2)
+            gprs.write(insn.rs2, grx_val + 1);
+        }
+        return true;
+      }
+
+      if (is_lid) {
+        if (!exec_valid_) {
+          st.stop_at_end_of_cycle(ErrBits::kDmemIntgViolation);
+          return false;
+        }
+        wdrs.write(exec_u32_[1], exec_wide_);
+      } else {
+        st.dmem.store_u256(exec_u32_[0], wdrs.read(exec_u32_[1]));
+      }
+      return false;
+    }
+
+    case Op::BnMov:
+      wdrs.write(insn.rd, wdrs.read(insn.rs1));
+      return false;
+
+    case Op::BnMovr: {
+      // rs2 is grd and rs1 is grs. inc1 is grs_inc and inc2 is grd_inc.
+      if (exec_stage_ == 0) {
+        if (insn.inc1 && insn.inc2) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          return false;
+        }
+
+        uint32_t grd_val = gprs.read(insn.rs2);
+        uint32_t grs_val = gprs.read(insn.rs1);
+
+        bool bad_grs = gprs.call_stack_err && insn.rs1 == 1;
+        bool bad_grd = gprs.call_stack_err && insn.rs2 == 1;
+        bool saw_err = false;
+
+        if (gprs.call_stack_err) {
+          st.stop_at_end_of_cycle(ErrBits::kCallStack);
+          saw_err = true;
+        }
+        if (grd_val > 31 && !bad_grd) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          saw_err = true;
+        }
+        if (grs_val > 31 && !bad_grs) {
+          st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+          saw_err = true;
+        }
+        if (saw_err)
+          return false;
+
+        exec_u32_[0] = grd_val & 0x1f;
+        exec_u32_[1] = grs_val & 0x1f;
+
+        if (insn.inc2)
+          gprs.write(insn.rs2, grd_val + 1);
+        if (insn.inc1)
+          gprs.write(insn.rs1, grs_val + 1);
+        return true;
+      }
+
+      wdrs.write(exec_u32_[0], wdrs.read(exec_u32_[1]));
+      return false;
+    }
+
+    case Op::BnWsrr: {
+      uint32_t wsr = (uint32_t)insn.imm;
+      if (exec_stage_ == 0 && !WsrFile::check_idx(wsr)) {
+        st.stop_at_end_of_cycle(ErrBits::kIllegalInsn);
+        return false;
+      }
+
+      if (wsr == 1 && !st.wsrs.RND.request_value())
+        return true;
+
+      if (!st.wsrs.has_value_at_idx(wsr)) {
+        st.stop_at_end_of_cycle(ErrBits::kKeyInvalid);
+        return false;
+      }
+
+      wdrs.write(insn.rd, st.wsrs.read_at_idx(wsr));
+      return false;
+    }
+
+    case Op::BnWsrw:
+      st.wsrs.write_at_idx((uint32_t)insn.imm, wdrs.read(insn.rs1));
+      return false;
+
+    default:
+      return execute_vec(insn);
+  }
+
+#undef CHECK_CALL_STACK
+}
+
+bool NativeSim::execute_vec(const Insn &insn) {
+  OtbnState &st = state_;
+  WdrFile &wdrs = st.wdrs;
+
+  const Wide &vec_a = wdrs.read(insn.rs1);
+  const Wide &vec_b = wdrs.read(insn.rs2);
+  unsigned size = simd_element_size(insn.dt);
+  unsigned num_elems = 256 / size;
+
+  Wide result = wide_zero();
+
+  switch (insn.op) {
+    case Op::BnAddv:
+    case Op::BnAddvm:
+    case Op::BnAddvc:
+    case Op::BnAddvi:
+    case Op::BnSubv:
+    case Op::BnSubvm:
+    case Op::BnSubvc:
+    case Op::BnSubvi:
+    case Op::BnMulv:
+    case Op::BnMulvl:
+    case Op::BnMulvm:
+    case Op::BnMulvml: {
+      // The modular variants take q from the bottom element of MOD and the
+      // Montgomery constant from the element above it.
+      const Wide &mod_wsr = st.wsrs.MOD.read();
+      Wide mod = extract_sub_word(mod_wsr, size, 0);
+      Wide q_prime = extract_sub_word(mod_wsr, size, 1);
+      bool is_mod_mul = insn.op == Op::BnMulvm || insn.op == Op::BnMulvml;
+
+      // The lane and immediate forms use the same second operand for every
+      // element. Only the bits of the lane that index an element are used.
+      bool by_lane = insn.op == Op::BnMulvl || insn.op == Op::BnMulvml;
+      bool by_imm = insn.op == Op::BnAddvi || insn.op == Op::BnSubvi;
+      Wide lane_elem =
+          by_imm ? wide_from_u64(insn.imm)
+                 : extract_sub_word(vec_b, size, insn.lane % num_elems);
+
+      // The add and subtract instructions set the vector flags. Lanes that
+      // this datatype doesn't have are cleared. The carry forms take a carry
+      // (or borrow) into each lane from the C flags of the same group.
+      bool sets_flags = !(is_mod_mul || insn.op == Op::BnMulv ||
+                          insn.op == Op::BnMulvl);
+      uint32_t carry_in = st.vec_flags[insn.fg].C;
+      VecFlagReg vec_flags;
+
+      for (unsigned elem = 0; elem < num_elems; ++elem) {
+        Wide elem_a = extract_sub_word(vec_a, size, elem);
+        Wide elem_b = (by_lane || by_imm) ? lane_elem
+                                          : extract_sub_word(vec_b, size, elem);
+        bool lane_cin = (carry_in >> elem) & 1;
+        Wide elem_c;
+        bool carry = false;
+
+        switch (insn.op) {
+          case Op::BnAddv:
+          case Op::BnAddvi:
+            wide_add(elem_a, elem_b, false, &elem_c);
+            carry = wide_bit(elem_c, size);
+            break;
+          case Op::BnAddvc:
+            wide_add(elem_a, elem_b, lane_cin, &elem_c);
+            carry = wide_bit(elem_c, size);
+            break;
+          case Op::BnAddvm:
+            // elem_a + elem_b fits in 129 bits, so can't overflow.
+            wide_add(elem_a, elem_b, false, &elem_c);
+            carry = wide_cmp(elem_c, mod) >= 0;
+            if (carry)
+              wide_sub(elem_c, mod, false, &elem_c);
+            break;
+          case Op::BnSubv:
+          case Op::BnSubvi:
+            carry = wide_sub(elem_a, elem_b, false, &elem_c);
+            break;
+          case Op::BnSubvc:
+            carry = wide_sub(elem_a, elem_b, lane_cin, &elem_c);
+            break;
+          case Op::BnSubvm:
+            carry = wide_sub(elem_a, elem_b, false, &elem_c);
+            if (carry)
+              wide_add(elem_c, mod, false, &elem_c);
+            break;
+          case Op::BnMulv:
+          case Op::BnMulvl:
+            elem_c = wide_mul(elem_a, elem_b);
+            break;
+          default:
+            elem_c = montgomery_mul(elem_a, elem_b, mod, q_prime, size);
+            break;
+        }
+
+        elem_c = wide_trunc(elem_c, size);
+        if (sets_flags)
+          vec_flags.set_lane(elem, FlagReg(carry, wide_bit(elem_c, size - 1),
+                                           wide_bit(elem_c, 0),
+                                           wide_is_zero(elem_c)));
+        result = wide_or(result, wide_shl(elem_c, size * elem));
+      }
+      if (sets_flags)
+        st.vec_flags.set(insn.fg, vec_flags);
+      break;
+    }
+
+    case Op::BnBflyv:
+    case Op::BnIbflyv: {
+      // The butterfly instructions write two WDRs. The register file has a
+      // single write port, so they take two cycles: rd is written on the
+      // first cycle and rs1 on the second.
+      if (exec_stage_ > 0) {
+        wdrs.write(insn.rs1, exec_wide_);
+        return false;
+      }
+
+      // Each step matches the bn.mulvm, bn.addvm or bn.subvm instruction
+      // that it replaces, including truncating its result to the element
+      // size. The inputs are read before either WDR is written.
+      const Wide &mod_wsr = st.wsrs.MOD.read();
+      Wide mod = extract_sub_word(mod_wsr, size, 0);
+      Wide q_prime = extract_sub_word(mod_wsr, size, 1);
+
+      // wra is in rd, wrb in rs1 and the twiddle factors in rs2.
+      const Wide &vec_wra = wdrs.read(insn.rd);
+      Wide result_b = wide_zero();
+      for (unsigned elem = 0; elem < num_elems; ++elem) {
+        Wide elem_a = extract_sub_word(vec_wra, size, elem);
+        Wide elem_b = extract_sub_word(vec_a, size, elem);
+        Wide elem_w = extract_sub_word(vec_b, size, elem);
+        Wide elem_x, elem_y;
+
+        if (insn.op == Op::BnBflyv) {
+          // Cooley-Tukey: a + w * b and a - w * b
+          Wide elem_t = montgomery_mul(elem_b, elem_w, mod, q_prime, size);
+          wide_add(elem_a, elem_t, false, &elem_x);
+          if (wide_cmp(elem_x, mod) >= 0)
+            wide_sub(elem_x, mod, false, &elem_x);
+          if (wide_sub(elem_a, elem_t, false, &elem_y))
+            wide_add(elem_y, mod, false, &elem_y);
+        } else {
+          // Gentleman-Sande: a + b and (a - b) * w
+          Wide elem_d;
+          wide_add(elem_a, elem_b, false, &elem_x);
+          if (wide_cmp(elem_x, mod) >= 0)
+            wide_sub(elem_x, mod, false, &elem_x);
+          if (wide_sub(elem_a, elem_b, false, &elem_d))
+            wide_add(elem_d, mod, false, &elem_d);
+          elem_d = wide_trunc(elem_d, size);
+          elem_y = montgomery_mul(elem_d, elem_w, mod, q_prime, size);
+        }
+
+        elem_x = wide_trunc(elem_x, size);
+        elem_y = wide_trunc(elem_y, size);
+        result = wide_or(result, wide_shl(elem_x, size * elem));
+        result_b = wide_or(result_b, wide_shl(elem_y, size * elem));
+      }
+
+      wdrs.write(insn.rd, result);
+      exec_wide_ = result_b;
+      return true;
+    }
+
+    case Op::BnTrn1:
+    case Op::BnTrn2: {
+      unsigned odd = insn.op == Op::BnTrn2 ? 1 : 0;
+      for (unsigned elem = 0; elem < num_elems; elem += 2) {
+        Wide elem_a = extract_sub_word(vec_a, size, elem + odd);
+        Wide elem_b = extract_sub_word(vec_b, size, elem + odd);
+        result = wide_or(result, wide_shl(elem_a, elem * size));
+        result = wide_or(result, wide_shl(elem_b, (elem + 1) * size));
+      }
+      break;
+    }
+
+    case Op::BnShv:
+      for (unsigned elem = 0; elem < num_elems; ++elem) {
+        Wide elem_a = extract_sub_word(vec_a, size, elem);
+        Wide shifted = insn.shift_type == 0 ? wide_shl(elem_a, insn.shift)
+                                            : wide_shr(elem_a, insn.shift);
+        result = wide_or(result,
+                         wide_shl(wide_trunc(shifted, size), elem * size));
+      }
+      break;
+
+    case Op::BnSelv: {
+      uint32_t lanes = st.vec_flags[insn.fg].get_by_idx(insn.flag);
+      for (unsigned elem = 0; elem < num_elems; ++elem) {
+        const Wide &vec_src = ((lanes >> elem) & 1) ? vec_a : vec_b;
+        Wide elem_c = extract_sub_word(vec_src, size, elem);
+        result = wide_or(result, wide_shl(elem_c, elem * size));
+      }
+      break;
+    }
+
+    default:
+      check(false, "unknown instruction");
+  }
+
+  wdrs.write(insn.rd, result);
+  return false;
+}
+
+namespace {
+
+// Render a string the way that Python's repr() would for a simple path
+std::string py_repr(const std::string &str) {
+  bool has_single = str.find('\'') != std::string::npos;
+  bool has_double = str.find('"') != std::string::npos;
+  char quote = (has_single && !has_double) ? '"' : '\'';
+
+  std::string ret(1, quote);
+  for (char c : str) {
+    if (c == '\\' || c == quote)
+      ret += '\\';
+    ret += c;
+  }
+  ret += quote;
+  return ret;
+}
+
+void check_arg_count(const char *cmd, size_t cnt,
+                     const std::vector<std::string> &args) {
+  if (args.size() != cnt) {
+    std::ostringstream oss;
+    oss << cmd << " expects exactly " << cnt << " arguments. Got "
+        << args.size() << ".";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+// Read an unsigned integer of at most bits bits from word_data (using the
+// same syntax as Python's int(x, 0) for hex, binary, octal and decimal
+// literals). The result is returned as little-endian 32-bit words.
+std::vector<uint32_t> read_word(const char *arg_name,
+                                const std::string &word_data,
+                                unsigned num_bits) {
+  std::string digits = word_data;
+  unsigned base = 10;
+  if (digits.size() > 2 && digits[0] == '0') {
+    char pfx = digits[1] | 0x20;
+    if (pfx == 'x')
+      base = 16;
+    else if (pfx == 'b')
+      base = 2;
+    else if (pfx == 'o')
+      base = 8;
+    if (base != 10)
+      digits = digits.substr(2);
+  }
+
+  std::vector<uint32_t> words((num_bits + 31) / 32 + 1, 0);
+  bool saw_digit = false;
+  for (char c : digits) {
+    if (c == '_')
+      continue;
+    unsigned digit;
+    if ('0' <= c && c <= '9')
+      digit = c - '0';
+    else if ('a' <= (c | 0x20) && (c | 0x20) <= 'f')
+      digit = (c | 0x20) - 'a' + 10;
+    else
+      digit = base;
+
+    if (digit >= base) {
+      std::ostringstream oss;
+      oss << "Failed to read '" << word_data << "' as an integer for <"
+          << arg_name << "> argument.";
+      throw std::runtime_error(oss.str());
+    }
+    saw_digit = true;
+
+    // words = words * base + digit
+    uint64_t carry = digit;
+    for (uint32_t &w : words) {
+      uint64_t acc = (uint64_t)w * base + carry;
+      w = (uint32_t)acc;
+      carry = acc >> 32;
+    }
+    if (carry)
+      words.back() = UINT32_MAX;
+  }
+
+  if (!saw_digit) {
+    std::ostringstream oss;
+    oss << "Failed to read '" << word_data << "' as an integer for <"
+        << arg_name << "> argument.";
+    throw std::runtime_error(oss.str());
+  }
+
+  // Check that the value fits in num_bits
+  bool too_big = false;
+  for (size_t i = 0; i < words.size(); ++i) {
+    unsigned lsb = 32 * i;
+    if (lsb >= num_bits)
+      too_big |= words[i] != 0;
+    else if (num_bits - lsb < 32)
+      too_big |= (words[i] >> (num_bits - lsb)) != 0;
+  }
+  if (too_big) {
+    std::ostringstream oss;
+    oss << "<" << arg_name << "> argument is '" << word_data
+        << "': not representable in " << num_bits << " bits.";
+    throw std::runtime_error(oss.str());
+  }
+
+  words.resize((num_bits + 31) / 32);
+  return words;
+}
+
+uint32_t read_u32_arg(const char *arg_name, const std::string &word_data,
+                      unsigned num_bits) {
+  assert(num_bits <= 32);
+  return read_word(arg_name, word_data, num_bits)[0];
+}
+
+std::vector<uint8_t> read_file(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::ostringstream oss;
+    oss << "Cannot open '" << path << "' for reading.";
+    throw std::runtime_error(oss.str());
+  }
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+// The zlib CRC-32 of data, starting from state (matching binascii.crc32)
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t state) {
+  uint32_t crc = ~state;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; ++j)
+      crc = (crc >> 1) ^ (0xedb88320 & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+}  // namespace
+
+void NativeSim::on_start_operation(const Args &args,
+                                   std::vector<std::string> *out) {
+  check_arg_count("start_operation", 1, args);
+  const std::string &command = args[0];
+
+  if (command == "Execute") {
+    out->push_back("START");
+    next_insn_valid_ = false;
+    insn_in_progress_ = false;
+    state_.start();
+  } else if (command == "DmemWipe") {
+    start_mem_wipe(false);
+  } else if (command == "ImemWipe") {
+    start_mem_wipe(true);
+  } else {
+    throw std::runtime_error("Invalid command for start_operation: " +
+                             command + ".");
+  }
+}
+
+bool NativeSim::step_cycle(std::vector<std::string> *out) {
+  uint32_t pc = state_.pc;
+  bool was_wiping = state_.wiping();
+
+  Insn insn;
+  std::vector<std::string> changes;
+  bool retired = step(&insn, &changes);
+
+  std::string hdr;
+  bool has_hdr = true;
+  if (retired) {
+    std::ostringstream oss;
+    if (insn.has_bits) {
+      oss << "E PC: " << hex_u32(pc) << ", insn: " << hex_u32(insn.raw);
+      out->push_back(oss.str());
+      hdr = "# @" + hex_u32(pc) + ": " + insn.mnemonic;
+    } else {
+      oss << "E PC: " << hex_u32(pc) << ", insn: ??";
+      out->push_back(oss.str());
+      hdr = "# @" + hex_u32(pc) + ": ??";
+    }
+  } else if (was_wiping) {
+    // The trailing space matches the behaviour in the RTL tracer.
+    hdr = state_.wipe_rounds_done == 2 ? "V " : "U ";
+  } else if (state_.executing()) {
+    hdr = "STALL";
+  } else {
+    has_hdr = false;
+  }
+
+  // When locking immediately, drop headers that get cancelled by RTL.
+  if (state_.lock_immediately && has_hdr && (hdr == "V " || hdr == "STALL"))
+    has_hdr = false;
+
+  // If there are traced changes with no instruction in flight, use STALL.
+  if (!has_hdr && !changes.empty()) {
+    hdr = "STALL";
+    has_hdr = true;
+  }
+
+  if (has_hdr) {
+    out->push_back(hdr);
+    out->insert(out->end(), changes.begin(), changes.end());
+  }
+
+  static const char ext_prefix[] = "! otbn.";
+  static const char insn_cnt_prefix[] = "! otbn.INSN_CNT:";
+  for (const std::string &change : changes) {
+    if (change.compare(0, sizeof ext_prefix - 1, ext_prefix) == 0 &&
+        change.compare(0, sizeof insn_cnt_prefix - 1, insn_cnt_prefix) != 0)
+      return true;
+  }
+  return false;
+}
+
+void NativeSim::on_step(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("step", 0, args);
+  step_cycle(out);
+}
+
+void NativeSim::on_run(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("run", 1, args);
+  uint32_t max_cycles = read_u32_arg("max_cycles", args[0], 32);
+  if (max_cycles == 0)
+    throw std::runtime_error("run needs a positive number of cycles.");
+
+  // Stop early on the same events as on_run in stepped.py
+  for (uint32_t i = 0; i < max_cycles; ++i) {
+    bool saw_event = step_cycle(out);
+    out->push_back("END_CYCLE");
+    if (saw_event || state_.fsm_state != FsmState::Exec ||
+        state_.ext_regs.read(kExtRndReq))
+      break;
+  }
+}
+
+void NativeSim::on_add_loop_warp(const Args &args,
+                                 std::vector<std::string> *out) {
+  check_arg_count("add_loop_warp", 3, args);
+
+  uint32_t addr = read_u32_arg("addr", args[0], 32);
+  uint32_t from_cnt = read_u32_arg("from_cnt", args[1], 32);
+  uint32_t to_cnt = read_u32_arg("to_cnt", args[2], 32);
+
+  std::ostringstream oss;
+  oss << "ADD_LOOP_WARP 0x" << std::hex << addr << std::dec << " " << from_cnt
+      << " " << to_cnt;
+  out->push_back(oss.str());
+
+  loop_warps_[addr][from_cnt] = to_cnt;
+}
+
+void NativeSim::on_load_d(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("load_d", 1, args);
+  out->push_back("LOAD_D " + py_repr(args[0]));
+  std::vector<uint8_t> bytes = read_file(args[0]);
+  state_.dmem.load_5byte_le_words(bytes.data(), bytes.size());
+}
+
+void NativeSim::on_load_i(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("load_i", 1, args);
+  out->push_back("LOAD_I " + py_repr(args[0]));
+
+  std::vector<uint8_t> bytes = read_file(args[0]);
+  load_program(bytes.data(), bytes.size(), args[0]);
+}
+
+void NativeSim::load_program(const uint8_t *bytes, size_t len,
+                             const std::string &src) {
+  if (len % 5) {
+    std::ostringstream oss;
+    oss << "Trying to load " << len << " bytes of data from " << src
+        << ", which is not a multiple of 5.";
+    throw std::runtime_error(oss.str());
+  }
+
+  std::vector<Insn> program;
+  program.reserve(len / 5);
+  for (size_t i = 0; i < len / 5; ++i) {
+    uint8_t vld = bytes[5 * i];
+    if (vld > 1) {
+      std::ostringstream oss;
+      oss << "The validity byte for 32-bit word " << i << " at " << src
+          << " is " << (int)vld << ", not 0 or 1.";
+      throw std::runtime_error(oss.str());
+    }
+    uint32_t word = 0;
+    for (int j = 0; j < 4; ++j)
+      word |= (uint32_t)bytes[5 * i + 1 + j] << (8 * j);
+
+    program.push_back(vld ? decode_word(4 * i, word) : Insn());
+  }
+
+  program_.swap(program);
+  state_.clear_imem_invalidation();
+}
+
+void NativeSim::on_dump_d(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("dump_d", 1, args);
+  out->push_back("DUMP_D " + py_repr(args[0]));
+
+  std::vector<uint8_t> bytes = state_.dmem.dump_le_words();
+  std::ofstream file(args[0], std::ios::binary);
+  file.write((const char *)bytes.data(), bytes.size());
+  if (!file) {
+    std::ostringstream oss;
+    oss << "Failed to write DMEM contents to '" << args[0] << "'.";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+IssSharedMem NativeSim::get_shared_mem(const char *verb) const {
+  if (!shared_mem_) {
+    std::ostringstream oss;
+    oss << "Cannot run " << verb << ": there is no shared memory.";
+    throw std::runtime_error(oss.str());
+  }
+  return IssSharedMem(shared_mem_);
+}
+
+void NativeSim::on_load_d_shared(const Args &args,
+                                 std::vector<std::string> *out) {
+  check_arg_count("load_d_shared", 0, args);
+  out->push_back("LOAD_D_SHARED");
+  IssSharedMem shm = get_shared_mem("load_d_shared");
+  state_.dmem.load_5byte_le_words(
+      shm.words(false), IssSharedMem::kBytesPerWord * shm.num_words(false));
+  state_.dmem.mark_clean();
+}
+
+void NativeSim::on_load_i_shared(const Args &args,
+                                 std::vector<std::string> *out) {
+  check_arg_count("load_i_shared", 0, args);
+  out->push_back("LOAD_I_SHARED");
+  IssSharedMem shm = get_shared_mem("load_i_shared");
+  load_program(shm.words(true),
+               IssSharedMem::kBytesPerWord * shm.num_words(true),
+               "shared memory");
+}
+
+void NativeSim::on_dump_d_shared(const Args &args,
+                                 std::vector<std::string> *out) {
+  check_arg_count("dump_d_shared", 0, args);
+  out->push_back("DUMP_D_SHARED");
+  IssSharedMem shm = get_shared_mem("dump_d_shared");
+
+  std::vector<uint8_t> bytes = state_.dmem.dump_le_words();
+  size_t shm_bytes = IssSharedMem::kBytesPerWord * shm.num_words(false);
+  if (bytes.size() < shm_bytes) {
+    std::ostringstream oss;
+    oss << "Cannot dump DMEM to shared memory: it has space for "
+        << shm.num_words(false) << " words, but DMEM only has "
+        << bytes.size() / IssSharedMem::kBytesPerWord << ".";
+    throw std::runtime_error(oss.str());
+  }
+  std::copy(bytes.begin(), bytes.begin() + shm_bytes, shm.words(false));
+  state_.dmem.mark_clean();
+}
+
+void NativeSim::on_dump_d_dirty(const Args &args,
+                                std::vector<std::string> *out) {
+  check_arg_count("dump_d_dirty", 0, args);
+  out->push_back("DUMP_D_DIRTY");
+  IssSharedMem shm = get_shared_mem("dump_d_dirty");
+
+  uint32_t num_words = shm.num_words(false);
+  uint8_t *words = shm.words(false);
+  uint8_t *flags = shm.dirty_flags();
+  for (size_t idx : state_.dmem.take_dirty()) {
+    if (idx >= num_words)
+      continue;
+    uint32_t value;
+    bool valid = state_.dmem.peek_word(idx, &value);
+    IssSharedMem::put_word(words + IssSharedMem::kBytesPerWord * idx, valid,
+                           value);
+    flags[idx] = 1;
+  }
+}
+
+void NativeSim::on_print_regs(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("print_regs", 0, args);
+  out->push_back("PRINT_REGS");
+
+  char buf[80];
+  for (unsigned idx = 0; idx < 32; ++idx) {
+    snprintf(buf, sizeof buf, " x%-2u = 0x%08x", idx, state_.gprs.peek(idx));
+    out->push_back(buf);
+  }
+  for (unsigned idx = 0; idx < 32; ++idx) {
+    std::ostringstream oss;
+    oss << " w" << std::left << std::setw(2) << idx << std::right
+        << " = 0x" << std::hex << std::setfill('0');
+    const Wide &value = state_.wdrs.read(idx);
+    for (int i = 7; i >= 0; --i)
+      oss << std::setw(8) << value[i];
+    out->push_back(oss.str());
+  }
+}
+
+void NativeSim::on_print_call_stack(const Args &args,
+                                    std::vector<std::string> *out) {
+  check_arg_count("print_call_stack", 0, args);
+  out->push_back("PRINT_CALL_STACK");
+  for (uint32_t value : state_.gprs.call_stack())
+    out->push_back(hex_u32(value));
+}
+
+void NativeSim::on_set_keymgr_value(const Args &args) {
+  check_arg_count("set_keymgr_value", 3, args);
+  std::vector<uint32_t> key0 = read_word("key0", args[0], 384);
+  std::vector<uint32_t> key1 = read_word("key1", args[1], 384);
+  bool valid = read_u32_arg("valid", args[2], 1) == 1;
+
+  state_.wsrs.KeyS0.valid = valid;
+  state_.wsrs.KeyS1.valid = valid;
+  for (int i = 0; i < 12; ++i) {
+    state_.wsrs.KeyS0.value[i] = valid ? key0[i] : 0;
+    state_.wsrs.KeyS1.value[i] = valid ? key1[i] : 0;
+  }
+}
+
+void NativeSim::on_step_crc(const Args &args, std::vector<std::string> *out) {
+  check_arg_count("step_crc", 2, args);
+  std::vector<uint32_t> item = read_word("item", args[0], 48);
+  uint32_t state = read_u32_arg("state", args[1], 32);
+
+  uint8_t bytes[6];
+  for (int i = 0; i < 6; ++i)
+    bytes[i] = (uint8_t)(item[i / 4] >> (8 * (i % 4)));
+
+  out->push_back("! otbn.LOAD_CHECKSUM: " +
+                 hex_u32(crc32(bytes, sizeof bytes, state)));
+}
+
+void NativeSim::run_command(const std::string &cmd,
+                            std::vector<std::string> *out) {
+  std::istringstream iss(cmd);
+  std::vector<std::string> words{std::istream_iterator<std::string>(iss),
+                                 std::istream_iterator<std::string>()};
+
+  // Just ignore empty lines
+  if (words.empty())
+    return;
+
+  const std::string verb = words[0];
+  Args args(words.begin() + 1, words.end());
+
+  if (verb == "start_operation") {
+    on_start_operation(args, out);
+  } else if (verb == "otp_key_cdc_done") {
+    check_arg_count("otp_key_cdc_done", 0, args);
+    on_otp_cdc_done();
+  } else if (verb == "step") {
+    on_step(args, out);
+  } else if (verb == "run") {
+    on_run(args, out);
+  } else if (verb == "add_loop_warp") {
+    on_add_loop_warp(args, out);
+  } else if (verb == "clear_loop_warps") {
+    check_arg_count("clear_loop_warps", 0, args);
+    loop_warps_.clear();
+  } else if (verb == "load_d") {
+    on_load_d(args, out);
+  } else if (verb == "load_i") {
+    on_load_i(args, out);
+  } else if (verb == "dump_d") {
+    on_dump_d(args, out);
+  } else if (verb == "load_d_shared") {
+    on_load_d_shared(args, out);
+  } else if (verb == "load_i_shared") {
+    on_load_i_shared(args, out);
+  } else if (verb == "dump_d_shared") {
+    on_dump_d_shared(args, out);
+  } else if (verb == "dump_d_dirty") {
+    on_dump_d_dirty(args, out);
+  } else if (verb == "print_regs") {
+    on_print_regs(args, out);
+  } else if (verb == "print_call_stack") {
+    on_print_call_stack(args, out);
+  } else if (verb == "edn_rnd_step") {
+    check_arg_count("edn_rnd_step", 2, args);
+    uint32_t data = read_u32_arg("edn_rnd_step", args[0], 32);
+    bool fips_err = read_u32_arg("fips_err", args[1], 1);
+    state_.ext_regs.rnd_take_word(data, fips_err);
+  } else if (verb == "edn_urnd_step") {
+    check_arg_count("edn_urnd_step", 1, args);
+    state_.urnd_client.take_word(read_u32_arg("edn_urnd_step", args[0], 32),
+                                 false);
+  } else if (verb == "edn_rnd_cdc_done") {
+    check_arg_count("edn_rnd_cdc_done", 0, args);
+    state_.rnd_completed();
+  } else if (verb == "edn_urnd_cdc_done") {
+    check_arg_count("urnd_cdc_done", 0, args);
+    urnd_completed();
+  } else if (verb == "edn_flush") {
+    check_arg_count("edn_flush", 0, args);
+    state_.edn_flush();
+  } else if (verb == "invalidate_imem") {
+    check_arg_count("invalidate_imem", 0, args);
+    state_.invalidate_imem();
+  } else if (verb == "invalidate_dmem") {
+    check_arg_count("invalidate_dmem", 0, args);
+    state_.dmem.empty_dmem();
+  } else if (verb == "set_keymgr_value") {
+    on_set_keymgr_value(args);
+  } else if (verb == "step_crc") {
+    on_step_crc(args, out);
+  } else if (verb == "send_err_escalation") {
+    check_arg_count("send_err_escalation", 2, args);
+    uint32_t err_val = read_u32_arg("err_val", args[0], 32);
+    bool lock_immediately = read_u32_arg("lock_immediately", args[1], 1);
+    check((err_val & ~ErrBits::kMask) == 0, "bad escalation error bits");
+    state_.injected_err_bits |= err_val;
+    state_.lock_immediately = lock_immediately;
+  } else if (verb == "set_rma_req") {
+    check_arg_count("set_rma_req", 1, args);
+    uint32_t rma_req = read_u32_arg("rma_req", args[0], 4);
+    state_.rma_req = rma_req == (uint32_t)LcTx::On    ? LcTx::On
+                     : rma_req == (uint32_t)LcTx::Off ? LcTx::Off
+                                                      : LcTx::Invalid;
+  } else if (verb == "initial_secure_wipe") {
+    check_arg_count("initial_secure_wipe", 0, args);
+    state_.start_init_sec_wipe();
+  } else if (verb == "set_software_errs_fatal") {
+    check_arg_count("set_software_errs_fatal", 1, args);
+    state_.software_errs_fatal = read_u32_arg("error", args[0], 1) != 0;
+  } else if (verb == "load_elf") {
+    throw std::runtime_error(
+        "The native OTBN ISS doesn't support load_elf: use load_d and "
+        "load_i instead.");
+  } else if (verb == "save_state" || verb == "restore_state") {
+    throw std::runtime_error("The native OTBN ISS doesn't support " + verb +
+                             ": use the Python ISS instead.");
+  } else {
+    throw std::runtime_error("Unknown command: '" + verb + "'");
+  }
+}
+
+NativeISS::NativeISS(uint8_t *shared_mem)
+    : shared_mem_(shared_mem), sim_(new NativeSim(shared_mem)) {}
+
+NativeISS::~NativeISS() {}
+
+void NativeISS::run_command(const std::string &cmd,
+                            std::vector<std::string> *dst) {
+  std::vector<std::string> lines;
+
+  // The reset command replaces the simulator with a fresh one. Everything
+  // else gets handled by the simulator itself.
+  std::istringstream iss(cmd);
+  std::string verb;
+  iss >> verb;
+  if (verb == "reset") {
+    std::string extra;
+    if (iss >> extra)
+      throw std::runtime_error("reset expects exactly 0 arguments.");
+    sim_.reset(new NativeSim(shared_mem_));
+  } else {
+    sim_->run_command(cmd, &lines);
+  }
+
+  if (dst)
+    dst->insert(dst->end(), lines.begin(), lines.end());
+}
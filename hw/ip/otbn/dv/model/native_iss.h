@@ -0,0 +1,47 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+#ifndef OPENTITAN_HW_IP_OTBN_DV_MODEL_NATIVE_ISS_H_
+#define OPENTITAN_HW_IP_OTBN_DV_MODEL_NATIVE_ISS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declaration (the implementation is private in native_iss.cc)
+class NativeSim;
+
+// An in-process C++ implementation of the OTBN instruction set simulator.
+//
+// This models the same architectural state as the Python ISS (in
+// hw/ip/otbn/dv/otbnsim) and understands the same command language as
+// stepped.py. The output for each command is the same, line for line, as the
+// output of stepped.py (without the terminating "." line). This means that
+// ISSWrapper can use it as a drop-in replacement for the Python subprocess.
+//
+// The Python ISS is the reference model: any change to its behaviour should be
+// mirrored here. ISSWrapper has a cross-checking mode (OTBN_ISS_BACKEND=cross)
+// that runs both models side by side and compares their output.
+class NativeISS {
+ public:
+  // shared_mem is the start of the memory that ISSWrapper shares with the ISS
+  // (see IssSharedMem in iss_protocol.h), which is used by the load_d_shared,
+  // load_i_shared, dump_d_shared and dump_d_dirty commands. It may be null, in
+  // which case those commands fail.
+  explicit NativeISS(uint8_t *shared_mem = nullptr);
+  ~NativeISS();
+
+  // Run a command, in the format that would be sent to stepped.py. cmd should
+  // end with a newline. If dst is not null, append each line of output to it.
+  //
+  // On failure (malformed commands or situations where the Python model would
+  // fail an assertion), throws a std::runtime_error.
+  void run_command(const std::string &cmd, std::vector<std::string> *dst);
+
+ private:
+  uint8_t *shared_mem_;
+  std::unique_ptr<NativeSim> sim_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_MODEL_NATIVE_ISS_H_
@@ -431,6 +431,14 @@ module otbn_core_model
       .stack_wr_ptr_q(u_call_stack.stack_wr_ptr)
     );
 
+  bind otbn_core otbn_dmem_snooper_if #(.DmemSizeByte(DmemSizeByte))
+    u_dmem_snooper (
+      .clk_i,
+      .dmem_req_o,
+      .dmem_write_o,
+      .dmem_addr_o
+    );
+
   assign err_o = |{failed_step, failed_check, check_mismatch_q,
                    failed_reset, failed_lc_escalate, failed_keymgr_value,
                    failed_edn_flush, failed_rnd_step, failed_urnd_step,
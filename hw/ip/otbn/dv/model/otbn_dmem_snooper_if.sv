@@ -0,0 +1,55 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Interface that can be bound into otbn_core to watch the writes that the LSU makes to DMEM. It
+// keeps a dirty bit for each 256-bit row of DMEM and exports functions to find and clear them,
+// which the model uses to avoid comparing rows that the RTL hasn't written when
+// OTBN_MODEL_INCREMENTAL_DMEM_CHECK is set. Writes that don't come from the LSU (backdoor loads,
+// fault injection) don't set a dirty bit, which is why that check isn't the default.
+
+`ifndef SYNTHESIS
+interface otbn_dmem_snooper_if #(
+  parameter int DmemSizeByte = 4096,
+  localparam int DmemAddrWidth = prim_util_pkg::vbits(DmemSizeByte)
+) (
+  input logic                     clk_i,
+  input logic                     dmem_req_o,
+  input logic                     dmem_write_o,
+  input logic [DmemAddrWidth-1:0] dmem_addr_o
+);
+
+  export "DPI-C" function otbn_dmem_dirty_next;
+  export "DPI-C" function otbn_dmem_dirty_clear;
+
+  // The number of bytes in a row of DMEM (WLEN / 8)
+  localparam int RowBytes = 32;
+  localparam int NumRows = DmemSizeByte / RowBytes;
+
+  bit dirty [NumRows];
+
+  always @(posedge clk_i) begin
+    if (dmem_req_o && dmem_write_o && (dmem_addr_o / RowBytes < NumRows)) begin
+      dirty[dmem_addr_o / RowBytes] = 1'b1;
+    end
+  end
+
+  // Return the index of the first dirty row at or after index, or -1 if there is no such row.
+  function automatic int otbn_dmem_dirty_next(input int index);
+    for (int i = (index < 0) ? 0 : index; i < NumRows; ++i) begin
+      if (dirty[i]) begin
+        return i;
+      end
+    end
+    return -1;
+  endfunction
+
+  // Mark every row as clean
+  function automatic void otbn_dmem_dirty_clear();
+    for (int i = 0; i < NumRows; ++i) begin
+      dirty[i] = 1'b0;
+    end
+  endfunction
+
+endinterface
+`endif // SYNTHESIS
@@ -6,8 +6,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -21,6 +21,8 @@
 extern "C" {
 int otbn_rf_peek(int index, svBitVecVal *val);
 int otbn_stack_element_peek(int index, svBitVecVal *val);
+int otbn_dmem_dirty_next(int index);
+void otbn_dmem_dirty_clear();
 }
 
 #define RUNNING_BIT (1U << 0)
@@ -40,83 +42,53 @@ int otbn_stack_element_peek(int index, svBitVecVal *val);
 #define STATUS_BUSY_SEC_WIPE_INT 0x04
 #define STATUS_LOCKED 0xFF
 
-// Read (the start of) the contents of a file at path as a vector of bytes.
-// Expects num_bytes bytes of data. On failure, throws a std::runtime_error.
-static Ecc32MemArea::EccWords read_words_from_file(const std::string &path,
-                                                   size_t num_words) {
-  std::filebuf fb;
-  if (!fb.open(path.c_str(), std::ios::in | std::ios::binary)) {
-    std::ostringstream oss;
-    oss << "Cannot open the file '" << path << "'.";
-    throw std::runtime_error(oss.str());
-  }
+// Read the contents of IMEM or DMEM from the memory that is shared with the
+// ISS. On failure, throws a std::runtime_error.
+static Ecc32MemArea::EccWords read_words_from_shared(const IssSharedMem &shm,
+                                                     bool is_imem) {
+  uint32_t num_words = shm.num_words(is_imem);
+  const uint8_t *src = shm.words(is_imem);
 
   Ecc32MemArea::EccWords ret;
   ret.reserve(num_words);
-
-  char minibuf[5];
-  for (size_t i = 0; i < num_words; ++i) {
-    std::streamsize chars_in = fb.sgetn(minibuf, 5);
-    if (chars_in != 5) {
-      std::ostringstream oss;
-      oss << "Cannot read word " << i << " from " << path
-          << " (expected 5 bytes, but actually got " << chars_in << ").";
-      throw std::runtime_error(oss.str());
-    }
-
-    // The layout should be a validity byte (either 0 or 1), followed
-    // by 4 bytes with a little-endian 32-bit word.
-    uint8_t vld_byte = minibuf[0];
-    if (vld_byte > 2) {
-      std::ostringstream oss;
-      oss << "Word " << i << " at " << path
-          << " had a validity byte with value " << (int)vld_byte
-          << "; not 0 or 1.";
-      throw std::runtime_error(oss.str());
-    }
-    bool valid = vld_byte == 1;
-
-    uint32_t word = 0;
-    for (int j = 0; j < 4; ++j) {
-      word |= (uint32_t)(uint8_t)minibuf[j + 1] << 8 * j;
-    }
-
+  for (uint32_t i = 0; i < num_words; ++i) {
+    uint32_t word;
+    bool valid =
+        IssSharedMem::get_word(src + IssSharedMem::kBytesPerWord * i, &word);
     ret.push_back(std::make_pair(valid, word));
   }
 
   return ret;
 }
 
-// Write some words to a new file at path. On failure, throws a
-// std::runtime_error.
-static void write_words_to_file(const std::string &path,
-                                const Ecc32MemArea::EccWords &words) {
-  std::filebuf fb;
-  if (!fb.open(path.c_str(), std::ios::out | std::ios::binary)) {
-    std::ostringstream oss;
-    oss << "Cannot open the file '" << path << "'.";
-    throw std::runtime_error(oss.str());
-  }
+// Write the contents of IMEM or DMEM to the memory that is shared with the
+// ISS. There must be space for exactly words.size() words.
+static void write_words_to_shared(const IssSharedMem &shm, bool is_imem,
+                                  const Ecc32MemArea::EccWords &words) {
+  assert(words.size() == shm.num_words(is_imem));
 
+  uint8_t *dst = shm.words(is_imem);
   for (const Ecc32MemArea::EccWord &word : words) {
-    uint8_t bytes[5];
-
-    bool valid = word.first;
-    uint32_t w32 = word.second;
-
-    bytes[0] = valid ? 1 : 0;
-    for (int j = 0; j < 4; ++j) {
-      bytes[j + 1] = (w32 >> (8 * j)) & 0xff;
-    }
+    IssSharedMem::put_word(dst, word.first, word.second);
+    dst += IssSharedMem::kBytesPerWord;
+  }
+}
 
-    std::streamsize chars_out =
-        fb.sputn(reinterpret_cast<const char *>(&bytes), 5);
-    if (chars_out != 5) {
-      std::ostringstream oss;
-      oss << "Failed to write to " << path << ".";
-      throw std::runtime_error(oss.str());
-    }
+// Return the indices of the rows of DMEM that the RTL has written since the
+// DMEM snooper at snooper_scope (see otbn_dmem_snooper_if.sv) was last
+// cleared, and then clear it.
+static std::vector<uint32_t> take_rtl_dirty_rows(
+    const std::string &snooper_scope) {
+  SVScoped scoped(snooper_scope);
+
+  std::vector<uint32_t> ret;
+  for (int row = otbn_dmem_dirty_next(0); row >= 0;
+       row = otbn_dmem_dirty_next(row + 1)) {
+    ret.push_back(row);
   }
+  otbn_dmem_dirty_clear();
+
+  return ret;
 }
 
 template <typename T>
@@ -193,6 +165,14 @@ OtbnModel::OtbnModel(const std::string &mem_scope,
                      const std::string &design_scope)
     : mem_util_(mem_scope), design_scope_(design_scope) {
   assert(mem_scope.size() && design_scope.size());
+
+  // By default, check_dmem compares all of DMEM. Setting
+  // OTBN_MODEL_INCREMENTAL_DMEM_CHECK to 1 makes it only compare the words that
+  // have been written by the ISS or by the RTL's LSU since the last check. That
+  // misses DMEM writes from anywhere else (such as backdoor loads or fault
+  // injection), so it is only safe for tests that don't make any.
+  const char *incr_check_str = getenv("OTBN_MODEL_INCREMENTAL_DMEM_CHECK");
+  incremental_dmem_check_ = incr_check_str && !strcmp(incr_check_str, "1");
 }
 
 OtbnModel::~OtbnModel() {}
@@ -226,6 +206,34 @@ int OtbnModel::take_loop_warps(const OtbnMemUtil &memutil) {
   return 0;
 }
 
+int OtbnModel::save_checkpoint(const std::string &path) const {
+  ISSWrapper *iss = iss_.get();
+  if (!iss)
+    return 0;
+
+  try {
+    iss->save_state(path);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "Error when saving ISS state: " << err.what() << "\n";
+    return -1;
+  }
+  return 1;
+}
+
+int OtbnModel::restore_checkpoint(const std::string &path) {
+  ISSWrapper *iss = ensure_wrapper();
+  if (!iss)
+    return -1;
+
+  try {
+    iss->restore_state(path);
+  } catch (const std::runtime_error &err) {
+    std::cerr << "Error when restoring ISS state: " << err.what() << "\n";
+    return -1;
+  }
+  return 0;
+}
+
 int OtbnModel::start_operation(command_t command) {
   ISSWrapper *iss = ensure_wrapper();
   if (!iss)
@@ -239,14 +247,18 @@ int OtbnModel::start_operation(command_t command) {
         cmd_desc = "execute";
         iss_command = ISSWrapper::Execute;
 
-        std::string dfname(iss->make_tmp_path("dmem"));
-        std::string ifname(iss->make_tmp_path("imem"));
+        IssSharedMem shm = iss->get_shared_mem();
+        write_words_to_shared(shm, false, get_sim_memory(false));
+        write_words_to_shared(shm, true, get_sim_memory(true));
 
-        write_words_to_file(dfname, get_sim_memory(false));
-        write_words_to_file(ifname, get_sim_memory(true));
+        iss->load_d_shared();
+        iss->load_i_shared();
 
-        iss->load_d(dfname);
-        iss->load_i(ifname);
+        // The ISS and RTL now have the same contents of DMEM, so nothing is
+        // dirty on either side.
+        memset(shm.dirty_flags(), 0, shm.num_words(false));
+        if (has_rtl())
+          take_rtl_dirty_rows(dmem_snooper_scope());
       } break;
 
       case DmemWipe:
@@ -500,14 +512,10 @@ int OtbnModel::load_dmem() {
     return -1;
   }
 
-  const MemArea &dmem = mem_util_.GetMemArea(false);
-
-  std::string dfname(iss->make_tmp_path("dmem_out"));
   try {
     // Read DMEM from the ISS
-    iss->dump_d(dfname);
-    set_sim_memory(false,
-                   read_words_from_file(dfname, dmem.GetSizeBytes() / 4));
+    iss->dump_d_shared();
+    set_sim_memory(false, read_words_from_shared(iss->get_shared_mem(), false));
   } catch (const std::exception &err) {
     std::cerr << "Error when loading dmem from ISS: " << err.what() << "\n";
     return -1;
@@ -661,7 +669,11 @@ bool OtbnModel::is_at_start_of_wipe() const {
 ISSWrapper *OtbnModel::ensure_wrapper() {
   if (!iss_) {
     try {
-      iss_.reset(new ISSWrapper());
+      // The shared memory holds 32-bit words, but MemArea counts words of the
+      // memory's native width, so work from the size in bytes.
+      uint32_t imem_words = mem_util_.GetMemArea(true).GetSizeBytes() / 4;
+      uint32_t dmem_words = mem_util_.GetMemArea(false).GetSizeBytes() / 4;
+      iss_.reset(new ISSWrapper(imem_words, dmem_words));
     } catch (const std::runtime_error &err) {
       std::cerr << "Error when constructing ISS wrapper: " << err.what()
                 << "\n";
@@ -683,66 +695,104 @@ void OtbnModel::set_sim_memory(bool is_imem,
 }
 
 bool OtbnModel::check_dmem(ISSWrapper &iss) const {
-  const MemArea &dmem = mem_util_.GetMemArea(false);
-  uint32_t dmem_bytes = dmem.GetSizeBytes();
-
-  std::string dfname(iss.make_tmp_path("dmem_out"));
-
-  iss.dump_d(dfname);
-  Ecc32MemArea::EccWords iss_words =
-      read_words_from_file(dfname, dmem_bytes / 4);
-  assert(iss_words.size() == dmem_bytes / 4);
-
-  Ecc32MemArea::EccWords rtl_words = get_sim_memory(false);
-  assert(rtl_words.size() == dmem_bytes / 4);
+  const Ecc32MemArea &dmem = mem_util_.GetMemArea(false);
+  uint32_t num_rows = dmem.GetSizeWords();
+  uint32_t words_per_row = dmem.GetWidthByte() / 4;
+  uint32_t dmem_words = num_rows * words_per_row;
+
+  IssSharedMem shm = iss.get_shared_mem();
+  assert(shm.num_words(false) == dmem_words);
+  uint8_t *dirty_flags = shm.dirty_flags();
+
+  // Decide which rows of DMEM to compare. In a full check, that's all of
+  // them. In an incremental check, it's the rows that the RTL has written,
+  // together with the rows containing words that the ISS reports as dirty. The
+  // shared memory already holds the ISS's contents for every other word.
+  std::vector<uint32_t> rtl_rows = take_rtl_dirty_rows(dmem_snooper_scope());
+  std::vector<bool> check_row(num_rows, !incremental_dmem_check_);
+  if (!incremental_dmem_check_) {
+    iss.dump_d_shared();
+  } else {
+    iss.dump_d_dirty();
+    for (uint32_t row : rtl_rows) {
+      if (row < num_rows)
+        check_row[row] = true;
+    }
+    for (uint32_t i = 0; i < dmem_words; ++i) {
+      if (dirty_flags[i])
+        check_row[i / words_per_row] = true;
+    }
+  }
+  memset(dirty_flags, 0, dmem_words);
 
   std::ios old_state(nullptr);
   old_state.copyfmt(std::cerr);
 
   int bad_count = 0;
-  for (size_t i = 0; i < dmem_bytes / 4; ++i) {
-    bool iss_valid = iss_words[i].first;
-    bool rtl_valid = rtl_words[i].first;
-    uint32_t iss_w32 = iss_words[i].second;
-    uint32_t rtl_w32 = rtl_words[i].second;
-
-    // If neither word has valid checksum bits, all is well.
-    if (!iss_valid && !rtl_valid)
-      continue;
-
-    // If both words have valid checksum bits and equal data, all is well.
-    if (iss_valid && rtl_valid && iss_w32 == rtl_w32)
+  uint32_t row = 0;
+  while (row < num_rows && bad_count < 10) {
+    if (!check_row[row]) {
+      ++row;
       continue;
+    }
 
-    // TODO: At the moment, the ISS doesn't track validity bits properly in
-    //       DMEM, which means that we might have a situation where RTL says a
-    //       word is invalid, but the ISS doesn't. To avoid spurious failures
-    //       until we've implemented things, skip the check in this case. Once
-    //       the ISS handles validity bits properly, delete this block.
-    if (iss_valid && !rtl_valid)
-      continue;
+    // Read each run of rows that need checking from the RTL in one go
+    uint32_t run_end = row + 1;
+    while (run_end < num_rows && check_row[run_end])
+      ++run_end;
+    Ecc32MemArea::EccWords rtl_words =
+        dmem.ReadWithIntegrity(row, run_end - row);
+    assert(rtl_words.size() == (run_end - row) * words_per_row);
+
+    for (size_t j = 0; j < rtl_words.size(); ++j) {
+      size_t i = row * words_per_row + j;
+      uint32_t iss_w32;
+      bool iss_valid = IssSharedMem::get_word(
+          shm.words(false) + IssSharedMem::kBytesPerWord * i, &iss_w32);
+      bool rtl_valid = rtl_words[j].first;
+      uint32_t rtl_w32 = rtl_words[j].second;
+
+      // If neither word has valid checksum bits, all is well.
+      if (!iss_valid && !rtl_valid)
+        continue;
+
+      // If both words have valid checksum bits and equal data, all is well.
+      if (iss_valid && rtl_valid && iss_w32 == rtl_w32)
+        continue;
+
+      // TODO: At the moment, the ISS doesn't track validity bits properly in
+      //       DMEM, which means that we might have a situation where RTL says
+      //       a word is invalid, but the ISS doesn't. To avoid spurious
+      //       failures until we've implemented things, skip the check in this
+      //       case. Once the ISS handles validity bits properly, delete this
+      //       block.
+      if (iss_valid && !rtl_valid)
+        continue;
+
+      // Otherwise, something has gone wrong. Print out a banner if this is
+      // the first mismatch.
+      if (bad_count == 0) {
+        std::cerr << "ERROR: Mismatches in dmem data:\n"
+                  << std::hex << std::setfill('0');
+      }
 
-    // Otherwise, something has gone wrong. Print out a banner if this is the
-    // first mismatch.
-    if (bad_count == 0) {
-      std::cerr << "ERROR: Mismatches in dmem data:\n"
-                << std::hex << std::setfill('0');
+      std::cerr << " @offset 0x" << std::setw(3) << 4 * i << ": ";
+      if (iss_valid != rtl_valid) {
+        std::cerr << "mismatching validity bits (rtl = " << rtl_valid
+                  << "; iss = " << iss_valid << ")\n";
+      } else {
+        assert(iss_valid && rtl_valid && iss_w32 != rtl_w32);
+        std::cerr << "rtl has 0x" << std::setw(8) << rtl_w32 << "; iss has 0x"
+                  << std::setw(8) << iss_w32 << "\n";
+      }
+      ++bad_count;
+      if (bad_count == 10) {
+        std::cerr << " (skipping further errors...)\n";
+        break;
+      }
     }
 
-    std::cerr << " @offset 0x" << std::setw(3) << 4 * i << ": ";
-    if (iss_valid != rtl_valid) {
-      std::cerr << "mismatching validity bits (rtl = " << rtl_valid
-                << "; iss = " << iss_valid << ")\n";
-    } else {
-      assert(iss_valid && rtl_valid && iss_w32 != rtl_w32);
-      std::cerr << "rtl has 0x" << std::setw(8) << rtl_w32 << "; iss has 0x"
-                << std::setw(8) << iss_w32 << "\n";
-    }
-    ++bad_count;
-    if (bad_count == 10) {
-      std::cerr << " (skipping further errors...)\n";
-      break;
-    }
+    row = run_end;
   }
   std::cerr.copyfmt(old_state);
   return bad_count == 0;
@@ -26,6 +26,16 @@ class OtbnModel {
   // already have been written to stderr.
   int take_loop_warps(const OtbnMemUtil &memutil);
 
+  // Save the state of the ISS to path, as part of a checkpoint of the whole
+  // simulation (see ISSWrapper::save_state). If the ISS hasn't started, there
+  // is nothing to save and the file isn't written. Returns 1 if the file was
+  // written, 0 if there was nothing to save or -1 on failure.
+  int save_checkpoint(const std::string &path) const;
+
+  // Restore the state of the ISS from a file written by save_checkpoint,
+  // starting the ISS if necessary. Returns 0 on success or -1 on failure.
+  int restore_checkpoint(const std::string &path);
+
   // True if this model is running in a simulation that has an RTL
   // implementation too (which needs checking).
   bool has_rtl() const { return !design_scope_.empty(); }
@@ -142,11 +152,19 @@ class OtbnModel {
   // Set the contents of the ISS's memory
   void set_sim_memory(bool is_imem, const Ecc32MemArea::EccWords &words);
 
-  // Grab contents of dmem from the model and compare them with the RTL. Prints
-  // messages to stderr on failure or mismatch. Returns true on success; false
-  // on mismatch. Throws a std::runtime_error on failure.
+  // Grab contents of dmem from the model and compare them with the RTL. If
+  // incremental_dmem_check_ is set, this only compares the words that the ISS
+  // or the RTL has written since the last check (or since the start of the
+  // operation). Prints messages to stderr on failure or mismatch. Returns true
+  // on success; false on mismatch. Throws a std::runtime_error on failure.
   bool check_dmem(ISSWrapper &iss) const;
 
+  // The scope of the interface that snoops on DMEM writes from the RTL (see
+  // otbn_dmem_snooper_if.sv)
+  std::string dmem_snooper_scope() const {
+    return design_scope_ + ".u_dmem_snooper";
+  }
+
   // Compare contents of ISS registers with those from the design. Prints
   // messages to stderr on failure or mismatch. Returns true on success; false
   // on mismatch. Throws a std::runtime_error on failure.
@@ -167,6 +185,11 @@ class OtbnModel {
   std::string design_scope_;
 
   bool stack_check_enabled_ = true;
+
+  // If true, check_dmem only compares the words that have been written since
+  // the last check, rather than all of DMEM. Set with
+  // OTBN_MODEL_INCREMENTAL_DMEM_CHECK.
+  bool incremental_dmem_check_ = false;
 };
 
 #endif  // OPENTITAN_HW_IP_OTBN_DV_MODEL_OTBN_MODEL_H_
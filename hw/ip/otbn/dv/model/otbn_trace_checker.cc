@@ -40,8 +40,7 @@ OtbnTraceChecker &OtbnTraceChecker::get() {
   return *trace_checker;
 }
 
-void OtbnTraceChecker::AcceptTraceString(const std::string &trace,
-                                         unsigned int cycle_count) {
+void OtbnTraceChecker::AcceptTraceEvent(const OtbnTraceEvent &event) {
   assert(!(rtl_pending_ && iss_pending_));
 
   if (seen_err_)
@@ -49,7 +48,7 @@ void OtbnTraceChecker::AcceptTraceString(const std::string &trace,
 
   done_ = false;
   OtbnTraceEntry trace_entry;
-  if (!trace_entry.from_rtl_trace(trace)) {
+  if (!trace_entry.from_rtl_event(event)) {
     seen_err_ = true;
     return;
   }
@@ -52,8 +52,7 @@ class OtbnTraceChecker : public OtbnTraceListener {
 
   // Take a trace entry from the wrapped RTL. Any mismatch error is stored
   // until the next call to an API function that can respond with the error.
-  void AcceptTraceString(const std::string &trace,
-                         unsigned int cycle_count) override;
+  void AcceptTraceEvent(const OtbnTraceEvent &event) override;
 
   // Take a trace entry from the wrapped ISS.
   //
@@ -4,86 +4,372 @@
 
 #include "otbn_trace_entry.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <regex>
 #include <sstream>
 
+// Names for locations of kind Named, indexed by the bottom 32 bits of the
+// location ID. New names get appended when they are first seen. The names here
+// are those we expect to see, which means that we don't normally have to
+// allocate anything.
+static std::vector<std::string> &named_locs() {
+  static std::vector<std::string> names = {
+      "MOD", "ACC", "RND", "URND", "KeyS0L", "KeyS0H", "KeyS1L", "KeyS1H"};
+  return names;
+}
+
+static OtbnTraceBodyLine::loc_t make_loc(OtbnTraceBodyLine::loc_kind_t kind,
+                                         uint32_t idx) {
+  return ((OtbnTraceBodyLine::loc_t)kind << 32) | idx;
+}
+
+// Return the value of a lower-case hex digit, or -1 if c isn't one.
+static int hex_digit(char c) {
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// Parse exactly len decimal digits from str. Return false if there is a
+// character that isn't a digit.
+static bool parse_dec(const char *str, size_t len, uint32_t *dst) {
+  uint32_t acc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (str[i] < '0' || str[i] > '9')
+      return false;
+    acc = 10 * acc + (str[i] - '0');
+  }
+  *dst = acc;
+  return true;
+}
+
 bool OtbnTraceBodyLine::fill_from_string(const std::string &src,
                                          const std::string &line) {
-  // A valid line matches the following regex
-  std::regex re("(.) ([^:]+): (.+)");
-  std::smatch match;
+  return fill_from_string(src, line.data(), line.size());
+}
 
-  if (!std::regex_match(line, match, re)) {
+bool OtbnTraceBodyLine::fill_from_string(const std::string &src,
+                                         const char *line, size_t len) {
+  // A valid line is a type character, a space, a location (which doesn't
+  // contain a colon), a colon and a space, and then a non-empty value.
+  const char *colon =
+      len > 2 ? (const char *)memchr(line + 2, ':', len - 2) : nullptr;
+  size_t loc_len = colon ? colon - (line + 2) : 0;
+  size_t val_pos = 2 + loc_len + 2;
+
+  if (len < 2 || line[1] != ' ' || loc_len == 0 || val_pos >= len ||
+      colon[1] != ' ' || memchr(line, '\n', len)) {
     std::cerr << "OTBN trace body line from " << src
-              << " does not have expected format. Saw: `" << line << "'.\n";
+              << " does not have expected format. Saw: `"
+              << std::string(line, len) << "'.\n";
     return false;
   }
 
-  assert(match.size() == 4);
-
-  raw_ = line;
-  type_ = match[1].str()[0];
-  loc_ = match[2].str();
-  value_ = match[3].str();
+  type_ = line[0];
+  if (!parse_loc(line + 2, loc_len)) {
+    // This is a name that we haven't seen before. Intern it.
+    std::vector<std::string> &names = named_locs();
+    loc_ = make_loc(Named, names.size());
+    names.push_back(std::string(line + 2, loc_len));
+  }
+  if (!parse_value(line + val_pos, len - val_pos)) {
+    fmt_ = TextValue;
+    text_.assign(line + val_pos, len - val_pos);
+  }
   return true;
 }
 
-bool OtbnTraceBodyLine::operator==(const OtbnTraceBodyLine &other) const {
-  // If the raw lines are identical, the two objects are identical and no
-  // further checks are required.
-  if (raw_ == other.raw_) {
+bool OtbnTraceBodyLine::parse_loc(const char *str, size_t len) {
+  uint32_t idx;
+
+  // GPRs and WDRs are written as x01 or w23
+  if (len == 3 && (str[0] == 'x' || str[0] == 'w') &&
+      parse_dec(str + 1, 2, &idx)) {
+    loc_ = make_loc(str[0] == 'x' ? Gpr : Wdr, idx);
+    return true;
+  }
+
+  // Flag groups are written as FLAGS0
+  if (len == 6 && memcmp(str, "FLAGS", 5) == 0 &&
+      parse_dec(str + 5, 1, &idx)) {
+    loc_ = make_loc(Flags, idx);
+    return true;
+  }
+
+  // Memory addresses are written as [0x12345678]
+  if (len == 12 && memcmp(str, "[0x", 3) == 0 && str[11] == ']') {
+    idx = 0;
+    for (int i = 0; i < 8; ++i) {
+      int digit = hex_digit(str[3 + i]);
+      if (digit < 0)
+        break;
+      idx = (idx << 4) | digit;
+      if (i == 7) {
+        loc_ = make_loc(Mem, idx);
+        return true;
+      }
+    }
+  }
+
+  const std::vector<std::string> &names = named_locs();
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i].size() == len && memcmp(names[i].data(), str, len) == 0) {
+      loc_ = make_loc(Named, i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OtbnTraceBodyLine::parse_value(const char *str, size_t len) {
+  memset(value_, 0, sizeof value_);
+  memset(unknown_, 0, sizeof unknown_);
+  text_.clear();
+
+  // Flags are written as {C: 0, M: 1, L: 0, Z: 0}, where each value might
+  // also be x.
+  static const char flags_fmt[] = "{C: ?, M: ?, L: ?, Z: ?}";
+  if (len > 0 && str[0] == '{') {
+    if (len != sizeof flags_fmt - 1)
+      return false;
+
+    int bit = 0;
+    for (size_t i = 0; i < len; ++i) {
+      if (flags_fmt[i] != '?') {
+        if (str[i] != flags_fmt[i])
+          return false;
+        continue;
+      }
+      if (str[i] == 'x') {
+        unknown_[0] |= 1 << bit;
+      } else if (str[i] == '1') {
+        value_[0] |= 1 << bit;
+      } else if (str[i] != '0') {
+        return false;
+      }
+      ++bit;
+    }
+    fmt_ = FlagsValue;
     return true;
   }
 
-  // If the raw lines are not identical, the two objects can be identical if one
-  // of them contains unknown values.
+  // Otherwise, we expect a hex value starting with 0x. Digits might be
+  // separated into groups of 8 with '_' characters and might be 'x' for an
+  // unknown value. Read backwards from the end, so that we start with the LSB.
+  if (len < 3 || str[0] != '0' || str[1] != 'x')
+    return false;
 
-  // Type and location have to be identical, though.
+  unsigned num_separators = 0;
+  unsigned num_digits = 0;
+  for (size_t i = len; i > 2; --i) {
+    char c = str[i - 1];
+    if (c == '_') {
+      if (num_digits != 8 * (num_separators + 1))
+        return false;
+      ++num_separators;
+      continue;
+    }
+    if (num_digits == 8 * kMaxWords)
+      return false;
+
+    int digit = hex_digit(c);
+    uint32_t *dst;
+    if (digit >= 0) {
+      dst = value_;
+    } else if (c == 'x') {
+      dst = unknown_;
+      digit = 0xf;
+    } else {
+      return false;
+    }
+    dst[num_digits / 8] |= (uint32_t)digit << (4 * (num_digits % 8));
+    ++num_digits;
+  }
+
+  // If there were separators, they must have been between every group
+  if (num_digits == 0 ||
+      (num_separators && num_separators != (num_digits - 1) / 8))
+    return false;
+
+  fmt_ = HexValue;
+  grouped_ = num_separators > 0;
+  num_digits_ = num_digits;
+  return true;
+}
+
+void OtbnTraceBodyLine::append_value(std::string *dst) const {
+  switch (fmt_) {
+    case FlagsValue: {
+      static const char flag_names[] = "CMLZ";
+      dst->push_back('{');
+      for (int bit = 0; bit < 4; ++bit) {
+        if (bit)
+          dst->append(", ");
+        dst->push_back(flag_names[bit]);
+        dst->append(": ");
+        dst->push_back(((unknown_[0] >> bit) & 1)  ? 'x'
+                       : ((value_[0] >> bit) & 1) ? '1'
+                                                  : '0');
+      }
+      dst->push_back('}');
+      break;
+    }
+
+    case HexValue:
+      dst->append("0x");
+      for (unsigned i = num_digits_; i > 0; --i) {
+        unsigned word = (i - 1) / 8, shift = 4 * ((i - 1) % 8);
+        if (grouped_ && i != num_digits_ && i % 8 == 0)
+          dst->push_back('_');
+        if ((unknown_[word] >> shift) & 0xf) {
+          dst->push_back('x');
+        } else {
+          dst->push_back("0123456789abcdef"[(value_[word] >> shift) & 0xf]);
+        }
+      }
+      break;
+
+    default:
+      assert(fmt_ == TextValue);
+      dst->append(text_);
+      break;
+  }
+}
+
+std::string OtbnTraceBodyLine::get_loc_name() const {
+  uint32_t idx = (uint32_t)loc_;
+  char buf[16];
+
+  switch (get_loc_kind()) {
+    case Gpr:
+    case Wdr:
+      snprintf(buf, sizeof buf, "%c%02u", get_loc_kind() == Gpr ? 'x' : 'w',
+               (unsigned)idx);
+      return buf;
+    case Flags:
+      snprintf(buf, sizeof buf, "FLAGS%u", (unsigned)idx);
+      return buf;
+    case Mem:
+      snprintf(buf, sizeof buf, "[0x%08x]", (unsigned)idx);
+      return buf;
+    default:
+      assert(get_loc_kind() == Named && idx < named_locs().size());
+      return named_locs()[idx];
+  }
+}
+
+std::string OtbnTraceBodyLine::get_string() const {
+  std::string ret(1, type_);
+  ret.push_back(' ');
+  ret.append(get_loc_name());
+  ret.append(": ");
+  append_value(&ret);
+  return ret;
+}
+
+bool OtbnTraceBodyLine::operator==(const OtbnTraceBodyLine &other) const {
+  // Type and location have to be identical.
   if (type_ != other.type_ || loc_ != other.loc_) {
     return false;
   }
 
-  // The values have to be of identical length.
-  if (value_.size() != other.value_.size()) {
+  if (fmt_ != other.fmt_ || fmt_ == TextValue) {
+    // At least one of the values has an unexpected format. Fall back to
+    // comparing the values as strings. They have to be of identical length.
+    // Compare them digit by digit and treat `x` as unknown value, which is
+    // identical to any other value.
+    std::string value, other_value;
+    append_value(&value);
+    other.append_value(&other_value);
+    if (value.size() != other_value.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < value.size(); ++i) {
+      char c = value[i], other_c = other_value[i];
+      if (c != other_c && !(c == 'x' || other_c == 'x')) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The values have to be of identical length (which means the same number of
+  // digits and the same grouping for hex values).
+  if (fmt_ == HexValue &&
+      (num_digits_ != other.num_digits_ || grouped_ != other.grouped_)) {
     return false;
   }
 
-  // Compare values digit by digit and treat `x` as unknown value, which is
-  // identical to any other value.
-  std::string::const_iterator other_it = other.value_.begin();
-  for (std::string::const_iterator it = value_.begin(); it != value_.end();
-       it++) {
-    if (*it != *other_it && !(*it == 'x' || *other_it == 'x')) {
+  // Compare the values, ignoring any bits that are unknown in either of them.
+  for (int i = 0; i < kMaxWords; ++i) {
+    uint32_t unknown = unknown_[i] | other.unknown_[i];
+    if ((value_[i] ^ other.value_[i]) & ~unknown) {
       return false;
     }
-    other_it++;
   }
   return true;
 }
 
+// Compare two body lines by location (used to keep writes sorted)
+static bool loc_less(const OtbnTraceBodyLine &a, const OtbnTraceBodyLine &b) {
+  return a.get_loc() < b.get_loc();
+}
+
+void OtbnTraceEntry::add_write(const OtbnTraceBodyLine &line) {
+  // Insert after any existing writes to the same location, so that writes to
+  // a location stay in order.
+  auto pos = std::upper_bound(writes_.begin(), writes_.end(), line, loc_less);
+  writes_.insert(pos, line);
+}
+
 bool OtbnTraceEntry::from_rtl_trace(const std::string &trace) {
   size_t eol = trace.find('\n');
   hdr_ = trace.substr(0, eol);
   trace_type_ = hdr_to_trace_type(hdr_);
+  writes_.clear();
 
   while (eol != std::string::npos) {
     size_t bol = eol + 1;
     eol = trace.find('\n', bol);
-    size_t line_len =
-        (eol == std::string::npos) ? std::string::npos : eol - bol;
-    std::string line = trace.substr(bol, line_len);
+    size_t line_len = (eol == std::string::npos) ? trace.size() - bol
+                                                 : eol - bol;
 
     // We're only interested in register writes
-    if (!(line.size() > 0 && line[0] == '>'))
+    if (!(line_len > 0 && trace[bol] == '>'))
       continue;
 
     OtbnTraceBodyLine parsed_line;
-    if (!parsed_line.fill_from_string("RTL", line)) {
+    if (!parsed_line.fill_from_string("RTL", trace.data() + bol, line_len)) {
       return false;
     }
-    writes_[parsed_line.get_loc()].push_back(parsed_line);
+    add_write(parsed_line);
+  }
+  return true;
+}
+
+bool OtbnTraceEntry::from_rtl_event(const OtbnTraceEvent &event) {
+  const char *text = event.text();
+  const char *eol =
+      static_cast<const char *>(memchr(text, '\n', event.text_len()));
+  hdr_.assign(text, eol ? eol - text : event.text_len());
+  trace_type_ = hdr_to_trace_type(hdr_);
+  writes_.clear();
+
+  for (const OtbnTraceEvent::Access &access : event.accesses()) {
+    // We're only interested in register writes
+    if (access.type != OtbnTraceEvent::kRegWrite)
+      continue;
+
+    OtbnTraceBodyLine parsed_line;
+    if (!parsed_line.fill_from_string("RTL", access.line, access.line_len)) {
+      return false;
+    }
+    add_write(parsed_line);
   }
   return true;
 }
@@ -98,26 +384,45 @@ bool OtbnTraceEntry::compare_rtl_iss_entries(const OtbnTraceEntry &other,
     return false;
   }
 
-  for (const auto &rtlptr : writes_) {
-    auto isskey = other.writes_.find(rtlptr.first);
-    if (isskey == other.writes_.end()) {
+  // Both lists of writes are sorted by location, so we can walk through the
+  // RTL writes a location at a time, finding the matching ISS writes with a
+  // binary search.
+  const OtbnTraceBodyLine *rtl_end = writes_.data() + writes_.size();
+  const OtbnTraceBodyLine *iss_end =
+      other.writes_.data() + other.writes_.size();
+  size_t rtl_locs = 0;
+  for (const OtbnTraceBodyLine *rtl_begin = writes_.data();
+       rtl_begin != rtl_end;) {
+    auto rtl_range = std::equal_range(rtl_begin, rtl_end, *rtl_begin, loc_less);
+    auto iss_range = std::equal_range(other.writes_.data(), iss_end,
+                                      *rtl_begin, loc_less);
+    if (iss_range.first == iss_range.second) {
       std::ostringstream oss;
-      oss << "RTL had a write to `" << rtlptr.first
+      oss << "RTL had a write to `" << rtl_begin->get_loc_name()
           << "', but the ISS doesn't have a write to that location.";
       *err_desc = oss.str();
       return false;
     }
-    // compare rtlptr.second and isskey.second
-    if (!check_entries_compatible(trace_type_, rtlptr.first, rtlptr.second,
-                                  isskey->second, no_sec_wipe_data_chk,
+    if (!check_entries_compatible(trace_type_, rtl_range.first,
+                                  rtl_range.second, iss_range.first,
+                                  iss_range.second, no_sec_wipe_data_chk,
                                   err_desc))
       return false;
+
+    ++rtl_locs;
+    rtl_begin = rtl_range.second;
+  }
+
+  size_t iss_locs = 0;
+  for (size_t i = 0; i < other.writes_.size(); ++i) {
+    if (i == 0 || other.writes_[i].get_loc() != other.writes_[i - 1].get_loc())
+      ++iss_locs;
   }
 
-  if (writes_.size() != other.writes_.size()) {
+  if (rtl_locs != iss_locs) {
     std::ostringstream oss;
-    oss << "RTL wrote to " << writes_.size() << " locations; the ISS wrote to "
-        << other.writes_.size() << ".";
+    oss << "RTL wrote to " << rtl_locs << " locations; the ISS wrote to "
+        << iss_locs << ".";
     *err_desc = oss.str();
     return false;
   }
@@ -127,30 +432,27 @@ bool OtbnTraceEntry::compare_rtl_iss_entries(const OtbnTraceEntry &other,
 
 void OtbnTraceEntry::print(const std::string &indent, std::ostream &os) const {
   os << indent << hdr_ << "\n";
-  for (const auto &pr : writes_) {
-    for (const auto &line : pr.second) {
-      os << indent << line.get_string() << "\n";
-    }
+  for (const auto &line : writes_) {
+    os << indent << line.get_string() << "\n";
   }
 }
 
 void OtbnTraceEntry::take_writes(const OtbnTraceEntry &other,
                                  bool other_first) {
-  for (const auto &pr : other.writes_) {
-    std::vector<OtbnTraceBodyLine> &so_far = writes_[pr.first];
-    if (other_first) {
-      // If other_first is true, we should prepend the writes from other. We do
-      // so by creating a temporary vector (with a copy of the writes from
-      // other) and then appending any writes we had before.
-      std::vector<OtbnTraceBodyLine> tmp(pr.second);
-      tmp.insert(tmp.end(), so_far.begin(), so_far.end());
-      writes_[pr.first] = tmp;
-    } else {
-      // If other_first is false, we should append the writes from other. We
-      // can do that with just a call to insert.
-      so_far.insert(so_far.end(), pr.second.begin(), pr.second.end());
-    }
+  // Both lists of writes are sorted by location. Merge them, taking writes to
+  // a given location from other first if other_first is true (std::merge is
+  // stable, taking elements from the first range first when they compare
+  // equal).
+  std::vector<OtbnTraceBodyLine> merged;
+  merged.reserve(writes_.size() + other.writes_.size());
+  if (other_first) {
+    std::merge(other.writes_.begin(), other.writes_.end(), writes_.begin(),
+               writes_.end(), std::back_inserter(merged), loc_less);
+  } else {
+    std::merge(writes_.begin(), writes_.end(), other.writes_.begin(),
+               other.writes_.end(), std::back_inserter(merged), loc_less);
   }
+  writes_.swap(merged);
 }
 
 bool OtbnTraceEntry::is_compatible(const OtbnTraceEntry &prev) const {
@@ -222,23 +524,26 @@ bool OtbnTraceEntry::is_final() const {
 }
 
 bool OtbnTraceEntry::check_entries_compatible(
-    trace_type_t type, const std::string &key,
-    const std::vector<OtbnTraceBodyLine> &rtl_lines,
-    const std::vector<OtbnTraceBodyLine> &iss_lines, bool no_sec_wipe_data_chk,
+    trace_type_t type, const OtbnTraceBodyLine *rtl_begin,
+    const OtbnTraceBodyLine *rtl_end, const OtbnTraceBodyLine *iss_begin,
+    const OtbnTraceBodyLine *iss_end, bool no_sec_wipe_data_chk,
     std::string *err_desc) {
-  assert(rtl_lines.size() && iss_lines.size());
+  assert(rtl_begin < rtl_end && iss_begin < iss_end);
   assert(type == WipeComplete || type == Exec);
   assert(err_desc);
 
-  if (type == WipeComplete && key != "FLAGS0" && key != "FLAGS1") {
+  size_t num_rtl_lines = rtl_end - rtl_begin;
+
+  if (type == WipeComplete &&
+      rtl_begin->get_loc_kind() != OtbnTraceBodyLine::Flags) {
     // As a quick check: make sure that there are at least 2 lines for
     // the key. We will also check that they are different, but
     // debugging is probably easier if the error message comments that
     // there aren't two lines *to* be different.
-    if (rtl_lines.size() < 2) {
+    if (num_rtl_lines < 2) {
       std::ostringstream oss;
-      oss << "There are " << rtl_lines.size() << " RTL lines for key `" << key
-          << "'; we expected at least 2.";
+      oss << "There are " << num_rtl_lines << " RTL lines for key `"
+          << rtl_begin->get_loc_name() << "'; we expected at least 2.";
       *err_desc = oss.str();
       return false;
     }
@@ -247,8 +552,9 @@ bool OtbnTraceEntry::check_entries_compatible(
     // different values. This checks that we don't (e.g.) just write
     // zero to the key many times.
     bool seen_change = false;
-    for (size_t i = 1; i < rtl_lines.size(); i++) {
-      if (!(rtl_lines[i] == rtl_lines[0])) {
+    for (const OtbnTraceBodyLine *line = rtl_begin + 1; line != rtl_end;
+         ++line) {
+      if (!(*line == *rtl_begin)) {
         seen_change = true;
         break;
       }
@@ -256,15 +562,17 @@ bool OtbnTraceEntry::check_entries_compatible(
 
     if (!seen_change && !no_sec_wipe_data_chk) {
       std::ostringstream oss;
-      oss << "All RTL lines for key `" << key << "' are identical.";
+      oss << "All RTL lines for key `" << rtl_begin->get_loc_name()
+          << "' are identical.";
       *err_desc = oss.str();
       return false;
     }
   }
 
-  if (!(rtl_lines.back() == iss_lines.back())) {
+  if (!(rtl_end[-1] == iss_end[-1])) {
     std::ostringstream oss;
-    oss << "Final values of ISS and RTL don't match for key `" << key << "'.";
+    oss << "Final values of ISS and RTL don't match for key `"
+        << rtl_begin->get_loc_name() << "'.";
     *err_desc = oss.str();
     return false;
   }
@@ -294,13 +602,33 @@ OtbnTraceEntry::trace_type_t OtbnTraceEntry::hdr_to_trace_type(
   }
 }
 
+bool OtbnIssTraceEntry::parse_special_line(const std::string &line) {
+  static const char prefix[] = "# @0x";
+  static const size_t prefix_len = sizeof prefix - 1;
+
+  if (line.size() < prefix_len + 10 ||
+      line.compare(0, prefix_len, prefix) != 0 ||
+      line.compare(prefix_len + 8, 2, ": ") != 0)
+    return false;
+
+  uint32_t addr = 0;
+  for (size_t i = prefix_len; i < prefix_len + 8; ++i) {
+    int digit = hex_digit(line[i]);
+    if (digit < 0)
+      return false;
+    addr = (addr << 4) | digit;
+  }
+
+  data_.insn_addr = addr;
+  data_.mnemonic.assign(line, prefix_len + 10, std::string::npos);
+  return true;
+}
+
 bool OtbnIssTraceEntry::from_iss_trace(const std::vector<std::string> &lines) {
   // Read FSM. state 0 = read header; state 1 = read mnemonic (for E
   // lines); state 2 = read writes
   int state = 0;
-
-  std::regex re("# @0x([0-9a-f]{8}): (.*)");
-  std::smatch match;
+  writes_.clear();
 
   for (const std::string &line : lines) {
     switch (state) {
@@ -318,15 +646,11 @@ bool OtbnIssTraceEntry::from_iss_trace(const std::vector<std::string> &lines) {
         //
         // where ADDR is an 8-digit instruction address (in hex) and mnemonic
         // is the string mnemonic.
-        if (!std::regex_match(line, match, re)) {
+        if (!parse_special_line(line)) {
           std::cerr << "Bad 'special' line for ISS trace with header `" << hdr_
                     << "': `" << line << "'.\n";
           return false;
         }
-        assert(match.size() == 3);
-        data_.insn_addr =
-            (uint32_t)strtoul(match[1].str().c_str(), nullptr, 16);
-        data_.mnemonic = match[2].str();
         state = 2;
         break;
 
@@ -340,7 +664,7 @@ bool OtbnIssTraceEntry::from_iss_trace(const std::vector<std::string> &lines) {
           if (!parsed_line.fill_from_string("ISS", line)) {
             return false;
           }
-          writes_[parsed_line.get_loc()].push_back(parsed_line);
+          add_write(parsed_line);
         }
         break;
       }
@@ -5,10 +5,11 @@
 #define OPENTITAN_HW_IP_OTBN_DV_MODEL_OTBN_TRACE_ENTRY_H_
 
 #include <cstdint>
-#include <map>
 #include <string>
 #include <vector>
 
+#include "otbn_trace_event.h"
+
 // This models a body line in an OTBN trace entry (type '<', '>', 'R' or 'W').
 // Each of these lines is of the format
 //
@@ -17,26 +18,65 @@
 // and we parse them accordingly here. The point is that we want to merge
 // successive writes to the same location and thus need to unpack things enough
 // to see them.
+//
+// Parsing is done with a hand-written tokenizer that doesn't allocate memory
+// for the common formats. The location is interned as a compact integer ID
+// (see loc_t) and the value is decoded into fixed-width words, together with a
+// mask of the nibbles that were traced as 'x' (unknown). Anything with an
+// unexpected format is kept as text, so no information is lost.
 class OtbnTraceBodyLine {
  public:
+  // The kind of location that is read or written. Named covers anything else
+  // (like MOD or ACC), using an index into a table of interned names.
+  enum loc_kind_t : uint8_t { Gpr, Wdr, Flags, Mem, Named };
+
+  // A location, packed as (kind << 32) | index. For Gpr and Wdr, the index is
+  // the register number. For Flags, it is the flag group. For Mem, it is the
+  // address.
+  typedef uint64_t loc_t;
+
   // Parse a line into this object, based on the format above. On success,
   // return true. On failure, write an error message to stderr (using src to
   // say where the line came from) and return false.
   bool fill_from_string(const std::string &src, const std::string &line);
+  bool fill_from_string(const std::string &src, const char *line, size_t len);
 
   bool operator==(const OtbnTraceBodyLine &other) const;
 
   // Return the location that is being read or written
-  const std::string &get_loc() const { return loc_; }
+  loc_t get_loc() const { return loc_; }
+  loc_kind_t get_loc_kind() const { return (loc_kind_t)(loc_ >> 32); }
+
+  // Return the location as it appeared in the trace
+  std::string get_loc_name() const;
 
-  // Return the original string format for the entry
-  const std::string &get_string() const { return raw_; }
+  // Return the entry in its original string format
+  std::string get_string() const;
 
  private:
-  std::string raw_;
+  // The format of a value. HexValue is something like 0x1234abcd, possibly
+  // with '_' separators every 8 digits. FlagsValue is something like
+  // {C: 0, M: 1, L: 0, Z: 0}. TextValue is anything else.
+  enum value_fmt_t : uint8_t { HexValue, FlagsValue, TextValue };
+
+  static const int kMaxWords = 8;
+
+  bool parse_loc(const char *str, size_t len);
+  bool parse_value(const char *str, size_t len);
+  void append_value(std::string *dst) const;
+
   char type_;
-  std::string loc_;
-  std::string value_;
+  value_fmt_t fmt_;
+  // For HexValue, whether there were '_' separators and the number of digits
+  bool grouped_;
+  uint8_t num_digits_;
+  loc_t loc_;
+  // The value, in LSB-first words. A bit in unknown_ is set if the
+  // corresponding bit of value_ was traced as 'x'.
+  uint32_t value_[kMaxWords];
+  uint32_t unknown_[kMaxWords];
+  // The value as text (only used for TextValue)
+  std::string text_;
 };
 
 class OtbnTraceEntry {
@@ -56,6 +96,10 @@ class OtbnTraceEntry {
   // message to stderr and return false.
   bool from_rtl_trace(const std::string &trace);
 
+  // Like from_rtl_trace, but use a trace that OtbnTraceSource has already
+  // split up.
+  bool from_rtl_event(const OtbnTraceEvent &event);
+
   bool compare_rtl_iss_entries(const OtbnTraceEntry &other,
                                bool no_sec_wipe_data_chk,
                                std::string *err_desc) const;
@@ -77,18 +121,24 @@ class OtbnTraceEntry {
   bool is_final() const;
 
  protected:
-  static bool check_entries_compatible(
-      trace_type_t type, const std::string &key,
-      const std::vector<OtbnTraceBodyLine> &rtl_lines,
-      const std::vector<OtbnTraceBodyLine> &iss_lines,
-      bool no_sec_wipe_data_chk, std::string *err_desc);
+  static bool check_entries_compatible(trace_type_t type,
+                                       const OtbnTraceBodyLine *rtl_begin,
+                                       const OtbnTraceBodyLine *rtl_end,
+                                       const OtbnTraceBodyLine *iss_begin,
+                                       const OtbnTraceBodyLine *iss_end,
+                                       bool no_sec_wipe_data_chk,
+                                       std::string *err_desc);
 
   static trace_type_t hdr_to_trace_type(const std::string &hdr);
 
+  // Add a register write to writes_
+  void add_write(const OtbnTraceBodyLine &line);
+
   trace_type_t trace_type_;
   std::string hdr_;
-  // The register writes for this trace entry, keyed by destination
-  std::map<std::string, std::vector<OtbnTraceBodyLine>> writes_;
+  // The register writes for this trace entry. These are sorted by location
+  // and writes to the same location are kept in the order they happened.
+  std::vector<OtbnTraceBodyLine> writes_;
 };
 
 class OtbnIssTraceEntry : public OtbnTraceEntry {
@@ -102,6 +152,11 @@ class OtbnIssTraceEntry : public OtbnTraceEntry {
   };
 
   IssData data_;
+
+ private:
+  // Parse the "special" line that follows the header for an instruction,
+  // filling in data_. Returns false if the line has the wrong format.
+  bool parse_special_line(const std::string &line);
 };
 
 #endif  // OPENTITAN_HW_IP_OTBN_DV_MODEL_OTBN_TRACE_ENTRY_H_
@@ -0,0 +1,77 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+#ifndef OPENTITAN_HW_IP_OTBN_DV_MODEL_SPSC_QUEUE_H_
+#define OPENTITAN_HW_IP_OTBN_DV_MODEL_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// A bounded, lock-free queue that passes items from a single producer thread
+// to a single consumer thread.
+//
+// Only the producer may call try_push and only the consumer may call try_pop.
+// The other methods may be called from either thread, but their answers might
+// be out of date by the time the caller sees them.
+template <typename T>
+class SpscQueue {
+ public:
+  // Make an empty queue with space for capacity items
+  explicit SpscQueue(size_t capacity)
+      : slots_(capacity + 1), head_(0), tail_(0) {}
+
+  // Append item to the queue. Returns false (and leaves item alone) if the
+  // queue is full.
+  bool try_push(T &&item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = advance(tail);
+    if (next == head_.load(std::memory_order_acquire))
+      return false;
+
+    slots_[tail] = std::move(item);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Remove the item at the front of the queue, moving it to *dst. Returns
+  // false if the queue is empty.
+  bool try_pop(T *dst) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+
+    *dst = std::move(slots_[head]);
+    head_.store(advance(head), std::memory_order_release);
+    return true;
+  }
+
+  // The number of items in the queue
+  size_t size() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : tail + slots_.size() - head;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  // The maximum number of items that the queue can hold
+  size_t capacity() const { return slots_.size() - 1; }
+
+ private:
+  size_t advance(size_t idx) const {
+    return idx + 1 == slots_.size() ? 0 : idx + 1;
+  }
+
+  // A ring buffer of items. There is always at least one empty slot, so that
+  // head_ == tail_ means the queue is empty rather than full.
+  std::vector<T> slots_;
+
+  // The index of the front of the queue (written by the consumer) and of the
+  // first empty slot (written by the producer).
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_MODEL_SPSC_QUEUE_H_
@@ -0,0 +1,368 @@
+#!/usr/bin/env python3
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''A fork server that starts stepped.py processes on demand
+
+Starting stepped.py costs a Python interpreter startup, plus importing the
+simulator and reading the instruction tables and the OTBN register description.
+When OTBN_ISS_FORK_SERVER is set to the path of a Unix socket, ISSWrapper asks
+a server listening there for its ISS instead. The server pays the startup cost
+once and then forks a child for each request, which runs the main loop of
+stepped.py. If there is no server, ISSWrapper starts one, which then outlives
+the simulation so that later simulations can use it too.
+
+A client connects to the socket, sends a single request and then shuts down
+its side of the connection for writing. The request data is a sequence of
+NUL-terminated strings:
+
+  - the path to stepped.py that the client expects (which must match the one
+    that the server imported),
+
+  - the source key that the client computed (see _source_key),
+
+  - the client's working directory,
+
+  - the number of environment variables, in decimal, followed by that many
+    NAME=VALUE strings, which become the child's environment,
+
+  - the arguments to pass to stepped.py.
+
+The first part of the request carries four file descriptors as SCM_RIGHTS
+ancillary data: the child's stdin, stdout and stderr and then the memory that
+is shared with ISSWrapper (see sim/shared_mem.py). The server adds the
+--shared-mem argument itself.
+
+The server replies with a line of text, which is "OK <pid>" (giving the PID of
+the child), "STALE" or "ERROR <message>", and then closes the connection. The
+child exits when it sees EOF on stdin.
+
+The source key is a CRC-32 of the simulator's Python sources and the OTBN data
+files, as they were when the server started. If the client's key doesn't match,
+the files have changed since then and the server would fork children that run
+the old version of the simulator. Rather than do that, the server stops
+listening, replies "STALE" and exits, so that the client can start a new one.
+
+Only one server listens on a given socket: the server holds a lock on a file
+next to the socket (with a .lock suffix) for as long as it runs and exits
+immediately if another server has it. The socket is only accessible by the
+user that started the server, since a child runs commands (such as dump_d) that
+write files with that user's permissions. A server also exits once it has been
+idle for --idle-timeout seconds.
+
+'''
+
+import argparse
+import array
+import fcntl
+import os
+import signal
+import socket
+import struct
+import sys
+import traceback
+import zlib
+from typing import Dict, List, Optional, Tuple
+
+import stepped
+from sim.sim import OTBNSim
+
+# The number of file descriptors that a client sends with a request
+_NUM_FDS = 4
+
+# The maximum length of the data in a request. This is mostly the client's
+# environment.
+_MAX_REQUEST_LEN = 1 << 20
+
+# The files that go into the source key, as pairs of a directory (relative to
+# the directory that contains stepped.py) and the suffixes of the files to
+# include from it. This must match kSourceKeyDirs in iss_wrapper.cc.
+_SOURCE_KEY_DIRS = [
+    ('.', ('.py',)),
+    ('sim', ('.py',)),
+    ('../../util/shared', ('.py',)),
+    ('../../data', ('.yml', '.hjson')),
+]
+
+
+def _source_key(model_dir: str) -> str:
+    '''Compute the source key for the simulator in model_dir
+
+    This is a CRC-32 (as 8 hex digits) of the name and contents of each file
+    listed by _SOURCE_KEY_DIRS, in order and sorted by name within each
+    directory, with a NUL after each name and after each file's contents.
+
+    '''
+    crc = 0
+    for rel_dir, suffixes in _SOURCE_KEY_DIRS:
+        dir_path = os.path.join(model_dir, rel_dir)
+        for name in sorted(os.listdir(dir_path)):
+            path = os.path.join(dir_path, name)
+            if not name.endswith(suffixes) or not os.path.isfile(path):
+                continue
+            with open(path, 'rb') as handle:
+                contents = handle.read()
+            crc = zlib.crc32(name.encode('utf-8') + b'\0', crc)
+            crc = zlib.crc32(contents + b'\0', crc)
+    return '{:08x}'.format(crc)
+
+
+def _close_inherited_fds() -> None:
+    '''Close any file descriptors, other than stdio, that we inherited
+
+    The server outlives the process that started it, so it mustn't keep that
+    process's pipes or files open.
+
+    '''
+    fd_dir = '/proc/self/fd' if os.path.isdir('/proc/self/fd') else '/dev/fd'
+    for name in os.listdir(fd_dir):
+        fd = int(name)
+        if fd > 2:
+            try:
+                os.close(fd)
+            except OSError:
+                # This is probably the fd for fd_dir, which listdir will have
+                # closed already.
+                pass
+
+
+def _check_peer(conn: socket.socket) -> None:
+    '''Check that the client is running as the same user as us
+
+    The socket's permissions should already stop other users from connecting,
+    but not every platform applies them to Unix sockets. Where the platform
+    tells us the client's credentials, check them too.
+
+    '''
+    if not hasattr(socket, 'SO_PEERCRED'):
+        return
+    creds = conn.getsockopt(socket.SOL_SOCKET, socket.SO_PEERCRED,
+                            struct.calcsize('3i'))
+    _, uid, _ = struct.unpack('3i', creds)
+    if uid != os.getuid():
+        raise PermissionError(f'Request from another user (UID {uid}).')
+
+
+def _read_request(conn: socket.socket) -> Tuple[List[str], List[int]]:
+    '''Read a request, returning its strings and file descriptors'''
+    fds = array.array('i')
+    data, ancdata, _, _ = conn.recvmsg(
+        _MAX_REQUEST_LEN, socket.CMSG_SPACE(_NUM_FDS * fds.itemsize))
+    for level, kind, cmsg_data in ancdata:
+        if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+            whole_len = len(cmsg_data) - (len(cmsg_data) % fds.itemsize)
+            fds.frombytes(cmsg_data[:whole_len])
+
+    # The file descriptors come with the first part of the data. Read the rest
+    # until the client shuts down its side of the connection.
+    while data:
+        chunk = conn.recv(_MAX_REQUEST_LEN)
+        if not chunk:
+            break
+        data += chunk
+        if len(data) > _MAX_REQUEST_LEN:
+            for fd in fds:
+                os.close(fd)
+            raise ValueError('Request is too long.')
+
+    strings = data.split(b'\0')
+    if strings[-1]:
+        raise ValueError('Request data is not NUL-terminated.')
+    return ([s.decode('utf-8') for s in strings[:-1]], list(fds))
+
+
+def _parse_env(strings: List[str]) -> Tuple[Dict[str, str], List[str]]:
+    '''Parse the environment at the start of strings
+
+    Returns the environment and the strings that follow it.
+
+    '''
+    if not strings or not strings[0].isdigit():
+        raise ValueError('Malformed request: no environment size.')
+    num_vars = int(strings[0])
+    if len(strings) < 1 + num_vars:
+        raise ValueError('Malformed request: environment is truncated.')
+
+    env = {}
+    for item in strings[1:1 + num_vars]:
+        name, sep, value = item.partition('=')
+        if not sep:
+            raise ValueError(f'Malformed environment variable: {item!r}.')
+        env[name] = value
+    return (env, strings[1 + num_vars:])
+
+
+def _run_child(fds: List[int], cwd: str, env: Dict[str, str],
+               args: List[str]) -> int:
+    '''Set up a forked child and run stepped.py's main loop'''
+    signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+
+    for idx in range(3):
+        os.dup2(fds[idx], idx)
+        os.close(fds[idx])
+
+    os.chdir(cwd)
+    os.environ.clear()
+    os.environ.update(env)
+    return stepped.main(args + ['--shared-mem', str(fds[3])])
+
+
+class _StaleServer(Exception):
+    '''Raised by _serve_one if a client's source key doesn't match ours'''
+
+
+def _serve_one(listener: socket.socket, lock_fd: int, conn: socket.socket,
+               model_path: str, source_key: str) -> None:
+    '''Handle a single request on conn
+
+    Raises _StaleServer if the request had a different source key, after
+    replying to the client.
+
+    '''
+    fds = []  # type: List[int]
+    try:
+        _check_peer(conn)
+        strings, fds = _read_request(conn)
+        if not strings:
+            # A connection that sends nothing (somebody checking whether we
+            # are alive). Ignore it.
+            return
+        if len(fds) != _NUM_FDS or len(strings) < 4:
+            raise ValueError(f'Malformed request: {len(strings)} strings and '
+                             f'{len(fds)} file descriptors.')
+        if strings[0] != model_path:
+            raise ValueError(f'This server runs {model_path}, not '
+                             f'{strings[0]}.')
+        env, args = _parse_env(strings[3:])
+
+        if strings[1] != source_key:
+            # Stop listening before replying, so that the client can start a
+            # new server as soon as it sees the reply.
+            os.unlink(listener.getsockname())
+            listener.close()
+            os.close(lock_fd)
+            conn.sendall(b'STALE\n')
+            raise _StaleServer()
+
+        pid = os.fork()
+        if pid == 0:
+            # We are the child. Drop the server's sockets and lock before
+            # doing anything else.
+            code = 1
+            try:
+                listener.close()
+                conn.close()
+                os.close(lock_fd)
+                code = _run_child(fds, strings[2], env, args)
+            except BaseException:
+                traceback.print_exc()
+            finally:
+                os._exit(code)
+
+        conn.sendall(f'OK {pid}\n'.encode('utf-8'))
+
+    except _StaleServer:
+        raise
+
+    except Exception as err:
+        try:
+            conn.sendall(f'ERROR {err}\n'.encode('utf-8'))
+        except OSError:
+            # The client has gone away, so there's nobody to tell.
+            pass
+
+    finally:
+        for fd in fds:
+            os.close(fd)
+        conn.close()
+
+
+def _take_lock(lock_path: str) -> Optional[int]:
+    '''Take an exclusive lock on lock_path
+
+    Returns the locked file descriptor or None if some other process holds
+    the lock.
+
+    '''
+    fd = os.open(lock_path, os.O_RDWR | os.O_CREAT, 0o600)
+    try:
+        fcntl.flock(fd, fcntl.LOCK_EX | fcntl.LOCK_NB)
+    except BlockingIOError:
+        os.close(fd)
+        return None
+    return fd
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--socket', required=True,
+                        help='The path of the Unix socket to listen on.')
+    parser.add_argument('--idle-timeout', type=float, default=3600,
+                        help=('Exit after this many seconds without a '
+                              'request (default: 3600).'))
+    args = parser.parse_args()
+
+    _close_inherited_fds()
+
+    lock_fd = _take_lock(args.socket + '.lock')
+    if lock_fd is None:
+        # Another server is running already
+        return 0
+
+    # Now that we hold the lock, anything at the socket path is left over
+    # from an old server.
+    if os.path.exists(args.socket):
+        os.unlink(args.socket)
+
+    # Only our own user may connect to the socket. Create it with a umask
+    # that makes it so (there's no window where another user could connect)
+    # and then drop the execute bit, which means nothing for a socket.
+    listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    old_umask = os.umask(0o077)
+    try:
+        listener.bind(args.socket)
+    finally:
+        os.umask(old_umask)
+    os.chmod(args.socket, 0o600)
+    listener.listen(64)
+
+    # Do the expensive initialisation that every child would otherwise have to
+    # do. Constructing a simulator reads the instruction tables and the memory
+    # layout. Compute the source key first, so that a file that changes while
+    # we import the simulator makes us look stale, rather than up to date.
+    model_path = os.path.realpath(stepped.__file__)
+    source_key = _source_key(os.path.dirname(model_path))
+    OTBNSim()
+
+    # Children exit when their clients go away. Let the kernel reap them.
+    signal.signal(signal.SIGCHLD, signal.SIG_IGN)
+
+    listener.settimeout(args.idle_timeout)
+    try:
+        while True:
+            try:
+                conn, _ = listener.accept()
+            except socket.timeout:
+                break
+            # Don't let a client that stalls part way through a request hang
+            # the server.
+            conn.settimeout(10)
+            _serve_one(listener, lock_fd, conn, model_path, source_key)
+    except _StaleServer:
+        # _serve_one has already removed the socket, closed the listener and
+        # dropped the lock. A new server might be starting up, so leave the
+        # socket path alone.
+        print('Simulator sources have changed. Exiting.')
+        return 0
+    finally:
+        if listener.fileno() != -1:
+            os.unlink(args.socket)
+            listener.close()
+            os.close(lock_fd)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
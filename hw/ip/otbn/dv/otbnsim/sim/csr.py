@@ -2,7 +2,7 @@
 # Licensed under the Apache License, Version 2.0, see LICENSE for details.
 # SPDX-License-Identifier: Apache-2.0
 
-from .flags import FlagGroups
+from .flags import FlagGroups, VecFlagGroups
 from .wsr import WSRFile
 
 
@@ -10,10 +10,13 @@ class CSRFile:
     '''A model of the CSR file'''
     def __init__(self) -> None:
         self.flags = FlagGroups()
+        self.vec_flags = VecFlagGroups()
 
         self._known_indices = set()
         self._known_indices.add(0x7c0)  # FG0
         self._known_indices.add(0x7c1)  # FG1
+        for idx in range(0x7c2, 0x7c6):
+            self._known_indices.add(idx)  # VFGi_CM, VFGi_LZ
         self._known_indices.add(0x7c8)  # FLAGS
         for idx in range(0x7d0, 0x7d8):
             self._known_indices.add(idx)  # MODi
@@ -44,6 +47,12 @@ class CSRFile:
             fg = idx - 0x7c0
             return self._get_field(fg, 4, self.flags.read_unsigned())
 
+        if 0x7c2 <= idx <= 0x7c5:
+            # VFG0_CM, VFG0_LZ, VFG1_CM, VFG1_LZ. Each vector flag group is
+            # 64 bits, split into two CSRs.
+            vfg, half = divmod(idx - 0x7c2, 2)
+            return self._get_field(half, 32, self.vec_flags.read_unsigned(vfg))
+
         if idx == 0x7c8:
             # FLAGS register
             return self.flags.read_unsigned()
@@ -77,6 +86,14 @@ class CSRFile:
             self.flags.write_unsigned(self._set_field(fg, 4, value & 0xf, old))
             return
 
+        if 0x7c2 <= idx <= 0x7c5:
+            # VFG0_CM, VFG0_LZ, VFG1_CM, VFG1_LZ
+            vfg, half = divmod(idx - 0x7c2, 2)
+            old = self.vec_flags.read_unsigned(vfg)
+            new = self._set_field(half, 32, value, old)
+            self.vec_flags.write_unsigned(vfg, new)
+            return
+
         if idx == 0x7c8:
             # FLAGS register
             self.flags.write_unsigned(value)
@@ -106,3 +123,5 @@ class CSRFile:
 
     def wipe(self) -> None:
         self.flags.write_unsigned(0)
+        for vfg in range(2):
+            self.vec_flags.write_unsigned(vfg, 0)
@@ -93,24 +93,30 @@ def decode_words(base_addr: int,
     return ret
 
 
-def decode_file(base_addr: int, path: str) -> List[OTBNInsn]:
-    with open(path, 'rb') as handle:
-        raw_bytes = handle.read()
-
+def decode_bytes(base_addr: int, raw_bytes: bytes,
+                 src: str) -> List[OTBNInsn]:
+    '''Decode instructions from raw_bytes, which came from src'''
     # Each 32-bit word is represented by a 5 bytes, consisting of a validity
     # byte (0 or 1) followed by 4 bytes for the word itself.
     if len(raw_bytes) % 5:
         raise ValueError('Trying to load {} bytes of data from {}, '
                          'which is not a multiple of 5.'
-                         .format(path, len(raw_bytes)))
+                         .format(len(raw_bytes), src))
 
     data = []
     for idx32, (vld, u32) in enumerate(struct.iter_unpack('<BI', raw_bytes)):
         if vld not in [0, 1]:
             raise ValueError('The validity byte for 32-bit word {} '
                              'at {} is {}, not 0 or 1.'
-                             .format(idx32, path, vld))
+                             .format(idx32, src, vld))
 
         data.append((vld == 1, u32))
 
     return decode_words(base_addr, data)
+
+
+def decode_file(base_addr: int, path: str) -> List[OTBNInsn]:
+    with open(path, 'rb') as handle:
+        raw_bytes = handle.read()
+
+    return decode_bytes(base_addr, raw_bytes, path)
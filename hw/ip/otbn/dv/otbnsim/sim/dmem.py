@@ -3,7 +3,7 @@
 # SPDX-License-Identifier: Apache-2.0
 
 import struct
-from typing import Dict, List, Sequence, Optional
+from typing import Dict, List, Sequence, Optional, Set, Tuple
 
 from shared.mem_layout import get_memory_layout
 
@@ -66,6 +66,13 @@ class Dmem:
         self.trace = []  # type: List[TraceDmemStore]
         self.pending = {}  # type: Dict[int, int]
 
+        # The indices of the 32-bit words that might have changed since the
+        # contents of DMEM were last passed to or from ISSWrapper through
+        # shared memory (see mark_clean and take_dirty). This lets the model
+        # only compare the words that have been written. Initially, we don't
+        # know what ISSWrapper has, so every word is dirty.
+        self.dirty = set(range(num_words))  # type: Set[int]
+
     def _load_5byte_le_words(self, data: bytes) -> None:
         '''Replace the start of memory with data
 
@@ -98,6 +105,7 @@ class Dmem:
                                  'in the input data is {}, not 0 or 1.'
                                  .format(idx32, vld))
             self.data[idx32] = u32 if vld else None
+            self.dirty.add(idx32)
 
     def _load_4byte_le_words(self, data: bytes) -> None:
         '''Replace the start of memory with data
@@ -117,6 +125,7 @@ class Dmem:
 
         for idx32, u32 in enumerate(struct.iter_unpack('<I', data)):
             self.data[idx32] = u32[0]
+            self.dirty.add(idx32)
 
     def load_le_words(self, data: bytes, has_validity: bool) -> None:
         '''Replace the start of memory with data
@@ -236,10 +245,12 @@ class Dmem:
             for i in range(256 // 32):
                 wr_data = (item.value >> (i * 32)) & mask
                 self.pending[(item.addr // 4) + i] = wr_data
+                self.dirty.add((item.addr // 4) + i)
 
         else:
             assert 0 <= item.value <= (1 << 32) - 1
             self.pending[item.addr // 4] = item.value
+            self.dirty.add(item.addr // 4)
 
     def commit(self) -> None:
         # Move items from self.pending to self.data
@@ -257,3 +268,27 @@ class Dmem:
 
     def empty_dmem(self) -> None:
         self.data = [None] * len(self.data)
+        self.dirty = set(range(len(self.data)))
+
+    def mark_clean(self) -> None:
+        '''Mark every word as clean
+
+        This should be called when ISSWrapper has just seen the whole of DMEM
+        (after loading it from or dumping it to shared memory).
+
+        '''
+        self.dirty = set()
+
+    def take_dirty(self) -> List[Tuple[int, Optional[int]]]:
+        '''Return the dirty words and then mark every word as clean
+
+        Each item in the list is a pair (idx, value) where idx is the index of
+        a 32-bit word and value is its contents, as would be seen by
+        dump_le_words (None if the word is invalid). The list is sorted by
+        index.
+
+        '''
+        ret = [(idx, self.pending.get(idx, self.data[idx]))
+               for idx in sorted(self.dirty)]
+        self.dirty = set()
+        return ret
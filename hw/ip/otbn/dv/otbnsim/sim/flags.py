@@ -90,6 +90,19 @@ class FlagReg:
         Z = bool(result == 0)
         return FlagReg(C=C, M=M, L=L, Z=Z)
 
+    @staticmethod
+    def mlz_for_elem(C: bool, result: int, size: int) -> 'FlagReg':
+        '''Generate flags for one element of a vector operation.
+
+        This is like mlz_for_result, but M is taken from bit size - 1 of the
+        result, which is an element of size bits.
+
+        '''
+        M = bool((result >> (size - 1)) & 1)
+        L = bool(result & 1)
+        Z = bool(result == 0)
+        return FlagReg(C=C, M=M, L=L, Z=Z)
+
     @staticmethod
     def from_bits(value: int) -> 'FlagReg':
         assert 0 <= value
@@ -151,3 +164,122 @@ class FlagGroups:
         self._dirty = True
         self._groups[0].write_unsigned((value >> 0) & mask4)
         self._groups[1].write_unsigned((value >> 4) & mask4)
+
+
+class TraceVecFlags(Trace):
+    def __init__(self, group: int, value: 'VecFlagReg'):
+        self.group = group
+        self.value = value
+
+    def trace(self) -> str:
+        return ('vfg{} = {{C: {:#06x}, M: {:#06x}, L: {:#06x}, Z: {:#06x}}}'
+                .format(self.group,
+                        self.value.C, self.value.M,
+                        self.value.L, self.value.Z))
+
+
+class VecFlagReg:
+    '''A vector flag group
+
+    Each flag is a mask with one bit per vector lane: bit i of C is the carry
+    flag of lane i. There are at most 16 lanes (for .16H). With fewer lanes,
+    the upper bits of each mask are zero.
+
+    '''
+    NUM_LANES = 16
+    LANE_MASK = (1 << NUM_LANES) - 1
+
+    def __init__(self, C: int, M: int, L: int, Z: int):
+        for mask in [C, M, L, Z]:
+            assert 0 <= mask <= VecFlagReg.LANE_MASK
+        self.C = C
+        self.M = M
+        self.L = L
+        self.Z = Z
+
+        self._new_val = None  # type: Optional['VecFlagReg']
+
+    def set_flags(self, other: 'VecFlagReg') -> None:
+        self._new_val = other
+
+    def get_by_idx(self, flag_idx: int) -> int:
+        '''Return the lane mask for a flag (with indices as in FlagReg)'''
+        assert 0 <= flag_idx <= 3
+        return cast(int, getattr(self, FlagReg.FLAG_NAMES[flag_idx]))
+
+    def changes(self, group: int) -> List[TraceVecFlags]:
+        return ([] if self._new_val is None
+                else [TraceVecFlags(group, self._new_val)])
+
+    def commit(self) -> None:
+        if self._new_val is not None:
+            for n in FlagReg.FLAG_NAMES:
+                setattr(self, n, getattr(self._new_val, n))
+        self._new_val = None
+
+    def abort(self) -> None:
+        self._new_val = None
+
+    def read_unsigned(self) -> int:
+        '''Return a 64-bit number with the masks as ZLMC (C at the bottom)'''
+        return ((self.Z << 48) | (self.L << 32) | (self.M << 16) | self.C)
+
+    @staticmethod
+    def from_bits(value: int) -> 'VecFlagReg':
+        assert 0 <= value
+        mask = VecFlagReg.LANE_MASK
+        return VecFlagReg(C=(value >> 0) & mask,
+                          M=(value >> 16) & mask,
+                          L=(value >> 32) & mask,
+                          Z=(value >> 48) & mask)
+
+    @staticmethod
+    def for_lanes(lane_flags: List[FlagReg]) -> 'VecFlagReg':
+        '''Collect the flags for each lane, with lane 0 first'''
+        assert len(lane_flags) <= VecFlagReg.NUM_LANES
+        masks = [0, 0, 0, 0]
+        for lane, flags in enumerate(lane_flags):
+            for idx in range(4):
+                masks[idx] |= int(flags.get_by_idx(idx)) << lane
+        return VecFlagReg(*masks)
+
+
+class VecFlagGroups:
+    '''The two vector flag groups, used by the vector instructions'''
+    def __init__(self) -> None:
+        self._groups = {0: VecFlagReg(0, 0, 0, 0),
+                        1: VecFlagReg(0, 0, 0, 0)}
+        # Have any flags changed?
+        self._dirty = False
+
+    def __getitem__(self, key: int) -> VecFlagReg:
+        assert 0 <= key <= 1
+        return self._groups[key]
+
+    def __setitem__(self, key: int, value: VecFlagReg) -> None:
+        assert 0 <= key <= 1
+        self._dirty = True
+        self._groups[key].set_flags(value)
+
+    def changes(self) -> List[TraceVecFlags]:
+        return self._groups[0].changes(0) + self._groups[1].changes(1)
+
+    def commit(self) -> None:
+        if self._dirty:
+            self._groups[0].commit()
+            self._groups[1].commit()
+        self._dirty = False
+
+    def abort(self) -> None:
+        if self._dirty:
+            self._groups[0].abort()
+            self._groups[1].abort()
+        self._dirty = False
+
+    def read_unsigned(self, group: int) -> int:
+        '''Return a vector flag group as a 64-bit value (see VecFlagReg)'''
+        return self[group].read_unsigned()
+
+    def write_unsigned(self, group: int, value: int) -> None:
+        '''Set a vector flag group from a 64-bit value (see VecFlagReg)'''
+        self[group] = VecFlagReg.from_bits(value)
@@ -5,12 +5,14 @@
 from typing import Dict, Iterator, Optional
 
 from .constants import ErrBits
-from .flags import FlagReg
+from .flags import FlagReg, VecFlagReg
 from .isa import (OTBNInsn, RV32RegReg, RV32RegImm,
                   RV32ImmShift, insn_for_mnemonic, logical_byte_shift,
                   extract_quarter_word,
                   extract_simd_element_size,
                   extract_sub_word,
+                  extract_vec_mod,
+                  montgomery_mul,
                   # extract_sub_word_signed,
                   logical_bit_shift,
                   # from_2s_complement_sized,
@@ -1291,23 +1293,27 @@ class BNADDV(OTBNInsn):
         self.vec_flag_group = op_vals['vec_flag_group']
 
     def execute(self, state: OTBNState) -> None:
-        # Flag groups are not implemented!
         vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
         result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
             elem_b = extract_sub_word(vec_b, size, elem)
 
             elem_c = elem_a + elem_b
+            carry = bool(elem_c >> size)
 
             elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
         state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
 
 
 class BNADDVM(OTBNInsn):
@@ -1322,27 +1328,100 @@ class BNADDVM(OTBNInsn):
         self.vec_flag_group = op_vals['vec_flag_group']
 
     def execute(self, state: OTBNState) -> None:
-        # Flag groups are not implemented!
         vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
         result = 0
-        mod_val = state.wsrs.MOD.read_unsigned()  # CHECK: do only extract size bits?
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        mod_val, _ = extract_vec_mod(state.wsrs.MOD.read_unsigned(), size)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
             elem_b = extract_sub_word(vec_b, size, elem)
 
             elem_c = elem_a + elem_b
 
-            if elem_c >= mod_val:
+            carry = elem_c >= mod_val
+            if carry:
                 elem_c -= mod_val
 
             elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
         state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
+
+
+class BNADDVC(OTBNInsn):
+    insn = insn_for_mnemonic('bn.addvc', 5)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.wrd = op_vals['wrd']
+        self.wrs1 = op_vals['wrs1']
+        self.wrs2 = op_vals['wrs2']
+        self.datatype = op_vals['datatype']
+        self.vec_flag_group = op_vals['vec_flag_group']
+
+    def execute(self, state: OTBNState) -> None:
+        vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
+        vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+        carry_in = state.csrs.vec_flags[self.vec_flag_group].C
+
+        result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+            elem_b = extract_sub_word(vec_b, size, elem)
+
+            elem_c = elem_a + elem_b + ((carry_in >> elem) & 1)
+            carry = bool(elem_c >> size)
+
+            elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
+            result = (result << size) | elem_c
+
+        result = result & ((1 << 256) - 1)
+        state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
+
+
+class BNADDVI(OTBNInsn):
+    insn = insn_for_mnemonic('bn.addvi', 5)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.wrd = op_vals['wrd']
+        self.wrs = op_vals['wrs']
+        self.imm = op_vals['imm']
+        self.datatype = op_vals['datatype']
+        self.vec_flag_group = op_vals['vec_flag_group']
+
+    def execute(self, state: OTBNState) -> None:
+        vec_a = state.wdrs.get_reg(self.wrs).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+
+        result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+
+            elem_c = elem_a + self.imm
+            carry = bool(elem_c >> size)
+
+            elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
+            result = (result << size) | elem_c
+
+        result = result & ((1 << 256) - 1)
+        state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
 
 
 class BNSUBV(OTBNInsn):
@@ -1357,23 +1436,27 @@ class BNSUBV(OTBNInsn):
         self.vec_flag_group = op_vals['vec_flag_group']
 
     def execute(self, state: OTBNState) -> None:
-        # Flag groups are not implemented!
         vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
         result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
             elem_b = extract_sub_word(vec_b, size, elem)
 
             elem_c = elem_a - elem_b
+            carry = bool(elem_c < 0)
 
             elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
         state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
 
 
 class BNSUBVM(OTBNInsn):
@@ -1388,27 +1471,100 @@ class BNSUBVM(OTBNInsn):
         self.vec_flag_group = op_vals['vec_flag_group']
 
     def execute(self, state: OTBNState) -> None:
-        # Flag groups are not implemented!
         vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
         result = 0
-        mod_val = state.wsrs.MOD.read_unsigned()  # CHECK: do only extract size bits?
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        mod_val, _ = extract_vec_mod(state.wsrs.MOD.read_unsigned(), size)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
             elem_b = extract_sub_word(vec_b, size, elem)
 
             elem_c = elem_a - elem_b
 
-            if elem_c < 0:
+            carry = elem_c < 0
+            if carry:
                 elem_c += mod_val
 
             elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
+            result = (result << size) | elem_c
+
+        result = result & ((1 << 256) - 1)
+        state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
+
+
+class BNSUBVC(OTBNInsn):
+    insn = insn_for_mnemonic('bn.subvc', 5)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.wrd = op_vals['wrd']
+        self.wrs1 = op_vals['wrs1']
+        self.wrs2 = op_vals['wrs2']
+        self.datatype = op_vals['datatype']
+        self.vec_flag_group = op_vals['vec_flag_group']
+
+    def execute(self, state: OTBNState) -> None:
+        vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
+        vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+        borrow_in = state.csrs.vec_flags[self.vec_flag_group].C
+
+        result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+            elem_b = extract_sub_word(vec_b, size, elem)
+
+            elem_c = elem_a - elem_b - ((borrow_in >> elem) & 1)
+            carry = bool(elem_c < 0)
+
+            elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
         state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
+
+
+class BNSUBVI(OTBNInsn):
+    insn = insn_for_mnemonic('bn.subvi', 5)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.wrd = op_vals['wrd']
+        self.wrs = op_vals['wrs']
+        self.imm = op_vals['imm']
+        self.datatype = op_vals['datatype']
+        self.vec_flag_group = op_vals['vec_flag_group']
+
+    def execute(self, state: OTBNState) -> None:
+        vec_a = state.wdrs.get_reg(self.wrs).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+
+        result = 0
+        lane_flags = [FlagReg(False, False, False, False)] * (256 // size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+
+            elem_c = elem_a - self.imm
+            carry = bool(elem_c < 0)
+
+            elem_c = elem_c & ((1 << size) - 1)
+            lane_flags[elem] = FlagReg.mlz_for_elem(carry, elem_c, size)
+            result = (result << size) | elem_c
+
+        result = result & ((1 << 256) - 1)
+        state.wdrs.get_reg(self.wrd).write_unsigned(result)
+        state.set_vec_flags(self.vec_flag_group,
+                            VecFlagReg.for_lanes(lane_flags))
 
 
 class BNMULV(OTBNInsn):
@@ -1459,7 +1615,9 @@ class BNMULVL(OTBNInsn):
 
         # TODO: match HW implementation regarding cycles
         result = 0
-        lane_elem = extract_sub_word(vec_b, size, self.lane)
+        # Only the bits of lane that index an element are used
+        lane = self.lane % (256 // size)
+        lane_elem = extract_sub_word(vec_b, size, lane)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
 
@@ -1487,19 +1645,13 @@ class BNMULVM(OTBNInsn):
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
-        # TODO: match HW implementation regarding cycles
         result = 0
-        mod_val = state.wsrs.MOD.read_unsigned()  # CHECK: do only extract size bits?
+        q, q_prime = extract_vec_mod(state.wsrs.MOD.read_unsigned(), size)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
             elem_b = extract_sub_word(vec_b, size, elem)
 
-            elem_c = elem_a * elem_b
-
-            # TODO: match HW implementation
-            elem_c = elem_c % mod_val
-
-            elem_c = elem_c & ((1 << size) - 1)
+            elem_c = montgomery_mul(elem_a, elem_b, q, q_prime, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
@@ -1522,25 +1674,125 @@ class BNMULVML(OTBNInsn):
         vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
         size = extract_simd_element_size(self.datatype)
 
-        # TODO: match HW implementation regarding cycles
         result = 0
-        mod_val = state.wsrs.MOD.read_unsigned()  # CHECK: do only extract size bits?
-        lane_elem = extract_sub_word(vec_b, size, self.lane)
+        q, q_prime = extract_vec_mod(state.wsrs.MOD.read_unsigned(), size)
+        # Only the bits of lane that index an element are used
+        lane = self.lane % (256 // size)
+        lane_elem = extract_sub_word(vec_b, size, lane)
         for elem in range(256 // size - 1, -1, -1):
             elem_a = extract_sub_word(vec_a, size, elem)
 
-            elem_c = elem_a * lane_elem
-
-            # TODO: match HW implementation
-            elem_c = elem_c % mod_val
-
-            elem_c = elem_c & ((1 << size) - 1)
+            elem_c = montgomery_mul(elem_a, lane_elem, q, q_prime, size)
             result = (result << size) | elem_c
 
         result = result & ((1 << 256) - 1)
         state.wdrs.get_reg(self.wrd).write_unsigned(result)
 
 
+class BNBFLYV(OTBNInsn):
+    insn = insn_for_mnemonic('bn.bflyv', 4)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.datatype = op_vals['datatype']
+        self.wra = op_vals['wra']
+        self.wrb = op_vals['wrb']
+        self.wrs = op_vals['wrs']
+
+    def execute(self, state: OTBNState) -> Optional[Iterator[None]]:
+        # The butterfly instructions write two WDRs. The register file has a
+        # single write port, so they take two cycles: wra is written on the
+        # first cycle and wrb on the second.
+        vec_a = state.wdrs.get_reg(self.wra).read_unsigned()
+        vec_b = state.wdrs.get_reg(self.wrb).read_unsigned()
+        vec_w = state.wdrs.get_reg(self.wrs).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+
+        result_a = 0
+        result_b = 0
+        mod_val, q_prime = extract_vec_mod(state.wsrs.MOD.read_unsigned(),
+                                           size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+            elem_b = extract_sub_word(vec_b, size, elem)
+            elem_w = extract_sub_word(vec_w, size, elem)
+
+            # Cooley-Tukey: a + w * b and a - w * b. Each step truncates its
+            # result like the bn.mulvm, bn.addvm or bn.subvm that it replaces.
+            elem_t = montgomery_mul(elem_b, elem_w, mod_val, q_prime, size)
+            elem_x = elem_a + elem_t
+            if elem_x >= mod_val:
+                elem_x -= mod_val
+            elem_y = elem_a - elem_t
+            if elem_y < 0:
+                elem_y += mod_val
+
+            elem_x = elem_x & ((1 << size) - 1)
+            elem_y = elem_y & ((1 << size) - 1)
+            result_a = (result_a << size) | elem_x
+            result_b = (result_b << size) | elem_y
+
+        state.wdrs.get_reg(self.wra).write_unsigned(result_a)
+
+        # Stall for a single cycle to write the second result
+        yield None
+
+        state.wdrs.get_reg(self.wrb).write_unsigned(result_b)
+        return None
+
+
+class BNIBFLYV(OTBNInsn):
+    insn = insn_for_mnemonic('bn.ibflyv', 4)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.datatype = op_vals['datatype']
+        self.wra = op_vals['wra']
+        self.wrb = op_vals['wrb']
+        self.wrs = op_vals['wrs']
+
+    def execute(self, state: OTBNState) -> Optional[Iterator[None]]:
+        # Like BN.BFLYV, this writes wra on the first cycle and wrb on the
+        # second.
+        vec_a = state.wdrs.get_reg(self.wra).read_unsigned()
+        vec_b = state.wdrs.get_reg(self.wrb).read_unsigned()
+        vec_w = state.wdrs.get_reg(self.wrs).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+
+        result_a = 0
+        result_b = 0
+        mod_val, q_prime = extract_vec_mod(state.wsrs.MOD.read_unsigned(),
+                                           size)
+        for elem in range(256 // size - 1, -1, -1):
+            elem_a = extract_sub_word(vec_a, size, elem)
+            elem_b = extract_sub_word(vec_b, size, elem)
+            elem_w = extract_sub_word(vec_w, size, elem)
+
+            # Gentleman-Sande: a + b and (a - b) * w. Each step truncates its
+            # result like the bn.addvm, bn.subvm or bn.mulvm that it replaces.
+            elem_x = elem_a + elem_b
+            if elem_x >= mod_val:
+                elem_x -= mod_val
+            elem_d = elem_a - elem_b
+            if elem_d < 0:
+                elem_d += mod_val
+            elem_d = elem_d & ((1 << size) - 1)
+            elem_y = montgomery_mul(elem_d, elem_w, mod_val, q_prime, size)
+
+            elem_x = elem_x & ((1 << size) - 1)
+            elem_y = elem_y & ((1 << size) - 1)
+            result_a = (result_a << size) | elem_x
+            result_b = (result_b << size) | elem_y
+
+        state.wdrs.get_reg(self.wra).write_unsigned(result_a)
+
+        # Stall for a single cycle to write the second result
+        yield None
+
+        state.wdrs.get_reg(self.wrb).write_unsigned(result_b)
+        return None
+
+
 class BNTRN1(OTBNInsn):
     insn = insn_for_mnemonic('bn.trn1', 4)
 
@@ -1619,6 +1871,34 @@ class BNSHV(OTBNInsn):
         state.wdrs.get_reg(self.wrd).write_unsigned(vec_c)
 
 
+class BNSELV(OTBNInsn):
+    insn = insn_for_mnemonic('bn.selv', 6)
+
+    def __init__(self, raw: int, op_vals: Dict[str, int]):
+        super().__init__(raw, op_vals)
+        self.datatype = op_vals['datatype']
+        self.wrd = op_vals['wrd']
+        self.wrs1 = op_vals['wrs1']
+        self.wrs2 = op_vals['wrs2']
+        self.vec_flag_group = op_vals['vec_flag_group']
+        self.flag = op_vals['flag']
+
+    def execute(self, state: OTBNState) -> None:
+        vec_a = state.wdrs.get_reg(self.wrs1).read_unsigned()
+        vec_b = state.wdrs.get_reg(self.wrs2).read_unsigned()
+        size = extract_simd_element_size(self.datatype)
+        lanes = state.csrs.vec_flags[self.vec_flag_group].get_by_idx(self.flag)
+
+        vec_c = 0
+        for elem in range(256 // size):
+            flag_is_set = (lanes >> elem) & 1
+            vec_src = vec_a if flag_is_set else vec_b
+            vec_c = vec_c | (extract_sub_word(vec_src, size, elem) <<
+                             (elem * size))
+
+        state.wdrs.get_reg(self.wrd).write_unsigned(vec_c)
+
+
 INSN_CLASSES = [
     ADD, ADDI, LUI, SUB, SLL, SLLI, SRL, SRLI, SRA, SRAI,
     AND, ANDI, OR, ORI, XOR, XORI,
@@ -1639,10 +1919,11 @@ INSN_CLASSES = [
     BNMOV, BNMOVR,
     BNWSRR, BNWSRW,
 
-    BNADDV, BNADDVM,  # forseen in ISA: BNADDVC, BNADDVI
-    BNSUBV, BNSUBVM,  # forseen in ISA: BNSUBVC, BNSUBVI
+    BNADDV, BNADDVM, BNADDVC, BNADDVI,
+    BNSUBV, BNSUBVM, BNSUBVC, BNSUBVI,
     BNMULV, BNMULVL,
     BNMULVM, BNMULVML,
+    BNBFLYV, BNIBFLYV,
     BNTRN1, BNTRN2,
-    BNSHV
+    BNSHV, BNSELV
 ]
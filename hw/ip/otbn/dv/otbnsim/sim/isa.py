@@ -192,7 +192,7 @@ def extract_sub_word(value: int, size: int, index: int) -> int:
     '''Extract a `size`-bit word at index `index` from a 256-bit value and
     interprets it as unsigned integer'''
     assert 0 <= value < (1 << 256)
-    assert 0 <= index <= 256 // size
+    assert 0 <= index < 256 // size
     return (value >> (index * size)) & ((1 << size) - 1)
 
 
@@ -241,3 +241,30 @@ def extract_simd_element_size(datatype: int) -> int:
             sys.stderr.write('The datatype ({}) for SIMD elements is '
                              'unkown!.\n'.format(datatype))
             sys.exit(1)
+
+
+def extract_vec_mod(mod: int, size: int) -> Tuple[int, int]:
+    '''Extract the modulus and Montgomery constant for `size`-bit elements
+
+    The vector modular instructions take the modulus q from MOD[size-1:0] and
+    the Montgomery constant q' = -q^-1 mod 2^size from MOD[2*size-1:size].
+    Returns the pair (q, q').'''
+    return (extract_sub_word(mod, size, 0), extract_sub_word(mod, size, 1))
+
+
+def montgomery_mul(a: int, b: int, q: int, q_prime: int, size: int) -> int:
+    '''Compute the Montgomery product of two `size`-bit elements
+
+    This is a * b * 2^-size mod q, computed as by bn.mulvm. With R = 2^size,
+    the product p = a * b is reduced to t = (p + m * q) / R, where
+    m = (p mod R) * q' mod R, and then q is subtracted once if t >= q. The
+    result is in [0, q) if a * b < q * R (which is the case if a and b are in
+    [0, q)). If q' is not -q^-1 mod R, the division rounds down. The result is
+    truncated to `size` bits.'''
+    mask = (1 << size) - 1
+    p = a * b
+    m = ((p & mask) * q_prime) & mask
+    t = (p + m * q) >> size
+    if t >= q:
+        t -= q
+    return t & mask
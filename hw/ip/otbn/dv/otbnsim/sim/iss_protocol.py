@@ -0,0 +1,359 @@
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Binary framing for the protocol between ISSWrapper and stepped.py
+
+By default, stepped.py reads one text command per line and writes text output,
+followed by a line containing just '.'. When run with --binary, commands and
+responses are sent as frames instead. The C++ side of this is in
+hw/ip/otbn/dv/model/iss_protocol.h, which must be kept in sync.
+
+Every frame (in either direction) is a 32-bit little-endian length, followed by
+that many bytes of payload. All integers in a payload are little-endian.
+
+The first frame that stepped.py sends in binary mode is a "hello" frame, whose
+payload is MAGIC followed by VERSION as a 16-bit integer.
+
+A command payload is a one-byte opcode (an index into COMMANDS, plus one),
+followed by the command's arguments. Each argument is either an unsigned
+integer of a fixed width in bytes, or a string (encoded as a 16-bit length
+followed by the UTF-8 bytes of the string).
+
+A response payload is a sequence of records, each of which starts with a
+one-byte record type:
+
+  REC_LINE              A 16-bit length, then a line of text (as would have
+                        been printed in text mode)
+
+  REC_EXT_REG           A one-byte register index (into EXT_REGS), then the
+                        new 32-bit value of that external register
+
+  REC_REGS              The 32 GPRs as 32-bit values, then the 32 WDRs as
+                        32-byte values
+
+  REC_CALL_STACK_ENTRY  A 32-bit entry in the call stack, starting from the
+                        bottom of the stack
+
+  REC_CYCLE_END         No data. Marks the end of the output for a cycle in
+                        the response to a run command
+
+'''
+
+import struct
+from typing import BinaryIO, List, Optional, Sequence, Tuple
+
+MAGIC = b'OTBN'
+VERSION = 5
+
+# A string argument for a command (as opposed to an integer with some number of
+# bytes)
+ARG_STR = 0
+
+# The commands understood by stepped.py, in opcode order. Each entry is the
+# command name and the list of its arguments. Each argument is either ARG_STR
+# or the width of an integer argument in bytes.
+COMMANDS = [
+    ('start_operation', [ARG_STR]),
+    ('step', []),
+    ('load_elf', [ARG_STR]),
+    ('add_loop_warp', [4, 4, 4]),
+    ('clear_loop_warps', []),
+    ('load_d', [ARG_STR]),
+    ('load_i', [ARG_STR]),
+    ('dump_d', [ARG_STR]),
+    ('print_regs', []),
+    ('print_call_stack', []),
+    ('reset', []),
+    ('edn_rnd_step', [4, 4]),
+    ('edn_urnd_step', [4]),
+    ('edn_rnd_cdc_done', []),
+    ('edn_urnd_cdc_done', []),
+    ('edn_flush', []),
+    ('invalidate_imem', []),
+    ('invalidate_dmem', []),
+    ('set_keymgr_value', [48, 48, 4]),
+    ('step_crc', [6, 4]),
+    ('send_err_escalation', [4, 4]),
+    ('set_rma_req', [4]),
+    ('initial_secure_wipe', []),
+    ('otp_key_cdc_done', []),
+    ('set_software_errs_fatal', [4]),
+    ('run', [4]),
+    ('load_d_shared', []),
+    ('load_i_shared', []),
+    ('dump_d_shared', []),
+    ('dump_d_dirty', []),
+    ('save_state', [ARG_STR]),
+    ('restore_state', [ARG_STR]),
+]  # type: List[Tuple[str, List[int]]]
+
+REC_LINE = 1
+REC_EXT_REG = 2
+REC_REGS = 3
+REC_CALL_STACK_ENTRY = 4
+REC_CYCLE_END = 5
+
+# The line that marks the end of a cycle in text mode
+CYCLE_END_LINE = 'END_CYCLE'
+
+# The external registers that can be reported with a REC_EXT_REG record.
+# Changes to any other register are sent as text in a REC_LINE record.
+EXT_REGS = [
+    'INTR_STATE',
+    'STATUS',
+    'ERR_BITS',
+    'INSN_CNT',
+    'STOP_PC',
+    'RND_REQ',
+    'WIPE_START',
+    'LOAD_CHECKSUM',
+]
+_EXT_REG_INDICES = {name: idx for idx, name in enumerate(EXT_REGS)}
+
+_U16 = struct.Struct('<H')
+_U32 = struct.Struct('<I')
+_EXT_REG_REC = struct.Struct('<BBI')
+_REGS_REC = struct.Struct('<B32I')
+
+
+def read_frame(stream: BinaryIO) -> Optional[bytes]:
+    '''Read a frame from stream, returning its payload
+
+    Returns None on a clean EOF (before the length of a frame). Raises a
+    ValueError if the stream ends part way through a frame.
+
+    '''
+    hdr = stream.read(4)
+    if not hdr:
+        return None
+    if len(hdr) != 4:
+        raise ValueError('Truncated frame header.')
+
+    length = _U32.unpack(hdr)[0]
+    payload = stream.read(length)
+    if len(payload) != length:
+        raise ValueError(f'Truncated frame: expected {length} bytes of '
+                         f'payload but got {len(payload)}.')
+    return payload
+
+
+def write_frame(stream: BinaryIO, payload: bytes) -> None:
+    '''Write payload to stream as a single frame and flush the stream'''
+    stream.write(_U32.pack(len(payload)) + payload)
+    stream.flush()
+
+
+def hello_payload() -> bytes:
+    '''The payload of the frame sent when starting in binary mode'''
+    return MAGIC + _U16.pack(VERSION)
+
+
+def encode_command(verb: str, args: Sequence[object]) -> bytes:
+    '''Encode a command as a frame payload
+
+    Each argument should be an int (for integer arguments) or a str.
+
+    '''
+    for idx, (name, arg_types) in enumerate(COMMANDS):
+        if name == verb:
+            break
+    else:
+        raise ValueError(f'Unknown command: {verb!r}')
+
+    if len(args) != len(arg_types):
+        raise ValueError(f'{verb} expects {len(arg_types)} arguments. '
+                         f'Got {len(args)}.')
+
+    parts = [bytes([idx + 1])]
+    for arg_type, arg in zip(arg_types, args):
+        if arg_type == ARG_STR:
+            assert isinstance(arg, str)
+            data = arg.encode('utf-8')
+            parts += [_U16.pack(len(data)), data]
+        else:
+            assert isinstance(arg, int)
+            parts.append(arg.to_bytes(arg_type, 'little'))
+
+    return b''.join(parts)
+
+
+def decode_command(payload: bytes) -> Tuple[str, List[str]]:
+    '''Decode a command payload to a command name and textual arguments
+
+    The arguments are converted to the strings that would have been seen for
+    the command in text mode, so the same handlers can be used for both
+    protocols. Raises a ValueError if the payload is malformed.
+
+    '''
+    if not payload:
+        raise ValueError('Empty command frame.')
+
+    opcode = payload[0]
+    if not 1 <= opcode <= len(COMMANDS):
+        raise ValueError(f'Unknown command opcode: {opcode}.')
+    verb, arg_types = COMMANDS[opcode - 1]
+
+    args = []
+    pos = 1
+    for arg_type in arg_types:
+        if arg_type == ARG_STR:
+            if pos + 2 > len(payload):
+                raise ValueError(f'Truncated string argument for {verb}.')
+            str_len = _U16.unpack_from(payload, pos)[0]
+            pos += 2
+            width = str_len
+        else:
+            width = arg_type
+
+        if pos + width > len(payload):
+            raise ValueError(f'Truncated argument for {verb}.')
+        data = payload[pos:pos + width]
+        pos += width
+
+        if arg_type == ARG_STR:
+            args.append(data.decode('utf-8'))
+        else:
+            args.append(str(int.from_bytes(data, 'little')))
+
+    if pos != len(payload):
+        raise ValueError(f'{len(payload) - pos} trailing bytes in payload '
+                         f'for {verb}.')
+
+    return (verb, args)
+
+
+class Output:
+    '''Somewhere to send the output from a command
+
+    The base class writes text for the text protocol.
+
+    '''
+    def line(self, text: str) -> None:
+        '''Send a line of text (an echoed command or a line of trace)'''
+        print(text)
+
+    def ext_reg(self, name: str, value: int) -> None:
+        '''Report a change to the named external register'''
+        print(f'! otbn.{name}: 0x{value:08x}')
+
+    def regs(self, gprs: Sequence[int], wdrs: Sequence[int]) -> None:
+        '''Report the contents of the register files'''
+        for idx, value in enumerate(gprs):
+            print(' x{:<2} = 0x{:08x}'.format(idx, value))
+        for idx, value in enumerate(wdrs):
+            print(' w{:<2} = 0x{:064x}'.format(idx, value))
+
+    def call_stack_entry(self, value: int) -> None:
+        '''Report an entry in the call stack'''
+        print('0x{:08x}'.format(value))
+
+    def cycle_end(self) -> None:
+        '''Mark the end of the output for a cycle (used by run)'''
+        print(CYCLE_END_LINE)
+
+    def end(self) -> None:
+        '''Finish the output for this command'''
+        print('.', flush=True)
+
+
+class BinaryOutput(Output):
+    '''An Output that collects records and writes them as a single frame'''
+    def __init__(self, stream: BinaryIO):
+        self._stream = stream
+        self._parts = []  # type: List[bytes]
+
+    def line(self, text: str) -> None:
+        # Some trace entries (like the header line for an instruction) contain
+        # embedded newlines. Send each line as a separate record, matching
+        # what the reader would see in text mode.
+        for part in text.split('\n'):
+            data = part.encode('utf-8')
+            self._parts += [bytes([REC_LINE]), _U16.pack(len(data)), data]
+
+    def ext_reg(self, name: str, value: int) -> None:
+        idx = _EXT_REG_INDICES.get(name)
+        if idx is None:
+            # There's no record type for this register. Send the line that
+            # would have appeared in text mode.
+            self.line(f'! otbn.{name}: 0x{value:08x}')
+            return
+        self._parts.append(_EXT_REG_REC.pack(REC_EXT_REG, idx, value))
+
+    def regs(self, gprs: Sequence[int], wdrs: Sequence[int]) -> None:
+        assert len(gprs) == 32 and len(wdrs) == 32
+        self._parts.append(_REGS_REC.pack(REC_REGS, *gprs))
+        self._parts += [value.to_bytes(32, 'little') for value in wdrs]
+
+    def call_stack_entry(self, value: int) -> None:
+        self._parts.append(bytes([REC_CALL_STACK_ENTRY]) + _U32.pack(value))
+
+    def cycle_end(self) -> None:
+        self._parts.append(bytes([REC_CYCLE_END]))
+
+    def end(self) -> None:
+        write_frame(self._stream, b''.join(self._parts))
+        self._parts = []
+
+
+def decode_response(payload: bytes) -> List[Tuple[int, object]]:
+    '''Decode a response payload into a list of records
+
+    Each record is returned as a pair (rec_type, data). The data is a str for
+    REC_LINE, a pair (name, value) for REC_EXT_REG, a pair (gprs, wdrs) of
+    lists for REC_REGS, an int for REC_CALL_STACK_ENTRY and None for
+    REC_CYCLE_END. Raises a ValueError if the payload is malformed.
+
+    '''
+    records = []  # type: List[Tuple[int, object]]
+    pos = 0
+    while pos < len(payload):
+        rec_type = payload[pos]
+        pos += 1
+
+        if rec_type == REC_LINE:
+            if pos + 2 > len(payload):
+                raise ValueError('Truncated line record.')
+            length = _U16.unpack_from(payload, pos)[0]
+            pos += 2
+            if pos + length > len(payload):
+                raise ValueError('Truncated line record.')
+            text = payload[pos:pos + length].decode('utf-8')
+            records.append((rec_type, text))
+            pos += length
+
+        elif rec_type == REC_EXT_REG:
+            if pos + 5 > len(payload):
+                raise ValueError('Truncated ext reg record.')
+            idx = payload[pos]
+            if idx >= len(EXT_REGS):
+                raise ValueError(f'Unknown external register index: {idx}.')
+            value = _U32.unpack_from(payload, pos + 1)[0]
+            records.append((rec_type, (EXT_REGS[idx], value)))
+            pos += 5
+
+        elif rec_type == REC_REGS:
+            body_len = 32 * 4 + 32 * 32
+            if pos + body_len > len(payload):
+                raise ValueError('Truncated register record.')
+            gprs = list(struct.unpack_from('<32I', payload, pos))
+            pos += 32 * 4
+            wdrs = [int.from_bytes(payload[pos + 32 * i:pos + 32 * (i + 1)],
+                                   'little')
+                    for i in range(32)]
+            pos += 32 * 32
+            records.append((rec_type, (gprs, wdrs)))
+
+        elif rec_type == REC_CALL_STACK_ENTRY:
+            if pos + 4 > len(payload):
+                raise ValueError('Truncated call stack record.')
+            records.append((rec_type, _U32.unpack_from(payload, pos)[0]))
+            pos += 4
+
+        elif rec_type == REC_CYCLE_END:
+            records.append((rec_type, None))
+
+        else:
+            raise ValueError(f'Unknown record type: {rec_type}.')
+
+    return records
@@ -0,0 +1,92 @@
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Memory shared with ISSWrapper for passing the contents of IMEM and DMEM
+
+When ISSWrapper starts stepped.py, it passes the file descriptor of a shared
+memory region with --shared-mem. The load_d_shared, load_i_shared,
+dump_d_shared and dump_d_dirty commands use this region instead of going
+through a temporary file. The C++ side of this is IssSharedMem in
+hw/ip/otbn/dv/model/iss_protocol.h, which must be kept in sync.
+
+The region starts with a header of two 32-bit little-endian words, giving the
+number of words of IMEM and of DMEM. The contents of IMEM and then DMEM follow.
+Each 32-bit word is stored as 5 bytes (the format used by load_d and dump_d): a
+validity byte (0 or 1), then the word in little-endian order.
+
+After DMEM, there is a dirty flag byte for each word of DMEM. The dump_d_dirty
+command only writes the DMEM words that have changed since DMEM was last
+loaded or dumped through the region, setting the dirty flag for each one.
+ISSWrapper clears the flags once it has read the words.
+
+'''
+
+import mmap
+import os
+import struct
+from typing import Optional, Sequence, Tuple
+
+_HEADER = struct.Struct('<II')
+_WORD = struct.Struct('<BI')
+BYTES_PER_WORD = 5
+
+
+class SharedMem:
+    '''A mapping of the memory region shared with ISSWrapper'''
+    def __init__(self, fd: int) -> None:
+        size = os.fstat(fd).st_size
+        if size < _HEADER.size:
+            raise ValueError(f'Shared memory is only {size} bytes long: '
+                             'too short for the header.')
+
+        self._mmap = mmap.mmap(fd, size)
+        imem_words, dmem_words = _HEADER.unpack_from(self._mmap, 0)
+
+        self._imem_start = _HEADER.size
+        self._dmem_start = self._imem_start + BYTES_PER_WORD * imem_words
+        self._dmem_end = self._dmem_start + BYTES_PER_WORD * dmem_words
+        self._dirty_start = self._dmem_end
+        self._dmem_words = dmem_words
+        if self._dirty_start + dmem_words > size:
+            raise ValueError(f'Shared memory is {size} bytes long, which is '
+                             f'too short for {imem_words} words of IMEM and '
+                             f'{dmem_words} words of DMEM.')
+
+    def read_imem(self) -> bytes:
+        '''Return the contents of IMEM in the 5-byte format'''
+        return self._mmap[self._imem_start:self._dmem_start]
+
+    def read_dmem(self) -> bytes:
+        '''Return the contents of DMEM in the 5-byte format'''
+        return self._mmap[self._dmem_start:self._dmem_end]
+
+    def write_dmem(self, data: bytes) -> None:
+        '''Write the contents of DMEM in the 5-byte format
+
+        If data is longer than the DMEM part of the region, only the start of
+        it is written. Raises a ValueError if it is shorter.
+
+        '''
+        dmem_len = self._dmem_end - self._dmem_start
+        if len(data) < dmem_len:
+            raise ValueError(f'Cannot write {len(data)} bytes of DMEM data '
+                             f'to shared memory, which expects {dmem_len}.')
+        self._mmap[self._dmem_start:self._dmem_end] = data[:dmem_len]
+
+    def write_dmem_dirty(self,
+                         words: Sequence[Tuple[int, Optional[int]]]) -> None:
+        '''Write some words of DMEM, setting their dirty flags
+
+        Each item in words is a pair (idx, value) giving the index of a 32-bit
+        word and its value (None if the word is invalid). Words past the end
+        of the DMEM part of the region are ignored, matching write_dmem.
+
+        '''
+        for idx, value in words:
+            if idx >= self._dmem_words:
+                continue
+            pos = self._dmem_start + BYTES_PER_WORD * idx
+            vld = 0 if value is None else 1
+            _WORD.pack_into(self._mmap, pos, vld, value or 0)
+            self._mmap[self._dirty_start + idx] = 1
@@ -2,6 +2,7 @@
 # Licensed under the Apache License, Version 2.0, see LICENSE for details.
 # SPDX-License-Identifier: Apache-2.0
 
+import pickle
 from typing import Dict, Iterator, List, Optional, Tuple
 
 from .constants import ErrBits, LcTx, Status, read_lc_tx_t
@@ -21,6 +22,11 @@ LoopWarps = Dict[int, Dict[int, int]]
 # executed, together with a list of changes.
 StepRes = Tuple[Optional[OTBNInsn], List[Trace]]
 
+# The bytes at the start of a file written by OTBNSim.save_state. Bump the
+# number at the end if the format changes in a way that would make old files
+# load incorrectly.
+_SAVED_STATE_MAGIC = b'OTBNSIM-STATE-1\n'
+
 
 class OTBNSim:
     def __init__(self) -> None:
@@ -39,6 +45,47 @@ class OTBNSim:
         '''Add a new loop warp to the simulation'''
         self.loop_warps.setdefault(addr, {})[from_cnt] = to_cnt
 
+    def save_state(self, path: str) -> None:
+        '''Save the state of the simulation to a file at path
+
+        This covers everything that the simulator knows: the program, loop
+        warps, registers, call and loop stacks, flags, WSRs, DMEM, the RND and
+        URND state and the external registers. The file is an opaque blob and
+        should only be read by load_state from the same version of the
+        simulator.
+
+        The state can only be saved between instructions. Raises a
+        RuntimeError if a multi-cycle instruction is part way through.
+
+        '''
+        if self._execute_generator is not None:
+            raise RuntimeError('Cannot save the simulator state part way '
+                               'through a multi-cycle instruction.')
+
+        with open(path, 'wb') as handle:
+            handle.write(_SAVED_STATE_MAGIC)
+            pickle.dump(self, handle, protocol=pickle.HIGHEST_PROTOCOL)
+
+    @staticmethod
+    def load_state(path: str) -> 'OTBNSim':
+        '''Load a simulator from a file written by save_state
+
+        Raises a ValueError if the file doesn't look like it was written by
+        save_state.
+
+        '''
+        with open(path, 'rb') as handle:
+            magic = handle.read(len(_SAVED_STATE_MAGIC))
+            if magic != _SAVED_STATE_MAGIC:
+                raise ValueError(f'{path} is not a saved OTBN simulator '
+                                 'state (or was saved by an incompatible '
+                                 'version).')
+            sim = pickle.load(handle)
+
+        if not isinstance(sim, OTBNSim):
+            raise ValueError(f'{path} does not contain an OTBN simulator.')
+        return sim
+
     def load_data(self, data: bytes, has_validity: bool) -> None:
         '''Load bytes into DMEM, starting at address zero.
 
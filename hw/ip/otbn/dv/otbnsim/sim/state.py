@@ -12,7 +12,7 @@ from .dmem import Dmem
 from .constants import ErrBits, LcTx, Status
 from .edn_client import EdnClient
 from .ext_regs import OTBNExtRegs
-from .flags import FlagReg
+from .flags import FlagReg, VecFlagReg
 from .gpr import GPRs
 from .loop import LoopStack
 from .reg import RegFile
@@ -273,6 +273,7 @@ class OTBNState:
         c += self.ext_regs.changes()
         c += self.wsrs.changes()
         c += self.csrs.flags.changes()
+        c += self.csrs.vec_flags.changes()
         c += self.wdrs.changes()
         return c
 
@@ -331,6 +332,7 @@ class OTBNState:
         self.loop_stack.commit()
         self.wsrs.commit()
         self.csrs.flags.commit()
+        self.csrs.vec_flags.commit()
         self.wdrs.commit()
 
         if not sim_stalled:
@@ -346,6 +348,7 @@ class OTBNState:
         self.ext_regs.abort()
         self.wsrs.abort()
         self.csrs.flags.abort()
+        self.csrs.vec_flags.abort()
         self.wdrs.abort()
 
     def start(self) -> None:
@@ -474,6 +477,10 @@ class OTBNState:
         self.csrs.flags[fg] = \
             FlagReg.mlz_for_result(self.csrs.flags[fg].C, result)
 
+    def set_vec_flags(self, vfg: int, flags: VecFlagReg) -> None:
+        '''Update flags for a vector flag group'''
+        self.csrs.vec_flags[vfg] = flags
+
     def pre_insn(self, insn_affects_control: bool) -> None:
         '''Run before running an instruction'''
         self.loop_stack.check_insn(self.pc, insn_affects_control)
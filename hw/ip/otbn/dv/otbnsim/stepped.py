@@ -17,6 +17,11 @@ prefixed with "0x" if they are hexadecimal.
     step                    Run one instruction. Print trace information to
                             stdout.
 
+    run <max_cycles>        Run for up to <max_cycles> cycles, stopping early
+                            after a cycle with an externally visible event (see
+                            on_run). Print the trace information for each
+                            cycle, followed by a line containing END_CYCLE.
+
     load_elf <path>         Load the ELF file at <path>, replacing current
                             contents of DMEM and IMEM.
 
@@ -37,6 +42,24 @@ prefixed with "0x" if they are hexadecimal.
     dump_d <path>           Write the current contents of DMEM to <path> (same
                             format as for load).
 
+    load_d_shared           Like load_d, load_i and dump_d, but use the memory
+    load_i_shared           shared with ISSWrapper instead of a file (see
+    dump_d_shared           sim/shared_mem.py). These need --shared-mem.
+
+    dump_d_dirty            Like dump_d_shared, but only write the words of
+                            DMEM that have changed since DMEM was last loaded
+                            or dumped through shared memory, setting their
+                            dirty flags. Needs --shared-mem.
+
+    save_state <path>       Save the state of the simulation to <path>, which
+                            is an opaque file that can only be read by
+                            restore_state. This must be between instructions.
+
+    restore_state <path>    Replace the simulation with one loaded from a file
+                            written by save_state. The output reports the
+                            current value of each external register that
+                            ISSWrapper mirrors.
+
     print_regs              Write the hex contents of all registers to stdout
 
     edn_rnd_step            Send 32b RND Data to the model.
@@ -70,16 +93,33 @@ prefixed with "0x" if they are hexadecimal.
     send_err_escalation     React to an injected error.
 
     set_software_errs_fatal Set software_errs_fatal bit.
+
+The output for each command is terminated by a line containing just '.'.
+
+If run with --binary, commands and their output are instead sent as
+length-prefixed binary frames. This avoids formatting and parsing text on
+every cycle and is what ISSWrapper uses by default. The text protocol is
+easier to drive by hand, which is handy for debugging. See sim/iss_protocol.py
+for the format.
 '''
 
+import argparse
 import binascii
 import sys
-from typing import List, Optional
+from typing import List, Optional, Union
 
-from sim.decode import decode_file
+from sim.decode import decode_bytes, decode_file
+from sim.ext_regs import TraceExtRegChange
+from sim.iss_protocol import (BinaryOutput, Output, decode_command,
+                              hello_payload, read_frame, write_frame)
+from sim.state import FsmState
 from sim.load_elf import load_elf
+from sim.shared_mem import SharedMem
 from sim.sim import OTBNSim
 
+# The memory shared with ISSWrapper, if we were run with --shared-mem
+_SHARED_MEM = None  # type: Optional[SharedMem]
+
 
 def read_word(arg_name: str, word_data: str, bits: int) -> int:
     '''Try to read an unsigned word of the specified bit length'''
@@ -97,12 +137,6 @@ def read_word(arg_name: str, word_data: str, bits: int) -> int:
     return value
 
 
-def end_command() -> None:
-    '''Print a single '.' to stdout and flush, ending the output for command'''
-    print('.')
-    sys.stdout.flush()
-
-
 def check_arg_count(cmd: str, cnt: int, args: List[str]) -> None:
     if len(args) != cnt:
         if cnt == 0:
@@ -115,12 +149,13 @@ def check_arg_count(cmd: str, cnt: int, args: List[str]) -> None:
         raise ValueError(f'{cmd} expects {txt_cnt} arguments. Got {args}.')
 
 
-def on_start_operation(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_start_operation(sim: OTBNSim, args: List[str],
+                       out: Output) -> Optional[OTBNSim]:
     check_arg_count('start_operation', 1, args)
     command = args[0]
 
     if command == 'Execute':
-        print('START')
+        out.line('START')
         sim.start(collect_stats=False)
     elif command == 'DmemWipe':
         sim.start_mem_wipe(False)
@@ -132,10 +167,13 @@ def on_start_operation(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
-    '''Step one instruction'''
-    check_arg_count('step', 0, args)
+def step_cycle(sim: OTBNSim, out: Output) -> bool:
+    '''Step one cycle, writing its trace to out
+
+    Returns True if the cycle changed an external register other than
+    INSN_CNT.
 
+    '''
     pc = sim.state.pc
     assert 0 == pc & 3
 
@@ -159,8 +197,17 @@ def on_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     if sim.state.lock_immediately and hdr in ['V ', 'STALL']:
         hdr = None
 
-    rtl_changes = []
+    # Changes to external registers are reported separately from the rest of
+    # the trace (so that they can be sent as dedicated records in binary
+    # mode). Each entry in rtl_changes is either a line of trace or a change
+    # to an external register.
+    rtl_changes = []  # type: List[Union[str, TraceExtRegChange]]
+    saw_event = False
     for c in changes:
+        if isinstance(c, TraceExtRegChange):
+            rtl_changes.append(c)
+            saw_event |= c.name != 'INSN_CNT'
+            continue
         rt = c.rtl_trace()
         if rt is not None:
             rtl_changes.append(rt)
@@ -175,26 +222,64 @@ def on_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
         hdr = 'STALL'
 
     if hdr is not None:
-        print(hdr)
-        for rt in rtl_changes:
-            print(rt)
+        out.line(hdr)
+        for change in rtl_changes:
+            if isinstance(change, TraceExtRegChange):
+                out.ext_reg(change.name, change.erc.new_value)
+            else:
+                out.line(change)
+
+    return saw_event
+
+
+def on_step(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
+    '''Step one instruction'''
+    check_arg_count('step', 0, args)
+    step_cycle(sim, out)
+    return None
+
+
+def on_run(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
+    '''Step several cycles, stopping at the first externally visible event
+
+    An event is a change to an external register other than INSN_CNT (such as
+    STATUS, RND_REQ or WIPE_START). We also stop once we are no longer
+    executing instructions or while there is an outstanding RND request: in
+    either case, the next cycle might depend on an input from the RTL side
+    (like EDN data) that we haven't seen yet.
+
+    '''
+    check_arg_count('run', 1, args)
+    max_cycles = read_word('max_cycles', args[0], 32)
+    if max_cycles == 0:
+        raise ValueError('run needs a positive number of cycles.')
+
+    for _ in range(max_cycles):
+        saw_event = step_cycle(sim, out)
+        out.cycle_end()
+        if (saw_event or
+                sim.state.get_fsm_state() != FsmState.EXEC or
+                sim.state.ext_regs.read('RND_REQ', True)):
+            break
 
     return None
 
 
-def on_load_elf(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_load_elf(sim: OTBNSim, args: List[str],
+                out: Output) -> Optional[OTBNSim]:
     '''Load contents of ELF at path given by only argument'''
     check_arg_count('load_elf', 1, args)
 
     path = args[0]
 
-    print('LOAD_ELF {!r}'.format(path))
+    out.line('LOAD_ELF {!r}'.format(path))
     load_elf(sim, path)
 
     return None
 
 
-def on_add_loop_warp(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_add_loop_warp(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
     '''Add a loop warp to the simulation'''
     check_arg_count('add_loop_warp', 3, args)
 
@@ -212,13 +297,14 @@ def on_add_loop_warp(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
         raise ValueError('Bad argument to add_loop_warp: {}'
                          .format(err)) from None
 
-    print('ADD_LOOP_WARP {:#x} {} {}'.format(addr, from_cnt, to_cnt))
+    out.line('ADD_LOOP_WARP {:#x} {} {}'.format(addr, from_cnt, to_cnt))
     sim.add_loop_warp(addr, from_cnt, to_cnt)
 
     return None
 
 
-def on_clear_loop_warps(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_clear_loop_warps(sim: OTBNSim, args: List[str],
+                        out: Output) -> Optional[OTBNSim]:
     '''Run until ecall or error'''
     check_arg_count('clear_loop_warps', 0, args)
 
@@ -227,38 +313,38 @@ def on_clear_loop_warps(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_load_d(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_load_d(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
     '''Load contents of data memory from file at path given by only argument'''
     check_arg_count('load_d', 1, args)
 
     path = args[0]
 
-    print('LOAD_D {!r}'.format(path))
+    out.line('LOAD_D {!r}'.format(path))
     with open(path, 'rb') as handle:
         sim.load_data(handle.read(), has_validity=True)
 
     return None
 
 
-def on_load_i(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_load_i(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
     '''Load contents of insn memory from file at path given by only argument'''
     check_arg_count('load_i', 1, args)
 
     path = args[0]
 
-    print('LOAD_I {!r}'.format(path))
+    out.line('LOAD_I {!r}'.format(path))
     sim.load_program(decode_file(0, path))
 
     return None
 
 
-def on_dump_d(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_dump_d(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
     '''Dump contents of data memory to file at path given by only argument'''
     check_arg_count('dump_d', 1, args)
 
     path = args[0]
 
-    print('DUMP_D {!r}'.format(path))
+    out.line('DUMP_D {!r}'.format(path))
 
     with open(path, 'wb') as handle:
         handle.write(sim.state.dmem.dump_le_words())
@@ -266,36 +352,127 @@ def on_dump_d(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_print_regs(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def get_shared_mem(verb: str) -> SharedMem:
+    '''Get the shared memory, raising a RuntimeError if there is none'''
+    if _SHARED_MEM is None:
+        raise RuntimeError(f'Cannot run {verb}: no --shared-mem argument.')
+    return _SHARED_MEM
+
+
+def on_load_d_shared(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
+    '''Load contents of data memory from the shared memory'''
+    check_arg_count('load_d_shared', 0, args)
+
+    out.line('LOAD_D_SHARED')
+    sim.load_data(get_shared_mem('load_d_shared').read_dmem(),
+                  has_validity=True)
+    sim.state.dmem.mark_clean()
+
+    return None
+
+
+def on_load_i_shared(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
+    '''Load contents of insn memory from the shared memory'''
+    check_arg_count('load_i_shared', 0, args)
+
+    out.line('LOAD_I_SHARED')
+    raw_bytes = get_shared_mem('load_i_shared').read_imem()
+    sim.load_program(decode_bytes(0, raw_bytes, 'shared memory'))
+
+    return None
+
+
+def on_dump_d_shared(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
+    '''Dump contents of data memory to the shared memory'''
+    check_arg_count('dump_d_shared', 0, args)
+
+    out.line('DUMP_D_SHARED')
+    get_shared_mem('dump_d_shared').write_dmem(sim.dump_data())
+    sim.state.dmem.mark_clean()
+
+    return None
+
+
+def on_dump_d_dirty(sim: OTBNSim, args: List[str],
+                    out: Output) -> Optional[OTBNSim]:
+    '''Dump changed words of data memory to the shared memory'''
+    check_arg_count('dump_d_dirty', 0, args)
+
+    out.line('DUMP_D_DIRTY')
+    shm = get_shared_mem('dump_d_dirty')
+    shm.write_dmem_dirty(sim.state.dmem.take_dirty())
+
+    return None
+
+
+def on_save_state(sim: OTBNSim, args: List[str],
+                  out: Output) -> Optional[OTBNSim]:
+    '''Save the simulation state to the file at path given by only argument'''
+    check_arg_count('save_state', 1, args)
+
+    path = args[0]
+
+    out.line('SAVE_STATE {!r}'.format(path))
+    sim.save_state(path)
+
+    return None
+
+
+# The external registers whose values ISSWrapper mirrors. These are reported
+# after restore_state so that it can update its copies.
+_MIRRORED_EXT_REGS = ['STATUS', 'INSN_CNT', 'ERR_BITS', 'STOP_PC',
+                      'RND_REQ', 'WIPE_START']
+
+
+def on_restore_state(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
+    '''Replace the simulation with one saved with save_state'''
+    check_arg_count('restore_state', 1, args)
+
+    path = args[0]
+
+    out.line('RESTORE_STATE {!r}'.format(path))
+    new_sim = OTBNSim.load_state(path)
+    for name in _MIRRORED_EXT_REGS:
+        out.ext_reg(name, new_sim.state.ext_regs.read(name, False))
+
+    return new_sim
+
+
+def on_print_regs(sim: OTBNSim, args: List[str],
+                  out: Output) -> Optional[OTBNSim]:
     '''Print registers to stdout'''
     check_arg_count('print_regs', 0, args)
 
-    print('PRINT_REGS')
-    for idx, value in enumerate(sim.state.gprs.peek_unsigned_values()):
-        print(' x{:<2} = 0x{:08x}'.format(idx, value))
-    for idx, value in enumerate(sim.state.wdrs.peek_unsigned_values()):
-        print(' w{:<2} = 0x{:064x}'.format(idx, value))
+    out.line('PRINT_REGS')
+    out.regs(sim.state.gprs.peek_unsigned_values(),
+             sim.state.wdrs.peek_unsigned_values())
 
     return None
 
 
-def on_print_call_stack(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_print_call_stack(sim: OTBNSim, args: List[str],
+                        out: Output) -> Optional[OTBNSim]:
     '''Print call stack to stdout. First element is the bottom of the stack'''
     check_arg_count('print_call_stack', 0, args)
 
-    print('PRINT_CALL_STACK')
+    out.line('PRINT_CALL_STACK')
     for value in sim.state.peek_call_stack():
-        print('0x{:08x}'.format(value))
+        out.call_stack_entry(value)
 
     return None
 
 
-def on_reset(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_reset(sim: OTBNSim, args: List[str], out: Output) -> Optional[OTBNSim]:
     check_arg_count('reset', 0, args)
     return OTBNSim()
 
 
-def on_edn_rnd_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_edn_rnd_step(sim: OTBNSim, args: List[str],
+                    out: Output) -> Optional[OTBNSim]:
     check_arg_count('edn_rnd_step', 2, args)
     edn_rnd_data = read_word('edn_rnd_step', args[0], 32)
     fips_err = read_word('fips_err', args[1], 1)
@@ -303,47 +480,53 @@ def on_edn_rnd_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_edn_urnd_step(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_edn_urnd_step(sim: OTBNSim, args: List[str],
+                     out: Output) -> Optional[OTBNSim]:
     check_arg_count('edn_urnd_step', 1, args)
     edn_urnd_data = read_word('edn_urnd_step', args[0], 32)
     sim.state.edn_urnd_step(edn_urnd_data)
     return None
 
 
-def on_edn_flush(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_edn_flush(sim: OTBNSim, args: List[str],
+                 out: Output) -> Optional[OTBNSim]:
     check_arg_count('edn_flush', 0, args)
     sim.state.edn_flush()
     return None
 
 
-def on_edn_urnd_cdc_done(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_edn_urnd_cdc_done(sim: OTBNSim, args: List[str],
+                         out: Output) -> Optional[OTBNSim]:
     check_arg_count('urnd_cdc_done', 0, args)
     sim.urnd_completed()
     return None
 
 
-def on_edn_rnd_cdc_done(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_edn_rnd_cdc_done(sim: OTBNSim, args: List[str],
+                        out: Output) -> Optional[OTBNSim]:
     check_arg_count('edn_rnd_cdc_done', 0, args)
     sim.state.rnd_completed()
     return None
 
 
-def on_invalidate_imem(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_invalidate_imem(sim: OTBNSim, args: List[str],
+                       out: Output) -> Optional[OTBNSim]:
     check_arg_count('invalidate_imem', 0, args)
 
     sim.state.invalidate_imem()
     return None
 
 
-def on_invalidate_dmem(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_invalidate_dmem(sim: OTBNSim, args: List[str],
+                       out: Output) -> Optional[OTBNSim]:
     check_arg_count('invalidate_dmem', 0, args)
 
     sim.state.dmem.empty_dmem()
     return None
 
 
-def on_set_software_errs_fatal(sim: OTBNSim,
-                               args: List[str]) -> Optional[OTBNSim]:
+def on_set_software_errs_fatal(sim: OTBNSim, args: List[str],
+                               out: Output) -> Optional[OTBNSim]:
     check_arg_count('set_software_errs_fatal', 1, args)
     new_val = read_word('error', args[0], 1)
     assert new_val in [0, 1]
@@ -352,7 +535,8 @@ def on_set_software_errs_fatal(sim: OTBNSim,
     return None
 
 
-def on_set_keymgr_value(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_set_keymgr_value(sim: OTBNSim, args: List[str],
+                        out: Output) -> Optional[OTBNSim]:
     check_arg_count('set_keymgr_value', 3, args)
     key0 = read_word('key0', args[0], 384)
     key1 = read_word('key1', args[1], 384)
@@ -363,19 +547,21 @@ def on_set_keymgr_value(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_step_crc(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_step_crc(sim: OTBNSim, args: List[str],
+                out: Output) -> Optional[OTBNSim]:
     check_arg_count('step_crc', 2, args)
 
     item = read_word('item', args[0], 48)
     state = read_word('state', args[1], 32)
 
     new_state = binascii.crc32(item.to_bytes(6, 'little'), state)
-    print(f'! otbn.LOAD_CHECKSUM: 0x{new_state:08x}')
+    out.ext_reg('LOAD_CHECKSUM', new_state)
 
     return None
 
 
-def on_send_err_escalation(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_send_err_escalation(sim: OTBNSim, args: List[str],
+                           out: Output) -> Optional[OTBNSim]:
     check_arg_count('send_err_escalation', 2, args)
     err_val = read_word('err_val', args[0], 32)
     lock_immediately = bool(read_word('lock_immediately', args[1], 1))
@@ -383,20 +569,23 @@ def on_send_err_escalation(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
     return None
 
 
-def on_set_rma_req(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_set_rma_req(sim: OTBNSim, args: List[str],
+                   out: Output) -> Optional[OTBNSim]:
     check_arg_count('set_rma_req', 1, args)
     rma_req = read_word('rma_req', args[0], 4)
     sim.set_rma_req(rma_req)
     return None
 
 
-def on_initial_secure_wipe(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_initial_secure_wipe(sim: OTBNSim, args: List[str],
+                           out: Output) -> Optional[OTBNSim]:
     check_arg_count('initial_secure_wipe', 0, args)
     sim.initial_secure_wipe()
     return None
 
 
-def on_otp_cdc_done(sim: OTBNSim, args: List[str]) -> Optional[OTBNSim]:
+def on_otp_cdc_done(sim: OTBNSim, args: List[str],
+                    out: Output) -> Optional[OTBNSim]:
     check_arg_count('otp_key_cdc_done', 0, args)
 
     sim.on_otp_cdc_done()
@@ -407,12 +596,19 @@ _HANDLERS = {
     'start_operation': on_start_operation,
     'otp_key_cdc_done': on_otp_cdc_done,
     'step': on_step,
+    'run': on_run,
     'load_elf': on_load_elf,
     'add_loop_warp': on_add_loop_warp,
     'clear_loop_warps': on_clear_loop_warps,
     'load_d': on_load_d,
     'load_i': on_load_i,
     'dump_d': on_dump_d,
+    'load_d_shared': on_load_d_shared,
+    'load_i_shared': on_load_i_shared,
+    'dump_d_shared': on_dump_d_shared,
+    'dump_d_dirty': on_dump_d_dirty,
+    'save_state': on_save_state,
+    'restore_state': on_restore_state,
     'print_regs': on_print_regs,
     'print_call_stack': on_print_call_stack,
     'reset': on_reset,
@@ -432,6 +628,19 @@ _HANDLERS = {
 }
 
 
+def run_command(sim: OTBNSim, verb: str, args: List[str],
+                out: Output) -> Optional[OTBNSim]:
+    '''Run a command, sending its output to out'''
+    handler = _HANDLERS.get(verb)
+    if handler is None:
+        raise RuntimeError('Unknown command: {!r}'.format(verb))
+
+    ret = handler(sim, args, out)
+    out.end()
+
+    return ret
+
+
 def on_input(sim: OTBNSim, line: str) -> Optional[OTBNSim]:
     '''Process an input command'''
     words = line.split()
@@ -440,25 +649,50 @@ def on_input(sim: OTBNSim, line: str) -> Optional[OTBNSim]:
     if not words:
         return None
 
-    verb = words[0]
-    handler = _HANDLERS.get(verb)
-    if handler is None:
-        raise RuntimeError('Unknown command: {!r}'.format(verb))
+    return run_command(sim, words[0], words[1:], Output())
 
-    ret = handler(sim, words[1:])
-    print('.')
-    sys.stdout.flush()
 
-    return ret
+def on_frame(sim: OTBNSim, payload: bytes,
+             out: BinaryOutput) -> Optional[OTBNSim]:
+    '''Process a command that was sent as a binary frame'''
+    verb, args = decode_command(payload)
+    return run_command(sim, verb, args, out)
+
 
+def main(argv: Optional[List[str]] = None) -> int:
+    '''Run the REPL, parsing arguments from argv (or sys.argv if None)'''
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--binary', action='store_true',
+                        help=('Use the binary framed protocol (see '
+                              'sim/iss_protocol.py) instead of text.'))
+    parser.add_argument('--shared-mem', type=int, metavar='FD',
+                        help=('A file descriptor for memory shared with '
+                              'ISSWrapper (see sim/shared_mem.py).'))
+    args = parser.parse_args(argv)
+
+    if args.shared_mem is not None:
+        global _SHARED_MEM
+        _SHARED_MEM = SharedMem(args.shared_mem)
 
-def main() -> int:
     sim = OTBNSim()
     try:
-        for line in sys.stdin:
-            ret = on_input(sim, line)
-            if ret is not None:
-                sim = ret
+        if args.binary:
+            stdin = sys.stdin.buffer
+            stdout = sys.stdout.buffer
+            write_frame(stdout, hello_payload())
+            out = BinaryOutput(stdout)
+            while True:
+                payload = read_frame(stdin)
+                if payload is None:
+                    break
+                ret = on_frame(sim, payload, out)
+                if ret is not None:
+                    sim = ret
+        else:
+            for line in sys.stdin:
+                ret = on_input(sim, line)
+                if ret is not None:
+                    sim = ret
 
     except KeyboardInterrupt:
         print("Received shutdown request, ending OTBN simulation.")
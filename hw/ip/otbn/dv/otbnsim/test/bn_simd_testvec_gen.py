@@ -52,6 +52,28 @@ def logical_bit_shift(value: int, size: int, shift_type: int, shift_bits: int) -
     return shifted & mask
 
 
+def montgomery_mul(a: int, b: int, q: int, q_prime: int, size: int) -> int:
+    '''Montgomery product a * b * 2^-size mod q of two `size`-bit values,
+    with a single conditional subtraction as done by bn.mulvm'''
+    mask = (1 << size) - 1
+    p = a * b
+    m = ((p & mask) * q_prime) & mask
+    t = (p + m * q) >> size
+    if t >= q:
+        t -= q
+    return t & mask
+
+
+def montgomery_constant(q: int, size: int) -> int:
+    '''Returns q' = -q^-1 mod 2^size for an odd modulus q'''
+    return -pow(q, -1, 1 << size) % (1 << size)
+
+
+def pack_vec_mod(q: int, size: int) -> int:
+    '''Packs q and q' into a MOD value as expected by bn.mulvm'''
+    return q | (montgomery_constant(q, size) << size)
+
+
 def split_vectors(elems_a, elems_b, elems_c, size: int):
     '''Splits the elements into multiple vectors which fit into
     256bit vectors depending on the element size.
@@ -378,11 +400,10 @@ def bn_mulv(size: int, mod: int = -1) -> str:
 
     elems_c = []
     for a, b in zip(elems_a, elems_b):
-        c = a * b
-
-        # TODO: match to HW implementation
         if mod > 0:
-            c = c % mod
+            c = montgomery_mul(a, b, mod, montgomery_constant(mod, size), size)
+        else:
+            c = a * b
 
         # fake wrap around
         c = c & ((1 << size) - 1)
@@ -405,8 +426,10 @@ def bn_mulvm(size: int, mod: int) -> str:
     '''Generates vectors to test bn.mulvm
 
     Returns a string containing the required assemlby data section.'''
-    txt_mod = format_otbn_memory(hex(mod)[2:].zfill(64),
-                                 size, [mod], f"mod{size}", "mulvm")
+    packed_mod = pack_vec_mod(mod, size)
+    txt_mod = format_otbn_memory(hex(packed_mod)[2:].zfill(64), size,
+                                 [mod, montgomery_constant(mod, size)],
+                                 f"mod{size}", "mulvm")
 
     return txt_mod + bn_mulv(size, mod=mod)
 
@@ -444,11 +467,11 @@ def bn_mulvl(size: int, mod: int = -1) -> str:
         lane_value = elems_b[lane]
 
         for elem in range(256 // size):
-            c = elems_a[elem] * lane_value
-
-            # TODO: match to HW implementation
             if mod > 0:
-                c = c % mod
+                c = montgomery_mul(elems_a[elem], lane_value, mod,
+                                   montgomery_constant(mod, size), size)
+            else:
+                c = elems_a[elem] * lane_value
 
             # fake wrap around
             c = c & ((1 << size) - 1)
@@ -480,8 +503,10 @@ def bn_mulvml(size: int, mod: int) -> str:
     '''Generates vectors to test bn.mulvm.l
 
     Returns a string containing the required assemlby data section.'''
-    txt_mod = format_otbn_memory(hex(mod)[2:].zfill(64),
-                                 size, [mod], f"mod{size}", "mulvml")
+    packed_mod = pack_vec_mod(mod, size)
+    txt_mod = format_otbn_memory(hex(packed_mod)[2:].zfill(64), size,
+                                 [mod, montgomery_constant(mod, size)],
+                                 f"mod{size}", "mulvml")
     return txt_mod + bn_mulvl(size, mod=mod)
 
 
@@ -0,0 +1,175 @@
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Test the fork server that starts stepped.py processes for ISSWrapper'''
+
+import array
+import os
+import pathlib
+import socket
+import struct
+import subprocess
+import sys
+import time
+from typing import Dict, Iterator, List
+
+import pytest
+
+import fork_server
+import stepped
+
+_SERVER = os.path.join(os.path.dirname(__file__), '..', 'fork_server.py')
+_MODEL = os.path.realpath(stepped.__file__)
+_KEY = fork_server._source_key(os.path.dirname(_MODEL))
+
+
+@pytest.fixture
+def server_proc(tmp_path: pathlib.Path) -> Iterator[subprocess.Popen]:
+    '''Start a fork server, yielding its process'''
+    sock_path = str(tmp_path / 'sock')
+    proc = subprocess.Popen([sys.executable, '-u', _SERVER,
+                             '--socket', sock_path, '--idle-timeout', '30'])
+    try:
+        for _ in range(1000):
+            if os.path.exists(sock_path):
+                break
+            time.sleep(0.01)
+        else:
+            assert False, 'Fork server never created its socket.'
+        yield proc
+    finally:
+        proc.kill()
+        proc.wait()
+
+
+@pytest.fixture
+def server(server_proc: subprocess.Popen, tmp_path: pathlib.Path) -> str:
+    '''Start a fork server, returning the path of its socket'''
+    return str(tmp_path / 'sock')
+
+
+def _request_strings(model: str, key: str, cwd: str, env: Dict[str, str],
+                     args: List[str]) -> List[str]:
+    '''Make the strings for a request, in the order the server expects'''
+    env_strs = ['{}={}'.format(name, value) for name, value in env.items()]
+    return [model, key, cwd, str(len(env_strs))] + env_strs + args
+
+
+def _request(sock_path: str, strings: List[str], fds: List[int]) -> str:
+    '''Send a request to the server at sock_path, returning its reply'''
+    data = b''.join(s.encode('utf-8') + b'\0' for s in strings)
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(sock_path)
+        sock.sendmsg([data], [(socket.SOL_SOCKET, socket.SCM_RIGHTS,
+                               array.array('i', fds))])
+        sock.shutdown(socket.SHUT_WR)
+        reply = b''
+        while True:
+            chunk = sock.recv(1024)
+            if not chunk:
+                return reply.decode('utf-8')
+            reply += chunk
+
+
+def test_fork_child(server: str, tmp_path: pathlib.Path) -> None:
+    '''Check that a forked child runs commands from its stdin'''
+    shm_path = tmp_path / 'shared'
+    shm_path.write_bytes(struct.pack('<II', 0, 0))
+
+    child_in, to_child = os.pipe()
+    from_child, child_out = os.pipe()
+    with open(shm_path, 'r+b') as shm:
+        fds = [child_in, child_out, 2, shm.fileno()]
+        strings = _request_strings(_MODEL, _KEY, str(tmp_path),
+                                   dict(os.environ), [])
+        reply = _request(server, strings, fds)
+    os.close(child_in)
+    os.close(child_out)
+    assert reply.startswith('OK ')
+
+    with os.fdopen(to_child, 'w') as cmd_file, \
+            os.fdopen(from_child, 'r') as out_file:
+        cmd_file.write('print_call_stack\n')
+        cmd_file.flush()
+        assert out_file.readline() == 'PRINT_CALL_STACK\n'
+        assert out_file.readline() == '.\n'
+
+        # Closing the child's stdin should make it exit, closing its stdout
+        cmd_file.close()
+        assert out_file.read() == ''
+
+
+def test_bad_requests(server: str, tmp_path: pathlib.Path) -> None:
+    '''Check that the server rejects requests that it can't serve'''
+    with open(os.devnull, 'r+b') as null:
+        fds = [null.fileno()] * 4
+        env = dict(os.environ)
+        strings = _request_strings('/not/stepped.py', _KEY, str(tmp_path),
+                                   env, [])
+        reply = _request(server, strings, fds)
+        assert reply.startswith('ERROR ')
+        strings = _request_strings(_MODEL, _KEY, str(tmp_path), env, [])
+        reply = _request(server, strings, fds[:2])
+        assert reply.startswith('ERROR ')
+        reply = _request(server, [_MODEL, _KEY, str(tmp_path), '2', 'A=1'],
+                         fds)
+        assert reply.startswith('ERROR ')
+
+
+def test_child_cwd(server: str, tmp_path: pathlib.Path) -> None:
+    '''Check that the child runs in the client's working directory'''
+    child_in, to_child = os.pipe()
+    from_child, child_out = os.pipe()
+    dump_path = tmp_path / 'dmem'
+    env = dict(os.environ)
+    shm_path = tmp_path / 'shared'
+    shm_path.write_bytes(struct.pack('<II', 0, 0))
+    with open(shm_path, 'r+b') as shm:
+        fds = [child_in, child_out, 2, shm.fileno()]
+        strings = _request_strings(_MODEL, _KEY, str(tmp_path), env, [])
+        reply = _request(server, strings, fds)
+    os.close(child_in)
+    os.close(child_out)
+    assert reply.startswith('OK ')
+
+    with os.fdopen(to_child, 'w') as cmd_file, \
+            os.fdopen(from_child, 'r') as out_file:
+        # A relative path for dump_d should be relative to the client's cwd
+        cmd_file.write('dump_d dmem\n')
+        cmd_file.flush()
+        assert out_file.readline() == "DUMP_D 'dmem'\n"
+        assert out_file.readline() == '.\n'
+        assert dump_path.exists()
+
+
+def test_parse_env() -> None:
+    '''Check that the server splits the environment from the arguments'''
+    env = {'A': '1', 'B': 'x=y', 'EMPTY': ''}
+    strings = _request_strings(_MODEL, _KEY, '/', env, ['--verbose'])
+    assert fork_server._parse_env(strings[3:]) == (env, ['--verbose'])
+
+
+def test_stale_key(server_proc: subprocess.Popen, server: str,
+                   tmp_path: pathlib.Path) -> None:
+    '''A request with a different source key should make the server exit'''
+    with open(os.devnull, 'r+b') as null:
+        fds = [null.fileno()] * 4
+        strings = _request_strings(_MODEL, '00000000', str(tmp_path),
+                                   dict(os.environ), [])
+        assert _request(server, strings, fds) == 'STALE\n'
+    assert server_proc.wait(timeout=30) == 0
+    assert not os.path.exists(server)
+
+
+def test_socket_mode(server: str) -> None:
+    '''Only the user that started the server should be able to connect'''
+    assert os.stat(server).st_mode & 0o777 == 0o600
+
+
+def test_single_server(server: str) -> None:
+    '''A second server for the same socket should exit immediately'''
+    proc = subprocess.run([sys.executable, _SERVER, '--socket', server],
+                          timeout=30)
+    assert proc.returncode == 0
+    assert os.path.exists(server)
@@ -0,0 +1,369 @@
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Test the binary protocol that is used between ISSWrapper and stepped.py.'''
+
+import contextlib
+import io
+import pathlib
+import struct
+from typing import List, Tuple
+
+import pytest
+
+from sim.decode import decode_words
+from sim.iss_protocol import (COMMANDS, CYCLE_END_LINE, REC_CALL_STACK_ENTRY,
+                              REC_CYCLE_END, REC_EXT_REG, REC_LINE, REC_REGS,
+                              BinaryOutput, Output, decode_command,
+                              decode_response, encode_command, hello_payload,
+                              read_frame, write_frame)
+from sim.shared_mem import BYTES_PER_WORD, SharedMem
+from sim.sim import OTBNSim
+import stepped
+
+# A command sequence that runs the initial secure wipe (which needs two URND
+# seeds) and then inspects the resulting state.
+_URND_SEED = ['edn_urnd_step {:#x}'.format(0x1234 * (i + 1))
+              for i in range(8)] + ['step', 'edn_urnd_cdc_done']
+_WIPE = (['initial_secure_wipe'] +
+         _URND_SEED + ['step'] * 100 +
+         _URND_SEED + ['step'] * 100)
+_COMMANDS = (_WIPE +
+             ['run 5',
+              'print_regs',
+              'print_call_stack',
+              'set_keymgr_value {:#x} {:#x} 1'.format(3 << 380, 5),
+              'step_crc 0x123456789abc 0xffffffff'])
+
+
+def _run_text(sim: OTBNSim, line: str) -> List[str]:
+    '''Run a command in text mode, returning the lines of output'''
+    with contextlib.redirect_stdout(io.StringIO()) as out:
+        assert stepped.on_input(sim, line) is None
+    lines = out.getvalue().split('\n')
+    assert lines[-2:] == ['.', '']
+    return lines[:-2]
+
+
+def _run_binary(sim: OTBNSim, line: str) -> List[str]:
+    '''Run a command in binary mode, returning the equivalent text output
+
+    This encodes the command, decodes the response and then renders the
+    records as they would have appeared in text mode.
+
+    '''
+    words = line.split()
+    verb = words[0]
+    arg_types = dict(COMMANDS)[verb]
+    args = [word if arg_type == 0 else int(word, 0)
+            for word, arg_type in zip(words[1:], arg_types)]
+
+    stream = io.BytesIO()
+    assert stepped.on_frame(sim, encode_command(verb, args),
+                            BinaryOutput(stream)) is None
+    stream.seek(0)
+    payload = read_frame(stream)
+    assert payload is not None
+    assert read_frame(stream) is None
+
+    txt_out = Output()
+    with contextlib.redirect_stdout(io.StringIO()) as out:
+        for rec_type, data in decode_response(payload):
+            if rec_type == REC_LINE:
+                assert isinstance(data, str)
+                txt_out.line(data)
+            elif rec_type == REC_EXT_REG:
+                assert isinstance(data, tuple)
+                txt_out.ext_reg(data[0], data[1])
+            elif rec_type == REC_REGS:
+                assert isinstance(data, tuple)
+                txt_out.regs(data[0], data[1])
+            elif rec_type == REC_CYCLE_END:
+                txt_out.cycle_end()
+            else:
+                assert rec_type == REC_CALL_STACK_ENTRY
+                assert isinstance(data, int)
+                txt_out.call_stack_entry(data)
+    return out.getvalue().split('\n')[:-1]
+
+
+def _make_shared_mem(path: pathlib.Path, imem: bytes, dmem: bytes,
+                     monkeypatch: pytest.MonkeyPatch) -> None:
+    '''Build a shared memory region as ISSWrapper would, backed by a file
+
+    imem and dmem are the contents of the memories in the 5-byte format. The
+    region is installed as stepped.py's shared memory.
+
+    '''
+    imem_words = len(imem) // BYTES_PER_WORD
+    dmem_words = len(dmem) // BYTES_PER_WORD
+    path.write_bytes(struct.pack('<II', imem_words, dmem_words) +
+                     imem + dmem + bytes(dmem_words))
+    with open(path, 'r+b') as handle:
+        monkeypatch.setattr(stepped, '_SHARED_MEM',
+                            SharedMem(handle.fileno()))
+
+
+def test_command_round_trip() -> None:
+    '''Check that each command decodes to the arguments it was encoded with'''
+    for verb, arg_types in COMMANDS:
+        args = []  # type: List[object]
+        for idx, arg_type in enumerate(arg_types):
+            if arg_type == 0:
+                args.append('/some/path/{}'.format(idx))
+            else:
+                args.append((1 << (8 * arg_type)) - 1 - idx)
+
+        dec_verb, dec_args = decode_command(encode_command(verb, args))
+        assert dec_verb == verb
+        assert dec_args == [str(arg) for arg in args]
+
+
+def test_bad_commands() -> None:
+    '''Check that malformed command payloads are rejected'''
+    bad_payloads = [
+        b'',
+        bytes([0]),
+        bytes([len(COMMANDS) + 1]),
+        # step takes no arguments
+        encode_command('step', []) + b'\x00',
+        # edn_urnd_step needs 4 bytes of argument
+        encode_command('edn_urnd_step', [1])[:-1],
+        # load_d with a string that is longer than the payload
+        encode_command('load_d', ['abc'])[:-1],
+    ]
+    for payload in bad_payloads:
+        with pytest.raises(ValueError):
+            decode_command(payload)
+
+
+def test_framing() -> None:
+    '''Check that frames are length-prefixed and truncation is detected'''
+    stream = io.BytesIO()
+    write_frame(stream, hello_payload())
+    write_frame(stream, b'')
+    data = stream.getvalue()
+    assert data[:4] == bytes([6, 0, 0, 0])
+    assert data[4:8] == b'OTBN'
+
+    stream.seek(0)
+    assert read_frame(stream) == hello_payload()
+    assert read_frame(stream) == b''
+    assert read_frame(stream) is None
+
+    with pytest.raises(ValueError):
+        read_frame(io.BytesIO(data[:7]))
+
+
+def test_binary_matches_text() -> None:
+    '''Check that binary mode carries the same information as text mode'''
+    txt_sim = OTBNSim()
+    bin_sim = OTBNSim()
+    seen_ext_reg = False
+    for line in _COMMANDS:
+        txt_lines = _run_text(txt_sim, line)
+        assert _run_binary(bin_sim, line) == txt_lines
+        seen_ext_reg |= any(t.startswith('! otbn.') for t in txt_lines)
+
+    # Make sure the test actually exercised the external register records
+    assert seen_ext_reg
+
+
+def test_ext_reg_fallback() -> None:
+    '''Registers without a record type are sent as text lines'''
+    stream = io.BytesIO()
+    out = BinaryOutput(stream)
+    out.ext_reg('STATUS', 0xff)
+    out.ext_reg('CTRL', 1)
+    out.end()
+
+    stream.seek(0)
+    payload = read_frame(stream)
+    assert payload is not None
+    expected = [
+        (REC_EXT_REG, ('STATUS', 0xff)),
+        (REC_LINE, '! otbn.CTRL: 0x00000001')
+    ]  # type: List[Tuple[int, object]]
+    assert decode_response(payload) == expected
+
+
+def test_run_matches_step() -> None:
+    '''Check that the run command gives the same trace as repeated steps'''
+    # 40 x "addi x2, x2, 1", followed by "ecall"
+    words = [0x00110113] * 40 + [0x73]
+    program = decode_words(0, [(True, w) for w in words])
+    ecall_hdr = 'E PC: 0x{:08x}, insn: 0x00000073'.format(4 * len(words) - 4)
+
+    step_sim = OTBNSim()
+    run_sim = OTBNSim()
+    for sim in [step_sim, run_sim]:
+        sim.load_program(program)
+        for line in _WIPE + ['start_operation Execute'] + _URND_SEED:
+            _run_text(sim, line)
+
+    batch_sizes = []
+    for _ in range(len(words)):
+        run_lines = _run_text(run_sim, 'run 1000')
+        num_cycles = run_lines.count(CYCLE_END_LINE)
+        assert run_lines[-1] == CYCLE_END_LINE
+        batch_sizes.append(num_cycles)
+
+        step_lines = []
+        for _ in range(num_cycles):
+            step_lines += _run_text(step_sim, 'step')
+
+        assert [x for x in run_lines if x != CYCLE_END_LINE] == step_lines
+
+        if ecall_hdr in run_lines:
+            break
+    else:
+        assert False, 'Never saw ECALL.'
+
+    assert _run_text(run_sim, 'print_regs') == _run_text(step_sim,
+                                                         'print_regs')
+
+    # The straight-line code should have run as a single batch
+    assert max(batch_sizes) >= len(words) - 1
+
+
+def test_shared_mem(tmp_path: pathlib.Path,
+                    monkeypatch: pytest.MonkeyPatch) -> None:
+    '''Check the shared memory commands match their file-based equivalents'''
+    imem_words = 64
+    dmem_words = 1024
+    data_len = BYTES_PER_WORD * dmem_words
+    imem = b''.join(struct.pack('<BI', 1, 0x00110113) for _ in range(63))
+    imem += struct.pack('<BI', 1, 0x73)
+    dmem = b''.join(struct.pack('<BI', i % 3 != 0, 0x01010101 * (i & 0xff))
+                    for i in range(dmem_words))
+
+    region_path = tmp_path / 'shared'
+    _make_shared_mem(region_path, imem, dmem, monkeypatch)
+
+    (tmp_path / 'imem').write_bytes(imem)
+    (tmp_path / 'dmem').write_bytes(dmem)
+
+    shm_sim = OTBNSim()
+    file_sim = OTBNSim()
+    _run_text(shm_sim, 'load_i_shared')
+    _run_text(shm_sim, 'load_d_shared')
+    _run_text(file_sim, 'load_i {}'.format(tmp_path / 'imem'))
+    _run_text(file_sim, 'load_d {}'.format(tmp_path / 'dmem'))
+
+    assert ([insn.raw for insn in shm_sim.program] ==
+            [insn.raw for insn in file_sim.program])
+    assert shm_sim.dump_data() == file_sim.dump_data()
+
+    # Clobber the DMEM part of the region, then dump DMEM back to it
+    with open(region_path, 'r+b') as handle:
+        handle.seek(struct.calcsize('<II') + BYTES_PER_WORD * imem_words)
+        handle.write(bytes(data_len))
+    assert _run_binary(shm_sim, 'dump_d_shared') == ['DUMP_D_SHARED']
+    _run_text(file_sim, 'dump_d {}'.format(tmp_path / 'dmem_out'))
+
+    dumped = (tmp_path / 'dmem_out').read_bytes()
+    dmem_start = struct.calcsize('<II') + BYTES_PER_WORD * imem_words
+    region = region_path.read_bytes()
+    assert region[dmem_start:dmem_start + data_len] == dumped[:data_len]
+
+
+def test_dump_d_dirty(tmp_path: pathlib.Path,
+                      monkeypatch: pytest.MonkeyPatch) -> None:
+    '''Check that dump_d_dirty only writes the words that have changed'''
+    # 3 x "addi x2, x2, 1", then "sw x2, 8(x0)" and "ecall"
+    words = [0x00110113] * 3 + [0x00202423, 0x73]
+    imem = b''.join(struct.pack('<BI', 1, w) for w in words)
+    dmem_words = 1024
+    dmem = b''.join(struct.pack('<BI', 1, 0x01010101 * (i & 0xff))
+                    for i in range(dmem_words))
+    data_len = BYTES_PER_WORD * dmem_words
+
+    region_path = tmp_path / 'shared'
+    _make_shared_mem(region_path, imem, dmem, monkeypatch)
+    dmem_start = struct.calcsize('<II') + len(imem)
+    flags_start = dmem_start + data_len
+
+    def take_flags() -> List[int]:
+        with open(region_path, 'r+b') as handle:
+            handle.seek(flags_start)
+            flags = handle.read(dmem_words)
+            handle.seek(flags_start)
+            handle.write(bytes(dmem_words))
+        return [idx for idx, flag in enumerate(flags) if flag]
+
+    sim = OTBNSim()
+    _run_text(sim, 'load_i_shared')
+    _run_text(sim, 'load_d_shared')
+
+    # Nothing has changed since DMEM was loaded
+    assert _run_binary(sim, 'dump_d_dirty') == ['DUMP_D_DIRTY']
+    assert take_flags() == []
+
+    for line in _WIPE + ['start_operation Execute'] + _URND_SEED:
+        _run_text(sim, line)
+    for _ in range(10):
+        if 'E PC: 0x00000010, insn: 0x00000073' in _run_text(sim, 'run 100'):
+            break
+    else:
+        assert False, 'Never saw ECALL.'
+
+    # The store should have made word 2 dirty. After the dump, the region
+    # should hold all of DMEM.
+    assert _run_binary(sim, 'dump_d_dirty') == ['DUMP_D_DIRTY']
+    assert take_flags() == [2]
+    region = region_path.read_bytes()
+    assert region[dmem_start:flags_start] == sim.dump_data()[:data_len]
+
+    assert _run_binary(sim, 'dump_d_dirty') == ['DUMP_D_DIRTY']
+    assert take_flags() == []
+
+    # Invalidating DMEM changes every word
+    _run_text(sim, 'invalidate_dmem')
+    assert _run_binary(sim, 'dump_d_dirty') == ['DUMP_D_DIRTY']
+    assert take_flags() == list(range(dmem_words))
+    region = region_path.read_bytes()
+    assert region[dmem_start:flags_start] == bytes(data_len)
+
+
+def test_save_restore_state(tmp_path: pathlib.Path) -> None:
+    '''Check that a restored simulation carries on as the original would'''
+    # 20 x ("addi x2, x2, 1", "sw x2, 8(x0)"), followed by "ecall"
+    words = [0x00110113, 0x00202423] * 20 + [0x73]
+    program = decode_words(0, [(True, w) for w in words])
+    ecall_hdr = 'E PC: 0x{:08x}, insn: 0x00000073'.format(4 * len(words) - 4)
+
+    sim = OTBNSim()
+    sim.load_program(program)
+    for line in _WIPE + ['start_operation Execute'] + _URND_SEED:
+        _run_text(sim, line)
+    for _ in range(11):
+        _run_text(sim, 'step')
+
+    state_path = tmp_path / 'state'
+    assert (_run_binary(sim, 'save_state {}'.format(state_path)) ==
+            ['SAVE_STATE {!r}'.format(str(state_path))])
+
+    # Restoring replaces the simulator and reports the mirrored external
+    # registers (the operation is still running, so STATUS is BUSY_EXECUTE).
+    with contextlib.redirect_stdout(io.StringIO()) as out:
+        restored = stepped.on_input(OTBNSim(),
+                                    'restore_state {}'.format(state_path))
+    assert restored is not None
+    assert '! otbn.STATUS: 0x00000001' in out.getvalue().split('\n')
+
+    for _ in range(100):
+        lines = _run_text(sim, 'step')
+        assert _run_text(restored, 'step') == lines
+        if ecall_hdr in lines:
+            break
+    else:
+        assert False, 'Never saw ECALL.'
+
+    assert _run_text(restored, 'print_regs') == _run_text(sim, 'print_regs')
+    assert restored.dump_data() == sim.dump_data()
+
+    # Anything other than a saved state is rejected
+    (tmp_path / 'junk').write_bytes(b'\x00' * 64)
+    with pytest.raises(ValueError):
+        OTBNSim.load_state(str(tmp_path / 'junk'))
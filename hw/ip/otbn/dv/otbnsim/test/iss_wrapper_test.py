@@ -0,0 +1,57 @@
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Build and run the ISSWrapper run-ahead test (dv/model/iss_wrapper_test.cc)
+
+This checks that the wrapper gives the same results when it runs the ISS
+ahead of the RTL (on the main thread or on a worker) as it does in lockstep.
+It needs a C++ compiler, which is taken from CXX (defaulting to g++), and is
+skipped if there isn't one.
+
+'''
+
+import os
+import pathlib
+import shutil
+import subprocess
+
+import pytest
+
+from testutil import OTBN_DIR
+
+_MODEL_DIR = os.path.join(OTBN_DIR, 'dv', 'model')
+_TRACER_DIR = os.path.join(OTBN_DIR, 'dv', 'tracer', 'cpp')
+_SOURCES = ['iss_wrapper_test.cc', 'iss_wrapper.cc', 'iss_protocol.cc',
+            'native_iss.cc']
+
+# The flags used for the model in the otbn_top_sim build, plus -Werror so that
+# the model and the test stay warning-clean.
+_CXXFLAGS = ['-std=c++11', '-O2', '-pthread', '-Wall', '-Werror']
+
+
+@pytest.fixture(scope='module')
+def test_binary(tmp_path_factory: pytest.TempPathFactory) -> pathlib.Path:
+    '''Compile iss_wrapper_test, returning the path to the binary'''
+    cxx = os.environ.get('CXX', 'g++')
+    if shutil.which(cxx) is None:
+        pytest.skip('No C++ compiler ({}) found.'.format(cxx))
+
+    binary = tmp_path_factory.mktemp('iss_wrapper') / 'iss_wrapper_test'
+    subprocess.run([cxx] + _CXXFLAGS + ['-I', _TRACER_DIR, '-o', str(binary)] +
+                   [os.path.join(_MODEL_DIR, src) for src in _SOURCES],
+                   check=True)
+    return binary
+
+
+@pytest.mark.parametrize('backend', ['native', 'python', 'cross'])
+def test_iss_wrapper(test_binary: pathlib.Path, backend: str) -> None:
+    env = dict(os.environ,
+               OTBN_ISS_BACKEND=backend,
+               REPO_TOP=os.path.realpath(os.path.join(OTBN_DIR, '../../..')))
+    env.pop('OTBN_ISS_FORK_SERVER', None)
+    result = subprocess.run([str(test_binary)], env=env,
+                            stdout=subprocess.PIPE, universal_newlines=True,
+                            timeout=600)
+    assert result.returncode == 0
+    assert result.stdout == 'PASS\n'
@@ -0,0 +1,248 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Check that bn.addvm takes q from the bottom element of MOD. MOD
+  holds q in element 0 and q' = -q^-1 mod 2^size in element 1,
+  which is a different value. Above those, the 16, 32 and 64-bit
+  moduli have random bits that must be ignored too. Each vector has
+  elements where q <= a + b, so a version that compared the sum
+  with q' or with the whole of MOD would give a different result.
+  Results are stored in WDRs:
+  16b: w10
+  32b: w11
+  64b: w12
+  128b: w13
+*/
+
+addi x2, x0, 0
+la     x3, vec16a
+bn.lid x2++, 0(x3)
+la     x3, vec16b
+bn.lid x2++, 0(x3)
+la     x3, vec32a
+bn.lid x2++, 0(x3)
+la     x3, vec32b
+bn.lid x2++, 0(x3)
+la     x3, vec64a
+bn.lid x2++, 0(x3)
+la     x3, vec64b
+bn.lid x2++, 0(x3)
+la     x3, vec128a
+bn.lid x2++, 0(x3)
+la     x3, vec128b
+bn.lid x2++, 0(x3)
+
+/* load each modulus into w20 and then into MOD */
+/* MOD <= dmem[modulus] = rest || q' || q */
+li           x2, 20
+la           x3, mod16
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.addvm.16H w10, w0, w1
+
+li           x2, 20
+la           x3, mod32
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.addvm.8S  w11, w2, w3
+
+li           x2, 20
+la           x3, mod64
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.addvm.4D  w12, w4, w5
+
+li           x2, 20
+la           x3, mod128
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.addvm.2Q  w13, w6, w7
+
+addi x2, x0, 0 /* reset x2*/
+addi x3, x0, 0 /* reset x3*/
+
+ecall
+
+.section .data
+/*
+  16bit vector vec16a for instruction addvm
+  vec16a = [1292, 3254, 807, 2812, 509, 393, 2313, 142, 3102, 1939, 1248, 1, 0, 3328, 3328, 3328]
+  vec16a = 0x050c0cb603270afc01fd01890909008e0c1e079304e0000100000d000d000d00
+*/
+vec16a:
+  .word 0x0d000d00
+  .word 0x00000d00
+  .word 0x04e00001
+  .word 0x0c1e0793
+  .word 0x0909008e
+  .word 0x01fd0189
+  .word 0x03270afc
+  .word 0x050c0cb6
+
+/*
+  16bit vector vec16b for instruction addvm
+  vec16b = [741, 2559, 2098, 2985, 2358, 2410, 1737, 1252, 1047, 173, 2606, 3327, 0, 0, 1, 3328]
+  vec16b = 0x02e509ff08320ba90936096a06c904e4041700ad0a2e0cff0000000000010d00
+*/
+vec16b:
+  .word 0x00010d00
+  .word 0x00000000
+  .word 0x0a2e0cff
+  .word 0x041700ad
+  .word 0x06c904e4
+  .word 0x0936096a
+  .word 0x08320ba9
+  .word 0x02e509ff
+
+/*
+  32bit vector vec32a for instruction addvm
+  vec32a = [5037784, 5687955, 6992383, 7409757, 0, 8380416, 8380416, 8380416]
+  vec32a = 0x004cded80056ca93006ab1ff0071105d00000000007fe000007fe000007fe000
+*/
+vec32a:
+  .word 0x007fe000
+  .word 0x007fe000
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x0071105d
+  .word 0x006ab1ff
+  .word 0x0056ca93
+  .word 0x004cded8
+
+/*
+  32bit vector vec32b for instruction addvm
+  vec32b = [4888680, 823977, 5335402, 8163008, 0, 0, 1, 8380416]
+  vec32b = 0x004a9868000c92a90051696a007c8ec0000000000000000000000001007fe000
+*/
+vec32b:
+  .word 0x007fe000
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x007c8ec0
+  .word 0x0051696a
+  .word 0x000c92a9
+  .word 0x004a9868
+
+/*
+  64bit vector vec64a for instruction addvm
+  vec64a = [162261824644618653, 371085057019272243, 2305843009213693950, 2305843009213693950]
+  vec64a = 0x02407845128c999d05265be4ad16dc331ffffffffffffffe1ffffffffffffffe
+*/
+vec64a:
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0xad16dc33
+  .word 0x05265be4
+  .word 0x128c999d
+  .word 0x02407845
+
+/*
+  64bit vector vec64b for instruction addvm
+  vec64b = [1298369027630470667, 1062402228232331529, 1, 2305843009213693950]
+  vec64b = 0x1204bbc06748960b0ebe69329e5f210900000000000000011ffffffffffffffe
+*/
+vec64b:
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x9e5f2109
+  .word 0x0ebe6932
+  .word 0x6748960b
+  .word 0x1204bbc0
+
+/*
+  128bit vector vec128a for instruction addvm
+  vec128a = [170141183460469231731687303715884105726, 170141183460469231731687303715884105726]
+  vec128a = 0x7ffffffffffffffffffffffffffffffe7ffffffffffffffffffffffffffffffe
+*/
+vec128a:
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+
+/*
+  128bit vector vec128b for instruction addvm
+  vec128b = [1, 170141183460469231731687303715884105726]
+  vec128b = 0x000000000000000000000000000000017ffffffffffffffffffffffffffffffe
+*/
+vec128b:
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  16bit modulus mod16 for instruction addvm
+  q = 3329, q' = 3327
+  mod16 = 0x36cbb40403ed3511d7ec202ad7f20e07ed4202edc4bb895c608099f60cff0d01
+*/
+mod16:
+  .word 0x0cff0d01
+  .word 0x608099f6
+  .word 0xc4bb895c
+  .word 0xed4202ed
+  .word 0xd7f20e07
+  .word 0xd7ec202a
+  .word 0x03ed3511
+  .word 0x36cbb404
+
+/*
+  32bit modulus mod32 for instruction addvm
+  q = 8380417, q' = 4236238847
+  mod32 = 0x1a9eb423864f96bf782a3ae88384a7f75bd2470b8c7d3846fc7fdfff007fe001
+*/
+mod32:
+  .word 0x007fe001
+  .word 0xfc7fdfff
+  .word 0x8c7d3846
+  .word 0x5bd2470b
+  .word 0x8384a7f7
+  .word 0x782a3ae8
+  .word 0x864f96bf
+  .word 0x1a9eb423
+
+/*
+  64bit modulus mod64 for instruction addvm
+  q = 2305843009213693951, q' = 2305843009213693953
+  mod64 = 0x307c48265a6c49686a17d2205b3627fc20000000000000011fffffffffffffff
+*/
+mod64:
+  .word 0xffffffff
+  .word 0x1fffffff
+  .word 0x00000001
+  .word 0x20000000
+  .word 0x5b3627fc
+  .word 0x6a17d220
+  .word 0x5a6c4968
+  .word 0x307c4826
+
+/*
+  128bit modulus mod128 for instruction addvm
+  q = 170141183460469231731687303715884105727, q' = 170141183460469231731687303715884105729
+  mod128 = 0x800000000000000000000000000000017fffffffffffffffffffffffffffffff
+*/
+mod128:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
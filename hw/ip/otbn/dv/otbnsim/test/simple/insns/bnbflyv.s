@@ -0,0 +1,417 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  For each datatype, load MOD, a into w0, b into w1, the twiddle factors into
+  w2 and their inverses into w3. The multiplications are Montgomery products
+  with R = 2^size, so w3 holds w^-1 * R^2 mod q to undo the factor w * R^-1
+  applied by the forward butterfly. Then
+  - compute the butterflies with bn.mulvm, bn.addvm and bn.subvm as a
+    reference,
+  - compute a forward butterfly in place on copies of a and b,
+  - undo it with an inverse butterfly with the inverse twiddle factors on
+    copies of the result, which gives 2a and 2b.
+
+  The bottom elements of each vector check the modular wrap at q - 1 and 0.
+  Their twiddle factor is R mod q, so w * b * R^-1 = b and the butterfly
+  computes a + b and a - b, where each of a and b is 0, 1 or q - 1 (see
+  the data).
+*/
+
+/* 16bit */
+addi          x2, x0, 0
+la            x3, mod16
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w0
+
+addi          x2, x0, 0
+la            x3, vec16a
+bn.lid        x2++, 0(x3)
+la            x3, vec16b
+bn.lid        x2++, 0(x3)
+la            x3, vec16w
+bn.lid        x2++, 0(x3)
+la            x3, vec16wi
+bn.lid        x2++, 0(x3)
+
+bn.mulvm.16H  w4, w1, w2
+bn.addvm.16H  w10, w0, w4
+bn.subvm.16H  w11, w0, w4
+
+bn.mov        w14, w0
+bn.mov        w15, w1
+bn.bflyv.16H  w14, w15, w2
+
+bn.mov        w16, w14
+bn.mov        w17, w15
+bn.ibflyv.16H w16, w17, w3
+
+/* 32bit */
+addi          x2, x0, 0
+la            x3, mod32
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w0
+
+addi          x2, x0, 0
+la            x3, vec32a
+bn.lid        x2++, 0(x3)
+la            x3, vec32b
+bn.lid        x2++, 0(x3)
+la            x3, vec32w
+bn.lid        x2++, 0(x3)
+la            x3, vec32wi
+bn.lid        x2++, 0(x3)
+
+bn.mulvm.8S   w4, w1, w2
+bn.addvm.8S   w12, w0, w4
+bn.subvm.8S   w13, w0, w4
+
+bn.mov        w18, w0
+bn.mov        w19, w1
+bn.bflyv.8S   w18, w19, w2
+
+bn.mov        w20, w18
+bn.mov        w21, w19
+bn.ibflyv.8S  w20, w21, w3
+
+/* 64bit */
+addi          x2, x0, 0
+la            x3, mod64
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w0
+
+addi          x2, x0, 0
+la            x3, vec64a
+bn.lid        x2++, 0(x3)
+la            x3, vec64b
+bn.lid        x2++, 0(x3)
+la            x3, vec64w
+bn.lid        x2++, 0(x3)
+la            x3, vec64wi
+bn.lid        x2++, 0(x3)
+
+bn.mulvm.4D   w4, w1, w2
+bn.addvm.4D   w22, w0, w4
+bn.subvm.4D   w23, w0, w4
+
+bn.mov        w24, w0
+bn.mov        w25, w1
+bn.bflyv.4D   w24, w25, w2
+
+bn.mov        w26, w24
+bn.mov        w27, w25
+bn.ibflyv.4D  w26, w27, w3
+
+/* 128bit */
+addi          x2, x0, 0
+la            x3, mod128
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w0
+
+addi          x2, x0, 0
+la            x3, vec128a
+bn.lid        x2++, 0(x3)
+la            x3, vec128b
+bn.lid        x2++, 0(x3)
+la            x3, vec128w
+bn.lid        x2++, 0(x3)
+la            x3, vec128wi
+bn.lid        x2++, 0(x3)
+
+bn.mulvm.2Q   w4, w1, w2
+bn.addvm.2Q   w5, w0, w4
+bn.subvm.2Q   w6, w0, w4
+
+bn.mov        w28, w0
+bn.mov        w29, w1
+bn.bflyv.2Q   w28, w29, w2
+
+bn.mov        w30, w28
+bn.mov        w31, w29
+bn.ibflyv.2Q  w30, w31, w3
+
+ecall
+
+.section .data
+
+/*
+  q = 3329 (ML-KEM), q' = -q^-1 mod 2^16
+*/
+mod16:
+  .word 0x0cff0d01
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  a, each element in [0, q). In the forward butterfly, the wrap cases in
+  elements 0 to 5 are:
+    0: q - 1 + 1 wraps to 0
+    1: 0 - 1 wraps to q - 1
+    2: (q - 1) + (q - 1) wraps to q - 2
+    3: 0 - (q - 1) wraps to 1
+    4: q - 1 + 0 stays at q - 1
+    5: 0 - 0 stays at 0
+*/
+vec16a:
+  .word 0x00000d00
+  .word 0x00000d00
+  .word 0x00000d00
+  .word 0x02b5031b
+  .word 0x0ae80abb
+  .word 0x0b4b0177
+  .word 0x026b0c1f
+  .word 0x0b4e0ce6
+
+/*
+  b, each element in [0, q)
+*/
+vec16b:
+  .word 0x00010001
+  .word 0x0d000d00
+  .word 0x00000000
+  .word 0x0a290b89
+  .word 0x007301d9
+  .word 0x02b20845
+  .word 0x0bd307dc
+  .word 0x0ae8071b
+
+/*
+  twiddle factors w (R mod q for the wrap cases)
+*/
+vec16w:
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x028609c9
+  .word 0x053b0ae7
+  .word 0x013204e3
+  .word 0x0a6308ad
+  .word 0x0a9305e0
+
+/*
+  w^-1 * R^2 mod q
+*/
+vec16wi:
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x086700a4
+  .word 0x0b9c080a
+  .word 0x04bc03df
+  .word 0x02750092
+  .word 0x073f0b45
+
+/*
+  q = 8380417 (ML-DSA), q' = -q^-1 mod 2^32
+*/
+mod32:
+  .word 0x007fe001
+  .word 0xfc7fdfff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  a, each element in [0, q). In the forward butterfly, the wrap cases in
+  elements 0 to 5 are:
+    0: q - 1 + 1 wraps to 0
+    1: 0 - 1 wraps to q - 1
+    2: (q - 1) + (q - 1) wraps to q - 2
+    3: 0 - (q - 1) wraps to 1
+    4: q - 1 + 0 stays at q - 1
+    5: 0 - 0 stays at 0
+*/
+vec32a:
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x00728825
+  .word 0x005f1af9
+
+/*
+  b, each element in [0, q)
+*/
+vec32b:
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x007fe000
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x006647f6
+  .word 0x00139344
+
+/*
+  twiddle factors w (R mod q for the wrap cases)
+*/
+vec32w:
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x002219cc
+  .word 0x0047f81f
+
+/*
+  w^-1 * R^2 mod q
+*/
+vec32wi:
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x003ffe00
+  .word 0x00008cd1
+  .word 0x00323a05
+
+/*
+  q = 2^61 - 1, q' = -q^-1 mod 2^64
+*/
+mod64:
+  .word 0xffffffff
+  .word 0x1fffffff
+  .word 0x00000001
+  .word 0x20000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  a, each element in [0, q). In the forward butterfly, the wrap cases in
+  elements 0 to 2 are:
+    0: q - 1 + 1 wraps to 0
+    1: 0 - 1 wraps to q - 1
+    2: (q - 1) + (q - 1) wraps to q - 2
+*/
+vec64a:
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0xff8f735c
+  .word 0x055ac3aa
+
+/*
+  b, each element in [0, q)
+*/
+vec64b:
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000001
+  .word 0x00000000
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0xc1fb0cf7
+  .word 0x1ff5b40c
+
+/*
+  twiddle factors w (R mod q for the wrap cases)
+*/
+vec64w:
+  .word 0x00000008
+  .word 0x00000000
+  .word 0x00000008
+  .word 0x00000000
+  .word 0x00000008
+  .word 0x00000000
+  .word 0xc414d39e
+  .word 0x00682247
+
+/*
+  w^-1 * R^2 mod q
+*/
+vec64wi:
+  .word 0x00000008
+  .word 0x00000000
+  .word 0x00000008
+  .word 0x00000000
+  .word 0x00000008
+  .word 0x00000000
+  .word 0x4046a98c
+  .word 0x01919d5c
+
+/*
+  q = 2^127 - 1, q' = -q^-1 mod 2^128
+*/
+mod128:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
+
+/*
+  a, each element in [0, q). In the forward butterfly, the wrap cases in
+  element 0 is:
+    0: q - 1 + 1 wraps to 0
+*/
+vec128a:
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0xfce799cd
+  .word 0xa29af482
+  .word 0x1d978d8c
+  .word 0x039b15f5
+
+/*
+  b, each element in [0, q)
+*/
+vec128b:
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0xbd38e7e2
+  .word 0xd860055b
+  .word 0x71b791cd
+  .word 0x5746f214
+
+/*
+  twiddle factors w (R mod q for the wrap cases)
+*/
+vec128w:
+  .word 0x00000002
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x15ca51b0
+  .word 0xafee4ee3
+  .word 0xc2b3cb62
+  .word 0x208013e3
+
+/*
+  w^-1 * R^2 mod q
+*/
+vec128wi:
+  .word 0x00000002
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x0e58d7ce
+  .word 0x4ae52df0
+  .word 0x6294c736
+  .word 0x742f2e6d
@@ -0,0 +1,176 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Check that bn.mulvl and bn.mulvml only use the bits of the lane index
+  that are needed to index an element of the datatype. Each lane here is
+  too big for its datatype, so the instruction uses the lane given by
+  its bottom bits instead.
+  Results are ordered as the instructions below:
+  bn.mulvl:  w10 to w17
+  bn.mulvml: w18 to w25
+*/
+
+addi x2, x0, 0
+la     x3, veca
+bn.lid x2++, 0(x3)
+la     x3, vecb
+bn.lid x2++, 0(x3)
+la     x3, vecma
+bn.lid x2++, 0(x3)
+la     x3, vecmb
+bn.lid x2++, 0(x3)
+
+/* 32bit: lanes 8, 15 use lanes 0, 7 */
+bn.mulvl.8S  w10, w0, w1, 8
+bn.mulvl.8S  w11, w0, w1, 15
+
+/* 64bit: lanes 4, 7, 13 use lanes 0, 3, 1 */
+bn.mulvl.4D  w12, w0, w1, 4
+bn.mulvl.4D  w13, w0, w1, 7
+bn.mulvl.4D  w14, w0, w1, 13
+
+/* 128bit: lanes 2, 3, 15 use lanes 0, 1, 1 */
+bn.mulvl.2Q  w15, w0, w1, 2
+bn.mulvl.2Q  w16, w0, w1, 3
+bn.mulvl.2Q  w17, w0, w1, 15
+
+/*
+  x2 is 4 after loading the vectors, so each modulus goes through w4
+  on its way to MOD.
+*/
+/* 32bit modular: lanes 8, 15 use lanes 0, 7 */
+la           x3, mod32
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w4
+bn.mulvml.8S  w18, w2, w3, 8
+bn.mulvml.8S  w19, w2, w3, 15
+
+/* 64bit modular: lanes 4, 7, 13 use lanes 0, 3, 1 */
+la           x3, mod64
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w4
+bn.mulvml.4D  w20, w2, w3, 4
+bn.mulvml.4D  w21, w2, w3, 7
+bn.mulvml.4D  w22, w2, w3, 13
+
+/* 128bit modular: lanes 2, 3, 15 use lanes 0, 1, 1 */
+la           x3, mod128
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w4
+bn.mulvml.2Q  w23, w2, w3, 2
+bn.mulvml.2Q  w24, w2, w3, 3
+bn.mulvml.2Q  w25, w2, w3, 15
+
+addi x2, x0, 0 /* reset x2*/
+addi x3, x0, 0 /* reset x3*/
+
+ecall
+
+.section .data
+/*
+  vector veca for instruction mulvl
+  veca = [3621853979, 2057720845, 1207989654, 2727303991, 1795425522, 2962526392, 1795269057, 708452615]
+  veca = 0xd7e11b1b7aa6540d48007596a28f5b376b0404f2b09490b86b01a1c12a3a2107
+*/
+veca:
+  .word 0x2a3a2107
+  .word 0x6b01a1c1
+  .word 0xb09490b8
+  .word 0x6b0404f2
+  .word 0xa28f5b37
+  .word 0x48007596
+  .word 0x7aa6540d
+  .word 0xd7e11b1b
+
+/*
+  vector vecb for instruction mulvl
+  vecb = [788475666, 2200982799, 4136977080, 3469707799, 2038594426, 3404334360, 4250820323, 927774550]
+  vecb = 0x2eff2f128330550ff69542b8cecf8a1779827b7acaea0518fd5e5ee3374cb756
+*/
+vecb:
+  .word 0x374cb756
+  .word 0xfd5e5ee3
+  .word 0xcaea0518
+  .word 0x79827b7a
+  .word 0xcecf8a17
+  .word 0xf69542b8
+  .word 0x8330550f
+  .word 0x2eff2f12
+
+/*
+  vector vecma for instruction mulvml
+  vecma = [7824710, 3112565, 118458, 26681, 6613608, 1980184, 4425395, 4236952]
+  vecma = 0x00776546002f7e750001ceba000068390064ea68001e3718004386b30040a698
+*/
+vecma:
+  .word 0x0040a698
+  .word 0x004386b3
+  .word 0x001e3718
+  .word 0x0064ea68
+  .word 0x00006839
+  .word 0x0001ceba
+  .word 0x002f7e75
+  .word 0x00776546
+
+/*
+  vector vecmb for instruction mulvml
+  vecmb = [7730060, 1948276, 6302530, 6658466, 1215694, 581034, 3591927, 4910376]
+  vecmb = 0x0075f38c001dba7400602b42006599a200128cce0008ddaa0036cef7004aed28
+*/
+vecmb:
+  .word 0x004aed28
+  .word 0x0036cef7
+  .word 0x0008ddaa
+  .word 0x00128cce
+  .word 0x006599a2
+  .word 0x00602b42
+  .word 0x001dba74
+  .word 0x0075f38c
+
+/*
+  32bit modulus mod32 for instruction mulvml
+  mod32 = [4236238847, 8380417]
+  mod32 = 0x000000000000000000000000000000000000000000000000fc7fdfff007fe001
+*/
+mod32:
+  .word 0x007fe001
+  .word 0xfc7fdfff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  64bit modulus mod64 for instruction mulvml
+  mod64 = [2305843009213693953, 2305843009213693951]
+  mod64 = 0x0000000000000000000000000000000020000000000000011fffffffffffffff
+*/
+mod64:
+  .word 0xffffffff
+  .word 0x1fffffff
+  .word 0x00000001
+  .word 0x20000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  128bit modulus mod128 for instruction mulvml
+  mod128 = [170141183460469231731687303715884105729, 170141183460469231731687303715884105727]
+  mod128 = 0x800000000000000000000000000000017fffffffffffffffffffffffffffffff
+*/
+mod128:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
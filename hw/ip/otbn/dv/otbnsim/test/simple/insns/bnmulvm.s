@@ -34,7 +34,7 @@ la     x3, vec128b1
 bn.lid x2++, 0(x3)
 
 /* load the modulus into w20 and then into MOD*/
-/* MOD <= dmem[modulus] = p */
+/* MOD <= dmem[modulus] = q' || q */
 li           x2, 20
 la           x3, mod16
 bn.lid       x2, 0(x3)
@@ -42,7 +42,7 @@ bn.wsrw      MOD, w20
 bn.mulvm.16H w10, w0, w1
 
 /* load the modulus into w20 and then into MOD*/
-/* MOD <= dmem[modulus] = p */
+/* MOD <= dmem[modulus] = q' || q */
 li           x2, 20
 la           x3, mod32
 bn.lid       x2, 0(x3)
@@ -50,7 +50,7 @@ bn.wsrw      MOD, w20
 bn.mulvm.8S  w11, w2, w3
 
 /* load the modulus into w20 and then into MOD*/
-/* MOD <= dmem[modulus] = p */
+/* MOD <= dmem[modulus] = q' || q */
 li           x2, 20
 la           x3, mod64
 bn.lid       x2, 0(x3)
@@ -58,7 +58,7 @@ bn.wsrw      MOD, w20
 bn.mulvm.4D  w12, w4, w5
 
 /* load the modulus into w20 and then into MOD*/
-/* MOD <= dmem[modulus] = p */
+/* MOD <= dmem[modulus] = q' || q */
 li           x2, 20
 la           x3, mod128
 bn.lid       x2, 0(x3)
@@ -75,11 +75,11 @@ ecall
 .section .data
 /*
   16bit vector mod16 for instruction mulvm
-  mod16 = [7583]
-  mod16 = 0x0000000000000000000000000000000000000000000000000000000000001d9f
+  mod16 = [7583, 16801]
+  mod16 = 0x0000000000000000000000000000000000000000000000000000000041a11d9f
 */
 mod16:
-  .word 0x00001d9f
+  .word 0x41a11d9f
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -120,18 +120,18 @@ vec16b0:
 
 /*
   Result of 16bit mulvm
-  res = [0, 5040, 1050, 3772, 2324, 5129, 7169, 5871, 1480, 62, 3300, 2019, 630, 2689, 3312, 6439]
-  res = 0x000013b0041a0ebc091414091c0116ef05c8003e0ce407e302760a810cf01927
+  res = [0, 524, 1373, 7, 5971, 6714, 6565, 809, 3163, 6783, 7565, 4525, 3857, 2729, 561, 5466]
+  res = 0x0000020c055d000717531a3a19a503290c5b1a7f1d8d11ad0f110aa90231155a
 */
 
 /*
   32bit vector mod32 for instruction mulvm
-  mod32 = [8380417]
-  mod32 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod32 = [8380417, 4236238847]
+  mod32 = 0x000000000000000000000000000000000000000000000000fc7fdfff007fe001
 */
 mod32:
   .word 0x007fe001
-  .word 0x00000000
+  .word 0xfc7fdfff
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -171,20 +171,20 @@ vec32b0:
 
 /*
   Result of 32bit mulvm
-  res = [0, 833365, 4819076, 3443797, 5900631, 6728368, 3940053, 6671840]
-  res = 0x00000000000cb7550049888400348c55005a09570066aab0003c1ed50065cde0
+  res = [0, 6270052, 21223, 2250706, 457676, 6359395, 4792916, 5953630]
+  res = 0x00000000005fac64000052e7002257d20006fbcc0061096300492254005ad85e
 */
 
 /*
   64bit vector mod64 for instruction mulvm
-  mod64 = [8380417]
-  mod64 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod64 = [8380417, 16714476285912408063]
+  mod64 = 0x00000000000000000000000000000000e7f5bf9ffc7fdfff00000000007fe001
 */
 mod64:
   .word 0x007fe001
   .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
+  .word 0xfc7fdfff
+  .word 0xe7f5bf9f
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -222,24 +222,24 @@ vec64b0:
 
 /*
   Result of 64bit mulvm
-  res = [0, 6736375, 5386136, 101487]
-  res = 0x0000000000000000000000000066c9f70000000000522f980000000000018c6f
+  res = [0, 893988, 1877081, 6022602]
+  res = 0x000000000000000000000000000da42400000000001ca45900000000005be5ca
 */
 
 /*
   128bit vector mod128 for instruction mulvm
-  mod128 = [8380417]
-  mod128 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod128 = [8380417, 2984062896558332194971546556068519935]
+  mod128 = 0x023eb5a8eccfe21ee7f5bf9ffc7fdfff000000000000000000000000007fe001
 */
 mod128:
   .word 0x007fe001
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
+  .word 0xfc7fdfff
+  .word 0xe7f5bf9f
+  .word 0xeccfe21e
+  .word 0x023eb5a8
 
 /*
   128bit vector vec128a0 for instruction mulvm
@@ -303,12 +303,13 @@ vec128b1:
 
 /*
   Result of 128bit mulvm
-  res = [0, 3871254]
-  res = 0x00000000000000000000000000000000000000000000000000000000003b1216
+  res = [0, 3931398]
+  res = 0x00000000000000000000000000000000000000000000000000000000003bfd06
 */
 
 /*
   Result of 128bit mulvm
-  res = [4265058, 6051552]
-  res = 0x00000000000000000000000000411462000000000000000000000000005c56e0
+  res = [7401261, 2638676]
+  res = 0x0000000000000000000000000070ef2d00000000000000000000000000284354
 */
+
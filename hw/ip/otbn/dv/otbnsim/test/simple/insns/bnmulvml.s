@@ -15,7 +15,7 @@
 */
 
 /* load the modulus into w0 and then into MOD*/
-/* MOD <= dmem[modulus] = p */
+/* MOD <= dmem[modulus] = q' || q */
 addi x2, x0, 0
 li           x2, 0
 la           x3, mod16
@@ -104,11 +104,11 @@ ecall
 .section .data
 /*
   16bit vector mod16 for instruction mulvml
-  mod16 = [7583]
-  mod16 = 0x0000000000000000000000000000000000000000000000000000000000001d9f
+  mod16 = [7583, 16801]
+  mod16 = 0x0000000000000000000000000000000000000000000000000000000041a11d9f
 */
 mod16:
-  .word 0x00001d9f
+  .word 0x41a11d9f
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -149,108 +149,108 @@ vec16b:
 
 /*
   Result of 16bit mulvlm index 0
-  res = [0, 47, 1598, 2726, 7379, 1081, 2804, 7473, 6956, 2914, 1551, 6063, 705, 7426, 1692, 6439]
-  res = 0x0000002f063e0aa61cd304390af41d311b2c0b62060f17af02c11d02069c1927
+  res = [0, 372, 5065, 6410, 5323, 973, 6382, 6067, 1975, 315, 4693, 2490, 5580, 5695, 5809, 5466]
+  res = 0x0000017413c9190a14cb03cd18ee17b307b7013b125509ba15cc163f16b1155a
 */
 
 /*
   Result of 16bit mulvlm index 1
-  res = [0, 92, 3128, 5336, 6861, 2116, 5166, 7045, 6033, 5704, 3036, 4285, 1380, 6953, 3312, 5021]
-  res = 0x0000005c0c3814d81acd0844142e1b85179116480bdc10bd05641b290cf0139d
+  res = [0, 4439, 6849, 7223, 6870, 3518, 2812, 582, 4834, 2230, 2410, 3906, 5921, 3726, 561, 1503]
+  res = 0x000011571ac11c371ad60dbe0afc024612e208b6096a0f4217210e8e023105df
 */
 
 /*
   Result of 16bit mulvlm index 2
-  res = [0, 161, 5474, 1755, 2528, 3703, 5249, 2850, 1079, 2399, 5313, 5603, 2415, 2689, 5796, 6891]
-  res = 0x000000a1156206db09e00e7714810b220437095f14c115e3096f0a8116a41aeb
+  res = [0, 2081, 2507, 6953, 648, 2365, 4921, 4810, 4668, 111, 426, 3044, 883, 2729, 6669, 4526]
+  res = 0x0000082109cb1b290288093d133912ca123c006f01aa0be403730aa91a0d11ae
 */
 
 /*
   Result of 16bit mulvlm index 3
-  res = [0, 42, 1428, 2436, 6594, 966, 1699, 6678, 6216, 2604, 1386, 5418, 630, 6636, 1512, 5754]
-  res = 0x0000002a0594098419c203c606a31a1618480a2c056a152a027619ec05e8167a
+  res = [0, 5818, 654, 3792, 3466, 4903, 4251, 7519, 4185, 4315, 2419, 7388, 3857, 1701, 4707, 851]
+  res = 0x000016ba028e0ed00d8a1327109b1d5f105910db09731cdc0f1106a512630353
 */
 
 /*
   Result of 16bit mulvlm index 4
-  res = [0, 192, 6528, 3553, 7395, 4416, 4517, 196, 5667, 4321, 6336, 2019, 2880, 4, 6912, 3555]
-  res = 0x000000c019800de11ce3114011a500c4162310e118c007e30b4000041b000de3
+  res = [0, 1681, 4073, 6502, 6095, 748, 7517, 1874, 6132, 5643, 2392, 4525, 2466, 193, 7435, 2807]
+  res = 0x000006910fe9196617cf02ec1d5d075217f4160b095811ad09a200c11d0b0af7
 */
 
 /*
   Result of 16bit mulvlm index 5
-  res = [0, 100, 3400, 5800, 534, 2300, 6934, 734, 7217, 6200, 3300, 5317, 1500, 634, 3600, 6117]
-  res = 0x000000640d4816a8021608fc1b1602de1c3118380ce414c505dc027a0e1017e5
+  res = [0, 4825, 4807, 6862, 6808, 4813, 4705, 1292, 1298, 3413, 7565, 619, 4128, 4050, 6874, 1304]
+  res = 0x000012d912c71ace1a9812cd1261050c05120d551d8d026b10200fd21ada0518
 */
 
 /*
   Result of 16bit mulvlm index 6
-  res = [0, 1, 34, 58, 157, 23, 221, 159, 148, 62, 33, 129, 15, 158, 36, 137]
-  res = 0x000000010022003a009d001700dd009f0094003e00210081000f009e00240089
+  res = [0, 1944, 5432, 6590, 1888, 6797, 4976, 5776, 7141, 6783, 3488, 537, 6411, 3832, 1737, 923]
+  res = 0x00000798153819be07601a8d137016901be51a7f0da00219190b0ef806c9039b
 */
 
 /*
   Result of 16bit mulvlm index 7
-  res = [0, 10, 340, 580, 1570, 230, 2210, 1590, 1480, 620, 330, 1290, 150, 1580, 360, 1370]
-  res = 0x0000000a01540244062200e608a2063605c8026c014a050a0096062c0168055a
+  res = [0, 4274, 1239, 5236, 3714, 7306, 4262, 4679, 3163, 7166, 4548, 5370, 3446, 405, 2204, 1647]
+  res = 0x000010b204d714740e821c8a10a612470c5b1bfe11c414fa0d760195089c066f
 */
 
 /*
   Result of 16bit mulvlm index 8
-  res = [0, 180, 6120, 2857, 5511, 4140, 1865, 5871, 3891, 3577, 5940, 471, 2700, 5691, 6480, 1911]
-  res = 0x000000b417e80b291587102c074916ef0f330df9173401d70a8c163b19500777
+  res = [0, 1102, 7136, 3252, 6188, 2597, 886, 809, 3853, 77, 6034, 5664, 1364, 7290, 1757, 6897]
+  res = 0x0000044e1be00cb4182c0a25037603290f0d004d1792162005541c7a06dd1af1
 */
 
 /*
   Result of 16bit mulvlm index 9
-  res = [0, 204, 6936, 4249, 1696, 4692, 7169, 2104, 7443, 5065, 6732, 3567, 3060, 1900, 7344, 5199]
-  res = 0x000000cc1b18109906a012541c0108381d1313c91a4c0def0bf4076c1cb0144f
+  res = [0, 2260, 1010, 2169, 6002, 6482, 6565, 2939, 828, 3626, 6333, 3386, 3568, 679, 5530, 6300]
+  res = 0x000008d403f208791772195219a50b7b033c0e2a18bd0d3a0df002a7159a189c
 */
 
 /*
   Result of 16bit mulvlm index 10
-  res = [0, 223, 7582, 5351, 4679, 5129, 3785, 5125, 2672, 6243, 7359, 6018, 3345, 4902, 445, 219]
-  res = 0x000000df1d9e14e7124714090ec914050a7018631cbf17820d11132601bd00db
+  res = [0, 1281, 5639, 6051, 3959, 6714, 2530, 6521, 13, 3592, 4358, 6006, 4049, 5240, 618, 1088]
+  res = 0x00000501160717a30f771a3a09e21979000d0e08110617760fd11478026a0440
 */
 
 /*
   Result of 16bit mulvlm index 11
-  res = [0, 208, 7072, 4481, 2324, 4784, 470, 2740, 452, 5313, 6864, 4083, 3120, 2532, 7488, 5747]
-  res = 0x000000d01ba01181091412b001d60ab401c414c11ad00ff30c3009e41d401673
+  res = [0, 2453, 7572, 5780, 5971, 3338, 3720, 3294, 6643, 426, 5119, 5534, 6463, 841, 4895, 2409]
+  res = 0x000009951d94169417530d0a0e880cde19f301aa13ff159e193f0349131f0969
 */
 
 /*
   Result of 16bit mulvlm index 12
-  res = [0, 588, 4826, 3772, 1320, 5941, 1037, 2496, 3611, 6124, 4238, 22, 1237, 1908, 6002, 4726]
-  res = 0x0000024c12da0ebc05281735040d09c00e1b17ec108e001604d5077417721276
+  res = [0, 5622, 1573, 7, 3026, 395, 6433, 6687, 5509, 7329, 3534, 4853, 917, 1065, 5234, 4331]
+  res = 0x000015f6062500070bd2018b19211a1f15851ca10dce12f503950429147210eb
 */
 
 /*
   Result of 16bit mulvlm index 13
-  res = [0, 923, 1050, 453, 834, 6063, 6825, 2680, 110, 4145, 127, 5322, 6262, 1757, 2896, 5123]
-  res = 0x0000039b041a01c5034217af1aa90a78006e1031007f14ca187606dd0b501403
+  res = [0, 4724, 1373, 1004, 6117, 2490, 5133, 399, 1516, 4734, 4232, 2756, 2613, 3258, 3238, 2633]
+  res = 0x00001274055d03ec17e509ba140d018f05ec127e10880ac40a350cba0ca60a49
 */
 
 /*
   Result of 16bit mulvlm index 14
-  res = [0, 5040, 4534, 4166, 2648, 2175, 6722, 5145, 2786, 1577, 7077, 5605, 7353, 105, 7031, 427]
-  res = 0x000013b011b610460a58087f1a4214190ae206291ba515e51cb900691b7701ab
+  res = [0, 524, 2650, 60, 6438, 4469, 2059, 7486, 1722, 2156, 2126, 6932, 277, 6962, 3698, 3541]
+  res = 0x0000020c0a5a003c19261175080b1d3e06ba086c084e1b1401151b320e720dd5
 */
 
 /*
   Result of 16bit mulvlm index 15
-  res = [0, 2542, 3015, 3359, 4778, 5385, 640, 2279, 4649, 5944, 473, 1849, 215, 7320, 516, 7019]
-  res = 0x000009ee0bc70d1f12aa1509028008e71229173801d9073900d71c9802041b6b
+  res = [0, 5115, 7084, 933, 6840, 3900, 548, 1904, 6303, 6227, 1969, 114, 895, 4372, 2148, 3119]
+  res = 0x000013fb1bac03a51ab80f3c02240770189f185307b10072037f111408640c2f
 */
 
 /*
   32bit vector mod32 for instruction mulvml
-  mod32 = [8380417]
-  mod32 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod32 = [8380417, 4236238847]
+  mod32 = 0x000000000000000000000000000000000000000000000000fc7fdfff007fe001
 */
 mod32:
   .word 0x007fe001
-  .word 0x00000000
+  .word 0xfc7fdfff
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -290,62 +290,62 @@ vec32b:
 
 /*
   Result of 32bit mulvlm index 0
-  res = [0, 30691, 4036495, 5431599, 2028271, 8079195, 5410311, 6671840]
-  res = 0x00000000000077e3003d978f0052e12f001ef2ef007b475b00528e070065cde0
+  res = [0, 2832068, 7081275, 4158399, 7235063, 7074218, 4891548, 5953630]
+  res = 0x00000000002b36c4006c0d3b003f73bf006e65f7006bf1aa004aa39c005ad85e
 */
 
 /*
   Result of 32bit mulvlm index 1
-  res = [0, 947, 630526, 837681, 5281538, 3129778, 3940053, 5213473]
-  res = 0x00000000000003b300099efe000cc83100509702002fc1b2003c1ed5004f8d21
+  res = [0, 426797, 2719982, 6135583, 3332827, 805356, 4792916, 869080]
+  res = 0x000000000006832d002980ee005d9f1f0032dadb000c49ec00492254000d42d8
 */
 
 /*
   Result of 32bit mulvlm index 2
-  res = [0, 52504, 3214975, 8248916, 6922639, 6728368, 4263263, 2184360]
-  res = 0x000000000000cd1800310e7f007dde540069a18f0066aab000410d5f002154a8
+  res = [0, 601038, 1096537, 972826, 2844515, 6359395, 575319, 4494253]
+  res = 0x0000000000092bce0010bb59000ed81a002b6763006109630008c757004493ad
 */
 
 /*
   Result of 32bit mulvlm index 3
-  res = [0, 59661, 6201470, 2491401, 5900631, 4426423, 5191246, 1612536]
-  res = 0x000000000000e90d005ea07e00260409005a095700438ab7004f364e00189af8
+  res = [0, 1746960, 3750526, 1042547, 457676, 454926, 258696, 4469538]
+  res = 0x00000000001aa81000393a7e000fe8730006fbcc0006f10e0003f28800443322
 */
 
 /*
   Result of 32bit mulvlm index 4
-  res = [0, 207841, 7358712, 3443797, 2206507, 2318385, 5517136, 3577585]
-  res = 0x0000000000032be1007048f800348c550021ab2b0023603100542f50003696f1
+  res = [0, 229242, 4793870, 2250706, 5891580, 7605814, 7390385, 7379320]
+  res = 0x0000000000037f7a0049260e002257d20059e5fc00740e360070c4b100709978
 */
 
 /*
   Result of 32bit mulvlm index 5
-  res = [0, 636760, 4819076, 5093677, 4648504, 7499691, 4395604, 7438661]
-  res = 0x000000000009b75800498884004db92d0046ee3800726fab0043125400718145
+  res = [0, 688899, 21223, 1409266, 3075403, 7172278, 3910217, 3073843]
+  res = 0x00000000000a8303000052e7001580f2002eed4b006d70b6003baa49002ee733
 */
 
 /*
   Result of 32bit mulvlm index 6
-  res = [0, 833365, 1979923, 8111671, 5118802, 5754119, 6199469, 3972656]
-  res = 0x00000000000cb755001e3613007bc637004e1b520057cd07005e98ad003c9e30
+  res = [0, 6270052, 8073442, 6489574, 5148714, 3585529, 6777859, 6415922]
+  res = 0x00000000005fac64007b30e2006305e6004e902a0036b5f900676c030061e632
 */
 
 /*
   Result of 32bit mulvlm index 7
-  res = [0, 156363, 8322390, 5181965, 2404210, 3874624, 6221716, 1457618]
-  res = 0x00000000000262cb007efd56004f120d0024af72003b1f40005eef9400163dd2
+  res = [0, 7763067, 3759303, 7854506, 2976555, 1959669, 5096403, 7109788]
+  res = 0x000000000076747b00395cc70077d9aa002d6b2b001de6f5004dc3d3006c7c9c
 */
 
 /*
   64bit vector mod64 for instruction mulvml
-  mod64 = [8380417]
-  mod64 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod64 = [8380417, 16714476285912408063]
+  mod64 = 0x00000000000000000000000000000000e7f5bf9ffc7fdfff00000000007fe001
 */
 mod64:
   .word 0x007fe001
   .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
+  .word 0xfc7fdfff
+  .word 0xe7f5bf9f
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
@@ -383,42 +383,42 @@ vec64b:
 
 /*
   Result of 64bit mulvlm index 0
-  res = [0, 7031919, 8297214, 101487]
-  res = 0x000000000000000000000000006b4c6f00000000007e9afe0000000000018c6f
+  res = [0, 5248006, 2482904, 6022602]
+  res = 0x00000000000000000000000000501406000000000025e2d800000000005be5ca
 */
 
 /*
   Result of 64bit mulvlm index 1
-  res = [0, 1222109, 5386136, 1181757]
-  res = 0x0000000000000000000000000012a5dd0000000000522f98000000000012083d
+  res = [0, 946313, 1877081, 3561500]
+  res = 0x000000000000000000000000000e708900000000001ca459000000000036581c
 */
 
 /*
   Result of 64bit mulvlm index 2
-  res = [0, 6736375, 7667658, 2952331]
-  res = 0x0000000000000000000000000066c9f7000000000074ffca00000000002d0c8b
+  res = [0, 893988, 667496324, 1261606]
+  res = 0x000000000000000000000000000da4240000000027c92f840000000000134026
 */
 
 /*
   Result of 64bit mulvlm index 3
-  res = [0, 559663, 5318863, 2046226]
-  res = 0x00000000000000000000000000088a2f00000000005128cf00000000001f3912
+  res = [0, 406427, 2301186325, 1941868]
+  res = 0x0000000000000000000000000006339b000000008929511500000000001da16c
 */
 
 /*
   128bit vector mod128 for instruction mulvml
-  mod128 = [8380417]
-  mod128 = 0x00000000000000000000000000000000000000000000000000000000007fe001
+  mod128 = [8380417, 2984062896558332194971546556068519935]
+  mod128 = 0x023eb5a8eccfe21ee7f5bf9ffc7fdfff000000000000000000000000007fe001
 */
 mod128:
   .word 0x007fe001
   .word 0x00000000
   .word 0x00000000
   .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
-  .word 0x00000000
+  .word 0xfc7fdfff
+  .word 0xe7f5bf9f
+  .word 0xeccfe21e
+  .word 0x023eb5a8
 
 /*
   128bit vector vec128a for instruction mulvlm
@@ -452,12 +452,13 @@ vec128b:
 
 /*
   Result of 128bit mulvlm index 0
-  res = [6288065, 6051552]
-  res = 0x000000000000000000000000005ff2c1000000000000000000000000005c56e0
+  res = [3230701, 2638676]
+  res = 0x00000000000000000000000000314bed00000000000000000000000000284354
 */
 
 /*
   Result of 128bit mulvlm index 1
-  res = [4265058, 5841845]
-  res = 0x00000000000000000000000000411462000000000000000000000000005923b5
+  res = [7401261, 15224341214078156]
+  res = 0x0000000000000000000000000070ef2d0000000000000000003616752a0124cc
 */
+
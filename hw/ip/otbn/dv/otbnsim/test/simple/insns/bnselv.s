@@ -0,0 +1,115 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Load the vectors into w0-w3
+*/
+addi x2, x0, 0
+
+la     x3, vec16a
+bn.lid x2++, 0(x3)
+la     x3, vec16b
+bn.lid x2++, 0(x3)
+
+la     x3, vec32a
+bn.lid x2++, 0(x3)
+la     x3, vec32b
+bn.lid x2++, 0(x3)
+
+/*
+  Elementwise unsigned minimum: bn.subv sets C in the lanes where the element
+  of the first vector is smaller.
+*/
+bn.subv.16H  w20, w0, w1
+bn.selv.16H  w10, w0, w1, C
+bn.subv.8S   w20, w2, w3, FG1
+bn.selv.8S   w11, w2, w3, FG1.C
+
+/* Keep the elements of w1 that are smaller than those of w0 (w31 is zero) */
+bn.subv.16H  w20, w10, w0
+bn.selv.16H  w12, w31, w1, FG0.Z
+
+/* Use the MSB and LSB flags of the result of the first bn.subv */
+bn.subv.16H  w20, w0, w1
+bn.selv.16H  w13, w0, w1, FG0.M
+bn.selv.16H  w14, w0, w1, FG0.L
+
+/*
+  Select with flags written through a CSR. For .4D, only bits 0-3 of each
+  flag are used.
+*/
+li           x4, 0x000a0005
+csrrw        x0, vfg1_cm, x4
+bn.selv.4D   w15, w0, w2, FG1.C
+bn.selv.4D   w16, w0, w2, FG1.M
+bn.selv.2Q   w17, w0, w2, FG1.C
+
+ecall
+
+.section .data
+
+/*
+  16bit vector vec16a
+  vec16a = [-32768 -32768  32767  32767  32767 -32768  32767 -32768 -32768 -32768
+  32767  32767  32767 -32768 -32768  32767]
+  vec16a = 0x800080007fff7fff7fff80007fff8000800080007fff7fff7fff800080007fff
+*/
+vec16a:
+  .word 0x80007fff
+  .word 0x7fff8000
+  .word 0x7fff7fff
+  .word 0x80008000
+  .word 0x7fff8000
+  .word 0x7fff8000
+  .word 0x7fff7fff
+  .word 0x80008000
+
+/*
+  16bit vector vec16b
+  vec16b = [  16  -16    1  -16    6  -16  564 -546  -32   -1   32    1    1   -1
+   -1    1]
+  vec16b = 0x0010fff00001fff00006fff00234fddeffe0ffff002000010001ffffffff0001
+*/
+vec16b:
+  .word 0xffff0001
+  .word 0x0001ffff
+  .word 0x00200001
+  .word 0xffe0ffff
+  .word 0x0234fdde
+  .word 0x0006fff0
+  .word 0x0001fff0
+  .word 0x0010fff0
+
+/*
+  32bit vector vec32a
+  vec32a = [-2147483648 -2147483648  2147483647  2147483647  2147483647 -2147483648
+ -2147483648  2147483647]
+  vec32a = 0x80000000800000007fffffff7fffffff7fffffff80000000800000007fffffff
+*/
+vec32a:
+  .word 0x7fffffff
+  .word 0x80000000
+  .word 0x80000000
+  .word 0x7fffffff
+  .word 0x7fffffff
+  .word 0x7fffffff
+  .word 0x80000000
+  .word 0x80000000
+
+/*
+  32bit vector vec32b
+  vec32b = [-32  -1  32   1   1  -1  -1   1]
+  vec32b = 0xffffffe0ffffffff000000200000000100000001ffffffffffffffff00000001
+*/
+vec32b:
+  .word 0x00000001
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x00000020
+  .word 0xffffffff
+  .word 0xffffffe0
+
@@ -0,0 +1,85 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Load eight 64-bit numbers per operand into w0-w3. The low 32 bits of each
+  number are in one WDR and the high 32 bits in another, one number per lane.
+*/
+addi x2, x0, 0
+
+la     x3, a_lo
+bn.lid x2++, 0(x3)
+la     x3, a_hi
+bn.lid x2++, 0(x3)
+la     x3, b_lo
+bn.lid x2++, 0(x3)
+la     x3, b_hi
+bn.lid x2++, 0(x3)
+
+/*
+  64-bit subtract on each lane: bn.subv sets the borrow flags that bn.subvc
+  subtracts from the high words.
+*/
+bn.subv.8S   w10, w0, w2
+bn.subvc.8S  w11, w1, w3
+csrrs        x4, vfg0_cm, x0
+csrrs        x5, vfg0_lz, x0
+
+/* Set the borrow flags of every other 16-bit lane and subtract them */
+li           x6, 0x00005555
+csrrw        x0, vfg1_cm, x6
+bn.subvc.16H w12, w31, w31, FG1
+csrrs        x7, vfg1_cm, x0
+csrrs        x8, vfg1_lz, x0
+
+ecall
+
+.section .data
+/*
+  a = [0x00000001ffffffff 0xffffffffffffffff 0x0000000100000000
+       0x0000000000000000 ...]
+  b = [0x0000000000000001 0x0000000000000001 0x0000000000000001
+       0x0000000000000001 ...]
+  The first lanes carry or borrow between the low and high words.
+*/
+a_lo:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x978f18a7
+  .word 0x6c7ab5c9
+  .word 0x87b3d90e
+  .word 0x215b8892
+
+a_hi:
+  .word 0x00000001
+  .word 0xffffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x4e86c4fa
+  .word 0x611244c0
+  .word 0x5bab1eec
+  .word 0xb9d8249e
+
+b_lo:
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x065720ce
+  .word 0x15f54a5c
+  .word 0xb5c318e9
+  .word 0x6bd6eed6
+
+b_hi:
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x1b1c3f27
+  .word 0xfb34ccc5
+  .word 0x7f8cb6d1
+  .word 0x05032a7e
@@ -0,0 +1,45 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Load the vector into w0
+*/
+addi x2, x0, 0
+
+la     x3, vec
+bn.lid x2, 0(x3)
+
+/*
+  check that all datatypes work as expected
+*/
+bn.subvi.16H w10, w0, 1
+csrrs        x4, vfg0_cm, x0
+csrrs        x5, vfg0_lz, x0
+
+bn.subvi.8S  w11, w0, 255, FG1
+csrrs        x6, vfg1_cm, x0
+csrrs        x7, vfg1_lz, x0
+
+bn.subvi.4D  w12, w0, 16
+bn.subvi.2Q  w13, w0, 128
+csrrs        x8, vfg0_cm, x0
+csrrs        x9, vfg0_lz, x0
+
+ecall
+
+.section .data
+
+/*
+  vec = 0xffff0000ff01fffe00000001fffffeff80000000ffffff00fffffffffffffff0
+*/
+vec:
+  .word 0xfffffff0
+  .word 0xffffffff
+  .word 0xffffff00
+  .word 0x80000000
+  .word 0xfffffeff
+  .word 0x00000001
+  .word 0xff01fffe
+  .word 0xffff0000
@@ -0,0 +1,248 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Check that bn.subvm takes q from the bottom element of MOD. MOD
+  holds q in element 0 and q' = -q^-1 mod 2^size in element 1,
+  which is a different value. Above those, the 16, 32 and 64-bit
+  moduli have random bits that must be ignored too. Each vector has
+  elements where a < b, so a version that added q' instead of q
+  would give a different result.
+  Results are stored in WDRs:
+  16b: w10
+  32b: w11
+  64b: w12
+  128b: w13
+*/
+
+addi x2, x0, 0
+la     x3, vec16a
+bn.lid x2++, 0(x3)
+la     x3, vec16b
+bn.lid x2++, 0(x3)
+la     x3, vec32a
+bn.lid x2++, 0(x3)
+la     x3, vec32b
+bn.lid x2++, 0(x3)
+la     x3, vec64a
+bn.lid x2++, 0(x3)
+la     x3, vec64b
+bn.lid x2++, 0(x3)
+la     x3, vec128a
+bn.lid x2++, 0(x3)
+la     x3, vec128b
+bn.lid x2++, 0(x3)
+
+/* load each modulus into w20 and then into MOD */
+/* MOD <= dmem[modulus] = rest || q' || q */
+li           x2, 20
+la           x3, mod16
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.subvm.16H w10, w0, w1
+
+li           x2, 20
+la           x3, mod32
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.subvm.8S  w11, w2, w3
+
+li           x2, 20
+la           x3, mod64
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.subvm.4D  w12, w4, w5
+
+li           x2, 20
+la           x3, mod128
+bn.lid       x2, 0(x3)
+bn.wsrw      MOD, w20
+bn.subvm.2Q  w13, w6, w7
+
+addi x2, x0, 0 /* reset x2*/
+addi x3, x0, 0 /* reset x3*/
+
+ecall
+
+.section .data
+/*
+  16bit vector vec16a for instruction subvm
+  vec16a = [1158, 235, 1977, 2067, 2023, 1784, 2292, 3163, 2383, 704, 165, 1, 0, 5, 3328, 0]
+  vec16a = 0x048600eb07b9081307e706f808f40c5b094f02c000a50001000000050d000000
+*/
+vec16a:
+  .word 0x0d000000
+  .word 0x00000005
+  .word 0x00a50001
+  .word 0x094f02c0
+  .word 0x08f40c5b
+  .word 0x07e706f8
+  .word 0x07b90813
+  .word 0x048600eb
+
+/*
+  16bit vector vec16b for instruction subvm
+  vec16b = [693, 2026, 1811, 2678, 2504, 3295, 1830, 1737, 904, 316, 2220, 0, 1, 5, 0, 3328]
+  vec16b = 0x02b507ea07130a7609c80cdf072606c90388013c08ac00000001000500000d00
+*/
+vec16b:
+  .word 0x00000d00
+  .word 0x00010005
+  .word 0x08ac0000
+  .word 0x0388013c
+  .word 0x072606c9
+  .word 0x09c80cdf
+  .word 0x07130a76
+  .word 0x02b507ea
+
+/*
+  32bit vector vec32a for instruction subvm
+  vec32a = [1842354, 4009753, 3835558, 5274976, 0, 5, 8380416, 0]
+  vec32a = 0x001c1cb2003d2f19003a86a600507d600000000000000005007fe00000000000
+*/
+vec32a:
+  .word 0x00000000
+  .word 0x007fe000
+  .word 0x00000005
+  .word 0x00000000
+  .word 0x00507d60
+  .word 0x003a86a6
+  .word 0x003d2f19
+  .word 0x001c1cb2
+
+/*
+  32bit vector vec32b for instruction subvm
+  vec32b = [3600438, 7864518, 154867, 8109533, 1, 5, 0, 8380416]
+  vec32b = 0x0036f036007800c600025cf3007bbddd000000010000000500000000007fe000
+*/
+vec32b:
+  .word 0x007fe000
+  .word 0x00000000
+  .word 0x00000005
+  .word 0x00000001
+  .word 0x007bbddd
+  .word 0x00025cf3
+  .word 0x007800c6
+  .word 0x0036f036
+
+/*
+  64bit vector vec64a for instruction subvm
+  vec64a = [539473044103900664, 1935638479504320922, 2305843009213693950, 0]
+  vec64a = 0x077c97e017b62df81adcc4f1106ea99a1ffffffffffffffe0000000000000000
+*/
+vec64a:
+  .word 0x00000000
+  .word 0x00000000
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0x106ea99a
+  .word 0x1adcc4f1
+  .word 0x17b62df8
+  .word 0x077c97e0
+
+/*
+  64bit vector vec64b for instruction subvm
+  vec64b = [432104009616808225, 287568359041460110, 0, 2305843009213693950]
+  vec64b = 0x05ff244eaf3b592103fda5e6214ee78e00000000000000001ffffffffffffffe
+*/
+vec64b:
+  .word 0xfffffffe
+  .word 0x1fffffff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x214ee78e
+  .word 0x03fda5e6
+  .word 0xaf3b5921
+  .word 0x05ff244e
+
+/*
+  128bit vector vec128a for instruction subvm
+  vec128a = [170141183460469231731687303715884105726, 0]
+  vec128a = 0x7ffffffffffffffffffffffffffffffe00000000000000000000000000000000
+*/
+vec128a:
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+
+/*
+  128bit vector vec128b for instruction subvm
+  vec128b = [0, 170141183460469231731687303715884105726]
+  vec128b = 0x000000000000000000000000000000007ffffffffffffffffffffffffffffffe
+*/
+vec128b:
+  .word 0xfffffffe
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  16bit modulus mod16 for instruction subvm
+  q = 3329, q' = 3327
+  mod16 = 0xf7d9dd09e00a8f6ebab8ab0a20884f39a2c0e2b283d24f4511c120280cff0d01
+*/
+mod16:
+  .word 0x0cff0d01
+  .word 0x11c12028
+  .word 0x83d24f45
+  .word 0xa2c0e2b2
+  .word 0x20884f39
+  .word 0xbab8ab0a
+  .word 0xe00a8f6e
+  .word 0xf7d9dd09
+
+/*
+  32bit modulus mod32 for instruction subvm
+  q = 8380417, q' = 4236238847
+  mod32 = 0x6076cc87d07f6a0ad480c29d68854e00fcb87ed20c38acb6fc7fdfff007fe001
+*/
+mod32:
+  .word 0x007fe001
+  .word 0xfc7fdfff
+  .word 0x0c38acb6
+  .word 0xfcb87ed2
+  .word 0x68854e00
+  .word 0xd480c29d
+  .word 0xd07f6a0a
+  .word 0x6076cc87
+
+/*
+  64bit modulus mod64 for instruction subvm
+  q = 2305843009213693951, q' = 2305843009213693953
+  mod64 = 0xf29bfbc059b7893b938390139e394f5520000000000000011fffffffffffffff
+*/
+mod64:
+  .word 0xffffffff
+  .word 0x1fffffff
+  .word 0x00000001
+  .word 0x20000000
+  .word 0x9e394f55
+  .word 0x93839013
+  .word 0x59b7893b
+  .word 0xf29bfbc0
+
+/*
+  128bit modulus mod128 for instruction subvm
+  q = 170141183460469231731687303715884105727, q' = 170141183460469231731687303715884105729
+  mod128 = 0x800000000000000000000000000000017fffffffffffffffffffffffffffffff
+*/
+mod128:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x7fffffff
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
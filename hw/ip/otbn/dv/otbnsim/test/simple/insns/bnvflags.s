@@ -0,0 +1,127 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Load the vectors into w0-w3
+*/
+addi x2, x0, 0
+
+la     x3, vec16a
+bn.lid x2++, 0(x3)
+la     x3, vec16b
+bn.lid x2++, 0(x3)
+
+la     x3, vec32a
+bn.lid x2++, 0(x3)
+la     x3, vec32b
+bn.lid x2++, 0(x3)
+
+/*
+  The vector flags of each lane are read through the VFGi_CM and VFGi_LZ CSRs.
+  Bits [15:0] of VFGi_CM are the carry flags of lanes 0-15 and bits [31:16]
+  are the MSB flags. VFGi_LZ holds the LSB and zero flags in the same way.
+*/
+
+/* 16bit add into vector flag group 1: C is the carry out of each element */
+bn.addv.16H  w10, w0, w1, FG1
+csrrs        x4, vfg1_cm, x0
+csrrs        x5, vfg1_lz, x0
+
+/* 32bit subtract into vector flag group 0: C is the borrow */
+bn.subv.8S   w11, w2, w3
+csrrs        x6, vfg0_cm, x0
+csrrs        x7, vfg0_lz, x0
+
+/* Modular add: C is set for the lanes where MOD was subtracted */
+li           x8, 0x8000
+csrrw        x0, mod0, x8
+bn.addvm.16H w12, w0, w1, FG1
+csrrs        x9, vfg1_cm, x0
+csrrs        x10, vfg1_lz, x0
+
+/*
+  Modular subtract with 8 lanes: C is set for the lanes where MOD was added.
+  The flags of lanes 8-15 are cleared.
+*/
+bn.subvm.8S  w13, w3, w2, FG1
+csrrs        x11, vfg1_cm, x0
+csrrs        x12, vfg1_lz, x0
+
+/* The vector instructions don't change the scalar flags */
+csrrs        x13, flags, x0
+
+/* The vector flags can be written through the CSRs */
+li           x14, 0x12345678
+csrrw        x15, vfg0_lz, x14
+csrrs        x16, vfg0_lz, x0
+csrrs        x17, vfg0_cm, x0
+
+ecall
+
+.section .data
+
+/*
+  16bit vector vec16a
+  vec16a = [-32768 -32768  32767  32767  32767 -32768  32767 -32768 -32768 -32768
+  32767  32767  32767 -32768 -32768  32767]
+  vec16a = 0x800080007fff7fff7fff80007fff8000800080007fff7fff7fff800080007fff
+*/
+vec16a:
+  .word 0x80007fff
+  .word 0x7fff8000
+  .word 0x7fff7fff
+  .word 0x80008000
+  .word 0x7fff8000
+  .word 0x7fff8000
+  .word 0x7fff7fff
+  .word 0x80008000
+
+/*
+  16bit vector vec16b
+  vec16b = [  16  -16    1  -16    6  -16  564 -546  -32   -1   32    1    1   -1
+   -1    1]
+  vec16b = 0x0010fff00001fff00006fff00234fddeffe0ffff002000010001ffffffff0001
+*/
+vec16b:
+  .word 0xffff0001
+  .word 0x0001ffff
+  .word 0x00200001
+  .word 0xffe0ffff
+  .word 0x0234fdde
+  .word 0x0006fff0
+  .word 0x0001fff0
+  .word 0x0010fff0
+
+/*
+  32bit vector vec32a
+  vec32a = [-2147483648 -2147483648  2147483647  2147483647  2147483647 -2147483648
+ -2147483648  2147483647]
+  vec32a = 0x80000000800000007fffffff7fffffff7fffffff80000000800000007fffffff
+*/
+vec32a:
+  .word 0x7fffffff
+  .word 0x80000000
+  .word 0x80000000
+  .word 0x7fffffff
+  .word 0x7fffffff
+  .word 0x7fffffff
+  .word 0x80000000
+  .word 0x80000000
+
+/*
+  32bit vector vec32b
+  vec32b = [-32  -1  32   1   1  -1  -1   1]
+  vec32b = 0xffffffe0ffffffff000000200000000100000001ffffffffffffffff00000001
+*/
+vec32b:
+  .word 0x00000001
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x00000001
+  .word 0x00000001
+  .word 0x00000020
+  .word 0xffffffff
+  .word 0xffffffe0
+
@@ -0,0 +1,108 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  Check the .4D and .2Q datatypes with values that would carry, borrow
+  or shift across the boundary of a narrower element. For example, the
+  carry out of the bottom 32 bits of a 64-bit element must stay in that
+  element and the carry out of the top of each element must be dropped.
+  Results are ordered (addv, subv, mulv, shv left, shv right, trn1, trn2):
+  64b:  w10 to w16
+  128b: w17 to w23
+*/
+
+addi x2, x0, 0
+la     x3, vec64a
+bn.lid x2++, 0(x3)
+la     x3, vec64b
+bn.lid x2++, 0(x3)
+la     x3, vec128a
+bn.lid x2++, 0(x3)
+la     x3, vec128b
+bn.lid x2++, 0(x3)
+
+/* 64bit */
+bn.addv.4D  w10, w0, w1
+bn.subv.4D  w11, w0, w1
+bn.mulv.4D  w12, w0, w1
+bn.shv.4D   w13, w0 << 63
+bn.shv.4D   w14, w0 >> 1
+bn.trn1.4D  w15, w0, w1
+bn.trn2.4D  w16, w0, w1
+
+/* 128bit */
+bn.addv.2Q  w17, w2, w3
+bn.subv.2Q  w18, w2, w3
+bn.mulv.2Q  w19, w2, w3
+bn.shv.2Q   w20, w2 << 1
+bn.shv.2Q   w21, w2 >> 127
+bn.trn1.2Q  w22, w2, w3
+bn.trn2.2Q  w23, w2, w3
+
+addi x2, x0, 0 /* reset x2*/
+addi x3, x0, 0 /* reset x3*/
+
+ecall
+
+.section .data
+/*
+  64bit vector vec64a
+  vec64a = [9223372036854775807, 4294967295, 9223372036854775808, 18446744073709551615]
+  vec64a = 0x7fffffffffffffff00000000ffffffff8000000000000000ffffffffffffffff
+*/
+vec64a:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x00000000
+  .word 0x80000000
+  .word 0xffffffff
+  .word 0x00000000
+  .word 0xffffffff
+  .word 0x7fffffff
+
+/*
+  64bit vector vec64b
+  vec64b = [18446744073709551615, 4294967297, 9223372036854775808, 1]
+  vec64b = 0xffffffffffffffff000000010000000180000000000000000000000000000001
+*/
+vec64b:
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
+  .word 0x00000001
+  .word 0x00000001
+  .word 0xffffffff
+  .word 0xffffffff
+
+/*
+  128bit vector vec128a
+  vec128a = [170141183460469231731687303715884105728, 18446744073709551615]
+  vec128a = 0x800000000000000000000000000000000000000000000000ffffffffffffffff
+*/
+vec128a:
+  .word 0xffffffff
+  .word 0xffffffff
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
+
+/*
+  128bit vector vec128b
+  vec128b = [170141183460469231731687303715884105729, 18446744073709551617]
+  vec128b = 0x8000000000000000000000000000000100000000000000010000000000000001
+*/
+vec128b:
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000001
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x80000000
@@ -0,0 +1,818 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  A 256-point inverse number theoretic transform with bn.ibflyv.
+
+  This is intt-mulvm.s with each bn.subvm, bn.addvm and bn.mulvm
+  butterfly replaced by a bn.ibflyv (see intt-mulvm.s for the
+  details). It gives the same result.
+
+  On the ISS, this takes 550 cycles.
+*/
+
+/* MOD <= dmem[modulus] = q' || q */
+li            x2, 16
+la            x3, modulus
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w16
+
+/* Load the coefficients into w0-w15. This leaves x3 pointing at the twiddle
+   factors, which we load into w16 as we go. */
+li            x2, 0
+la            x3, coeffs
+loopi         16, 2
+  bn.lid      x2, 0(x3++)
+  addi        x2, x2, 1
+li            x4, 16
+
+/* Coefficients 1 apart: gather them from each pair of WDRs with .16H */
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w0, w1
+bn.trn2.16H   w18, w0, w1
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w0, w17, w18
+bn.trn2.16H   w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w2, w3
+bn.trn2.16H   w18, w2, w3
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w2, w17, w18
+bn.trn2.16H   w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w4, w5
+bn.trn2.16H   w18, w4, w5
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w4, w17, w18
+bn.trn2.16H   w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w6, w7
+bn.trn2.16H   w18, w6, w7
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w6, w17, w18
+bn.trn2.16H   w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w8, w9
+bn.trn2.16H   w18, w8, w9
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w8, w17, w18
+bn.trn2.16H   w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w10, w11
+bn.trn2.16H   w18, w10, w11
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w10, w17, w18
+bn.trn2.16H   w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w12, w13
+bn.trn2.16H   w18, w12, w13
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w12, w17, w18
+bn.trn2.16H   w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w14, w15
+bn.trn2.16H   w18, w14, w15
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.16H   w14, w17, w18
+bn.trn2.16H   w15, w17, w18
+
+/* Coefficients 2 apart: gather them from each pair of WDRs with .8S */
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w0, w1
+bn.trn2.8S    w18, w0, w1
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w0, w17, w18
+bn.trn2.8S    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w2, w3
+bn.trn2.8S    w18, w2, w3
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w2, w17, w18
+bn.trn2.8S    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w4, w5
+bn.trn2.8S    w18, w4, w5
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w4, w17, w18
+bn.trn2.8S    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w6, w7
+bn.trn2.8S    w18, w6, w7
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w6, w17, w18
+bn.trn2.8S    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w8, w9
+bn.trn2.8S    w18, w8, w9
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w8, w17, w18
+bn.trn2.8S    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w10, w11
+bn.trn2.8S    w18, w10, w11
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w10, w17, w18
+bn.trn2.8S    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w12, w13
+bn.trn2.8S    w18, w12, w13
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w12, w17, w18
+bn.trn2.8S    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w14, w15
+bn.trn2.8S    w18, w14, w15
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.8S    w14, w17, w18
+bn.trn2.8S    w15, w17, w18
+
+/* Coefficients 4 apart: gather them from each pair of WDRs with .4D */
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w0, w1
+bn.trn2.4D    w18, w0, w1
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w0, w17, w18
+bn.trn2.4D    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w2, w3
+bn.trn2.4D    w18, w2, w3
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w2, w17, w18
+bn.trn2.4D    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w4, w5
+bn.trn2.4D    w18, w4, w5
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w4, w17, w18
+bn.trn2.4D    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w6, w7
+bn.trn2.4D    w18, w6, w7
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w6, w17, w18
+bn.trn2.4D    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w8, w9
+bn.trn2.4D    w18, w8, w9
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w8, w17, w18
+bn.trn2.4D    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w10, w11
+bn.trn2.4D    w18, w10, w11
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w10, w17, w18
+bn.trn2.4D    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w12, w13
+bn.trn2.4D    w18, w12, w13
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w12, w17, w18
+bn.trn2.4D    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w14, w15
+bn.trn2.4D    w18, w14, w15
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.4D    w14, w17, w18
+bn.trn2.4D    w15, w17, w18
+
+/* Coefficients 8 apart: gather them from each pair of WDRs with .2Q */
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w0, w1
+bn.trn2.2Q    w18, w0, w1
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w0, w17, w18
+bn.trn2.2Q    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w2, w3
+bn.trn2.2Q    w18, w2, w3
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w2, w17, w18
+bn.trn2.2Q    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w4, w5
+bn.trn2.2Q    w18, w4, w5
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w4, w17, w18
+bn.trn2.2Q    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w6, w7
+bn.trn2.2Q    w18, w6, w7
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w6, w17, w18
+bn.trn2.2Q    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w8, w9
+bn.trn2.2Q    w18, w8, w9
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w8, w17, w18
+bn.trn2.2Q    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w10, w11
+bn.trn2.2Q    w18, w10, w11
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w10, w17, w18
+bn.trn2.2Q    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w12, w13
+bn.trn2.2Q    w18, w12, w13
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w12, w17, w18
+bn.trn2.2Q    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w14, w15
+bn.trn2.2Q    w18, w14, w15
+bn.ibflyv.16H w17, w18, w16
+bn.trn1.2Q    w14, w17, w18
+bn.trn2.2Q    w15, w17, w18
+
+/* Coefficients 16 apart: wi and wi+1 */
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w0, w1, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w2, w3, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w4, w5, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w6, w7, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w8, w9, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w10, w11, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w12, w13, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w14, w15, w16
+
+/* Coefficients 32 apart: wi and wi+2 */
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w0, w2, w16
+bn.ibflyv.16H w1, w3, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w4, w6, w16
+bn.ibflyv.16H w5, w7, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w8, w10, w16
+bn.ibflyv.16H w9, w11, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w12, w14, w16
+bn.ibflyv.16H w13, w15, w16
+
+/* Coefficients 64 apart: wi and wi+4 */
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w0, w4, w16
+bn.ibflyv.16H w1, w5, w16
+bn.ibflyv.16H w2, w6, w16
+bn.ibflyv.16H w3, w7, w16
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w8, w12, w16
+bn.ibflyv.16H w9, w13, w16
+bn.ibflyv.16H w10, w14, w16
+bn.ibflyv.16H w11, w15, w16
+
+/* Coefficients 128 apart: wi and wi+8 */
+bn.lid        x4, 0(x3++)
+bn.ibflyv.16H w0, w8, w16
+bn.ibflyv.16H w1, w9, w16
+bn.ibflyv.16H w2, w10, w16
+bn.ibflyv.16H w3, w11, w16
+bn.ibflyv.16H w4, w12, w16
+bn.ibflyv.16H w5, w13, w16
+bn.ibflyv.16H w6, w14, w16
+bn.ibflyv.16H w7, w15, w16
+
+ecall
+
+.section .data
+
+/*
+  q = 3329 and q' = -q^-1 mod 2^16 = 3327
+*/
+modulus:
+  .word 0x0cff0d01
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  The NTT (in bit-reversed order) of a[i] = 1 + 11i + 37i^2 mod q,
+  as computed by ntt-mulvm.s and ntt-bflyv.s
+*/
+coeffs:
+  .word 0x0a6c0934
+  .word 0x03cc0208
+  .word 0x026a0aa1
+  .word 0x08f107a2
+  .word 0x07dd0a1c
+  .word 0x064f0bb8
+  .word 0x0b240452
+  .word 0x03600b39
+  .word 0x027c085d
+  .word 0x07c40431
+  .word 0x0c8c0ae5
+  .word 0x0846051f
+  .word 0x079d01ce
+  .word 0x0cfe094b
+  .word 0x06c90be4
+  .word 0x07a802ba
+  .word 0x02d9070b
+  .word 0x03ce0987
+  .word 0x04190569
+  .word 0x08d50380
+  .word 0x03380699
+  .word 0x00060b0d
+  .word 0x062806f8
+  .word 0x0cb30413
+  .word 0x0b2b05ac
+  .word 0x006904b2
+  .word 0x021c0275
+  .word 0x0564089f
+  .word 0x07c20cd3
+  .word 0x03b60afc
+  .word 0x06b10720
+  .word 0x01ee068c
+  .word 0x098403b1
+  .word 0x02060337
+  .word 0x00920bd9
+  .word 0x018f0721
+  .word 0x08ef0128
+  .word 0x048c08e1
+  .word 0x0ca008c9
+  .word 0x0b2c054b
+  .word 0x086806ed
+  .word 0x09b60bb8
+  .word 0x0a080260
+  .word 0x06cf0be0
+  .word 0x081c035b
+  .word 0x0bf1015f
+  .word 0x05070883
+  .word 0x0ab00a3a
+  .word 0x07ce0c0f
+  .word 0x03620b57
+  .word 0x03b606ae
+  .word 0x03d30787
+  .word 0x078f02fd
+  .word 0x09e50aa3
+  .word 0x0ba80793
+  .word 0x08cb0420
+  .word 0x09e3018f
+  .word 0x06e60a06
+  .word 0x0bd10261
+  .word 0x09540a5e
+  .word 0x0b05044f
+  .word 0x0af908c7
+  .word 0x0c1a0089
+  .word 0x040a0bf2
+  .word 0x02aa0299
+  .word 0x0b2d0676
+  .word 0x00810b64
+  .word 0x06a20320
+  .word 0x00f509b3
+  .word 0x0697070d
+  .word 0x02a206eb
+  .word 0x041d0806
+  .word 0x050f0ae4
+  .word 0x066d07e3
+  .word 0x03e30bb6
+  .word 0x026603c5
+  .word 0x098d00d9
+  .word 0x077e048c
+  .word 0x01bb012e
+  .word 0x07240514
+  .word 0x0c410777
+  .word 0x07420c3c
+  .word 0x09e30111
+  .word 0x0cfe00dc
+  .word 0x043402f7
+  .word 0x00ff03e0
+  .word 0x08600bf4
+  .word 0x05870809
+  .word 0x0b3a05d1
+  .word 0x0c5c09a5
+  .word 0x06b20448
+  .word 0x0a9b090b
+  .word 0x0502010e
+  .word 0x06150a7d
+  .word 0x010e0192
+  .word 0x046703dc
+  .word 0x04e2061f
+  .word 0x0cdc0aee
+  .word 0x037e0cb3
+  .word 0x038b0544
+  .word 0x0c1c0a05
+  .word 0x0a100598
+  .word 0x0b900947
+  .word 0x0c790582
+  .word 0x03ec0200
+  .word 0x0a74013e
+  .word 0x05d8003d
+  .word 0x078401b0
+  .word 0x08220172
+  .word 0x09fe00d6
+  .word 0x03b0073e
+  .word 0x0106096d
+  .word 0x03870278
+  .word 0x053b06de
+  .word 0x061300c3
+  .word 0x067d0023
+  .word 0x09e504f1
+  .word 0x086c000c
+  .word 0x066b0ac3
+  .word 0x06170032
+  .word 0x0166033c
+  .word 0x0047040d
+  .word 0x099e076f
+  .word 0x04b70431
+  .word 0x016a055e
+  .word 0x03f00cba
+  .word 0x0b400b3f
+  .word 0x0a6e0888
+
+/*
+  The twiddle factors for each butterfly, in the order that they are used.
+  Each is w * 2^16 mod q, where w is a power of 17^-1 = 1175
+  (a primitive 256th root of unity mod q).
+*/
+twiddles:
+  .word 0x074508ed
+  .word 0x05c202f6
+  .word 0x04b205ed
+  .word 0x093f0167
+  .word 0x0c4b0c37
+  .word 0x06d80be2
+  .word 0x0a930773
+  .word 0x00ab072c
+  .word 0x00820623
+  .word 0x064200cd
+  .word 0x074f0b66
+  .word 0x033d0606
+  .word 0x0b820aa1
+  .word 0x0bf90a25
+  .word 0x052d0908
+  .word 0x0ac402a9
+  .word 0x03b704fb
+  .word 0x00f70a5c
+  .word 0x058d0429
+  .word 0x0c960b41
+  .word 0x09c302d5
+  .word 0x010f05e4
+  .word 0x005a0940
+  .word 0x0355018e
+  .word 0x06080744
+  .word 0x011a0c83
+  .word 0x072e048a
+  .word 0x050d0652
+  .word 0x090a029a
+  .word 0x02280140
+  .word 0x0a750008
+  .word 0x083a0afd
+  .word 0x0b2306a5
+  .word 0x0366070f
+  .word 0x035605b4
+  .word 0x05e60943
+  .word 0x09e70922
+  .word 0x04fe091d
+  .word 0x05fa0134
+  .word 0x04a1006c
+  .word 0x0b81067b
+  .word 0x05b904a3
+  .word 0x05050c25
+  .word 0x07d7036a
+  .word 0x0a9f0537
+  .word 0x0aa6083f
+  .word 0x08b80088
+  .word 0x09d004bf
+  .word 0x08a2004b
+  .word 0x025a009c
+  .word 0x07360bb8
+  .word 0x03090b5f
+  .word 0x00930ba4
+  .word 0x087a0368
+  .word 0x09f70a7d
+  .word 0x00f60636
+  .word 0x0c98068c
+  .word 0x06f306db
+  .word 0x099a01cc
+  .word 0x04e30123
+  .word 0x09b600eb
+  .word 0x0ad60c50
+  .word 0x0b530ab6
+  .word 0x044f0b5b
+  .word 0x08ed08ed
+  .word 0x0c370c37
+  .word 0x02f602f6
+  .word 0x0be20be2
+  .word 0x05ed05ed
+  .word 0x07730773
+  .word 0x01670167
+  .word 0x072c072c
+  .word 0x07450745
+  .word 0x0c4b0c4b
+  .word 0x05c205c2
+  .word 0x06d806d8
+  .word 0x04b204b2
+  .word 0x0a930a93
+  .word 0x093f093f
+  .word 0x00ab00ab
+  .word 0x06230623
+  .word 0x0aa10aa1
+  .word 0x00cd00cd
+  .word 0x0a250a25
+  .word 0x0b660b66
+  .word 0x09080908
+  .word 0x06060606
+  .word 0x02a902a9
+  .word 0x00820082
+  .word 0x0b820b82
+  .word 0x06420642
+  .word 0x0bf90bf9
+  .word 0x074f074f
+  .word 0x052d052d
+  .word 0x033d033d
+  .word 0x0ac40ac4
+  .word 0x04fb04fb
+  .word 0x02d502d5
+  .word 0x0a5c0a5c
+  .word 0x05e405e4
+  .word 0x04290429
+  .word 0x09400940
+  .word 0x0b410b41
+  .word 0x018e018e
+  .word 0x03b703b7
+  .word 0x09c309c3
+  .word 0x00f700f7
+  .word 0x010f010f
+  .word 0x058d058d
+  .word 0x005a005a
+  .word 0x0c960c96
+  .word 0x03550355
+  .word 0x07440744
+  .word 0x029a029a
+  .word 0x0c830c83
+  .word 0x01400140
+  .word 0x048a048a
+  .word 0x00080008
+  .word 0x06520652
+  .word 0x0afd0afd
+  .word 0x06080608
+  .word 0x090a090a
+  .word 0x011a011a
+  .word 0x02280228
+  .word 0x072e072e
+  .word 0x0a750a75
+  .word 0x050d050d
+  .word 0x083a083a
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x07450745
+  .word 0x07450745
+  .word 0x04b204b2
+  .word 0x04b204b2
+  .word 0x05c205c2
+  .word 0x05c205c2
+  .word 0x093f093f
+  .word 0x093f093f
+  .word 0x0c4b0c4b
+  .word 0x0c4b0c4b
+  .word 0x0a930a93
+  .word 0x0a930a93
+  .word 0x06d806d8
+  .word 0x06d806d8
+  .word 0x00ab00ab
+  .word 0x00ab00ab
+  .word 0x06230623
+  .word 0x06230623
+  .word 0x0b660b66
+  .word 0x0b660b66
+  .word 0x00cd00cd
+  .word 0x00cd00cd
+  .word 0x06060606
+  .word 0x06060606
+  .word 0x0aa10aa1
+  .word 0x0aa10aa1
+  .word 0x09080908
+  .word 0x09080908
+  .word 0x0a250a25
+  .word 0x0a250a25
+  .word 0x02a902a9
+  .word 0x02a902a9
+  .word 0x00820082
+  .word 0x00820082
+  .word 0x074f074f
+  .word 0x074f074f
+  .word 0x06420642
+  .word 0x06420642
+  .word 0x033d033d
+  .word 0x033d033d
+  .word 0x0b820b82
+  .word 0x0b820b82
+  .word 0x052d052d
+  .word 0x052d052d
+  .word 0x0bf90bf9
+  .word 0x0bf90bf9
+  .word 0x0ac40ac4
+  .word 0x0ac40ac4
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x07450745
+  .word 0x07450745
+  .word 0x07450745
+  .word 0x07450745
+  .word 0x05c205c2
+  .word 0x05c205c2
+  .word 0x05c205c2
+  .word 0x05c205c2
+  .word 0x04b204b2
+  .word 0x04b204b2
+  .word 0x04b204b2
+  .word 0x04b204b2
+  .word 0x093f093f
+  .word 0x093f093f
+  .word 0x093f093f
+  .word 0x093f093f
+  .word 0x0c4b0c4b
+  .word 0x0c4b0c4b
+  .word 0x0c4b0c4b
+  .word 0x0c4b0c4b
+  .word 0x06d806d8
+  .word 0x06d806d8
+  .word 0x06d806d8
+  .word 0x06d806d8
+  .word 0x0a930a93
+  .word 0x0a930a93
+  .word 0x0a930a93
+  .word 0x0a930a93
+  .word 0x00ab00ab
+  .word 0x00ab00ab
+  .word 0x00ab00ab
+  .word 0x00ab00ab
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0c370c37
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x0be20be2
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x07730773
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x072c072c
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x05ed05ed
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x01670167
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x02f602f6
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
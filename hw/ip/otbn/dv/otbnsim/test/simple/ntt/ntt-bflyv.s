@@ -0,0 +1,817 @@
+/* Copyright lowRISC contributors (OpenTitan project). */
+/* Licensed under the Apache License, Version 2.0, see LICENSE for details. */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+.section .text.start
+/*
+  A 256-point number theoretic transform with bn.bflyv.
+
+  This is ntt-mulvm.s with each bn.mulvm, bn.subvm and bn.addvm
+  butterfly replaced by a bn.bflyv (see ntt-mulvm.s for the
+  details). It gives the same result.
+
+  On the ISS, this takes 550 cycles.
+*/
+
+/* MOD <= dmem[modulus] = q' || q */
+li            x2, 16
+la            x3, modulus
+bn.lid        x2, 0(x3)
+bn.wsrw       MOD, w16
+
+/* Load the coefficients into w0-w15. This leaves x3 pointing at the twiddle
+   factors, which we load into w16 as we go. */
+li            x2, 0
+la            x3, coeffs
+loopi         16, 2
+  bn.lid      x2, 0(x3++)
+  addi        x2, x2, 1
+li            x4, 16
+
+/* Coefficients 128 apart: wi and wi+8 */
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w0, w8, w16
+bn.bflyv.16H  w1, w9, w16
+bn.bflyv.16H  w2, w10, w16
+bn.bflyv.16H  w3, w11, w16
+bn.bflyv.16H  w4, w12, w16
+bn.bflyv.16H  w5, w13, w16
+bn.bflyv.16H  w6, w14, w16
+bn.bflyv.16H  w7, w15, w16
+
+/* Coefficients 64 apart: wi and wi+4 */
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w0, w4, w16
+bn.bflyv.16H  w1, w5, w16
+bn.bflyv.16H  w2, w6, w16
+bn.bflyv.16H  w3, w7, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w8, w12, w16
+bn.bflyv.16H  w9, w13, w16
+bn.bflyv.16H  w10, w14, w16
+bn.bflyv.16H  w11, w15, w16
+
+/* Coefficients 32 apart: wi and wi+2 */
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w0, w2, w16
+bn.bflyv.16H  w1, w3, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w4, w6, w16
+bn.bflyv.16H  w5, w7, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w8, w10, w16
+bn.bflyv.16H  w9, w11, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w12, w14, w16
+bn.bflyv.16H  w13, w15, w16
+
+/* Coefficients 16 apart: wi and wi+1 */
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w0, w1, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w2, w3, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w4, w5, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w6, w7, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w8, w9, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w10, w11, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w12, w13, w16
+bn.lid        x4, 0(x3++)
+bn.bflyv.16H  w14, w15, w16
+
+/* Coefficients 8 apart: gather them from each pair of WDRs with .2Q */
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w0, w1
+bn.trn2.2Q    w18, w0, w1
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w0, w17, w18
+bn.trn2.2Q    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w2, w3
+bn.trn2.2Q    w18, w2, w3
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w2, w17, w18
+bn.trn2.2Q    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w4, w5
+bn.trn2.2Q    w18, w4, w5
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w4, w17, w18
+bn.trn2.2Q    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w6, w7
+bn.trn2.2Q    w18, w6, w7
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w6, w17, w18
+bn.trn2.2Q    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w8, w9
+bn.trn2.2Q    w18, w8, w9
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w8, w17, w18
+bn.trn2.2Q    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w10, w11
+bn.trn2.2Q    w18, w10, w11
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w10, w17, w18
+bn.trn2.2Q    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w12, w13
+bn.trn2.2Q    w18, w12, w13
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w12, w17, w18
+bn.trn2.2Q    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.2Q    w17, w14, w15
+bn.trn2.2Q    w18, w14, w15
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.2Q    w14, w17, w18
+bn.trn2.2Q    w15, w17, w18
+
+/* Coefficients 4 apart: gather them from each pair of WDRs with .4D */
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w0, w1
+bn.trn2.4D    w18, w0, w1
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w0, w17, w18
+bn.trn2.4D    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w2, w3
+bn.trn2.4D    w18, w2, w3
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w2, w17, w18
+bn.trn2.4D    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w4, w5
+bn.trn2.4D    w18, w4, w5
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w4, w17, w18
+bn.trn2.4D    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w6, w7
+bn.trn2.4D    w18, w6, w7
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w6, w17, w18
+bn.trn2.4D    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w8, w9
+bn.trn2.4D    w18, w8, w9
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w8, w17, w18
+bn.trn2.4D    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w10, w11
+bn.trn2.4D    w18, w10, w11
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w10, w17, w18
+bn.trn2.4D    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w12, w13
+bn.trn2.4D    w18, w12, w13
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w12, w17, w18
+bn.trn2.4D    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.4D    w17, w14, w15
+bn.trn2.4D    w18, w14, w15
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.4D    w14, w17, w18
+bn.trn2.4D    w15, w17, w18
+
+/* Coefficients 2 apart: gather them from each pair of WDRs with .8S */
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w0, w1
+bn.trn2.8S    w18, w0, w1
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w0, w17, w18
+bn.trn2.8S    w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w2, w3
+bn.trn2.8S    w18, w2, w3
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w2, w17, w18
+bn.trn2.8S    w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w4, w5
+bn.trn2.8S    w18, w4, w5
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w4, w17, w18
+bn.trn2.8S    w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w6, w7
+bn.trn2.8S    w18, w6, w7
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w6, w17, w18
+bn.trn2.8S    w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w8, w9
+bn.trn2.8S    w18, w8, w9
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w8, w17, w18
+bn.trn2.8S    w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w10, w11
+bn.trn2.8S    w18, w10, w11
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w10, w17, w18
+bn.trn2.8S    w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w12, w13
+bn.trn2.8S    w18, w12, w13
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w12, w17, w18
+bn.trn2.8S    w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.8S    w17, w14, w15
+bn.trn2.8S    w18, w14, w15
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.8S    w14, w17, w18
+bn.trn2.8S    w15, w17, w18
+
+/* Coefficients 1 apart: gather them from each pair of WDRs with .16H */
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w0, w1
+bn.trn2.16H   w18, w0, w1
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w0, w17, w18
+bn.trn2.16H   w1, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w2, w3
+bn.trn2.16H   w18, w2, w3
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w2, w17, w18
+bn.trn2.16H   w3, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w4, w5
+bn.trn2.16H   w18, w4, w5
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w4, w17, w18
+bn.trn2.16H   w5, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w6, w7
+bn.trn2.16H   w18, w6, w7
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w6, w17, w18
+bn.trn2.16H   w7, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w8, w9
+bn.trn2.16H   w18, w8, w9
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w8, w17, w18
+bn.trn2.16H   w9, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w10, w11
+bn.trn2.16H   w18, w10, w11
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w10, w17, w18
+bn.trn2.16H   w11, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w12, w13
+bn.trn2.16H   w18, w12, w13
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w12, w17, w18
+bn.trn2.16H   w13, w17, w18
+bn.lid        x4, 0(x3++)
+bn.trn1.16H   w17, w14, w15
+bn.trn2.16H   w18, w14, w15
+bn.bflyv.16H  w17, w18, w16
+bn.trn1.16H   w14, w17, w18
+bn.trn2.16H   w15, w17, w18
+
+ecall
+
+.section .data
+
+/*
+  q = 3329 and q' = -q^-1 mod 2^16 = 3327
+*/
+modulus:
+  .word 0x0cff0d01
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+  .word 0x00000000
+
+/*
+  a[i] = 1 + 11i + 37i^2 mod q for 0 <= i < 256
+*/
+coeffs:
+  .word 0x00310001
+  .word 0x016f00ab
+  .word 0x03d5027d
+  .word 0x07630577
+  .word 0x0c190999
+  .word 0x04f601e2
+  .word 0x0bfc0854
+  .word 0x072902ed
+  .word 0x037e0baf
+  .word 0x00fb0898
+  .word 0x0ca106a9
+  .word 0x0c6e05e2
+  .word 0x00620643
+  .word 0x027f07cc
+  .word 0x05c40a7d
+  .word 0x0a310155
+  .word 0x02c50656
+  .word 0x09820c7f
+  .word 0x046606cf
+  .word 0x00720247
+  .word 0x0aa70be8
+  .word 0x090309b0
+  .word 0x088708a0
+  .word 0x093308b8
+  .word 0x0b0709f8
+  .word 0x01020c60
+  .word 0x052602ef
+  .word 0x0a7207a7
+  .word 0x03e50086
+  .word 0x0b81078e
+  .word 0x074402bd
+  .word 0x042f0c15
+  .word 0x02420994
+  .word 0x017d083b
+  .word 0x01e0080a
+  .word 0x036b0901
+  .word 0x061e0b20
+  .word 0x09f90166
+  .word 0x01fb05d5
+  .word 0x08260b6c
+  .word 0x0278052a
+  .word 0x0af30010
+  .word 0x0795091f
+  .word 0x055f0655
+  .word 0x045104b3
+  .word 0x046b0439
+  .word 0x05ad04e7
+  .word 0x081706bd
+  .word 0x0ba909bb
+  .word 0x036200e0
+  .word 0x0944062e
+  .word 0x034d0ca4
+  .word 0x0b7f0741
+  .word 0x07d80306
+  .word 0x05590cf4
+  .word 0x04020b09
+  .word 0x03d30a46
+  .word 0x04cc0aab
+  .word 0x06ed0c38
+  .word 0x0a3601ec
+  .word 0x01a605c9
+  .word 0x073f0ace
+  .word 0x00ff03fa
+  .word 0x08e80b4f
+  .word 0x04f806cb
+  .word 0x0230036f
+  .word 0x0090013b
+  .word 0x0018002f
+  .word 0x00c8004b
+  .word 0x02a0018f
+  .word 0x05a003fb
+  .word 0x09c8078f
+  .word 0x02170c4b
+  .word 0x088f052e
+  .word 0x032e0c3a
+  .word 0x0bf6076d
+  .word 0x08e503c8
+  .word 0x06fc014b
+  .word 0x063b0cf7
+  .word 0x06a20cca
+  .word 0x083100c4
+  .word 0x0ae802e7
+  .word 0x01c60632
+  .word 0x06cd0aa5
+  .word 0x0cfc033f
+  .word 0x07520a02
+  .word 0x02d004ec
+  .word 0x0c7700fe
+  .word 0x0a450b39
+  .word 0x093b099b
+  .word 0x09590925
+  .word 0x0a9f09d7
+  .word 0x000c0bb1
+  .word 0x03a201b2
+  .word 0x086005dc
+  .word 0x01450b2e
+  .word 0x085304a7
+  .word 0x03880c49
+  .word 0x0ce60812
+  .word 0x0a6b0503
+  .word 0x0918031c
+  .word 0x08ed025d
+  .word 0x09ea02c6
+  .word 0x0c0f0457
+  .word 0x025b0710
+  .word 0x06d00af1
+  .word 0x0c6d02f9
+  .word 0x0631092a
+  .word 0x011d0382
+  .word 0x0a320c03
+  .word 0x076e08ab
+  .word 0x05d2067b
+  .word 0x055e0573
+  .word 0x06120593
+  .word 0x07ee06db
+  .word 0x0af2094b
+  .word 0x021d0ce3
+  .word 0x077104a2
+  .word 0x00ec0a8a
+  .word 0x08900499
+  .word 0x045b0cd1
+  .word 0x014e0930
+  .word 0x0c6a06b7
+  .word 0x0bad0566
+  .word 0x0c18053d
+  .word 0x00aa063c
+  .word 0x03650863
+  .word 0x07480bb2
+
+/*
+  The twiddle factors for each butterfly, in the order that they are used.
+  Each is w * 2^16 mod q, where w is a power of 17
+  (a primitive 256th root of unity mod q).
+*/
+twiddles:
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x0c560c56
+  .word 0x0c560c56
+  .word 0x0c560c56
+  .word 0x0c560c56
+  .word 0x026e026e
+  .word 0x026e026e
+  .word 0x026e026e
+  .word 0x026e026e
+  .word 0x06290629
+  .word 0x06290629
+  .word 0x06290629
+  .word 0x06290629
+  .word 0x00b600b6
+  .word 0x00b600b6
+  .word 0x00b600b6
+  .word 0x00b600b6
+  .word 0x03c203c2
+  .word 0x03c203c2
+  .word 0x03c203c2
+  .word 0x03c203c2
+  .word 0x084f084f
+  .word 0x084f084f
+  .word 0x084f084f
+  .word 0x084f084f
+  .word 0x073f073f
+  .word 0x073f073f
+  .word 0x073f073f
+  .word 0x073f073f
+  .word 0x05bc05bc
+  .word 0x05bc05bc
+  .word 0x05bc05bc
+  .word 0x05bc05bc
+  .word 0x08ed08ed
+  .word 0x08ed08ed
+  .word 0x0b9a0b9a
+  .word 0x0b9a0b9a
+  .word 0x0a0b0a0b
+  .word 0x0a0b0a0b
+  .word 0x07140714
+  .word 0x07140714
+  .word 0x05d505d5
+  .word 0x05d505d5
+  .word 0x011f011f
+  .word 0x011f011f
+  .word 0x058e058e
+  .word 0x058e058e
+  .word 0x00ca00ca
+  .word 0x00ca00ca
+  .word 0x0c560c56
+  .word 0x0c560c56
+  .word 0x06290629
+  .word 0x06290629
+  .word 0x026e026e
+  .word 0x026e026e
+  .word 0x00b600b6
+  .word 0x00b600b6
+  .word 0x03c203c2
+  .word 0x03c203c2
+  .word 0x073f073f
+  .word 0x073f073f
+  .word 0x084f084f
+  .word 0x084f084f
+  .word 0x05bc05bc
+  .word 0x05bc05bc
+  .word 0x023d023d
+  .word 0x023d023d
+  .word 0x01080108
+  .word 0x01080108
+  .word 0x07d407d4
+  .word 0x07d407d4
+  .word 0x017f017f
+  .word 0x017f017f
+  .word 0x09c409c4
+  .word 0x09c409c4
+  .word 0x06bf06bf
+  .word 0x06bf06bf
+  .word 0x05b205b2
+  .word 0x05b205b2
+  .word 0x0c7f0c7f
+  .word 0x0c7f0c7f
+  .word 0x0a580a58
+  .word 0x0a580a58
+  .word 0x02dc02dc
+  .word 0x02dc02dc
+  .word 0x03f903f9
+  .word 0x03f903f9
+  .word 0x02600260
+  .word 0x02600260
+  .word 0x06fb06fb
+  .word 0x06fb06fb
+  .word 0x0c340c34
+  .word 0x0c340c34
+  .word 0x019b019b
+  .word 0x019b019b
+  .word 0x06de06de
+  .word 0x06de06de
+  .word 0x08ed08ed
+  .word 0x05d505d5
+  .word 0x0a0b0a0b
+  .word 0x058e058e
+  .word 0x0b9a0b9a
+  .word 0x011f011f
+  .word 0x07140714
+  .word 0x00ca00ca
+  .word 0x0c560c56
+  .word 0x03c203c2
+  .word 0x026e026e
+  .word 0x084f084f
+  .word 0x06290629
+  .word 0x073f073f
+  .word 0x00b600b6
+  .word 0x05bc05bc
+  .word 0x023d023d
+  .word 0x09c409c4
+  .word 0x07d407d4
+  .word 0x05b205b2
+  .word 0x01080108
+  .word 0x06bf06bf
+  .word 0x017f017f
+  .word 0x0c7f0c7f
+  .word 0x0a580a58
+  .word 0x06fb06fb
+  .word 0x03f903f9
+  .word 0x019b019b
+  .word 0x02dc02dc
+  .word 0x0c340c34
+  .word 0x02600260
+  .word 0x06de06de
+  .word 0x04c704c7
+  .word 0x07f407f4
+  .word 0x028c028c
+  .word 0x05d305d3
+  .word 0x0ad90ad9
+  .word 0x0be70be7
+  .word 0x03f703f7
+  .word 0x06f906f9
+  .word 0x02040204
+  .word 0x06af06af
+  .word 0x0cf90cf9
+  .word 0x08770877
+  .word 0x0bc10bc1
+  .word 0x007e007e
+  .word 0x0a670a67
+  .word 0x05bd05bd
+  .word 0x09ac09ac
+  .word 0x006b006b
+  .word 0x0ca70ca7
+  .word 0x07740774
+  .word 0x0bf20bf2
+  .word 0x0c0a0c0a
+  .word 0x033e033e
+  .word 0x094a094a
+  .word 0x0b730b73
+  .word 0x01c001c0
+  .word 0x03c103c1
+  .word 0x08d808d8
+  .word 0x071d071d
+  .word 0x02a502a5
+  .word 0x0a2c0a2c
+  .word 0x08060806
+  .word 0x0c5608ed
+  .word 0x026e0a0b
+  .word 0x06290b9a
+  .word 0x00b60714
+  .word 0x03c205d5
+  .word 0x084f058e
+  .word 0x073f011f
+  .word 0x05bc00ca
+  .word 0x0a58023d
+  .word 0x03f907d4
+  .word 0x02dc0108
+  .word 0x0260017f
+  .word 0x06fb09c4
+  .word 0x019b05b2
+  .word 0x0c3406bf
+  .word 0x06de0c7f
+  .word 0x020404c7
+  .word 0x0cf9028c
+  .word 0x0bc10ad9
+  .word 0x0a6703f7
+  .word 0x06af07f4
+  .word 0x087705d3
+  .word 0x007e0be7
+  .word 0x05bd06f9
+  .word 0x0b7309ac
+  .word 0x03c10ca7
+  .word 0x071d0bf2
+  .word 0x0a2c033e
+  .word 0x01c0006b
+  .word 0x08d80774
+  .word 0x02a50c0a
+  .word 0x0806094a
+  .word 0x01a608b2
+  .word 0x024b01ae
+  .word 0x00b1022b
+  .word 0x0c16034b
+  .word 0x0bde081e
+  .word 0x0b350367
+  .word 0x0626060e
+  .word 0x06750069
+  .word 0x06cb0c0b
+  .word 0x0284030a
+  .word 0x09990487
+  .word 0x015d0c6e
+  .word 0x01a209f8
+  .word 0x014905cb
+  .word 0x0c650aa7
+  .word 0x0cb6045f
+  .word 0x08420331
+  .word 0x0c790449
+  .word 0x04c2025b
+  .word 0x07ca0262
+  .word 0x0997052a
+  .word 0x00dc07fc
+  .word 0x085e0748
+  .word 0x06860180
+  .word 0x0c950860
+  .word 0x0bcd0707
+  .word 0x03e40803
+  .word 0x03df031a
+  .word 0x03be071b
+  .word 0x074d09ab
+  .word 0x05f2099b
+  .word 0x065c01de
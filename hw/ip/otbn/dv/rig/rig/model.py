@@ -15,6 +15,12 @@ from .program import ProgInsn
 # A dictionary mapping integers to weights
 WDict = Dict[int, float]
 
+# CSRs that only the ISS implements: VFG0_CM, VFG0_LZ, VFG1_CM and VFG1_LZ,
+# which hold the vector flag groups. The RTL doesn't decode them, so the ISS
+# and RTL would disagree about any instruction that accessed them. They are
+# neither valid targets nor bad addresses for generated programs.
+_ISS_ONLY_CSRS = range(0x7c2, 0x7c6)
+
 
 class CallStack:
     '''An abstract model of the x1 call stack'''
@@ -1065,4 +1071,7 @@ class Model:
         self.consume_fuel()
 
     def pick_bad_addr(self, mem_type: str) -> Optional[int]:
-        return self._known_mem[mem_type].pick_bad_addr()
+        while True:
+            addr = self._known_mem[mem_type].pick_bad_addr()
+            if mem_type != 'csr' or addr not in _ISS_ONLY_CSRS:
+                return addr
@@ -0,0 +1,32 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "binary_trace_listener.h"
+
+const char BinaryTraceListener::kMagic[8] = {'O', 'T', 'B', 'N',
+                                             'T', 'R', 'C', 1};
+
+BinaryTraceListener::BinaryTraceListener(const std::string &filename,
+                                         bool compress)
+    : writer_(filename, compress), last_cycle_count_(0) {
+  writer_.Write(kMagic, sizeof kMagic);
+}
+
+void BinaryTraceListener::AcceptTraceEvent(const OtbnTraceEvent &event) {
+  record_buf_.clear();
+  AppendVarint((uint32_t)(event.cycle_count() - last_cycle_count_));
+  AppendVarint(event.text_len());
+  writer_.Write(record_buf_);
+  writer_.Write(event.text(), event.text_len());
+
+  last_cycle_count_ = event.cycle_count();
+}
+
+void BinaryTraceListener::AppendVarint(uint64_t value) {
+  while (value >= 0x80) {
+    record_buf_.push_back((char)(0x80 | (value & 0x7f)));
+    value >>= 7;
+  }
+  record_buf_.push_back((char)value);
+}
@@ -0,0 +1,54 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_BINARY_TRACE_LISTENER_H_
+#define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_BINARY_TRACE_LISTENER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "otbn_trace_listener.h"
+#include "trace_file_writer.h"
+
+/**
+ * An OtbnTraceListener that dumps the trace to a file in a compact binary
+ * format, which is much cheaper to write than the text log from
+ * LogTraceListener. Use otbn_trace_to_text.py (next to the tracer) to convert
+ * the file to the same text as LogTraceListener would have written.
+ *
+ * The file starts with the 8 bytes of kMagic. The rest of the file is a
+ * sequence of records, one for each trace from OTBN. Each record is the
+ * difference between its cycle count and that of the previous record (the
+ * first record just gives its cycle count), the length of the trace in bytes
+ * and then the trace itself. The difference and length are unsigned LEB128
+ * varints and the difference is taken modulo 2^32.
+ *
+ * If compress is true, the whole file is compressed with gzip.
+ */
+class BinaryTraceListener : public OtbnTraceListener {
+ public:
+  // The magic bytes at the start of a binary trace. The last byte is the
+  // version of the format.
+  static const char kMagic[8];
+
+  /**
+   * Constructor that takes a filename to write trace output to. It throws
+   * std::runtime_error if the file cannot be opened.
+   */
+  BinaryTraceListener(const std::string &filename, bool compress);
+
+  void AcceptTraceEvent(const OtbnTraceEvent &event) override;
+
+ private:
+  // Append value to record_buf_ as an unsigned LEB128 varint
+  void AppendVarint(uint64_t value);
+
+  TraceFileWriter writer_;
+  unsigned int last_cycle_count_;
+
+  // Scratch space for encoding the header of a record
+  std::string record_buf_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_BINARY_TRACE_LISTENER_H_
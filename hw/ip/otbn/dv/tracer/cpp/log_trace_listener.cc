@@ -5,63 +5,84 @@
 #include "log_trace_listener.h"
 
 #include <cassert>
-#include <iomanip>
-#include <ios>
-#include <sstream>
-#include <stdexcept>
+#include <cstdio>
+#include <cstring>
 #include <string>
 
-LogTraceListener::LogTraceListener(const std::string &log_filename)
-    : trace_log(log_filename, std::fstream::out) {
-  if (!trace_log.is_open()) {
-    std::ostringstream oss;
-    oss << "Could not open log file: " << log_filename;
-    throw std::runtime_error(oss.str());
-  }
+LogTraceListener::LogTraceListener(const std::string &log_filename,
+                                   bool compress)
+    : trace_log(log_filename, compress) {}
+
+void LogTraceListener::AcceptTraceEvent(const OtbnTraceEvent &event) {
+  record_buf.clear();
+  FormatRecord(event.text(), event.text_len(), event.cycle_count(),
+               &record_buf);
+  trace_log.Write(record_buf);
 }
 
-void LogTraceListener::AcceptTraceString(const std::string &trace,
-                                         unsigned int cycle_count) {
-  assert(trace_log.is_open());
+void LogTraceListener::FormatRecord(const char *trace, size_t len,
+                                    unsigned int cycle_count,
+                                    std::string *dst) {
+  assert(dst);
 
-  // Split the trace up into a vector of strings, one per line
-  auto trace_lines = SplitTraceLines(trace);
+  // The cycle count, padded to 9 digits
+  char count_buf[16];
+  snprintf(count_buf, sizeof count_buf, "%09u", cycle_count);
 
-  // Write out the lines from the trace
+  // Walk the lines of the trace. This splits the trace the same way as
+  // SplitTraceLines, but without copying each line: a newline at the very end
+  // of the trace doesn't start another (empty) line.
   bool first_line = true;
-  for (auto &line : trace_lines) {
-    if (first_line) {
-      if (line.size() > 1) {
-        // It is expected the first line of any trace output is an 'E' or 'S'
-        // line (instruction execute or instruction stall)
-        bool is_e_or_s_line = line[0] == 'E' || line[0] == 'S';
+  size_t pos = 0;
+  while (pos < len) {
+    const char *nl =
+        static_cast<const char *>(memchr(trace + pos, '\n', len - pos));
+    size_t end = nl ? nl - trace : len;
+
+    const char *line = trace + pos;
+    size_t line_len = end - pos;
+    pos = end + 1;
+
+    if (!first_line) {
+      // All lines other than the first are indented.
+      dst->append("    ");
+      dst->append(line, line_len);
+      dst->push_back('\n');
+      continue;
+    }
+
+    first_line = false;
 
-        // Output the beginning of the first line adding a cycle count. A
-        // special '!' line, only giving the cycle count, is output if the first
-        // line isn't an 'E' or 'S' line.
-        std::ios old_state(nullptr);
-        old_state.copyfmt(trace_log);
-        trace_log << (is_e_or_s_line ? line[0] : '!') << " " << std::setw(9)
-                  << std::setfill('0') << cycle_count;
-        trace_log.copyfmt(old_state);
+    if (line_len <= 1) {
+      dst->append("ERR: Bad line at ");
+      dst->append(std::to_string(cycle_count));
+      dst->append(" line should be more than 1 character: ");
+      dst->append(line, line_len);
+      dst->push_back('\n');
+      continue;
+    }
 
-        if (is_e_or_s_line) {
-          // If this is an expected 'E' or 'S' line write the rest of it out
-          trace_log << line.substr(1) << "\n";
-        } else {
-          // Otherwise leave the '!' line on it's own and dump this line out
-          // indented.
-          trace_log << "\n    " << line << "\n";
-        }
-      } else {
-        trace_log << "ERR: Bad line at " << cycle_count
-                  << " line should be more than 1 character: " << line << "\n";
-      }
+    // It is expected the first line of any trace output is an 'E' or 'S'
+    // line (instruction execute or instruction stall)
+    bool is_e_or_s_line = line[0] == 'E' || line[0] == 'S';
 
-      first_line = false;
+    // Output the beginning of the first line adding a cycle count. A special
+    // '!' line, only giving the cycle count, is output if the first line isn't
+    // an 'E' or 'S' line.
+    dst->push_back(is_e_or_s_line ? line[0] : '!');
+    dst->push_back(' ');
+    dst->append(count_buf);
+
+    if (is_e_or_s_line) {
+      // If this is an expected 'E' or 'S' line write the rest of it out
+      dst->append(line + 1, line_len - 1);
+      dst->push_back('\n');
     } else {
-      // All lines other than the first are indented.
-      trace_log << "    " << line << "\n";
+      // Otherwise leave the '!' line on it's own and dump this line out
+      // indented.
+      dst->append("\n    ");
+      dst->append(line, line_len);
+      dst->push_back('\n');
     }
   }
 }
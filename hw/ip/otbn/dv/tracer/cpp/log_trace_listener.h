@@ -5,10 +5,11 @@
 #ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_LOG_TRACE_LISTENER_H_
 #define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_LOG_TRACE_LISTENER_H_
 
-#include <fstream>
+#include <cstddef>
 #include <string>
 
 #include "otbn_trace_listener.h"
+#include "trace_file_writer.h"
 
 /**
  * An OtbnTraceListener that dumps the trace to a log file, with some minimal
@@ -22,19 +23,39 @@
  * If an 'E' or 'S' line isn't seen as the first line it prints a special '!'
  * line that gives the cycle count and dumps the rest of the trace indented by
  * four spaces.
+ *
+ * The file is written by a TraceFileWriter, so the simulation doesn't wait for
+ * the disk.
  */
 class LogTraceListener : public OtbnTraceListener {
  private:
-  std::ofstream trace_log;
+  TraceFileWriter trace_log;
+
+  // Scratch space for formatting a trace record (kept between calls to avoid
+  // allocating on every cycle)
+  std::string record_buf;
 
  public:
   /**
-   * Constructor that takes a log filename to write trace output to. It throws
+   * Constructor that takes a log filename to write trace output to. If
+   * compress is true, the log is compressed with gzip. It throws
    * std::runtime_error if the file cannot be opened.
    */
-  LogTraceListener(const std::string &log_filename);
-  void AcceptTraceString(const std::string &trace,
-                         unsigned int cycle_count) override;
+  LogTraceListener(const std::string &log_filename, bool compress = false);
+  void AcceptTraceEvent(const OtbnTraceEvent &event) override;
+
+  /**
+   * Format a trace record (len bytes at trace) as it appears in the log,
+   * appending it to dst. This is also what otbn_trace_to_text.py does with
+   * records from a binary trace (see BinaryTraceListener).
+   */
+  static void FormatRecord(const char *trace, size_t len,
+                           unsigned int cycle_count, std::string *dst);
+
+  static void FormatRecord(const std::string &trace, unsigned int cycle_count,
+                           std::string *dst) {
+    FormatRecord(trace.data(), trace.size(), cycle_count, dst);
+  }
 };
 
 #endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_LOG_TRACE_LISTENER_H_
@@ -0,0 +1,213 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "otbn_trace_event.h"
+
+#include <cstring>
+
+// Parse up to 8 hex digits at *pos (which must be before end), advancing
+// *pos past them. Returns false if there are no digits.
+static bool ParseHex32(const char **pos, const char *end, uint32_t *dst) {
+  uint32_t value = 0;
+  int digits = 0;
+  for (; *pos < end && digits < 8; ++*pos, ++digits) {
+    char c = **pos;
+    unsigned nibble;
+    if ('0' <= c && c <= '9') {
+      nibble = c - '0';
+    } else if ('a' <= c && c <= 'f') {
+      nibble = 10 + c - 'a';
+    } else if ('A' <= c && c <= 'F') {
+      nibble = 10 + c - 'A';
+    } else {
+      break;
+    }
+    value = (value << 4) | nibble;
+  }
+  *dst = value;
+  return digits > 0;
+}
+
+// If the text at *pos starts with the NUL-terminated string expected, advance
+// *pos past it and return true.
+static bool Consume(const char **pos, const char *end, const char *expected) {
+  size_t len = strlen(expected);
+  if ((size_t)(end - *pos) < len || memcmp(*pos, expected, len) != 0)
+    return false;
+  *pos += len;
+  return true;
+}
+
+OtbnTraceEvent::OtbnTraceEvent()
+    : text_(nullptr),
+      text_len_(0),
+      cycle_count_(0),
+      kind_(kOther),
+      kinds_(0),
+      has_pc_(false),
+      pc_(0),
+      has_insn_(false),
+      insn_(0),
+      str_valid_(false) {}
+
+void OtbnTraceEvent::Parse(const char *text, size_t len,
+                           unsigned int cycle_count) {
+  text_ = text;
+  text_len_ = len;
+  cycle_count_ = cycle_count;
+  kind_ = kOther;
+  kinds_ = 0;
+  has_pc_ = false;
+  pc_ = 0;
+  has_insn_ = false;
+  insn_ = 0;
+  accesses_.clear();
+  str_valid_ = false;
+
+  // Split the trace into lines the same way as
+  // OtbnTraceListener::SplitTraceLines: a newline at the very end of the
+  // trace doesn't start another (empty) line.
+  bool first_line = true;
+  const char *end = text + len;
+  for (const char *line = text; line < end;) {
+    const char *eol =
+        static_cast<const char *>(memchr(line, '\n', end - line));
+    if (!eol)
+      eol = end;
+    size_t line_len = eol - line;
+
+    // Every line that we understand is a prefix character, followed by a
+    // space (or nothing, for some header lines).
+    int line_kind = 0;
+    if (line_len > 0 && (line_len == 1 || line[1] == ' ')) {
+      switch (line[0]) {
+        case 'E':
+          line_kind = kExec;
+          break;
+        case 'S':
+          line_kind = kStall;
+          break;
+        case 'U':
+          line_kind = kWipeInProgress;
+          break;
+        case 'V':
+          line_kind = kWipeComplete;
+          break;
+        case 'Z':
+          line_kind = kStray;
+          break;
+        case '<':
+          ParseAccess(kRegRead, line, line_len);
+          break;
+        case '>':
+          ParseAccess(kRegWrite, line, line_len);
+          break;
+        case 'R':
+          ParseAccess(kMemRead, line, line_len);
+          break;
+        case 'W':
+          ParseAccess(kMemWrite, line, line_len);
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (line_kind == kExec || line_kind == kStall)
+      ParseInsnHeader(line, line_len);
+
+    if (first_line) {
+      kind_ = line_kind ? static_cast<Kind>(line_kind) : kOther;
+      kinds_ |= kind_;
+      first_line = false;
+    } else {
+      kinds_ |= line_kind;
+    }
+
+    line = eol + 1;
+  }
+
+  // An empty trace has no header line, so counts as kOther.
+  if (first_line)
+    kinds_ = kOther;
+}
+
+const std::string &OtbnTraceEvent::str() const {
+  if (!str_valid_) {
+    str_.assign(text_, text_len_);
+    str_valid_ = true;
+  }
+  return str_;
+}
+
+// Fields of the RISC-V instruction encoding
+static uint32_t InsnOpcode(uint32_t insn) { return insn & 0x7f; }
+static uint32_t InsnRd(uint32_t insn) { return (insn >> 7) & 0x1f; }
+static uint32_t InsnFunct3(uint32_t insn) { return (insn >> 12) & 0x7; }
+static uint32_t InsnRs1(uint32_t insn) { return (insn >> 15) & 0x1f; }
+
+bool OtbnTraceEvent::IsCall() const {
+  if (!(has_insn_ && (kinds_ & kExec)))
+    return false;
+  uint32_t opcode = InsnOpcode(insn_);
+  // JAL or JALR, writing x1
+  return (opcode == 0x6f || opcode == 0x67) && InsnRd(insn_) == 1;
+}
+
+bool OtbnTraceEvent::IsReturn() const {
+  if (!(has_insn_ && (kinds_ & kExec)))
+    return false;
+  // JALR x0, x1, ...
+  return InsnOpcode(insn_) == 0x67 && InsnRd(insn_) == 0 &&
+         InsnRs1(insn_) == 1;
+}
+
+uint32_t OtbnTraceEvent::LoopBodySize() const {
+  if (!(has_insn_ && (kinds_ & kExec)))
+    return 0;
+  // LOOP and LOOPI are in the custom-3 opcode, with funct3 0 and 1. The
+  // bodysize field is the number of instructions in the body, minus one.
+  if (InsnOpcode(insn_) != 0x7b || InsnFunct3(insn_) > 1)
+    return 0;
+  return (insn_ >> 20) + 1;
+}
+
+void OtbnTraceEvent::ParseInsnHeader(const char *line, size_t line_len) {
+  // The line looks like "E PC: 0x00000004, insn: 0x00000013" or, if there
+  // was an error fetching the instruction, "E PC: 0x00000004, insn: ??".
+  const char *pos = line + 1;
+  const char *end = line + line_len;
+
+  if (!Consume(&pos, end, " PC: 0x") || !ParseHex32(&pos, end, &pc_))
+    return;
+  has_pc_ = true;
+
+  if (Consume(&pos, end, ", insn: 0x") && ParseHex32(&pos, end, &insn_))
+    has_insn_ = true;
+}
+
+void OtbnTraceEvent::ParseAccess(AccessType type, const char *line,
+                                 size_t line_len) {
+  // Body lines look like "> x3: 0x00000001": the location runs up to the
+  // first ": " and the value is everything after it.
+  Access access;
+  access.type = type;
+  access.line = line;
+  access.line_len = line_len;
+  access.loc = line + (line_len < 2 ? line_len : 2);
+  access.loc_len = line_len < 2 ? 0 : line_len - 2;
+  access.value = line + line_len;
+  access.value_len = 0;
+
+  for (size_t i = 2; i + 1 < line_len; ++i) {
+    if (line[i] == ':' && line[i + 1] == ' ') {
+      access.loc_len = i - 2;
+      access.value = line + i + 2;
+      access.value_len = line_len - (i + 2);
+      break;
+    }
+  }
+
+  accesses_.push_back(access);
+}
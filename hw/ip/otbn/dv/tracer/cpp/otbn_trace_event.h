@@ -0,0 +1,165 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_EVENT_H_
+#define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_EVENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A parsed version of the trace output from OTBN for a single cycle.
+ *
+ * The trace from the RTL tracer (otbn_tracer.sv) is some header lines (whose
+ * first character is one of E, S, U, V or Z) followed by body lines that
+ * describe register and memory accesses. OtbnTraceSource parses each trace
+ * into an event once, and then passes the same event to all of its
+ * listeners.
+ *
+ * An event doesn't own its text: the text pointers (and the locations and
+ * values of accesses) point into the trace that was passed to Parse(), so
+ * they are only valid until the listener callback returns. Parsing a new
+ * trace reuses the storage of the event, so parsing doesn't normally
+ * allocate.
+ */
+class OtbnTraceEvent {
+ public:
+  /**
+   * The kinds of header line that can appear in a trace. These are bits, so
+   * that listeners can subscribe to a set of kinds with a mask.
+   */
+  enum Kind {
+    // 'E': An instruction completed its execution
+    kExec = 1 << 0,
+    // 'S': An instruction stalled
+    kStall = 1 << 1,
+    // 'U': A secure wipe is in progress
+    kWipeInProgress = 1 << 2,
+    // 'V': A secure wipe completed
+    kWipeComplete = 1 << 3,
+    // 'Z': A change that happened without any of the above
+    kStray = 1 << 4,
+    // A trace whose first line isn't a header we recognise
+    kOther = 1 << 5
+  };
+
+  // A mask that matches every kind of event
+  static const unsigned kAllKinds = (1u << 6) - 1;
+
+  /** The kinds of line that describe an access */
+  enum AccessType {
+    // '<': A register read
+    kRegRead,
+    // '>': A register write
+    kRegWrite,
+    // 'R': A memory read
+    kMemRead,
+    // 'W': A memory write
+    kMemWrite
+  };
+
+  /**
+   * A register or memory access. line is the whole line (including the
+   * prefix character). loc is the location (like "x3", "w12", "ACC" or
+   * "[0x00000040]") and value is the text after the colon.
+   */
+  struct Access {
+    AccessType type;
+    const char *line;
+    size_t line_len;
+    const char *loc;
+    size_t loc_len;
+    const char *value;
+    size_t value_len;
+  };
+
+  OtbnTraceEvent();
+
+  /**
+   * Parse the trace at text (which is len bytes long) from the given cycle.
+   * The text must stay valid for as long as the event is used.
+   */
+  void Parse(const char *text, size_t len, unsigned int cycle_count);
+
+  /** The cycle count associated with the trace */
+  unsigned int cycle_count() const { return cycle_count_; }
+
+  /**
+   * The kind of the first line of the trace. A trace can have more than one
+   * header line (an instruction might execute in the same cycle as a secure
+   * wipe starts): kinds() returns all of them.
+   */
+  Kind kind() const { return kind_; }
+
+  /** A mask with the bit for each kind of header line in the trace */
+  unsigned kinds() const { return kinds_; }
+
+  /**
+   * True if the trace has an E or S line, in which case pc() is the address
+   * of the instruction.
+   */
+  bool has_pc() const { return has_pc_; }
+  uint32_t pc() const { return pc_; }
+
+  /**
+   * True if the E or S line gives the instruction's bits (it doesn't if
+   * fetching the instruction caused an integrity error), in which case
+   * insn() returns them.
+   */
+  bool has_insn() const { return has_insn_; }
+  uint32_t insn() const { return insn_; }
+
+  /**
+   * Helpers that classify the instruction in an E line. A call is a JAL or
+   * JALR that writes x1 and a return is JALR x0, x1. LoopBodySize returns the
+   * number of instructions in the body if the instruction is a LOOP or LOOPI
+   * and zero otherwise. All of these are false (or zero) if the trace has no
+   * E line with instruction bits.
+   */
+  bool IsCall() const;
+  bool IsReturn() const;
+  uint32_t LoopBodySize() const;
+
+  /** The register and memory accesses in the trace, in trace order */
+  const std::vector<Access> &accesses() const { return accesses_; }
+
+  /** The raw trace text */
+  const char *text() const { return text_; }
+  size_t text_len() const { return text_len_; }
+
+  /**
+   * The trace text as a string. This is copied the first time it is asked
+   * for after each call to Parse(), so listeners that don't need it don't
+   * pay for it.
+   */
+  const std::string &str() const;
+
+ private:
+  // Parse the "PC: 0x..., insn: 0x..." text after an E or S prefix
+  void ParseInsnHeader(const char *line, size_t line_len);
+
+  // Parse a body line that starts with the prefix for type
+  void ParseAccess(AccessType type, const char *line, size_t line_len);
+
+  const char *text_;
+  size_t text_len_;
+  unsigned int cycle_count_;
+
+  Kind kind_;
+  unsigned kinds_;
+
+  bool has_pc_;
+  uint32_t pc_;
+  bool has_insn_;
+  uint32_t insn_;
+
+  std::vector<Access> accesses_;
+
+  mutable std::string str_;
+  mutable bool str_valid_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_EVENT_H_
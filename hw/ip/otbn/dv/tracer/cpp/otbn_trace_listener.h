@@ -9,10 +9,18 @@
 #include <string>
 #include <vector>
 
+#include "otbn_trace_event.h"
+
 /**
  * Base class for anything that wants to examine trace output from OTBN. The
  * simulation that hosts the tracer is responsible for setting up listeners and
  * routing the DPI `accept_otbn_trace_string` calls to them.
+ *
+ * OtbnTraceSource parses each trace into an OtbnTraceEvent once and passes it
+ * to AcceptTraceEvent. Listeners that work with the parsed trace should
+ * override that. The default implementation renders the trace as a string
+ * and passes it to AcceptTraceString, which is what older listeners override.
+ * A listener can also override EventKinds to only see some kinds of trace.
  */
 class OtbnTraceListener {
  public:
@@ -35,14 +43,33 @@ class OtbnTraceListener {
     return trace_lines;
   }
 
+  /**
+   * The kinds of event that this listener wants to see, as a mask of
+   * OtbnTraceEvent::Kind bits. A trace is passed to the listener if any of its
+   * header lines has a kind in the mask. The source reads this when the
+   * listener is added.
+   */
+  virtual unsigned EventKinds() const { return OtbnTraceEvent::kAllKinds; }
+
+  /**
+   * Called to process an OTBN trace, called a maximum of once per cycle
+   *
+   * @param event The parsed trace. This (and the text that it points at) is
+   *              only valid until the function returns.
+   */
+  virtual void AcceptTraceEvent(const OtbnTraceEvent &event) {
+    AcceptTraceString(event.str(), event.cycle_count());
+  }
+
   /**
    * Called to process an OTBN trace output, called a maximum of once per cycle
+   * by the default implementation of AcceptTraceEvent.
    *
    * @param trace Trace output from OTBN
    * @param cycle_count The cycle count associated with the trace output
    */
-  virtual void AcceptTraceString(const std::string &trace,
-                                 unsigned int cycle_count) = 0;
+  virtual void AcceptTraceString(const std::string & /* trace */,
+                                 unsigned int /* cycle_count */) {}
   virtual ~OtbnTraceListener() {}
 };
 
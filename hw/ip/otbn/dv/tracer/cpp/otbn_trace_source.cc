@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <memory>
 
 static std::unique_ptr<OtbnTraceSource> trace_source;
@@ -18,24 +19,40 @@ OtbnTraceSource &OtbnTraceSource::get() {
 }
 
 void OtbnTraceSource::AddListener(OtbnTraceListener *listener) {
-  listeners_.push_back(listener);
+  Subscription sub = {listener, listener->EventKinds()};
+  listeners_.push_back(sub);
+  all_kinds_ |= sub.kinds;
 }
 
 void OtbnTraceSource::RemoveListener(const OtbnTraceListener *listener) {
-  auto it = std::find(listeners_.begin(), listeners_.end(), listener);
+  auto it = std::find_if(
+      listeners_.begin(), listeners_.end(),
+      [listener](const Subscription &sub) { return sub.listener == listener; });
   assert(it != listeners_.end());
   listeners_.erase(it);
+
+  all_kinds_ = 0;
+  for (const Subscription &sub : listeners_) {
+    all_kinds_ |= sub.kinds;
+  }
 }
 
-void OtbnTraceSource::Broadcast(const std::string &trace,
+void OtbnTraceSource::Broadcast(const char *trace, size_t len,
                                 unsigned cycle_count) {
-  for (OtbnTraceListener *listener : listeners_) {
-    listener->AcceptTraceString(trace, cycle_count);
+  // Don't bother parsing the trace if nobody is listening.
+  if (!all_kinds_)
+    return;
+
+  event_.Parse(trace, len, cycle_count);
+  for (const Subscription &sub : listeners_) {
+    if (sub.kinds & event_.kinds()) {
+      sub.listener->AcceptTraceEvent(event_);
+    }
   }
 }
 
 extern "C" void accept_otbn_trace_string(const char *trace,
                                          unsigned int cycle_count) {
   assert(trace != nullptr);
-  OtbnTraceSource::get().Broadcast(trace, cycle_count);
+  OtbnTraceSource::get().Broadcast(trace, strlen(trace), cycle_count);
 }
@@ -4,8 +4,11 @@
 #ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_SOURCE_H_
 #define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_SOURCE_H_
 
+#include <cstddef>
+#include <string>
 #include <vector>
 
+#include "otbn_trace_event.h"
 #include "otbn_trace_listener.h"
 
 // A source for simulation trace data.
@@ -15,7 +18,9 @@
 //
 // The object is in charge of taking trace data from the simulation (which is
 // sent by calling the accept_otbn_trace_string DPI function) and passing it
-// out to registered listeners.
+// out to registered listeners. Each trace is parsed once into an
+// OtbnTraceEvent, which is reused from cycle to cycle, and passed to the
+// listeners that want its kind of event.
 
 class OtbnTraceSource {
  public:
@@ -28,11 +33,28 @@ class OtbnTraceSource {
   // Remove a listener from the source
   void RemoveListener(const OtbnTraceListener *listener);
 
+  // Send a trace (len bytes at trace) to all listeners
+  void Broadcast(const char *trace, size_t len, unsigned cycle_count);
+
   // Send a trace string to all listeners
-  void Broadcast(const std::string &trace, unsigned cycle_count);
+  void Broadcast(const std::string &trace, unsigned cycle_count) {
+    Broadcast(trace.data(), trace.size(), cycle_count);
+  }
 
  private:
-  std::vector<OtbnTraceListener *> listeners_;
+  struct Subscription {
+    OtbnTraceListener *listener;
+    // The listener's EventKinds() mask
+    unsigned kinds;
+  };
+
+  std::vector<Subscription> listeners_;
+
+  // The union of the kinds masks in listeners_
+  unsigned all_kinds_ = 0;
+
+  // The event for the current trace
+  OtbnTraceEvent event_;
 };
 
 #endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_OTBN_TRACE_SOURCE_H_
@@ -0,0 +1,284 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "profile_trace_listener.h"
+
+#include <cassert>
+#include <cstdio>
+#include <utility>
+
+#include "trace_file_writer.h"
+
+namespace {
+
+// Helpers for writing protobuf messages (see
+// https://protobuf.dev/programming-guides/encoding/). We only need varint and
+// length-delimited fields.
+void AppendVarint(std::string *dst, uint64_t value) {
+  while (value >= 0x80) {
+    dst->push_back((char)(0x80 | (value & 0x7f)));
+    value >>= 7;
+  }
+  dst->push_back((char)value);
+}
+
+void AppendIntField(std::string *dst, unsigned field, uint64_t value) {
+  AppendVarint(dst, (uint64_t)field << 3);
+  AppendVarint(dst, value);
+}
+
+void AppendBytesField(std::string *dst, unsigned field,
+                      const std::string &value) {
+  AppendVarint(dst, ((uint64_t)field << 3) | 2);
+  AppendVarint(dst, value.size());
+  dst->append(value);
+}
+
+void AppendPackedField(std::string *dst, unsigned field,
+                       const std::vector<uint64_t> &values) {
+  std::string packed;
+  for (uint64_t value : values) {
+    AppendVarint(&packed, value);
+  }
+  AppendBytesField(dst, field, packed);
+}
+
+// The string table of a pprof profile. Index zero is always the empty string.
+class StringTable {
+ public:
+  StringTable() { Intern(""); }
+
+  uint64_t Intern(const std::string &str) {
+    auto pr = indices_.insert(std::make_pair(str, strings_.size()));
+    if (pr.second) {
+      strings_.push_back(str);
+    }
+    return pr.first->second;
+  }
+
+  const std::vector<std::string> &strings() const { return strings_; }
+
+ private:
+  std::vector<std::string> strings_;
+  std::map<std::string, uint64_t> indices_;
+};
+
+// Encode a pprof ValueType message
+std::string ValueType(StringTable *strings, const char *type,
+                      const char *unit) {
+  std::string msg;
+  AppendIntField(&msg, 1, strings->Intern(type));
+  AppendIntField(&msg, 2, strings->Intern(unit));
+  return msg;
+}
+
+}  // namespace
+
+ProfileTraceListener::ProfileTraceListener(const Symbols *symbols)
+    : symbols_(symbols), pending_call_(false) {
+  assert(symbols);
+}
+
+void ProfileTraceListener::AcceptTraceEvent(const OtbnTraceEvent &event) {
+  key_.clear();
+
+  if (!event.has_pc()) {
+    if (event.kinds() &
+        (OtbnTraceEvent::kWipeInProgress | OtbnTraceEvent::kWipeComplete)) {
+      // A secure wipe means that OTBN has stopped running (or hasn't started
+      // yet), so the next instruction starts a new stack.
+      stack_.clear();
+      loop_ends_.clear();
+      pending_call_ = false;
+      key_.push_back(MakeFrame(kFrameWipe, 0));
+    } else {
+      key_.push_back(MakeFrame(kFrameOther, 0));
+    }
+    Count(key_, false);
+    return;
+  }
+
+  uint32_t pc = event.pc();
+
+  // The first instruction of a run or of a function that has just been called
+  // starts a new call frame.
+  if (stack_.empty() || pending_call_) {
+    stack_.push_back(MakeFrame(kFrameCall, pc));
+    loop_ends_.push_back(0);
+    pending_call_ = false;
+  }
+
+  // Pop any loops that we have left. A loop's body starts just after the LOOP
+  // instruction.
+  while (GetKind(stack_.back()) == kFrameLoop &&
+         (pc <= GetAddr(stack_.back()) || loop_ends_.back() < pc)) {
+    stack_.pop_back();
+    loop_ends_.pop_back();
+  }
+
+  key_ = stack_;
+  key_.push_back(MakeFrame(kFramePc, pc));
+  Count(key_, (event.kinds() & OtbnTraceEvent::kStall) != 0);
+
+  OnExec(event);
+}
+
+void ProfileTraceListener::Count(const std::vector<Frame> &key, bool stall) {
+  auto it = profile_.find(key);
+  if (it == profile_.end()) {
+    Counts zero = {0, 0};
+    it = profile_.insert(std::make_pair(key, zero)).first;
+  }
+  ++it->second.cycles;
+  if (stall) {
+    ++it->second.stalls;
+  }
+}
+
+void ProfileTraceListener::OnExec(const OtbnTraceEvent &event) {
+  if (event.IsCall()) {
+    pending_call_ = true;
+  } else if (event.IsReturn()) {
+    // Pop everything up to and including the innermost call frame (but never
+    // the outermost frame, which is where the run started).
+    while (stack_.size() > 1) {
+      FrameKind kind = GetKind(stack_.back());
+      stack_.pop_back();
+      loop_ends_.pop_back();
+      if (kind == kFrameCall)
+        break;
+    }
+  } else if (uint32_t body_size = event.LoopBodySize()) {
+    stack_.push_back(MakeFrame(kFrameLoop, event.pc()));
+    loop_ends_.push_back(event.pc() + 4 * body_size);
+  }
+}
+
+std::string ProfileTraceListener::AddrName(uint32_t addr) const {
+  char buf[32];
+
+  auto it = symbols_->upper_bound(addr);
+  if (it == symbols_->begin()) {
+    snprintf(buf, sizeof buf, "0x%08x", (unsigned)addr);
+    return buf;
+  }
+
+  --it;
+  if (it->first == addr)
+    return it->second;
+
+  snprintf(buf, sizeof buf, "+0x%x", (unsigned)(addr - it->first));
+  return it->second + buf;
+}
+
+std::string ProfileTraceListener::FrameName(Frame frame) const {
+  switch (GetKind(frame)) {
+    case kFrameCall:
+      return AddrName(GetAddr(frame));
+    case kFrameLoop:
+      return "loop@" + AddrName(GetAddr(frame));
+    case kFrameWipe:
+      return "[secure_wipe]";
+    default:
+      return "[other]";
+  }
+}
+
+void ProfileTraceListener::WriteFolded(const std::string &path) const {
+  // Several stacks (with different PCs) fold to the same line, so collect the
+  // lines first.
+  std::map<std::string, uint64_t> folded;
+  for (const auto &entry : profile_) {
+    std::string line;
+    for (Frame frame : entry.first) {
+      if (GetKind(frame) == kFramePc)
+        continue;
+      if (!line.empty())
+        line.push_back(';');
+      line += FrameName(frame);
+    }
+    folded[line] += entry.second.cycles;
+  }
+
+  TraceFileWriter writer(path, false);
+  for (const auto &entry : folded) {
+    writer.Write(entry.first + " " + std::to_string(entry.second) + "\n");
+  }
+}
+
+void ProfileTraceListener::WritePprof(const std::string &path) const {
+  // The fields of the Profile message (see profile.proto in the pprof
+  // sources) that we write. The order of fields in a message doesn't matter,
+  // so we write the string table last, once we know all the strings.
+  StringTable strings;
+  std::string profile;
+
+  AppendBytesField(&profile, 1, ValueType(&strings, "cycles", "count"));
+  AppendBytesField(&profile, 1, ValueType(&strings, "stall_cycles", "count"));
+
+  // Functions are keyed by name and locations by function ID and address.
+  // Each frame in a stack is a location, except for the PC, which is the
+  // address of the location for the innermost frame.
+  std::map<std::string, uint64_t> function_ids;
+  std::map<std::pair<uint64_t, uint32_t>, uint64_t> location_ids;
+  std::string functions, locations;
+
+  for (const auto &entry : profile_) {
+    const std::vector<Frame> &stack = entry.first;
+    bool has_pc = !stack.empty() && GetKind(stack.back()) == kFramePc;
+    size_t num_frames = stack.size() - (has_pc ? 1 : 0);
+
+    std::vector<uint64_t> sample_locs;
+    for (size_t i = num_frames; i-- > 0;) {
+      std::string name = FrameName(stack[i]);
+      auto fn_pr = function_ids.insert(
+          std::make_pair(name, (uint64_t)function_ids.size() + 1));
+      uint64_t fn_id = fn_pr.first->second;
+      if (fn_pr.second) {
+        std::string fn;
+        AppendIntField(&fn, 1, fn_id);
+        AppendIntField(&fn, 2, strings.Intern(name));
+        AppendIntField(&fn, 3, strings.Intern(name));
+        AppendBytesField(&functions, 5, fn);
+      }
+
+      uint32_t addr = (has_pc && i + 1 == num_frames) ? GetAddr(stack.back())
+                                                      : GetAddr(stack[i]);
+      auto loc_pr = location_ids.insert(std::make_pair(
+          std::make_pair(fn_id, addr), (uint64_t)location_ids.size() + 1));
+      uint64_t loc_id = loc_pr.first->second;
+      if (loc_pr.second) {
+        std::string line, loc;
+        AppendIntField(&line, 1, fn_id);
+        AppendIntField(&loc, 1, loc_id);
+        AppendIntField(&loc, 3, addr);
+        AppendBytesField(&loc, 4, line);
+        AppendBytesField(&locations, 4, loc);
+      }
+
+      sample_locs.push_back(loc_id);
+    }
+
+    std::string sample;
+    AppendPackedField(&sample, 1, sample_locs);
+    AppendPackedField(&sample, 2,
+                      {entry.second.cycles, entry.second.stalls});
+    AppendBytesField(&profile, 2, sample);
+  }
+
+  profile += locations;
+  profile += functions;
+
+  AppendBytesField(&profile, 11, ValueType(&strings, "cycles", "count"));
+  AppendIntField(&profile, 12, 1);
+  // default_sample_type: show cycles, rather than stalls, by default
+  AppendIntField(&profile, 14, strings.Intern("cycles"));
+
+  for (const std::string &str : strings.strings()) {
+    AppendBytesField(&profile, 6, str);
+  }
+
+  TraceFileWriter writer(path, TraceFileWriter::CanCompress());
+  writer.Write(profile);
+}
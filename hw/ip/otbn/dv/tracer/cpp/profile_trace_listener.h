@@ -0,0 +1,125 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_PROFILE_TRACE_LISTENER_H_
+#define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_PROFILE_TRACE_LISTENER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "otbn_trace_listener.h"
+
+/**
+ * An OtbnTraceListener that builds a cycle-accurate profile of the program
+ * that OTBN runs.
+ *
+ * Every cycle that has an 'E' or 'S' line is attributed to the PC of the
+ * instruction and to the stack of functions and loops that the instruction is
+ * in. The stack is tracked from the instructions in the trace: a JAL or JALR
+ * that writes x1 is a call, a JALR x0, x1 is a return and a LOOP or LOOPI
+ * starts a loop that lasts until the PC leaves the loop body. Cycles with a
+ * secure wipe ('U' or 'V') are attributed to a "[secure_wipe]" frame and any
+ * other cycles with trace output to an "[other]" frame.
+ *
+ * Addresses are named with the code symbols from the ELF file: a function is
+ * named by the symbol at its entry point (or the closest symbol before it, with
+ * an offset) and a loop is named "loop@" followed by the name of the address
+ * of its LOOP instruction. The symbols are only read when the profile is
+ * written, so they can be loaded after the listener is constructed.
+ *
+ * The profile can be written as folded stacks (the input format for
+ * flamegraph.pl and similar tools) and as a pprof profile.
+ */
+class ProfileTraceListener : public OtbnTraceListener {
+ public:
+  typedef std::map<uint32_t, std::string> Symbols;
+
+  /**
+   * Constructor. symbols maps addresses in IMEM to symbol names. It must
+   * outlive the listener, but may be empty.
+   */
+  explicit ProfileTraceListener(const Symbols *symbols);
+
+  void AcceptTraceEvent(const OtbnTraceEvent &event) override;
+
+  /**
+   * Write the profile as folded stacks to path. Each line is a stack of
+   * frames, outermost first and separated by ';', followed by a space and the
+   * number of cycles spent there. Throws std::runtime_error on failure.
+   */
+  void WriteFolded(const std::string &path) const;
+
+  /**
+   * Write the profile to path in pprof's protobuf format (gzipped, if the
+   * build supports it). Samples have two values: cycles and, of those, the
+   * cycles spent stalled. Throws std::runtime_error on failure.
+   */
+  void WritePprof(const std::string &path) const;
+
+ private:
+  // A frame in a stack. The top 32 bits are a FrameKind and the bottom 32
+  // bits are an address (for frames that have one).
+  typedef uint64_t Frame;
+
+  enum FrameKind {
+    // A function, whose address is its entry point
+    kFrameCall = 0,
+    // A loop, whose address is the LOOP or LOOPI instruction
+    kFrameLoop = 1,
+    // The PC of the instruction. This is always the last frame in a stack.
+    kFramePc = 2,
+    // Secure wipe cycles
+    kFrameWipe = 3,
+    // Cycles with trace output that doesn't fit any of the above
+    kFrameOther = 4
+  };
+
+  // Cycle counts for a stack
+  struct Counts {
+    uint64_t cycles;
+    uint64_t stalls;
+  };
+
+  typedef std::map<std::vector<Frame>, Counts> Profile;
+
+  static Frame MakeFrame(FrameKind kind, uint32_t addr) {
+    return ((Frame)kind << 32) | addr;
+  }
+  static FrameKind GetKind(Frame frame) { return (FrameKind)(frame >> 32); }
+  static uint32_t GetAddr(Frame frame) { return (uint32_t)frame; }
+
+  // Add a cycle to the count for key
+  void Count(const std::vector<Frame> &key, bool stall);
+
+  // Update the stack for the instruction in event (if it executed)
+  void OnExec(const OtbnTraceEvent &event);
+
+  // The name of the code at addr ("sym" or "sym+0x10")
+  std::string AddrName(uint32_t addr) const;
+
+  // The name of a frame in a stack (not a kFramePc frame)
+  std::string FrameName(Frame frame) const;
+
+  const Symbols *symbols_;
+
+  Profile profile_;
+
+  // The current stack of call and loop frames, outermost first. This is empty
+  // when OTBN isn't running. The last byte address of the body of each loop
+  // frame is in loop_ends_ at the same index (the entries for call frames are
+  // unused).
+  std::vector<Frame> stack_;
+  std::vector<uint32_t> loop_ends_;
+
+  // True if the last instruction was a call, so the next PC is the entry
+  // point of a function.
+  bool pending_call_;
+
+  // Scratch space for building a key for profile_
+  std::vector<Frame> key_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_PROFILE_TRACE_LISTENER_H_
@@ -0,0 +1,192 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "trace_file_writer.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef OTBN_TRACE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// The size of a chunk of trace data and the number of full chunks that can be
+// queued for the writer thread before Write() has to wait for it.
+static const size_t kChunkBytes = 1 << 20;
+static const size_t kMaxQueuedChunks = 8;
+
+#ifdef OTBN_TRACE_HAVE_ZLIB
+struct TraceFileWriter::Compressor {
+  z_stream stream;
+  std::vector<unsigned char> out;
+
+  Compressor() : out(kChunkBytes) {
+    memset(&stream, 0, sizeof stream);
+    // Adding 16 to the window bits asks for a gzip header. Favour speed over
+    // size, since the point is to keep up with the simulation.
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      throw std::runtime_error("Failed to initialise zlib.");
+    }
+  }
+
+  ~Compressor() { deflateEnd(&stream); }
+};
+#else
+struct TraceFileWriter::Compressor {};
+#endif
+
+bool TraceFileWriter::CanCompress() {
+#ifdef OTBN_TRACE_HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+TraceFileWriter::TraceFileWriter(const std::string &path, bool compress)
+    : path_(path), file_(nullptr), done_(false) {
+  if (compress) {
+    if (!CanCompress()) {
+      throw std::runtime_error(
+          "Cannot compress trace output: this simulator was built without "
+          "zlib support (OTBN_TRACE_HAVE_ZLIB).");
+    }
+    compressor_.reset(new Compressor());
+  }
+
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) {
+    std::ostringstream oss;
+    oss << "Could not open log file: " << path << ": " << strerror(errno);
+    throw std::runtime_error(oss.str());
+  }
+
+  current_.reserve(kChunkBytes);
+  thread_ = std::thread(&TraceFileWriter::WriterMain, this);
+}
+
+TraceFileWriter::~TraceFileWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    full_.push_back(std::move(current_));
+    done_ = true;
+  }
+  cond_.notify_all();
+  thread_.join();
+
+  if (!error_.empty())
+    std::cerr << "ERROR: " << error_ << std::endl;
+  if (fclose(file_) != 0 && error_.empty())
+    std::cerr << "ERROR: Failed to close trace file `" << path_
+              << "': " << strerror(errno) << std::endl;
+}
+
+void TraceFileWriter::Write(const char *data, size_t len) {
+  current_.append(data, len);
+  if (current_.size() >= kChunkBytes)
+    Submit();
+}
+
+void TraceFileWriter::Submit() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return full_.size() < kMaxQueuedChunks; });
+  if (!error_.empty())
+    throw std::runtime_error(error_);
+
+  full_.push_back(std::move(current_));
+  if (!empty_.empty()) {
+    current_ = std::move(empty_.back());
+    empty_.pop_back();
+  } else {
+    current_ = std::string();
+    current_.reserve(kChunkBytes);
+  }
+
+  lock.unlock();
+  cond_.notify_all();
+}
+
+void TraceFileWriter::WriterMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    cond_.wait(lock, [this] { return done_ || !full_.empty(); });
+    if (full_.empty())
+      return;
+
+    std::string chunk = std::move(full_.front());
+    full_.pop_front();
+    // The destructor queues the final chunk and sets done_ together, so this
+    // is the last chunk if there's nothing left after it.
+    bool last = done_ && full_.empty();
+    bool failed = !error_.empty();
+    lock.unlock();
+
+    // Once something has gone wrong, just throw the data away. Write() will
+    // report the error.
+    std::string err;
+    bool ok = failed || WriteChunk(chunk, last, &err);
+    chunk.clear();
+
+    lock.lock();
+    if (!ok)
+      error_ = err;
+    empty_.push_back(std::move(chunk));
+    cond_.notify_all();
+
+    if (last)
+      return;
+  }
+}
+
+bool TraceFileWriter::WriteChunk(const std::string &chunk, bool finish,
+                                 std::string *err) {
+  assert(err);
+
+  if (!compressor_) {
+    if (fwrite(chunk.data(), 1, chunk.size(), file_) == chunk.size())
+      return true;
+
+    *err = "Failed to write to trace file `" + path_ + "': " + strerror(errno);
+    return false;
+  }
+
+#ifdef OTBN_TRACE_HAVE_ZLIB
+  z_stream &stream = compressor_->stream;
+  std::vector<unsigned char> &out = compressor_->out;
+
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(chunk.data()));
+  stream.avail_in = chunk.size();
+
+  // Run deflate until it stops filling the output buffer, which means that
+  // it has consumed all the input (and, if finishing, written the trailer).
+  do {
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+    if (deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+      *err = "zlib failed to compress trace for `" + path_ + "'.";
+      return false;
+    }
+
+    size_t have = out.size() - stream.avail_out;
+    if (fwrite(out.data(), 1, have, file_) != have) {
+      *err =
+          "Failed to write to trace file `" + path_ + "': " + strerror(errno);
+      return false;
+    }
+  } while (stream.avail_out == 0);
+
+  return true;
+#else
+  (void)finish;
+  assert(0);
+  return false;
+#endif
+}
@@ -0,0 +1,92 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_TRACE_FILE_WRITER_H_
+#define OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_TRACE_FILE_WRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes trace output to a file from a background thread.
+ *
+ * Data passed to Write() is collected into large chunks. Full chunks are
+ * handed to a writer thread, which writes them out (compressing them first if
+ * requested), so the simulation only waits for the disk if it gets several
+ * chunks ahead of the writer. Chunks are recycled once they have been written,
+ * so a long trace doesn't allocate on every write.
+ *
+ * Compression uses zlib and produces a gzip stream. It is only available if
+ * the code was compiled with OTBN_TRACE_HAVE_ZLIB defined (and linked against
+ * zlib).
+ */
+class TraceFileWriter {
+ public:
+  /**
+   * Open the file at path for writing. If compress is true, compress the
+   * output with gzip. Throws std::runtime_error if the file cannot be opened
+   * or compression isn't supported.
+   */
+  TraceFileWriter(const std::string &path, bool compress);
+
+  /**
+   * Flush any buffered data, wait for the writer thread to finish and close
+   * the file. Errors at this point are reported on stderr.
+   */
+  ~TraceFileWriter();
+
+  /**
+   * Append len bytes at data to the output. Throws std::runtime_error if the
+   * writer thread has failed to write earlier data.
+   */
+  void Write(const char *data, size_t len);
+
+  void Write(const std::string &str) { Write(str.data(), str.size()); }
+
+  /** True if this build supports compressed output */
+  static bool CanCompress();
+
+ private:
+  struct Compressor;
+
+  // Hand the current chunk to the writer thread, waiting if it already has
+  // too many queued.
+  void Submit();
+
+  // The body of the writer thread
+  void WriterMain();
+
+  // Write a chunk to the file (compressing it if necessary) and, if finish is
+  // true, finish the compressed stream. Returns false on failure, writing a
+  // message to *err.
+  bool WriteChunk(const std::string &chunk, bool finish, std::string *err);
+
+  std::string path_;
+  FILE *file_;
+  std::unique_ptr<Compressor> compressor_;
+
+  // The chunk that Write() is currently filling
+  std::string current_;
+
+  // Protected by mutex_: full chunks waiting for the writer thread, empty
+  // chunks that it has finished with, whether the writer should exit once
+  // the full chunks are written and the first error that it saw.
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::string> full_;
+  std::vector<std::string> empty_;
+  bool done_;
+  std::string error_;
+
+  std::thread thread_;
+};
+
+#endif  // OPENTITAN_HW_IP_OTBN_DV_TRACER_CPP_TRACE_FILE_WRITER_H_
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# Copyright lowRISC contributors (OpenTitan project).
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+'''Convert a binary OTBN trace to the text format of LogTraceListener
+
+Binary traces are written by BinaryTraceListener (see
+cpp/binary_trace_listener.h for the format), possibly compressed with gzip.
+This writes the text that LogTraceListener would have written for the same
+trace, so its output can be compared with a trace file from an older run.
+
+'''
+
+import argparse
+import gzip
+import sys
+from typing import BinaryIO, Iterator, List, TextIO, Tuple
+
+MAGIC = b'OTBNTRC\x01'
+GZIP_MAGIC = b'\x1f\x8b'
+
+
+def read_varint(data: bytes, pos: int) -> Tuple[int, int]:
+    '''Read an unsigned LEB128 varint from data at pos
+
+    Returns the value and the position after it.
+
+    '''
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError('Truncated varint at end of trace.')
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return (value, pos)
+
+
+def read_records(data: bytes) -> Iterator[Tuple[int, str]]:
+    '''Yield (cycle_count, trace) for each record in a binary trace'''
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError('Not a binary OTBN trace (bad magic or version).')
+
+    pos = len(MAGIC)
+    cycle_count = 0
+    while pos < len(data):
+        delta, pos = read_varint(data, pos)
+        length, pos = read_varint(data, pos)
+        if pos + length > len(data):
+            raise ValueError('Truncated record at end of trace.')
+        cycle_count = (cycle_count + delta) & 0xffffffff
+        yield (cycle_count, data[pos:pos + length].decode('utf-8'))
+        pos += length
+
+
+def split_trace_lines(trace: str) -> List[str]:
+    '''Split a trace into lines, like OtbnTraceListener::SplitTraceLines'''
+    lines = trace.split('\n')
+    if lines[-1] == '':
+        lines.pop()
+    return lines
+
+
+def format_record(trace: str, cycle_count: int) -> str:
+    '''Format a record like LogTraceListener::FormatRecord'''
+    out = []
+    for idx, line in enumerate(split_trace_lines(trace)):
+        if idx > 0:
+            out.append('    ' + line + '\n')
+        elif len(line) <= 1:
+            out.append(f'ERR: Bad line at {cycle_count} line should be more '
+                       f'than 1 character: {line}\n')
+        elif line[0] in 'ES':
+            out.append(f'{line[0]} {cycle_count:09}{line[1:]}\n')
+        else:
+            out.append(f'! {cycle_count:09}\n    {line}\n')
+    return ''.join(out)
+
+
+def read_trace(handle: BinaryIO) -> bytes:
+    '''Read a binary trace, decompressing it if it was compressed'''
+    data = handle.read()
+    if data[:len(GZIP_MAGIC)] == GZIP_MAGIC:
+        data = gzip.decompress(data)
+    return data
+
+
+def convert(data: bytes, out: TextIO) -> None:
+    '''Write the text version of the binary trace in data to out'''
+    for cycle_count, trace in read_records(data):
+        out.write(format_record(trace, cycle_count))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser()
+    parser.add_argument('trace', type=argparse.FileType('rb'),
+                        help='The binary trace to convert.')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'),
+                        default=sys.stdout,
+                        help='Where to write the text (default: stdout).')
+    args = parser.parse_args()
+
+    try:
+        convert(read_trace(args.trace), args.output)
+    except ValueError as err:
+        print(f'Error: {err}', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -2,20 +2,32 @@
 // Licensed under the Apache License, Version 2.0, see LICENSE for details.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <getopt.h>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <svdpi.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
 
 #include "Votbn_top_sim__Syms.h"
+#include "binary_trace_listener.h"
 #include "log_trace_listener.h"
 #include "otbn_memutil.h"
 #include "otbn_model.h"
 #include "otbn_trace_checker.h"
 #include "otbn_trace_source.h"
+#include "profile_trace_listener.h"
 #include "sv_scoped.h"
 #include "verilated_toplevel.h"
 #include "verilator_memutil.h"
@@ -33,15 +45,30 @@ extern int otbn_core_get_stop_pc();
 /**
  * SimCtrlExtension that adds a '--otbn-trace-file' command line option. If set
  * it sets up a LogTraceListener that will dump out the trace to the given log
- * file
+ * file. With '--otbn-trace-format=binary', it sets up a BinaryTraceListener
+ * instead, and '--otbn-trace-compress' compresses the file with gzip.
+ *
+ * It also adds '--otbn-profile' and '--otbn-profile-pprof' options, which set
+ * up a ProfileTraceListener and write its profile (as folded stacks or in
+ * pprof format) when the simulation finishes.
  */
 class OtbnTraceUtil : public SimCtrlExtension {
  private:
-  std::unique_ptr<LogTraceListener> log_trace_listener_;
+  std::unique_ptr<OtbnTraceListener> log_trace_listener_;
 
-  bool SetupTraceLog(const std::string &log_filename) {
+  const ProfileTraceListener::Symbols *symbols_;
+  std::unique_ptr<ProfileTraceListener> profile_listener_;
+  std::string profile_filename_, pprof_filename_;
+
+  bool SetupTraceLog(const std::string &log_filename, bool binary,
+                     bool compress) {
     try {
-      log_trace_listener_.reset(new LogTraceListener(log_filename));
+      if (binary) {
+        log_trace_listener_.reset(
+            new BinaryTraceListener(log_filename, compress));
+      } else {
+        log_trace_listener_.reset(new LogTraceListener(log_filename, compress));
+      }
       OtbnTraceSource::get().AddListener(log_trace_listener_.get());
       return true;
     } catch (const std::runtime_error &err) {
@@ -56,16 +83,52 @@ class OtbnTraceUtil : public SimCtrlExtension {
   void PrintHelp() {
     std::cout << "Trace log utilities:\n\n"
                  "--otbn-trace-file=FILE\n"
-                 "  Write OTBN trace log to FILE\n\n";
+                 "  Write OTBN trace log to FILE\n\n"
+                 "--otbn-trace-format=text|binary\n"
+                 "  Format of the trace log (default: text). Convert a binary\n"
+                 "  log to text with\n"
+                 "  hw/ip/otbn/dv/tracer/otbn_trace_to_text.py\n\n"
+                 "--otbn-trace-compress\n"
+                 "  Compress the trace log with gzip\n\n"
+                 "--otbn-profile=FILE\n"
+                 "  Write a profile of the RTL cycles spent in each function\n"
+                 "  and loop to FILE, as folded stacks for flamegraph.pl\n\n"
+                 "--otbn-profile-pprof=FILE\n"
+                 "  Write the same profile to FILE in pprof format\n\n";
+  }
+
+  // Write out any profiles that were requested
+  void WriteProfiles() {
+    try {
+      if (!profile_filename_.empty())
+        profile_listener_->WriteFolded(profile_filename_);
+      if (!pprof_filename_.empty())
+        profile_listener_->WritePprof(pprof_filename_);
+    } catch (const std::runtime_error &err) {
+      std::cerr << "ERROR: Failed to write profile: " << err.what()
+                << std::endl;
+    }
   }
 
  public:
+  // symbols gives the names of addresses in IMEM for profiles
+  explicit OtbnTraceUtil(const ProfileTraceListener::Symbols *symbols)
+      : symbols_(symbols) {}
+
   virtual bool ParseCLIArguments(int argc, char **argv, bool &exit_app) {
     const struct option long_options[] = {
         {"otbn-trace-file", required_argument, nullptr, 'l'},
+        {"otbn-trace-format", required_argument, nullptr, 'f'},
+        {"otbn-trace-compress", no_argument, nullptr, 'z'},
+        {"otbn-profile", required_argument, nullptr, 'p'},
+        {"otbn-profile-pprof", required_argument, nullptr, 'P'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, no_argument, nullptr, 0}};
 
+    std::string log_filename;
+    bool binary = false;
+    bool compress = false;
+
     // Reset the command parsing index in-case other utils have already parsed
     // some arguments
     optind = 1;
@@ -80,28 +143,395 @@ class OtbnTraceUtil : public SimCtrlExtension {
         case 1:
           break;
         case 'l':
-          return SetupTraceLog(optarg);
+          log_filename = optarg;
+          break;
+        case 'f':
+          if (!strcmp(optarg, "binary")) {
+            binary = true;
+          } else if (strcmp(optarg, "text")) {
+            std::cerr << "ERROR: Unknown OTBN trace format: `" << optarg
+                      << "'. Expected text or binary." << std::endl;
+            return false;
+          }
+          break;
+        case 'z':
+          compress = true;
+          break;
+        case 'p':
+          profile_filename_ = optarg;
+          break;
+        case 'P':
+          pprof_filename_ = optarg;
+          break;
         case 'h':
           PrintHelp();
           break;
       }
     }
 
-    return true;
+    if (!(profile_filename_.empty() && pprof_filename_.empty())) {
+      profile_listener_.reset(new ProfileTraceListener(symbols_));
+      OtbnTraceSource::get().AddListener(profile_listener_.get());
+    }
+
+    if (log_filename.empty())
+      return true;
+
+    return SetupTraceLog(log_filename, binary, compress);
   }
 
   ~OtbnTraceUtil() {
     if (log_trace_listener_)
       OtbnTraceSource::get().RemoveListener(log_trace_listener_.get());
+    if (profile_listener_) {
+      OtbnTraceSource::get().RemoveListener(profile_listener_.get());
+      WriteProfiles();
+    }
+  }
+};
+
+/**
+ * SimCtrlExtension that starts and stops wave tracing when OTBN gets to
+ * interesting points in its program. This is much cheaper than tracing a
+ * whole run and combines with '--trace-pre-trigger' (see VerilatorSimCtrl)
+ * to also keep the cycles just before the trigger.
+ *
+ * '--otbn-trace-start-at' and '--otbn-trace-stop-at' take an IMEM address or
+ * a code symbol from the ELF file and trigger when an instruction at that
+ * address executes. '--otbn-trace-function' traces from the entry of a
+ * function until it returns (following calls that it makes itself).
+ * '--otbn-trace-on-mismatch' starts tracing on the first cycle that
+ * otbn_top_sim flags an error, such as a mismatch between the RTL and the
+ * model.
+ */
+class OtbnWaveTrigger : public SimCtrlExtension, public OtbnTraceListener {
+ private:
+  // A trigger point, as given on the command line, and its address once that
+  // has been resolved.
+  struct Point {
+    std::string spec;
+    bool valid;
+    uint32_t addr;
+  };
+
+  const OtbnMemUtil *memutil_;
+  Point start_at_, stop_at_, function_;
+  bool on_mismatch_;
+
+  // The depth of calls made from function_ while we are tracing it, or -1 if
+  // we aren't in it.
+  int function_depth_;
+
+  bool listening_;
+
+  void PrintHelp() {
+    std::cout << "Wave trace triggers:\n\n"
+                 "--otbn-trace-start-at=ADDR|SYMBOL\n"
+                 "  Start the wave trace when OTBN executes the instruction\n"
+                 "  at ADDR (or the code symbol SYMBOL)\n\n"
+                 "--otbn-trace-stop-at=ADDR|SYMBOL\n"
+                 "  Stop the wave trace when OTBN executes the instruction\n"
+                 "  at ADDR (or the code symbol SYMBOL)\n\n"
+                 "--otbn-trace-function=SYMBOL\n"
+                 "  Write the wave trace from each call to the function at\n"
+                 "  SYMBOL until it returns\n\n"
+                 "--otbn-trace-on-mismatch\n"
+                 "  Start the wave trace when the RTL first disagrees with\n"
+                 "  the model\n\n";
+  }
+
+  // Resolve the address of point (a number or a symbol in the ELF file).
+  // Returns false if it isn't either.
+  bool Resolve(Point *point) {
+    if (point->spec.empty())
+      return true;
+
+    const char *spec = point->spec.c_str();
+    char *end;
+    unsigned long addr = strtoul(spec, &end, 0);
+    if (isdigit(spec[0]) && *end == '\0' && addr <= UINT32_MAX) {
+      point->addr = addr;
+    } else if (!memutil_->GetImemSymbolAddr(point->spec, &point->addr)) {
+      std::cerr << "ERROR: `" << point->spec
+                << "' is neither an address nor a code symbol in the ELF "
+                   "file."
+                << std::endl;
+      return false;
+    }
+
+    point->valid = true;
+    return true;
+  }
+
+  static std::string Reason(const char *what, const Point &point) {
+    std::ostringstream oss;
+    oss << what << " " << point.spec;
+    if (point.spec.compare(0, 2, "0x"))
+      oss << " at 0x" << std::hex << point.addr;
+    return oss.str();
+  }
+
+ public:
+  explicit OtbnWaveTrigger(const OtbnMemUtil *memutil)
+      : memutil_(memutil),
+        start_at_{"", false, 0},
+        stop_at_{"", false, 0},
+        function_{"", false, 0},
+        on_mismatch_(false),
+        function_depth_(-1),
+        listening_(false) {}
+
+  virtual bool ParseCLIArguments(int argc, char **argv, bool &exit_app) {
+    const struct option long_options[] = {
+        {"otbn-trace-start-at", required_argument, nullptr, 's'},
+        {"otbn-trace-stop-at", required_argument, nullptr, 'e'},
+        {"otbn-trace-function", required_argument, nullptr, 'F'},
+        {"otbn-trace-on-mismatch", no_argument, nullptr, 'm'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, no_argument, nullptr, 0}};
+
+    // Reset the command parsing index in-case other utils have already parsed
+    // some arguments
+    optind = 1;
+    while (1) {
+      int c = getopt_long(argc, argv, "-h", long_options, nullptr);
+      if (c == -1) {
+        break;
+      }
+
+      switch (c) {
+        case 0:
+        case 1:
+          break;
+        case 's':
+          start_at_.spec = optarg;
+          break;
+        case 'e':
+          stop_at_.spec = optarg;
+          break;
+        case 'F':
+          function_.spec = optarg;
+          break;
+        case 'm':
+          on_mismatch_ = true;
+          break;
+        case 'h':
+          PrintHelp();
+          break;
+      }
+    }
+
+    return true;
+  }
+
+  // The ELF file is loaded by the time that we get here, so this is where we
+  // look up symbols.
+  virtual void PreExec() {
+    if (!(Resolve(&start_at_) && Resolve(&stop_at_) && Resolve(&function_))) {
+      VerilatorSimCtrl::GetInstance().RequestStop(false);
+      return;
+    }
+
+    if (start_at_.valid || stop_at_.valid || function_.valid) {
+      OtbnTraceSource::get().AddListener(this);
+      listening_ = true;
+    }
+  }
+
+  virtual void OnClock(unsigned long sim_time) {
+    if (!on_mismatch_)
+      return;
+
+    svBit err;
+    {
+      SVScoped top_scope("TOP.otbn_top_sim");
+      err = otbn_err_get();
+    }
+    if (err) {
+      VerilatorSimCtrl::GetInstance().TriggerTraceStart("OTBN mismatch");
+      on_mismatch_ = false;
+    }
+  }
+
+  unsigned EventKinds() const override { return OtbnTraceEvent::kExec; }
+
+  void AcceptTraceEvent(const OtbnTraceEvent &event) override {
+    VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+    uint32_t pc = event.pc();
+
+    if (start_at_.valid && pc == start_at_.addr)
+      simctrl.TriggerTraceStart(Reason("OTBN executed", start_at_));
+
+    if (function_.valid) {
+      if (function_depth_ < 0 && pc == function_.addr) {
+        simctrl.TriggerTraceStart(Reason("OTBN entered", function_));
+        function_depth_ = 0;
+      }
+      if (function_depth_ >= 0) {
+        if (event.IsCall()) {
+          ++function_depth_;
+        } else if (event.IsReturn() && function_depth_-- == 0) {
+          simctrl.TriggerTraceStop(Reason("OTBN returned from", function_));
+        }
+      }
+    }
+
+    if (stop_at_.valid && pc == stop_at_.addr)
+      simctrl.TriggerTraceStop(Reason("OTBN executed", stop_at_));
+  }
+
+  ~OtbnWaveTrigger() {
+    if (listening_)
+      OtbnTraceSource::get().RemoveListener(this);
   }
 };
 
 static otbn_top_sim *verilator_top;
 static OtbnMemUtil otbn_memutil("TOP.otbn_top_sim");
 
+// The iteration counts of the loops that the RTL is running, tracked by
+// OtbnTopApplyLoopWarp.
+static std::vector<uint32_t> loop_count_stack;
+
+// The handle of the model in otbn_core_model
+static OtbnModel *GetModelHandle() {
+  // See OtbnTopInstallLoopWarps for why this upcast is needed.
+  Votbn_top_sim &top = *verilator_top;
+  return (OtbnModel *)top.otbn_top_sim->u_otbn_core_model->model_handle;
+}
+
+static void SetModelHandle(OtbnModel *model) {
+  Votbn_top_sim &top = *verilator_top;
+  auto &handle = top.otbn_top_sim->u_otbn_core_model->model_handle;
+  handle = (typename std::remove_reference<decltype(handle)>::type)(
+      uintptr_t)model;
+}
+
+/**
+ * SimCtrlExtension that saves and restores the parts of the OTBN simulation
+ * that aren't in the Verilated model when VerilatorSimCtrl saves or restores
+ * a checkpoint.
+ *
+ * These are the state of the ISS (which needs the Python ISS: see
+ * ISSWrapper::save_state) and the loop stack tracked by OtbnTopApplyLoopWarp.
+ * The model handle in otbn_core_model is a pointer, so restoring a checkpoint
+ * leaves it pointing at the model of the simulation that saved it: we put
+ * back the handle of our own model.
+ *
+ * Checkpoints should be saved between instructions. When restoring one, pass
+ * the same --load-elf argument as the simulation that saved it to get its
+ * symbols and loop warps.
+ */
+class OtbnCheckpointUtil : public SimCtrlExtension {
+ private:
+  OtbnModel *model_;
+
+  // A file for passing the ISS state to and from the ISS. This is deleted
+  // when we are done with it.
+  static std::string TempPath() {
+    const char *tmpdir = getenv("TMPDIR");
+    std::string path = std::string(tmpdir ? tmpdir : "/tmp") +
+                       "/otbn-checkpoint-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0)
+      return "";
+    close(fd);
+    return path;
+  }
+
+  static void AppendU32(std::string *dst, uint32_t value) {
+    dst->append((const char *)&value, sizeof value);
+  }
+
+  static bool ReadU32(const std::string &src, size_t *pos, uint32_t *value) {
+    if (src.size() - *pos < sizeof *value)
+      return false;
+    memcpy(value, &src[*pos], sizeof *value);
+    *pos += sizeof *value;
+    return true;
+  }
+
+ public:
+  OtbnCheckpointUtil() : model_(nullptr) {}
+
+  // The state is the loop stack (its size, then the entries), then a word
+  // that is 1 if the ISS state follows or 0 if the ISS hadn't started.
+  bool SaveCheckpoint(std::string &state) override {
+    state.clear();
+    AppendU32(&state, loop_count_stack.size());
+    for (uint32_t count : loop_count_stack) {
+      AppendU32(&state, count);
+    }
+
+    std::string path = TempPath();
+    if (path.empty()) {
+      std::cerr << "ERROR: Failed to create a file for the ISS state."
+                << std::endl;
+      return false;
+    }
+
+    OtbnModel *model = GetModelHandle();
+    assert(model);
+    int ret = model->save_checkpoint(path);
+    AppendU32(&state, ret > 0);
+    if (ret > 0) {
+      std::ifstream is(path, std::ios::binary);
+      state.append(std::istreambuf_iterator<char>(is),
+                   std::istreambuf_iterator<char>());
+      if (!is) {
+        ret = -1;
+      }
+    }
+    remove(path.c_str());
+    return ret >= 0;
+  }
+
+  void PreRestoreCheckpoint() override { model_ = GetModelHandle(); }
+
+  bool RestoreCheckpoint(const std::string &state) override {
+    assert(model_);
+    SetModelHandle(model_);
+
+    size_t pos = 0;
+    uint32_t depth, has_iss;
+    if (!ReadU32(state, &pos, &depth))
+      return false;
+    loop_count_stack.clear();
+    for (uint32_t i = 0; i < depth; ++i) {
+      uint32_t count;
+      if (!ReadU32(state, &pos, &count))
+        return false;
+      loop_count_stack.push_back(count);
+    }
+    if (!ReadU32(state, &pos, &has_iss))
+      return false;
+    if (!has_iss)
+      return true;
+
+    std::string path = TempPath();
+    if (path.empty()) {
+      std::cerr << "ERROR: Failed to create a file for the ISS state."
+                << std::endl;
+      return false;
+    }
+
+    bool ok;
+    {
+      std::ofstream os(path, std::ios::binary);
+      os.write(&state[pos], state.size() - pos);
+      ok = (bool)os;
+    }
+    ok = ok && model_->restore_checkpoint(path) == 0;
+    remove(path.c_str());
+    return ok;
+  }
+};
+
 int main(int argc, char **argv) {
   VerilatorMemUtil memutil(&otbn_memutil);
-  OtbnTraceUtil traceutil;
+  OtbnTraceUtil traceutil(&otbn_memutil.GetImemSymbols());
+  OtbnWaveTrigger wave_trigger(&otbn_memutil);
+  OtbnCheckpointUtil checkpointutil;
 
   otbn_top_sim top;
   // Make the otbn_top_sim object visible to OtbnTopApplyLoopWarp.
@@ -115,6 +545,8 @@ int main(int argc, char **argv) {
                  VerilatorSimCtrlFlags::ResetPolarityNegative);
   simctrl.RegisterExtension(&memutil);
   simctrl.RegisterExtension(&traceutil);
+  simctrl.RegisterExtension(&wave_trigger);
+  simctrl.RegisterExtension(&checkpointutil);
 
   std::cout << "Simulation of OTBN" << std::endl
             << "==================" << std::endl
@@ -231,8 +663,6 @@ auto get_loop_counter(LoopControllerT *loop_controller, uint32_t counter_idx)
 // updating the top of the loop stack if necessary to match loop warp symbols
 // in the ELF file.
 extern "C" void OtbnTopApplyLoopWarp() {
-  static std::vector<uint32_t> loop_count_stack;
-
   // See not in OtbnTopInstallLoopWarps for why this upcast is needed.
   Votbn_top_sim &top = *verilator_top;
 
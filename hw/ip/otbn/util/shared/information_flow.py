@@ -303,6 +303,10 @@ class InformationFlowGraph:
                 flag_groups.add('FG0')
             elif sink.startswith('fg1'):
                 flag_groups.add('FG1')
+            elif sink.startswith('vfg0'):
+                flag_groups.add('VFG0')
+            elif sink.startswith('vfg1'):
+                flag_groups.add('VFG1')
             else:
                 special.append(sink)
 
@@ -455,6 +459,27 @@ class InsnGroupFlagNode(InsnInformationFlowNode):
         return 'fg{}-{}'.format(op_vals['flag_group'], self.flag)
 
 
+class InsnVecGroupFlagNode(InsnInformationFlowNode):
+    '''Represents a vector flag node whose group depends on the
+    vec_flag_group operand.'''
+    def __init__(self, flag: str):
+        flag = flag.lower()
+        if flag not in FLAG_NAMES:
+            raise ValueError(
+                'Invalid flag name: "{}". Valid names are: {}'.format(
+                    flag, FLAG_NAMES))
+        self.flag = flag
+        self.constant_dependent = False
+
+    def evaluate(self, op_vals: Dict[str, int],
+                 constant_regs: Dict[str, int]) -> str:
+        if 'vec_flag_group' not in op_vals:
+            raise ValueError(
+                'Operand vec_flag_group not found in provided operand '
+                'values: {}'.format(op_vals.keys()))
+        return 'vfg{}-{}'.format(op_vals['vec_flag_group'], self.flag)
+
+
 class InsnConstantNode(InsnInformationFlowNode):
     '''Represents instruction node whose value does not depend on operands.'''
     def __init__(self, node: str):
@@ -481,6 +506,10 @@ def _parse_iflow_nodes(
       be either "fg0", "fg1", or (if the instruction has a flag_group
       operand) simply "flags" to select the current flag group, and <flag>
       can be l, c, m, z, or "all".
+    - a vector flag (represented as "<vector flag group>-<flag>", where
+      <vector flag group> can be either "vfg0", "vfg1", or (if the
+      instruction has a vec_flag_group operand) simply "vflags", and <flag>
+      is as above). Each of these nodes stands for that flag in every lane.
 
     Raises a ValueError if the node does not have a valid format.
     '''
@@ -530,7 +559,11 @@ def _parse_iflow_nodes(
         if flag == 'all':
             return [InsnGroupFlagNode(flag) for flag in FLAG_NAMES]
         return [InsnGroupFlagNode(flag)]
-    elif flag_group_str == 'fg0' or flag_group_str == 'fg1':
+    elif flag_group_str == 'vflags':
+        if flag == 'all':
+            return [InsnVecGroupFlagNode(flag) for flag in FLAG_NAMES]
+        return [InsnVecGroupFlagNode(flag)]
+    elif flag_group_str in ['fg0', 'fg1', 'vfg0', 'vfg1']:
         if flag == 'all':
             return [
                 InsnConstantNode('{}-{}'.format(flag_group_str, flag))
@@ -10,22 +10,26 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 
-#include "prince_ref.h"
+#include "prince_batch.h"
 #include "svdpi.h"
 
 extern uint64_t c_dpi_prince_encrypt(uint64_t plaintext, uint64_t key0,
                                      uint64_t key1, int num_half_rounds,
                                      int old_key_schedule) {
-  return prince_enc_dec_uint64(plaintext, key0, key1, 0, num_half_rounds,
-                               old_key_schedule);
+  uint64_t ciphertext;
+  prince_enc_dec_uint64_batch(&plaintext, &ciphertext, 1, key0, key1, 0,
+                              num_half_rounds, old_key_schedule);
+  return ciphertext;
 }
 
 extern uint64_t c_dpi_prince_decrypt(const uint64_t ciphertext,
                                      const uint64_t key0, const uint64_t key1,
                                      int num_half_rounds,
                                      int old_key_schedule) {
-  return prince_enc_dec_uint64(ciphertext, key0, key1, 1, num_half_rounds,
-                               old_key_schedule);
+  uint64_t plaintext;
+  prince_enc_dec_uint64_batch(&ciphertext, &plaintext, 1, key0, key1, 1,
+                              num_half_rounds, old_key_schedule);
+  return plaintext;
 }
 
 #ifdef _cplusplus
@@ -0,0 +1,192 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_IP_PRIM_DV_PRIM_PRINCE_CRYPTO_DPI_PRINCE_PRINCE_BATCH_H_
+#define OPENTITAN_HW_IP_PRIM_DV_PRIM_PRINCE_CRYPTO_DPI_PRINCE_PRINCE_BATCH_H_
+
+/*! \file prince_batch.h
+    \brief A faster implementation of the Prince block cipher for DV models,
+   which encrypts or decrypts a batch of blocks under one key. It computes
+   exactly the same function as prince_enc_dec_uint64() in prince_ref.h.
+*/
+
+/*
+ * The reference implementation works a nibble or a bit at a time: the S step
+ * looks up each of the 16 nibbles of the state in turn and the M' step loops
+ * over each of the 64 bits. Here, every step works on the whole 64-bit state
+ * at once with shifts, masks and logic operations:
+ *
+ *    - The S and S^-1 steps split the state into four words holding bit 0, 1,
+ *      2 and 3 of each nibble, compute each output bit from its algebraic
+ *      normal form and combine the results.
+ *    - Every output bit of the M' step is the XOR of the same bit of three of
+ *      the four nibbles in its 16 bit chunk, so the M' step is the XOR of the
+ *      state with its nibbles rotated by 0, 1, 2 and 3 places within each
+ *      chunk, each ANDed with a constant mask.
+ *    - The shift rows step rotates each row by a multiple of 16 bits.
+ *
+ * None of these steps branch or look anything up, so the loops over the
+ * blocks of a batch (which apply each round to every block in turn, with the
+ * round key computed once) can be vectorized by the compiler. The key
+ * schedule is also computed once per batch.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "prince_ref.h"
+
+// Bit 0 of every nibble
+#define PRINCE_BATCH_NIBBLE_LSBS 0x1111111111111111ULL
+
+/**
+ * The S step of the Prince cipher, working on all nibbles at once.
+ */
+static inline uint64_t prince_batch_s_layer(const uint64_t in) {
+  const uint64_t ones = PRINCE_BATCH_NIBBLE_LSBS;
+  const uint64_t x0 = in & ones, x1 = (in >> 1) & ones;
+  const uint64_t x2 = (in >> 2) & ones, x3 = (in >> 3) & ones;
+  const uint64_t x01 = x0 & x1, x02 = x0 & x2, x03 = x0 & x3;
+  const uint64_t x12 = x1 & x2, x13 = x1 & x3, x23 = x2 & x3;
+  const uint64_t x012 = x01 & x2, x013 = x01 & x3, x023 = x02 & x3;
+  const uint64_t x123 = x12 & x3;
+
+  const uint64_t y0 = ones ^ x01 ^ x2 ^ x12 ^ x012 ^ x3 ^ x03 ^ x23;
+  const uint64_t y1 = ones ^ x02 ^ x12 ^ x012 ^ x13 ^ x123;
+  const uint64_t y2 = x0 ^ x01 ^ x3 ^ x03 ^ x13 ^ x013 ^ x123;
+  const uint64_t y3 = ones ^ x1 ^ x12 ^ x012 ^ x3 ^ x013 ^ x23 ^ x023;
+  return y0 | (y1 << 1) | (y2 << 2) | (y3 << 3);
+}
+
+/**
+ * The S^-1 step of the Prince cipher, working on all nibbles at once.
+ */
+static inline uint64_t prince_batch_s_inv_layer(const uint64_t in) {
+  const uint64_t ones = PRINCE_BATCH_NIBBLE_LSBS;
+  const uint64_t x0 = in & ones, x1 = (in >> 1) & ones;
+  const uint64_t x2 = (in >> 2) & ones, x3 = (in >> 3) & ones;
+  const uint64_t x01 = x0 & x1, x02 = x0 & x2;
+  const uint64_t x12 = x1 & x2, x13 = x1 & x3, x23 = x2 & x3;
+  const uint64_t x012 = x01 & x2, x013 = x01 & x3, x023 = x02 & x3;
+  const uint64_t x123 = x12 & x3;
+
+  const uint64_t y0 = ones ^ x01 ^ x12 ^ x3 ^ x013 ^ x23 ^ x023;
+  const uint64_t y1 = ones ^ x02 ^ x12 ^ x012 ^ x13 ^ x23;
+  const uint64_t y2 = x0 ^ x01 ^ x2 ^ x02 ^ x12 ^ x012 ^ x13 ^ x013;
+  const uint64_t y3 =
+      ones ^ x0 ^ x1 ^ x01 ^ x02 ^ x12 ^ x012 ^ x23 ^ x023 ^ x123;
+  return y0 | (y1 << 1) | (y2 << 2) | (y3 << 3);
+}
+
+/**
+ * The M' step of the Prince cipher.
+ *
+ * The masks select the bits of the state rotated left by 0, 4, 8 and 12 bits
+ * within each 16 bit chunk that contribute to each output bit. They are split
+ * into the bits that come from a left shift and those that come from the
+ * matching right shift.
+ */
+static inline uint64_t prince_batch_m_prime_layer(const uint64_t in) {
+  return (in & 0x7d7dbebebebe7d7dULL) ^
+         ((in << 4) & 0xbeb0d7d0d7d0beb0ULL) ^
+         ((in >> 12) & 0x000e00070007000eULL) ^
+         ((in << 8) & 0xd700eb00eb00d700ULL) ^
+         ((in >> 8) & 0x00d700eb00eb00d7ULL) ^
+         ((in << 12) & 0xe00070007000e000ULL) ^
+         ((in >> 4) & 0x0beb0d7d0d7d0bebULL);
+}
+
+/**
+ * Rotate a 64-bit word left by shift bits, where 0 < shift < 64.
+ */
+static inline uint64_t prince_batch_rotl(const uint64_t in, unsigned shift) {
+  return (in << shift) | (in >> (64 - shift));
+}
+
+/**
+ * The shift rows step of the Prince cipher. Row i (the nibbles at positions
+ * 3 - i, 7 - i, 11 - i and 15 - i) is rotated left by 16 * i bits.
+ */
+static inline uint64_t prince_batch_shift_rows(const uint64_t in) {
+  return (in & 0xf000f000f000f000ULL) |
+         prince_batch_rotl(in & 0x0f000f000f000f00ULL, 16) |
+         prince_batch_rotl(in & 0x00f000f000f000f0ULL, 32) |
+         prince_batch_rotl(in & 0x000f000f000f000fULL, 48);
+}
+
+/**
+ * The inverse shift rows step of the Prince cipher.
+ */
+static inline uint64_t prince_batch_shift_rows_inv(const uint64_t in) {
+  return (in & 0xf000f000f000f000ULL) |
+         prince_batch_rotl(in & 0x0f000f000f000f00ULL, 48) |
+         prince_batch_rotl(in & 0x00f000f000f000f0ULL, 32) |
+         prince_batch_rotl(in & 0x000f000f000f000fULL, 16);
+}
+
+/**
+ * Prince encryption/decryption of num_blocks blocks from input to output
+ * (which may be the same array), all under the same key.
+ *
+ * The arguments are the same as for prince_enc_dec_uint64(), which gives
+ * exactly the same result for each block.
+ */
+static inline void prince_enc_dec_uint64_batch(
+    const uint64_t *input, uint64_t *output, size_t num_blocks,
+    const uint64_t enc_k0, const uint64_t enc_k1, int decrypt,
+    int num_half_rounds, int old_key_schedule) {
+  const uint64_t prince_alpha = 0xc0ac29b7c97c50dd;
+  const uint64_t k1 = enc_k1 ^ (decrypt ? prince_alpha : 0);
+  const uint64_t k0_new =
+      (old_key_schedule) ? k1 : enc_k0 ^ (decrypt ? prince_alpha : 0);
+  const uint64_t enc_k0_prime = prince_k0_to_k0_prime(enc_k0);
+  const uint64_t k0 = decrypt ? enc_k0_prime : enc_k0;
+  const uint64_t k0_prime = decrypt ? enc_k0 : enc_k0_prime;
+  size_t i;
+  int round;
+
+  // Whitening and the first key addition of the core
+  const uint64_t first_key = k0 ^ k1 ^ prince_round_constant(0);
+  for (i = 0; i < num_blocks; i++)
+    output[i] = input[i] ^ first_key;
+
+  // Forward rounds
+  for (round = 1; round <= num_half_rounds; round++) {
+    const uint64_t round_key =
+        ((round % 2 == 1) ? k0_new : k1) ^ prince_round_constant(round);
+    for (i = 0; i < num_blocks; i++) {
+      const uint64_t s_out = prince_batch_s_layer(output[i]);
+      const uint64_t m_out =
+          prince_batch_shift_rows(prince_batch_m_prime_layer(s_out));
+      output[i] = m_out ^ round_key;
+    }
+  }
+
+  // Middle round
+  for (i = 0; i < num_blocks; i++) {
+    const uint64_t s_out = prince_batch_s_layer(output[i]);
+    const uint64_t m_prime_out = prince_batch_m_prime_layer(s_out);
+    output[i] = prince_batch_s_inv_layer(m_prime_out);
+  }
+
+  // Backward rounds
+  for (round = 1; round <= num_half_rounds; round++) {
+    const uint64_t constant_idx = 10 - num_half_rounds + round;
+    const uint64_t round_key =
+        (((num_half_rounds + round + 1) % 2 == 1) ? k0_new : k1) ^
+        prince_round_constant(constant_idx);
+    for (i = 0; i < num_blocks; i++) {
+      const uint64_t s_inv_in = prince_batch_m_prime_layer(
+          prince_batch_shift_rows_inv(output[i] ^ round_key));
+      output[i] = prince_batch_s_inv_layer(s_inv_in);
+    }
+  }
+
+  // The last key addition of the core and whitening
+  const uint64_t last_key = k1 ^ prince_round_constant(11) ^ k0_prime;
+  for (i = 0; i < num_blocks; i++)
+    output[i] ^= last_key;
+}
+
+#endif  // OPENTITAN_HW_IP_PRIM_DV_PRIM_PRINCE_CRYPTO_DPI_PRINCE_PRINCE_BATCH_H_
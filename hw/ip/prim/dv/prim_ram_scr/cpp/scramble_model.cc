@@ -11,7 +11,7 @@
 #include <stdint.h>
 #include <vector>
 
-#include "prince_ref.h"
+#include "prince_batch.h"
 
 uint8_t PRESENT_SBOX4[] = {0xc, 0x5, 0x6, 0xb, 0x9, 0x0, 0xa, 0xd,
                            0x3, 0xe, 0xf, 0x8, 0x4, 0x7, 0x1, 0x2};
@@ -23,15 +23,6 @@ static const uint32_t kNumAddrSubstPermRounds = 2;
 static const uint32_t kNumDataSubstPermRounds = 2;
 static const uint32_t kNumPrinceHalfRounds = 3;
 
-static std::vector<uint8_t> byte_reverse_vector(
-    const std::vector<uint8_t> &vec_in) {
-  std::vector<uint8_t> vec_out(vec_in.size());
-
-  std::reverse_copy(std::begin(vec_in), std::end(vec_in), std::begin(vec_out));
-
-  return vec_out;
-}
-
 static uint8_t read_vector_bit(const std::vector<uint8_t> &vec,
                                uint32_t bit_pos) {
   assert(bit_pos / 8 < vec.size());
@@ -131,6 +122,229 @@ static std::vector<uint8_t> scramble_perm_layer(const std::vector<uint8_t> &in,
   return out;
 }
 
+// Word-level versions of the layers above. These work on up to 64 bits in a
+// uint64_t or (where the compiler supports it) up to 128 bits in an unsigned
+// __int128, with bit i of the byte vector in bit i of the word, and use lookup
+// tables to handle a byte or nibble at a time rather than a bit at a time.
+// Every input must be zero above bit_width.
+
+// Lookup tables for the word-level layers
+struct ScrambleTables {
+  // PRESENT_SBOX4 and PRESENT_SBOX4_INV applied to both nibbles of a byte
+  uint8_t sbox[256];
+  uint8_t sbox_inv[256];
+  // A byte with its bits reversed
+  uint8_t reverse[256];
+  // The even and odd bits of a byte, packed into a nibble
+  uint8_t even[256];
+  uint8_t odd[256];
+  // A nibble with its bits spread onto the even bits of a byte
+  uint8_t spread[16];
+
+  ScrambleTables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      sbox[i] = PRESENT_SBOX4[i & 0xf] | (PRESENT_SBOX4[i >> 4] << 4);
+      sbox_inv[i] =
+          PRESENT_SBOX4_INV[i & 0xf] | (PRESENT_SBOX4_INV[i >> 4] << 4);
+      reverse[i] = even[i] = odd[i] = 0;
+      for (uint32_t j = 0; j < 8; ++j) {
+        uint8_t bit = (i >> j) & 1;
+        reverse[i] |= bit << (7 - j);
+        if (j % 2) {
+          odd[i] |= bit << (j / 2);
+        } else {
+          even[i] |= bit << (j / 2);
+        }
+      }
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+      spread[i] = 0;
+      for (uint32_t j = 0; j < 4; ++j) {
+        spread[i] |= ((i >> j) & 1) << (j * 2);
+      }
+    }
+  }
+};
+
+static const ScrambleTables scramble_tables;
+
+// A word with the bottom `width` bits set
+template <typename Word>
+static inline Word low_mask(uint32_t width) {
+  return width >= 8 * sizeof(Word) ? ~(Word)0 : ((Word)1 << width) - 1;
+}
+
+// Read `width` bits (at most the width of Word) from `vec`, starting at bit
+// `bit_pos`
+template <typename Word>
+static Word read_vector_word(const std::vector<uint8_t> &vec, uint32_t bit_pos,
+                             uint32_t width) {
+  assert(width && width <= 8 * sizeof(Word));
+  assert((bit_pos + width - 1) / 8 < vec.size());
+
+  uint32_t first_byte = bit_pos / 8;
+  uint32_t shift = bit_pos % 8;
+  uint32_t num_bytes = (shift + width + 7) / 8;
+
+  Word out = vec[first_byte] >> shift;
+  for (uint32_t i = 1; i < num_bytes; ++i) {
+    out |= (Word)vec[first_byte + i] << (8 * i - shift);
+  }
+
+  return out & low_mask<Word>(width);
+}
+
+// OR the bottom `width` bits of `word` into `vec`, starting at bit `bit_pos`
+template <typename Word>
+static void or_vector_word(std::vector<uint8_t> &vec, uint32_t bit_pos,
+                           uint32_t width, Word word) {
+  assert(width && width <= 8 * sizeof(Word));
+  assert((bit_pos + width - 1) / 8 < vec.size());
+
+  uint32_t first_byte = bit_pos / 8;
+  uint32_t shift = bit_pos % 8;
+  uint32_t num_bytes = (shift + width + 7) / 8;
+
+  word &= low_mask<Word>(width);
+  vec[first_byte] |= (uint8_t)(word << shift);
+  for (uint32_t i = 1; i < num_bytes; ++i) {
+    vec[first_byte + i] |= (uint8_t)(word >> (8 * i - shift));
+  }
+}
+
+template <typename Word>
+static Word word_sbox_layer(Word in, uint32_t bit_width, bool invert) {
+  const uint8_t *sbox8 =
+      invert ? scramble_tables.sbox_inv : scramble_tables.sbox;
+  const uint8_t *sbox4 = invert ? PRESENT_SBOX4_INV : PRESENT_SBOX4;
+
+  Word out = 0;
+  uint32_t done = 0;
+  for (; done + 8 <= bit_width; done += 8) {
+    out |= (Word)sbox8[(uint8_t)(in >> done)] << done;
+  }
+  if (done + 4 <= bit_width) {
+    out |= (Word)sbox4[(uint8_t)(in >> done) & 0xf] << done;
+    done += 4;
+  }
+
+  // Where bit_width is not a multiple of 4 copy over the remaining bits
+  return out | (in & ~low_mask<Word>(done));
+}
+
+template <typename Word>
+static Word word_flip_layer(Word in, uint32_t bit_width) {
+  uint32_t num_bytes = (bit_width + 7) / 8;
+
+  Word out = 0;
+  for (uint32_t i = 0; i < num_bytes; ++i) {
+    out = (out << 8) | scramble_tables.reverse[(uint8_t)(in >> (8 * i))];
+  }
+
+  return out >> (8 * num_bytes - bit_width);
+}
+
+template <typename Word>
+static Word word_perm_layer(Word in, uint32_t bit_width, bool invert) {
+  uint32_t half_width = bit_width / 2;
+  Word half_mask = low_mask<Word>(half_width);
+
+  // Where bit_width isn't even, the final bit is copied across to the same
+  // position
+  Word out = in & ~low_mask<Word>(half_width * 2);
+
+  if (invert) {
+    Word lo = in & half_mask;
+    Word hi = (in >> half_width) & half_mask;
+    for (uint32_t i = 0; i * 4 < half_width; ++i) {
+      uint8_t lo_bits = scramble_tables.spread[(uint8_t)(lo >> (4 * i)) & 0xf];
+      uint8_t hi_bits = scramble_tables.spread[(uint8_t)(hi >> (4 * i)) & 0xf];
+      out |= (Word)(lo_bits | (hi_bits << 1)) << (8 * i);
+    }
+  } else {
+    Word pairs = in & low_mask<Word>(half_width * 2);
+    Word evens = 0, odds = 0;
+    for (uint32_t i = 0; i * 8 < half_width * 2; ++i) {
+      uint8_t byte = (uint8_t)(pairs >> (8 * i));
+      evens |= (Word)scramble_tables.even[byte] << (4 * i);
+      odds |= (Word)scramble_tables.odd[byte] << (4 * i);
+    }
+    out |= evens | (odds << half_width);
+  }
+
+  return out;
+}
+
+template <typename Word>
+static Word word_subst_perm_enc(Word in, Word key, uint32_t bit_width,
+                                uint32_t num_rounds) {
+  Word state = in;
+
+  for (uint32_t i = 0; i < num_rounds; ++i) {
+    state ^= key;
+
+    state = word_sbox_layer(state, bit_width, false);
+    state = word_flip_layer(state, bit_width);
+    state = word_perm_layer(state, bit_width, false);
+  }
+
+  return state ^ key;
+}
+
+template <typename Word>
+static Word word_subst_perm_dec(Word in, Word key, uint32_t bit_width,
+                                uint32_t num_rounds) {
+  Word state = in;
+
+  for (uint32_t i = 0; i < num_rounds; ++i) {
+    state ^= key;
+
+    state = word_perm_layer(state, bit_width, true);
+    state = word_flip_layer(state, bit_width);
+    state = word_sbox_layer(state, bit_width, true);
+  }
+
+  return state ^ key;
+}
+
+template <typename Word>
+static void word_subst_perm_bits(const std::vector<uint8_t> &in,
+                                 const std::vector<uint8_t> *key,
+                                 uint32_t key_pos, std::vector<uint8_t> &out,
+                                 uint32_t bit_pos, uint32_t bit_width,
+                                 uint32_t num_rounds, bool enc) {
+  Word state = read_vector_word<Word>(in, bit_pos, bit_width);
+  Word key_word = key ? read_vector_word<Word>(*key, key_pos, bit_width) : 0;
+  state = enc ? word_subst_perm_enc(state, key_word, bit_width, num_rounds)
+              : word_subst_perm_dec(state, key_word, bit_width, num_rounds);
+  or_vector_word(out, bit_pos, bit_width, state);
+}
+
+// Apply the substitution/permutation rounds to the `bit_width` bits of `in`
+// starting at bit `bit_pos` and OR the result into `out` at the same position,
+// using the word-level layers. The key is the `bit_width` bits of `key`
+// starting at bit `key_pos`, or zero if `key` is null. Returns false (having
+// done nothing) if bit_width is too wide for the word-level layers.
+static bool subst_perm_bits(const std::vector<uint8_t> &in,
+                            const std::vector<uint8_t> *key, uint32_t key_pos,
+                            std::vector<uint8_t> &out, uint32_t bit_pos,
+                            uint32_t bit_width, uint32_t num_rounds,
+                            bool enc) {
+  if (bit_width <= 64) {
+    word_subst_perm_bits<uint64_t>(in, key, key_pos, out, bit_pos, bit_width,
+                                   num_rounds, enc);
+    return true;
+  }
+#ifdef __SIZEOF_INT128__
+  if (bit_width <= 128) {
+    word_subst_perm_bits<unsigned __int128>(in, key, key_pos, out, bit_pos,
+                                            bit_width, num_rounds, enc);
+    return true;
+  }
+#endif
+  return false;
+}
+
 // Apply a full set of subsitution/permutation rounds for encrypt to the
 // incoming byte vector
 static std::vector<uint8_t> scramble_subst_perm_enc(
@@ -197,57 +411,48 @@ static std::vector<uint8_t> scramble_gen_keystream(
     num_repetitions = 1;
   }
 
-  std::vector<uint8_t> keystream;
+  // The PRINCE C reference model takes K0 from the top 64 bits of the key and
+  // K1 from the bottom 64 bits.
+  uint64_t key_k0 = read_vector_word<uint64_t>(key, kPrinceWidth, kPrinceWidth);
+  uint64_t key_k1 = read_vector_word<uint64_t>(key, 0, kPrinceWidth);
 
+  // The bottom addr_width bits of the initial vector (the data for PRINCE to
+  // encrypt) are the address and the other bits are taken from the nonce.
+  // Each PRINCE instantiation will use different nonce bits.
+  uint32_t iv_addr_width = std::min(addr_width, kPrinceWidth);
+  uint32_t iv_nonce_width = kPrinceWidth - iv_addr_width;
+  uint64_t iv_addr =
+      iv_addr_width ? read_vector_word<uint64_t>(addr, 0, iv_addr_width) : 0;
+
+  // Total keystream bits generated are some multiple of kPrinceWidth. This can
+  // result in unused keystream bits, which are dropped.
+  uint32_t keystream_bytes = (keystream_width + 7) / 8;
+  std::vector<uint8_t> keystream(keystream_bytes, 0);
+
+  std::vector<uint64_t> blocks(num_princes);
   for (uint32_t i = 0; i < num_princes; ++i) {
-    // Initial vector is data for PRINCE to encrypt. Formed from nonce and data
-    // address
-    std::vector<uint8_t> iv(8, 0);
-
-    for (uint32_t j = 0; j < kPrinceWidth; ++j) {
-      if (j < addr_width) {
-        // Bottom addr_width bits of IV are address
-        or_vector_bit(iv, j, read_vector_bit(addr, j));
-      } else {
-        // Other bits are taken from nonce. Each PRINCE instantiation will use
-        // different nonce bits.
-        int nonce_bit = (j - addr_width) + i * (kPrinceWidth - addr_width);
-        or_vector_bit(iv, j, read_vector_bit(nonce, nonce_bit));
-      }
+    blocks[i] = iv_addr;
+    if (iv_nonce_width) {
+      blocks[i] |= read_vector_word<uint64_t>(nonce, i * iv_nonce_width,
+                                              iv_nonce_width)
+                   << iv_addr_width;
     }
+  }
 
-    // PRINCE C reference model works on big-endian byte order
-    iv = byte_reverse_vector(iv);
-    auto key_be = byte_reverse_vector(key);
-
-    // Apply PRINCE to IV to produce keystream
-    std::vector<uint8_t> keystream_block(kPrinceWidthByte);
-    prince_enc_dec(&iv[0], &key_be[0], &keystream_block[0], 0, num_half_rounds,
-                   0);
+  // Apply PRINCE to the IVs to produce keystream
+  prince_enc_dec_uint64_batch(&blocks[0], &blocks[0], num_princes, key_k0,
+                              key_k1, 0, num_half_rounds, 0);
 
-    // Flip keystream into little endian order and add to keystream vector
-    keystream_block = byte_reverse_vector(keystream_block);
+  for (uint32_t i = 0; i < num_princes; ++i) {
     // Repeat the output of a single PRINCE instance if needed
     for (uint32_t k = 0; k < num_repetitions; ++k) {
-      keystream.insert(keystream.end(), keystream_block.begin(),
-                       keystream_block.end());
+      uint32_t block_pos = (i * num_repetitions + k) * kPrinceWidth;
+      uint32_t block_width =
+          std::min(kPrinceWidth, keystream_width - block_pos);
+      or_vector_word(keystream, block_pos, block_width, blocks[i]);
     }
   }
 
-  // Total keystream bits generated are some multiple of kPrinceWidth. This can
-  // result in unused keystream bits. Remove the unused bytes from the keystream
-  // vector and zero out top unused bits in the final byte if required.
-  uint32_t keystream_bytes = (keystream_width + 7) / 8;
-  uint32_t keystream_bytes_to_erase = keystream.size() - keystream_bytes;
-  if (keystream_bytes_to_erase) {
-    keystream.erase(keystream.end() - keystream_bytes_to_erase,
-                    keystream.end());
-  }
-
-  if (keystream_width % 8) {
-    keystream[keystream.size() - 1] &= (1 << (keystream_width % 8)) - 1;
-  }
-
   return keystream;
 }
 
@@ -265,7 +470,6 @@ static std::vector<uint8_t> scramble_subst_perm_full_width(
       (bit_width + subst_perm_width - 1) / subst_perm_width;
 
   std::vector<uint8_t> out(in.size(), 0);
-  std::vector<uint8_t> zero_key(subst_perm_bytes, 0);
 
   auto sp_scrambler = enc ? scramble_subst_perm_enc : scramble_subst_perm_dec;
 
@@ -275,7 +479,15 @@ static std::vector<uint8_t> scramble_subst_perm_full_width(
     uint32_t bits_so_far = subst_perm_width * i;
     uint32_t block_width = std::min(subst_perm_width, bit_width - bits_so_far);
 
+    if (subst_perm_bits(in, nullptr, 0, out, bits_so_far, block_width,
+                        kNumDataSubstPermRounds, enc)) {
+      continue;
+    }
+
+    // Otherwise the block is too wide for the word-level layers: use the byte
+    // vector ones.
     std::vector<uint8_t> subst_perm_data(subst_perm_bytes, 0);
+    std::vector<uint8_t> zero_key(subst_perm_bytes, 0);
 
     // Extract bits from in for this chunk
     for (uint32_t j = 0; j < block_width; ++j) {
@@ -303,10 +515,16 @@ std::vector<uint8_t> scramble_addr(const std::vector<uint8_t> &addr_in,
                                    uint32_t nonce_width) {
   assert(addr_in.size() == ((addr_width + 7) / 8));
 
-  std::vector<uint8_t> addr_enc_nonce(addr_in.size(), 0);
-
   // Address is scrambled by using substitution/permutation layer with the nonce
   // used as a key.
+  std::vector<uint8_t> addr_out(addr_in.size(), 0);
+  if (subst_perm_bits(addr_in, &nonce, nonce_width - addr_width, addr_out, 0,
+                      addr_width, kNumAddrSubstPermRounds, true)) {
+    return addr_out;
+  }
+
+  std::vector<uint8_t> addr_enc_nonce(addr_in.size(), 0);
+
   // Extract relevant nonce bits for key
   for (uint32_t i = 0; i < addr_width; ++i) {
     or_vector_bit(addr_enc_nonce, i,